@@ -1,640 +1,1727 @@
-/*
- * @file reclaims.cpp
- * @brief This file contains functions for managing and drawing reclaim areas on a price chart using Sierra Chart's custom study interface.
- *
- * The functions include:
- * - Drawing and updating reclaim rectangles
- * - Handling memory management for reclaim data
- * - Managing reclaim state across multiple bars
- *
- * @author dream_without
- * @date 2024-09-01
- *
- * @license MIT License
- * 
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- * 
- * The above copyright notice and this permission notice shall be included in all
- * copies or substantial portions of the Software.
- * 
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
- * SOFTWARE.
- */
-
-
-#include "sierrachart.h"
-
-SCDLLName("FatCat Reclaims");
-
-/**
- * @struct Reclaim
- * @brief Represents a reclaim
- *
- * This structure holds information about a specific rectangle on a financial chart,
- * including pricing on fixed and active sides, the start date, and additional metadata.
- */
-struct Reclaim
-{
-	/**
-	 * @brief Price on the fixed side of the rectangle.
-	 *
-	 * This is the price that remains constant along one side of the rectangle.
-	 */
-	float FixedSidePrice;
-
-	/**
-	 * @brief Price on the active side of the rectangle.
-	 *
-	 * This is the price that may vary or move during the period the rectangle is active.
-	 */
-	float ActiveSidePrice;
-
-	/**
-	 * @brief The maximum height in ticks that the reclaims got to be during its existance
-	 *
-	 * when the current rectangle height is smaller than MaxHeight by a certain number of ticks, 
-	 * a new reclaim should be created.
-	 */
-	int MaxHeight;
-
-	/**
-	 * @brief The current height in ticks of the reclaim
-	 *
-	 * This is calcuated as abs(ActiveSidePrice-FixedSidePrice)
-	 */
-	int CurrentHeight;
-
-	/**
-	 * @brief The maximum retracement (How many ticks smaller the reclaim got from the MaxHeight)
-	 *
-	 */
-	int MaxRetracement;
-
-	/**
-	 * @brief The start date and time when the rectangle is created.
-	 *
-	 * Represents the left anchor of the rectangle
-	 */
-	SCDateTime StartDate;
-
-	/**
-	 * @brief The line number associated with the rectangle.
-	 *
-	 * This is the sierra chart LineNumber of the rectangle drawing that corresplonds to the reclaim
-	 */
-	int LineNumber;
-
-	/**
-	 * @brief Flag indicating if the rectangle has been deleted.
-	 *
-	 * When set to `true`, the rectangle is considered deleted and should no longer be displayed.
-	 */
-	bool Deleted;
-
-	/**
-	 * @brief Type of the reclaim.
-	 *
-	 * Defines the type of reclaim:
-	 * - `0`: Bullish reclaim
-	 * - `1`: Bearish reclaim
-	 */
-	int Type;
-};
-
-/**
- * @brief Checks for price overlap in the last specified number of bars.
- *
- * This function determines whether there is an overlap in the price range
- * of the last `numberOfBars` bars on a chart. An overlap occurs when each
- * bar's price range (high to low) overlaps with the previous ones.
- *
- * @param sc A reference to the study interface, providing access to chart data.
- * @param numberOfBars The number of bars to check for price overlap.
- * @return `true` if there is an overlap in the price ranges of the last `numberOfBars` bars, otherwise `false`.
- */
-bool CheckPriceOverlap(SCStudyInterfaceRef sc, int numberOfBars)
-{
-	// Ensure there are enough bars to check
-	if (sc.ArraySize < numberOfBars)
-		return false;
-
-	// Initialize variables for high and low price ranges
-	float lastHigh = sc.High[sc.ArraySize - 1];
-	float lastLow = sc.Low[sc.ArraySize - 1];
-
-	// Iterate through the last `numberOfBars` bars
-	bool isOverlap = true;
-	for (int i = 1; i < numberOfBars; ++i)
-	{
-		// Retrieve the high and low prices of the current bar
-		float high = sc.High[sc.ArraySize - 1 - i];
-		float low = sc.Low[sc.ArraySize - 1 - i];
-
-		// Update the maximum high and minimum low
-		if (low >= lastHigh || high <= lastLow)
-		{
-			isOverlap = false;
-			break;
-		}
-	}
-
-	return isOverlap;
-}
-
-/**
- * @brief Draws or updates a rectangle on the chart to represent a reclaim area.
- *
- * This function either draws a new rectangle or updates an existing one on the chart
- * based on the provided reclaim data.
- *
- * @param sc A reference to the study interface, providing access to chart data and tools.
- * @param reclaim A reference to the `Reclaim` structure containing the data needed to draw the rectangle.
- * @param createNew A boolean flag indicating whether to create a new rectangle (`true`) or update an existing one (`false`).
- *                  - `true`: A new rectangle is drawn, and a new line number is assigned.
- *                  - `false`: The existing rectangle with the specified line number is updated.
- * @param reclaimIndex The index of the reclaim in the reclaims array. The reclaims with reclaimIndex==0 are drawn differently
- * @return The line number of the newly created rectangle, or `-1` if an existing rectangle was updated.
- */
-int DrawReclaim(SCStudyInterfaceRef sc, const Reclaim &reclaim, bool createNew = false, int reclaimIndex=0)
-{
-	// Draw the initial rectangle
-	s_UseTool RectangleTool;
-	RectangleTool.Clear(); // Initialize the Tool structure
-
-	RectangleTool.ChartNumber = sc.ChartNumber;
-	RectangleTool.DrawingType = DRAWING_RECTANGLEHIGHLIGHT;
-	RectangleTool.AddAsUserDrawnDrawing = 0;
-	RectangleTool.Region = 0;
-
-	// Define the rectangle coordinates
-	RectangleTool.BeginDateTime = reclaim.StartDate;
-	RectangleTool.EndDateTime = sc.BaseDateTimeIn[sc.ArraySize + sc.Input[2].GetInt()];
-	RectangleTool.BeginValue = reclaim.FixedSidePrice;
-	RectangleTool.EndValue = reclaim.ActiveSidePrice;
-
-	// Set the rectangle color
-	if (reclaim.Type == 0)
-	{
-		if(reclaimIndex==0) {
-			// current reclaim
-			RectangleTool.Color = sc.Input[6].GetColor();
-			RectangleTool.SecondaryColor = sc.Input[6].GetColor();
-			RectangleTool.TransparencyLevel = sc.Input[9].GetInt();
-		} else {
-			// old reclaim
-			RectangleTool.Color = sc.Input[3].GetColor();
-			RectangleTool.SecondaryColor = sc.Input[3].GetColor();
-			RectangleTool.TransparencyLevel = sc.Input[8].GetInt();
-		}
-	}
-	else
-	{
-		if(reclaimIndex==0) {
-			// current reclaim
-			RectangleTool.Color = sc.Input[7].GetColor();
-			RectangleTool.SecondaryColor = sc.Input[7].GetColor();
-			RectangleTool.TransparencyLevel = sc.Input[9].GetInt();
-		} else {
-			// old reclaim
-			RectangleTool.Color = sc.Input[4].GetColor();
-			RectangleTool.SecondaryColor = sc.Input[4].GetColor();
-			RectangleTool.TransparencyLevel = sc.Input[8].GetInt();
-		}
-	}
-
-	if(reclaimIndex!=0 && int(abs(reclaim.ActiveSidePrice-reclaim.FixedSidePrice)/sc.TickSize)<=sc.Input[10].GetInt()) {
-		RectangleTool.TransparencyLevel = 100;
-	}
-
-
-	if (!createNew)
-	{
-		RectangleTool.LineNumber = reclaim.LineNumber;
-		sc.UseTool(RectangleTool);
-		// always return -1 when updating existing rectangle
-		return -1;
-	}
-	else
-	{
-		// Creating new rectangle. Allow sierra to choose a new LineNumber.
-		sc.UseTool(RectangleTool);
-		// return the LineNumber of the new rectangle
-		return RectangleTool.LineNumber;
-	}
-}
-
-/**
- * @brief Deletes a reclaim rectangle from the chart.
- *
- * This function removes a previously drawn rectangle from the chart, identified by the
- * `LineNumber` in the provided `Reclaim` structure.
- *
- * @param sc A reference to the study interface, providing access to chart data and tools.
- * @param reclaim A reference to the `Reclaim` structure that contains the line number of the rectangle to be deleted.
- */
-void DeleteReclaim(SCStudyInterfaceRef sc, const Reclaim &reclaim)
-{
-	sc.DeleteACSChartDrawing(sc.ChartNumber, TOOL_DELETE_CHARTDRAWING, reclaim.LineNumber);
-}
-
-/**
- * @brief Updates and manages the drawing of reclaim rectangles on the chart based on the current price.
- *
- * This function updates the reclaim areas on the chart by adjusting the `ActiveSidePrice` and `FixedSidePrice`
- * of both bullish (up) and bearish (down) reclaims. If a reclaim has been fully reclaimed (price crosses the
- * fixed side), the corresponding rectangle is deleted. Otherwise, the rectangle is updated or drawn with the
- * specified colors.
- *
- * @param sc A reference to the study interface, providing access to chart data and tools.
- * @param size The number of reclaim structures to update in the `upReclaims` and `downReclaims` arrays.
- * @param checkPreviousBar When true, uses the high and low of the previous bar instead of the CurrentPrice to update reclaims
- */
-void UpdateReclaims(SCStudyInterfaceRef sc, int size, bool checkPreviousBar=false)
-{
-	// get sierra chart persistent variables for up and down reclaims
-	Reclaim *upReclaims = (Reclaim *)sc.GetPersistentPointer(1);
-	Reclaim *downReclaims = (Reclaim *)sc.GetPersistentPointer(2);
-
-
-	// get current price
-	float CurrentPrice = sc.LastTradePrice;
-	//float CurrentHigh = max(sc.High[sc.Index], sc.High[sc.Index-1]);
-	//float CurrentLow = min(sc.Low[sc.Index], sc.Low[sc.Index-1]);
-	float CurrentHigh = CurrentPrice;
-	float CurrentLow = CurrentPrice;
-	//float CurrentClose = sc.Close[sc.Index-1];
-	float CurrentClose = sc.Close[sc.Index];
-
-	if(checkPreviousBar) {
-		CurrentHigh = sc.High[sc.Index-1];
-		CurrentLow = sc.Low[sc.Index-1];
-	}
-
-
-
-	// Loop all up reclaims and update them according to CurrentPrice
-	for (int i = 0; i < size; i++)
-	{
-		if (i == 0)
-		{
-			// update active side of first rectangle
-			upReclaims[i].ActiveSidePrice = CurrentHigh;
-
-			// update reclaim max height parameter if it got bigger
-			upReclaims[i].CurrentHeight = (int)((upReclaims[i].ActiveSidePrice-upReclaims[i].FixedSidePrice)/sc.TickSize);
-
-			int newMaxHeight = int((CurrentHigh-upReclaims[i].FixedSidePrice)/sc.TickSize);
-			if (newMaxHeight>upReclaims[i].MaxHeight) {
-				upReclaims[i].MaxHeight = newMaxHeight;
-			}
-
-			int newMaxRetracement = int((upReclaims[i].FixedSidePrice+upReclaims[i].MaxHeight*sc.TickSize-CurrentClose)/sc.TickSize);
-			if(newMaxRetracement>upReclaims[i].MaxRetracement) {
-				upReclaims[i].MaxRetracement = newMaxRetracement;
-			}
-
-			if (CurrentLow <= upReclaims[i].FixedSidePrice)
-			{
-				// update fixed side as well
-				upReclaims[i].FixedSidePrice = CurrentLow;
-				upReclaims[i].ActiveSidePrice = CurrentLow;
-				upReclaims[i].StartDate = sc.BaseDateTimeIn[sc.ArraySize - 1];
-				upReclaims[i].CurrentHeight = 0;
-				upReclaims[i].MaxHeight = 0;
-				upReclaims[i].MaxRetracement = 0;
-			}
-		}
-		else
-		{
-			if (CurrentLow < upReclaims[i].ActiveSidePrice)
-			{
-				upReclaims[i].ActiveSidePrice = max(CurrentLow, upReclaims[i].FixedSidePrice);
-			}
-
-			if (CurrentLow<=upReclaims[i].FixedSidePrice || upReclaims[i].ActiveSidePrice<=upReclaims[i].FixedSidePrice)
-			{
-				// delete drawing, the reclaim has been reclaimed
-				upReclaims[i].Deleted = true; // update struct in array
-				// delete drawing
-				DeleteReclaim(sc, upReclaims[i]);
-				continue;
-			}
-		}
-
-
-		DrawReclaim(sc, upReclaims[i], false, i);
-	}
-
-	// Loop all down reclaims and update them according to CurrentPrice
-	for (int i = 0; i < size; i++)
-	{
-
-		if (i == 0)
-		{
-
-			// update active side of first rectangle
-			downReclaims[i].ActiveSidePrice = CurrentLow;
-
-			downReclaims[i].CurrentHeight= (int)((downReclaims[i].FixedSidePrice-downReclaims[i].ActiveSidePrice)/sc.TickSize);
-
-			// update reclaim max height parameter if it got bigger
-			int newMaxHeight = int((downReclaims[i].FixedSidePrice-CurrentLow)/sc.TickSize);
-			if (newMaxHeight>downReclaims[i].MaxHeight) {
-				downReclaims[i].MaxHeight = newMaxHeight;
-			}
-
-			int newMaxRetracement = int((CurrentClose-(downReclaims[i].FixedSidePrice-downReclaims[i].MaxHeight*sc.TickSize))/sc.TickSize);
-			if(newMaxRetracement>downReclaims[i].MaxRetracement) {
-				downReclaims[i].MaxRetracement = newMaxRetracement;
-			}
-
-			if (CurrentHigh >= downReclaims[i].FixedSidePrice)
-			{
-				// update fixed side as well
-				downReclaims[i].FixedSidePrice = CurrentHigh;
-				downReclaims[i].StartDate = sc.BaseDateTimeIn[sc.ArraySize - 1];
-				downReclaims[i].CurrentHeight = 0;
-				downReclaims[i].MaxHeight = 0;
-				downReclaims[i].MaxRetracement = 0;
-			}
-		}
-		else
-		{
-			if (CurrentHigh > downReclaims[i].ActiveSidePrice)
-			{
-				downReclaims[i].ActiveSidePrice = min(CurrentHigh, downReclaims[i].FixedSidePrice);
-			}
-
-			if (CurrentHigh>=downReclaims[i].FixedSidePrice || downReclaims[i].ActiveSidePrice>=downReclaims[i].FixedSidePrice)
-			{
-				// delete drawing, the reclaim has been reclaimed
-				downReclaims[i].Deleted = true; // update struct in array
-				// delete drawing
-				DeleteReclaim(sc, downReclaims[i]);
-				continue;
-			}
-		}
-
-		DrawReclaim(sc, downReclaims[i], false, i);
-	}
-}
-
-/**
- * @brief A Sierra Chart study function that manages the drawing of reclaim rectangles on the chart.
- *
- * This function tracks price movements to identify and visualize "reclaim" areas on the chart.
- * The function handles the initialization, updating, and deletion of
- * these reclaim rectangles, as well as memory management.
- *
- * @param sc A reference to the study interface, providing access to chart data, user inputs,
- *           and drawing tools.
- */
-SCSFExport scsf_Reclaims(SCStudyInterfaceRef sc)
-{
-	// user inputs
-	SCInputRef MaxNumberOfReclaims = sc.Input[0];	   // length of the p_UpReclaims and p_DownReclaims arrays
-	SCInputRef NewReclaimThreshold = sc.Input[1];	   // Minimum size in ticks that an existing reclaim must be to start creating new ones (if there is enough bar overlap)
-	SCInputRef RectangleExtendBars = sc.Input[2];	   // How many bars the rectangles should extend to the right
-	SCInputRef UpReclaimsColor = sc.Input[3];		   // color of bullish reclaims
-	SCInputRef DownReclaimsColor = sc.Input[4];		   // color of bearish reclaims
-	SCInputRef UpdateOnBarClose = sc.Input[5];		   // When true, only update reclaims on bar close
-	SCInputRef UpCurrentReclaimColor = sc.Input[6];		// Color of the most recent bullish reclaim
-	SCInputRef DownCurrentReclaimColor = sc.Input[7];		// Color of the most recent bearish reclaim
-	SCInputRef OldReclaimsTransparency = sc.Input[8];		// Transparency of old reclaims from 0 (opaque) to 100 (transparent)
-	SCInputRef CurrentReclaimsTransparency = sc.Input[9];		// Transparency of current reclaims from 0 (opaque) to 100 (transparent)
-	SCInputRef MinReclaimSize = sc.Input[10];		// Display the reclaim being build when set to true
-
-
-	// Persistent variables to store the previous price (required to only update reclaims if price has changed)
-	float &PreviousPrice = sc.GetPersistentFloat(0);
-
-	// Persistent pointers to up and down Reclaims
-	Reclaim *p_UpReclaims = (Reclaim *)sc.GetPersistentPointer(1);
-	Reclaim *p_DownReclaims = (Reclaim *)sc.GetPersistentPointer(2);
-	int &lastIndex = sc.GetPersistentInt(3); 
-
-	// Set default study properties
-	if (sc.SetDefaults)
-	{
-
-		sc.GraphName = "FatCat reclaims";
-		sc.StudyDescription = "Draws reclaims on the chart";
-		sc.GraphRegion = 0;
-
-		// Inputs default values
-		MaxNumberOfReclaims.Name = "Max active reclaims";
-		MaxNumberOfReclaims.SetInt(100);			  
-		MaxNumberOfReclaims.SetIntLimits(1, 1000); 
-
-		// Inputs default values
-		NewReclaimThreshold.Name = "Threshold tick size";
-		NewReclaimThreshold.SetInt(2); 
-		NewReclaimThreshold.SetIntLimits(1,1000);
-
-		// Inputs default values
-		RectangleExtendBars.Name = "Extend right amount";
-		RectangleExtendBars.SetInt(10000); // Default to 10 bars extension
-        RectangleExtendBars.SetIntLimits(0, 10000); // Allow extension to a maximum of 500 bars
-
-		UpReclaimsColor.Name = "Existing bullish reclaims color";
-		UpReclaimsColor.SetColor(RGB(0, 100, 255)); 
-
-		DownReclaimsColor.Name = "Existing bearish reclaims color";
-		DownReclaimsColor.SetColor(RGB(255, 100, 0)); 
-
-		UpdateOnBarClose.Name = "Only update on bar close";
-		UpdateOnBarClose.SetYesNo(0); 
-
-		UpCurrentReclaimColor.Name="Current bullish reclaim color";		
-		UpCurrentReclaimColor.SetColor(RGB(0, 100, 255)); 
-
-		DownCurrentReclaimColor.Name="Current bearish reclaim color";		
-		DownCurrentReclaimColor.SetColor(RGB(255, 100, 0)); 
-
-		OldReclaimsTransparency.Name="Transparency of existing reclaims"; 
-		OldReclaimsTransparency.SetInt(70); 
-        OldReclaimsTransparency.SetIntLimits(0, 100); 
-
-		CurrentReclaimsTransparency.Name="Transparency of current reclaims"; 
-		CurrentReclaimsTransparency.SetInt(70); 
-        CurrentReclaimsTransparency.SetIntLimits(0, 100); 
-
-		MinReclaimSize.Name = "Hide reclaims smaller than (ticks)";
-		MinReclaimSize.SetInt(2); 
-        MinReclaimSize.SetIntLimits(0, 10000); 
-
-		return;
-	}
-
-	// Get the current price
-
-	// Initialize stuff on the first run
-	if (sc.Index == 0)
-	{
-		PreviousPrice = sc.LastTradePrice;
-
-		if (p_UpReclaims == NULL)
-		{
-			// Allocate array for up reclaims.
-			p_UpReclaims = (Reclaim *)sc.AllocateMemory(MaxNumberOfReclaims.GetInt() * sizeof(Reclaim));
-
-			// inizialize default values for Deleted and Type fields
-			for (int i = 0; i < MaxNumberOfReclaims.GetInt(); i++)
-			{
-				p_UpReclaims[i].Deleted = true;
-				p_UpReclaims[i].Type = 0;
-				p_UpReclaims[i].CurrentHeight= 0;
-				p_UpReclaims[i].MaxHeight = 0;
-				p_UpReclaims[i].MaxRetracement = 0;
-			}
-
-			// initialize values for first reclaim
-			p_UpReclaims[0].FixedSidePrice = sc.LastTradePrice;
-			p_UpReclaims[0].ActiveSidePrice = sc.LastTradePrice;
-			p_UpReclaims[0].StartDate = sc.BaseDateTimeIn[sc.ArraySize - 1];
-			p_UpReclaims[0].Deleted = false;
-
-			// store array in the persistent variable
-			if (p_UpReclaims != NULL)
-			{
-				sc.SetPersistentPointer(1, p_UpReclaims);
-			}
-
-			// draw first reclaim and store the sierra chart linenumber
-			p_UpReclaims[0].LineNumber = DrawReclaim(sc, p_UpReclaims[0], true, 0);
-		}
-
-		if (p_DownReclaims == NULL)
-		{
-			// Allocate array for down reclaims.
-			p_DownReclaims = (Reclaim *)sc.AllocateMemory(MaxNumberOfReclaims.GetInt() * sizeof(Reclaim));
-
-			// inizialize default values for Deleted and Type fields
-			for (int i = 0; i < MaxNumberOfReclaims.GetInt(); i++)
-			{
-				p_DownReclaims[i].Deleted = true;
-				p_DownReclaims[i].Type = 1;
-				p_DownReclaims[i].CurrentHeight = 0;
-				p_DownReclaims[i].MaxHeight = 0;
-				p_DownReclaims[i].MaxRetracement = 0;
-			}
-
-			// initialize values for first reclaim
-			p_DownReclaims[0].FixedSidePrice = sc.LastTradePrice;
-			p_DownReclaims[0].ActiveSidePrice = sc.LastTradePrice;
-			p_DownReclaims[0].StartDate = sc.BaseDateTimeIn[sc.ArraySize - 1];
-			p_DownReclaims[0].Deleted = false;
-
-			// store array in the persistent variable
-			if (p_DownReclaims != NULL)
-			{
-				sc.SetPersistentPointer(2, p_DownReclaims);
-			}
-
-			// draw first reclaim and store the sierra chart linenumber
-			p_DownReclaims[0].LineNumber = DrawReclaim(sc, p_DownReclaims[0], true, 0);
-		}
-
-		return;
-	}
-
-	if(!UpdateOnBarClose.GetYesNo()) {
-		// update existing reclaims using currentPrice
-		UpdateReclaims(sc, MaxNumberOfReclaims.GetInt(), false);
-	}
-
-	// return if no new bar has formed 
-	if (lastIndex == sc.Index) { 
-        return; 
-    } 
-
-	// from this point on code is only executed once per bar
-
-    lastIndex = sc.Index; 
-
-	// If the price has changed, update stuff
-	// store new value for PreviousPrice
-	PreviousPrice = sc.LastTradePrice;
-
-	// Check if we need to create a new bullish reclaim
-	if (p_UpReclaims[0].MaxRetracement >= NewReclaimThreshold.GetInt())
-	{
-
-		// delete rectangle that corresponds to the last array element
-		DeleteReclaim(sc, p_UpReclaims[MaxNumberOfReclaims.GetInt() - 1]);
-
-		// Shift elements of the array to the right
-		for (int i = MaxNumberOfReclaims.GetInt() - 1; i > 0; --i)
-		{
-			p_UpReclaims[i] = p_UpReclaims[i - 1];
-		}
-
-		// first member of the array is now the new reclaim, so update its values
-		p_UpReclaims[0].FixedSidePrice = sc.LastTradePrice;
-		p_UpReclaims[0].ActiveSidePrice = p_UpReclaims[0].FixedSidePrice;
-		p_UpReclaims[0].StartDate = sc.BaseDateTimeIn[sc.ArraySize - 1];
-		p_UpReclaims[0].MaxHeight = 0;
-		p_UpReclaims[0].CurrentHeight = 0;
-		p_UpReclaims[0].MaxRetracement = 0;
-		p_UpReclaims[0].Deleted = false;
-
-		// draw the new rectangle and store the sierra LineNumber
-		p_UpReclaims[0].LineNumber = DrawReclaim(sc, p_UpReclaims[0], true, 0);
-	}
-
-	// Check if we need to create a new bearish reclaim
-	if (p_DownReclaims[0].MaxRetracement >= NewReclaimThreshold.GetInt())
-	{
-		// delete rectangle that corresponds to the last array element
-		DeleteReclaim(sc,p_DownReclaims[MaxNumberOfReclaims.GetInt() - 1]);
-
-		// Shift elements of the array to the right
-		for (int i = MaxNumberOfReclaims.GetInt() - 1; i > 0; --i)
-		{
-			p_DownReclaims[i] = p_DownReclaims[i - 1];
-		}
-
-		// first member of the array is now the new reclaim, so update its values
-		p_DownReclaims[0].FixedSidePrice = sc.LastTradePrice;
-		p_DownReclaims[0].ActiveSidePrice = p_DownReclaims[0].FixedSidePrice;
-		p_DownReclaims[0].StartDate = sc.BaseDateTimeIn[sc.ArraySize - 1];
-		p_DownReclaims[0].MaxHeight = 0;
-		p_DownReclaims[0].CurrentHeight = 0;
-		p_DownReclaims[0].MaxRetracement = 0;
-		p_DownReclaims[0].Deleted = false;
-
-		// draw the new rectangle and store the sierra LineNumber
-		p_DownReclaims[0].LineNumber = DrawReclaim(sc, p_DownReclaims[0], true, 0);
-	}
-
-	// update existing reclaims
-	UpdateReclaims(sc, MaxNumberOfReclaims.GetInt(), true);
-
-	// Memory management: Deallocate when the study is unloaded
-	if (sc.LastCallToFunction)
-	{
-		// clear memory for bullish reclaims
-		if (p_UpReclaims != NULL)
-		{
-			sc.FreeMemory(p_UpReclaims);
-			sc.SetPersistentPointer(1, NULL);
-		}
-
-		// clear memory for bearish reclaims
-		if (p_DownReclaims != NULL)
-		{
-			sc.FreeMemory(p_DownReclaims);
-			sc.SetPersistentPointer(2, NULL);
-		}
-	}
-}
+/*
+ * @file reclaims.cpp
+ * @brief This file contains functions for managing and drawing reclaim areas on a price chart using Sierra Chart's custom study interface.
+ *
+ * The functions include:
+ * - Drawing and updating reclaim rectangles
+ * - Handling memory management for reclaim data
+ * - Managing reclaim state across multiple bars
+ *
+ * @author dream_without
+ * @date 2024-09-01
+ *
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifdef _WIN32
+// winsock2.h must come before windows.h, which sierrachart.h includes, see reclaims_stream.h
+#include <winsock2.h>
+#endif
+
+#include "sierrachart.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "reclaims_engine.h"
+#include "reclaims_hierarchy.h"
+#include "reclaims_query.h"
+#include "reclaims_scid.h"
+#include "reclaims_shared.h"
+#include "reclaims_shm.h"
+#include "reclaims_stats.h"
+#include "reclaims_stream.h"
+#include "reclaims_trace.h"
+
+SCDLLName("FatCat Reclaims");
+
+/**
+ * @brief Checks for price overlap in the last specified number of bars.
+ *
+ * This function determines whether there is an overlap in the price range
+ * of the last `numberOfBars` bars on a chart. An overlap occurs when each
+ * bar's price range (high to low) overlaps with the previous ones.
+ *
+ * @param sc A reference to the study interface, providing access to chart data.
+ * @param numberOfBars The number of bars to check for price overlap.
+ * @return `true` if there is an overlap in the price ranges of the last `numberOfBars` bars, otherwise `false`.
+ */
+bool CheckPriceOverlap(SCStudyInterfaceRef sc, int numberOfBars)
+{
+	// Ensure there are enough bars to check
+	if (sc.ArraySize < numberOfBars)
+		return false;
+
+	// Initialize variables for high and low price ranges
+	float lastHigh = sc.High[sc.ArraySize - 1];
+	float lastLow = sc.Low[sc.ArraySize - 1];
+
+	// Iterate through the last `numberOfBars` bars
+	bool isOverlap = true;
+	for (int i = 1; i < numberOfBars; ++i)
+	{
+		// Retrieve the high and low prices of the current bar
+		float high = sc.High[sc.ArraySize - 1 - i];
+		float low = sc.Low[sc.ArraySize - 1 - i];
+
+		// Update the maximum high and minimum low
+		if (low >= lastHigh || high <= lastLow)
+		{
+			isOverlap = false;
+			break;
+		}
+	}
+
+	return isOverlap;
+}
+
+/**
+ * @brief Draws or updates a rectangle on the chart to represent a reclaim area.
+ *
+ * This function either draws a new rectangle or updates an existing one on the chart
+ * based on the provided reclaim data.
+ *
+ * @param sc A reference to the study interface, providing access to chart data and tools.
+ * @param reclaim A reference to the `Reclaim` structure containing the data needed to draw the rectangle.
+ * @param createNew A boolean flag indicating whether to create a new rectangle (`true`) or update an existing one (`false`).
+ *                  - `true`: A new rectangle is drawn, and a new line number is assigned.
+ *                  - `false`: The existing rectangle with the specified line number is updated.
+ * @param reclaimIndex The index of the reclaim in the reclaims array. The reclaims with reclaimIndex==0 are drawn differently
+ * @param level `0` for the reclaims of the study threshold, `1` for intermediate and `2` for major reclaims.
+ * @return The line number of the newly created rectangle, or `-1` if an existing rectangle was updated.
+ */
+int DrawReclaim(SCStudyInterfaceRef sc, const Reclaim &reclaim, bool createNew = false, int reclaimIndex=0, int level=0)
+{
+	// Draw the initial rectangle
+	s_UseTool RectangleTool;
+	RectangleTool.Clear(); // Initialize the Tool structure
+
+	RectangleTool.ChartNumber = sc.ChartNumber;
+	RectangleTool.DrawingType = DRAWING_RECTANGLEHIGHLIGHT;
+	RectangleTool.AddAsUserDrawnDrawing = 0;
+	RectangleTool.Region = 0;
+
+	// Define the rectangle coordinates
+	RectangleTool.BeginDateTime = SCDateTime(reclaim.StartDate);
+	RectangleTool.EndDateTime = sc.BaseDateTimeIn[sc.ArraySize + sc.Input[2].GetInt()];
+	RectangleTool.BeginValue = reclaim.FixedSidePrice;
+	RectangleTool.EndValue = reclaim.ActiveSidePrice;
+
+	// Set the rectangle color
+	if (level > 0)
+	{
+		// intermediate and major reclaims have one color per side
+		RectangleTool.Color = sc.Input[16 + 2 * level + reclaim.Type].GetColor();
+		RectangleTool.SecondaryColor = RectangleTool.Color;
+		RectangleTool.TransparencyLevel = sc.Input[21 + level].GetInt();
+	}
+	else if (reclaim.Type == 0)
+	{
+		if(reclaimIndex==0) {
+			// current reclaim
+			RectangleTool.Color = sc.Input[6].GetColor();
+			RectangleTool.SecondaryColor = sc.Input[6].GetColor();
+			RectangleTool.TransparencyLevel = sc.Input[9].GetInt();
+		} else {
+			// old reclaim
+			RectangleTool.Color = sc.Input[3].GetColor();
+			RectangleTool.SecondaryColor = sc.Input[3].GetColor();
+			RectangleTool.TransparencyLevel = sc.Input[8].GetInt();
+		}
+	}
+	else
+	{
+		if(reclaimIndex==0) {
+			// current reclaim
+			RectangleTool.Color = sc.Input[7].GetColor();
+			RectangleTool.SecondaryColor = sc.Input[7].GetColor();
+			RectangleTool.TransparencyLevel = sc.Input[9].GetInt();
+		} else {
+			// old reclaim
+			RectangleTool.Color = sc.Input[4].GetColor();
+			RectangleTool.SecondaryColor = sc.Input[4].GetColor();
+			RectangleTool.TransparencyLevel = sc.Input[8].GetInt();
+		}
+	}
+
+	if(reclaimIndex!=0 && int(abs(reclaim.ActiveSidePrice-reclaim.FixedSidePrice)/sc.TickSize)<=sc.Input[10].GetInt()) {
+		RectangleTool.TransparencyLevel = 100;
+	}
+
+
+	if (!createNew)
+	{
+		RectangleTool.LineNumber = reclaim.LineNumber;
+		sc.UseTool(RectangleTool);
+		// always return -1 when updating existing rectangle
+		return -1;
+	}
+	else
+	{
+		// Creating new rectangle. Allow sierra to choose a new LineNumber.
+		sc.UseTool(RectangleTool);
+		// return the LineNumber of the new rectangle
+		return RectangleTool.LineNumber;
+	}
+}
+
+/**
+ * @brief Deletes a reclaim rectangle from the chart.
+ *
+ * This function removes a previously drawn rectangle from the chart, identified by the
+ * `LineNumber` in the provided `Reclaim` structure.
+ *
+ * @param sc A reference to the study interface, providing access to chart data and tools.
+ * @param reclaim A reference to the `Reclaim` structure that contains the line number of the rectangle to be deleted.
+ */
+void DeleteReclaim(SCStudyInterfaceRef sc, const Reclaim &reclaim)
+{
+	sc.DeleteACSChartDrawing(sc.ChartNumber, TOOL_DELETE_CHARTDRAWING, reclaim.LineNumber);
+}
+
+/**
+ * @class ReclaimDrawBuffer
+ * @brief Records the drawing changes of one study call and draws them once at the end of the call.
+ *
+ * On a new bar the reclaims are updated with the last price, new ones are created and they are
+ * updated again with the previous bar, so the same rectangle would be drawn several times in one
+ * call. The commands are coalesced per reclaim: the last update wins, an update of a reclaim created
+ * in the same call is drawn as part of its creation, and a reclaim created and reclaimed in the same
+ * call is never drawn. `Flush` deletes first, then redraws the existing rectangles, then creates the
+ * new ones and stores their LineNumber in the engine, found by the reclaim id, and in the optional
+ * map from LineNumber to the handle of the reclaim.
+ */
+class ReclaimDrawBuffer
+{
+public:
+	/**
+	 * @param stats Optional statistics of the study, counts the drawing calls of `Flush`.
+	 * @param trace Optional trace of the study, `Flush` adds a "draw" span.
+	 * @param lineNumbers Optional map from the LineNumber of the rectangles of the study reclaims
+	 *        (level 0) to their handles, kept up to date by `Flush`.
+	 * @param stream Optional stream of the changes of the study reclaims (level 0), see `ChartReclaimListener`.
+	 */
+	ReclaimDrawBuffer(SCStudyInterfaceRef sc, ReclaimStats *stats = NULL, ReclaimTrace *trace = NULL, ReclaimLineNumberMap *lineNumbers = NULL,
+		ReclaimStreamServer *stream = NULL)
+		: m_sc(sc)
+		, p_Stats(stats)
+		, p_Trace(trace)
+		, p_LineNumbers(lineNumbers)
+		, p_Stream(stream)
+	{
+	}
+
+	~ReclaimDrawBuffer() { Flush(); }
+
+	/**
+	 * @brief Records the rectangle of a new reclaim of an engine.
+	 */
+	void Create(ReclaimEngine &engine, const Reclaim &reclaim, int reclaimIndex, int level)
+	{
+		Command &command = Find(engine, reclaim);
+		command.Kind = COMMAND_CREATE;
+		command.Snapshot = reclaim;
+		command.ReclaimIndex = reclaimIndex;
+		command.Level = level;
+	}
+
+	/**
+	 * @brief Records the redraw of a reclaim.
+	 */
+	void Update(ReclaimEngine &engine, const Reclaim &reclaim, int reclaimIndex, int level)
+	{
+		Command &command = Find(engine, reclaim);
+		if (command.Kind != COMMAND_CREATE)
+			command.Kind = COMMAND_UPDATE;
+		command.Snapshot = reclaim;
+		command.ReclaimIndex = reclaimIndex;
+		command.Level = level;
+	}
+
+	/**
+	 * @brief Records the deletion of the rectangle of a reclaimed or evicted reclaim.
+	 */
+	void Delete(ReclaimEngine &engine, const Reclaim &reclaim)
+	{
+		Command &command = Find(engine, reclaim);
+
+		// a rectangle that was never drawn has nothing to delete
+		command.Kind = command.Kind == COMMAND_CREATE ? COMMAND_NONE : COMMAND_DELETE;
+		command.Snapshot = reclaim;
+	}
+
+	/**
+	 * @brief Draws the recorded commands and clears them.
+	 */
+	void Flush()
+	{
+		if (m_Commands.empty())
+			return;
+
+		ReclaimTraceSpan drawSpan(p_Trace, "draw");
+
+		for (size_t i = 0; i < m_Commands.size(); i++)
+		{
+			if (m_Commands[i].Kind == COMMAND_DELETE)
+			{
+				DeleteReclaim(m_sc, m_Commands[i].Snapshot);
+				if (p_Stats != NULL)
+					p_Stats->Counters.DeleteCalls++;
+				if (p_LineNumbers != NULL && m_Commands[i].Level == 0)
+					p_LineNumbers->erase(m_Commands[i].Snapshot.LineNumber);
+			}
+		}
+
+		for (size_t i = 0; i < m_Commands.size(); i++)
+		{
+			const Command &command = m_Commands[i];
+			if (command.Kind == COMMAND_UPDATE)
+			{
+				DrawReclaim(m_sc, command.Snapshot, false, command.ReclaimIndex, command.Level);
+				if (p_Stats != NULL)
+					p_Stats->Counters.UseToolCalls++;
+			}
+		}
+
+		for (size_t i = 0; i < m_Commands.size(); i++)
+		{
+			const Command &command = m_Commands[i];
+			if (command.Kind != COMMAND_CREATE)
+				continue;
+
+			int lineNumber = DrawReclaim(m_sc, command.Snapshot, true, command.ReclaimIndex, command.Level);
+			if (p_Stats != NULL)
+				p_Stats->Counters.UseToolCalls++;
+			if (p_LineNumbers != NULL && command.Level == 0 && lineNumber > 0)
+				(*p_LineNumbers)[lineNumber] = command.Snapshot.Handle;
+
+			// the reclaim may have been shifted since it was created
+			Reclaim *reclaims = command.Snapshot.Type == 0 ? command.p_Engine->GetUpReclaims() : command.p_Engine->GetDownReclaims();
+			for (int j = 0; j < command.p_Engine->GetSize(); j++)
+			{
+				if (reclaims[j].Id == command.Snapshot.Id && !reclaims[j].Deleted)
+				{
+					reclaims[j].LineNumber = lineNumber;
+					break;
+				}
+			}
+		}
+
+		m_Commands.clear();
+		m_Index.clear();
+	}
+
+	ReclaimStats *GetStats() const { return p_Stats; }
+	ReclaimStreamServer *GetStream() const { return p_Stream; }
+
+private:
+	enum CommandKind
+	{
+		COMMAND_NONE,
+		COMMAND_CREATE,
+		COMMAND_UPDATE,
+		COMMAND_DELETE
+	};
+
+	struct Command
+	{
+		ReclaimEngine *p_Engine;
+		Reclaim Snapshot;
+		int ReclaimIndex;
+		int Level;
+		CommandKind Kind;
+	};
+
+	// the ids are unique per engine and side
+	typedef std::tuple<const ReclaimEngine *, int, int64_t> CommandKey;
+
+	/**
+	 * @brief Returns the command of a reclaim, added if it has none yet.
+	 */
+	Command &Find(ReclaimEngine &engine, const Reclaim &reclaim)
+	{
+		CommandKey key(&engine, reclaim.Type, reclaim.Id);
+		std::map<CommandKey, size_t>::iterator found = m_Index.find(key);
+		if (found != m_Index.end())
+			return m_Commands[found->second];
+
+		m_Index[key] = m_Commands.size();
+
+		Command command;
+		command.p_Engine = &engine;
+		command.Snapshot = reclaim;
+		command.ReclaimIndex = 0;
+		command.Level = 0;
+		command.Kind = COMMAND_NONE;
+		m_Commands.push_back(command);
+		return m_Commands.back();
+	}
+
+	SCStudyInterfaceRef m_sc;
+	ReclaimStats *p_Stats;
+	ReclaimTrace *p_Trace;
+	ReclaimLineNumberMap *p_LineNumbers;
+	ReclaimStreamServer *p_Stream;
+
+	std::vector<Command> m_Commands;
+	std::map<CommandKey, size_t> m_Index;
+};
+
+/**
+ * @class ChartReclaimListener
+ * @brief Records the changes reported by the reclaim engine in the drawing buffer of the call.
+ *
+ * The changes of the study reclaims are also sent to the stream of the drawing buffer, if it has one.
+ * They are not coalesced: subscribers see every change as it happens.
+ */
+class ChartReclaimListener : public ReclaimListener
+{
+public:
+	/**
+	 * @param engine Engine whose changes are reported, where `ReclaimDrawBuffer::Flush` stores the LineNumber of new reclaims.
+	 * @param level Level of the reclaims in the threshold hierarchy, see `DrawReclaim`.
+	 */
+	ChartReclaimListener(ReclaimDrawBuffer &drawBuffer, ReclaimEngine &engine, int level = 0)
+		: m_DrawBuffer(drawBuffer)
+		, m_Engine(engine)
+		, m_Level(level)
+		, p_Stats(drawBuffer.GetStats())
+		, p_Stream(level == 0 ? drawBuffer.GetStream() : NULL)
+	{
+	}
+
+	void OnReclaimCreated(Reclaim &reclaim)
+	{
+		if (p_Stats != NULL)
+			p_Stats->Counters.Created++;
+
+		m_DrawBuffer.Create(m_Engine, reclaim, 0, m_Level);
+		if (p_Stream != NULL)
+			p_Stream->OnReclaimCreated(reclaim);
+	}
+
+	void OnReclaimUpdated(const Reclaim &reclaim, int reclaimIndex)
+	{
+		m_DrawBuffer.Update(m_Engine, reclaim, reclaimIndex, m_Level);
+		if (p_Stream != NULL)
+			p_Stream->OnReclaimUpdated(reclaim, reclaimIndex);
+	}
+
+	void OnReclaimReclaimed(const Reclaim &reclaim)
+	{
+		if (p_Stats != NULL)
+			p_Stats->Counters.Reclaimed++;
+
+		m_DrawBuffer.Delete(m_Engine, reclaim);
+		if (p_Stream != NULL)
+			p_Stream->OnReclaimReclaimed(reclaim);
+	}
+
+	void OnReclaimEvicted(const Reclaim &reclaim)
+	{
+		if (p_Stats != NULL)
+			p_Stats->Counters.Evicted++;
+
+		m_DrawBuffer.Delete(m_Engine, reclaim);
+		if (p_Stream != NULL)
+			p_Stream->OnReclaimEvicted(reclaim);
+	}
+
+private:
+	ReclaimDrawBuffer &m_DrawBuffer;
+	ReclaimEngine &m_Engine;
+	int m_Level;
+	ReclaimStats *p_Stats;
+	ReclaimStreamServer *p_Stream;
+};
+
+/**
+ * @brief Updates the reclaims with the current price and records their drawing changes.
+ *
+ * If a reclaim has been fully reclaimed (price crosses the fixed side), the corresponding rectangle
+ * is deleted. Otherwise, the rectangle is updated or drawn with the specified colors.
+ *
+ * @param sc A reference to the study interface, providing access to chart data and tools.
+ * @param drawBuffer Drawing buffer of the call, see `ReclaimDrawBuffer`.
+ * @param engine The reclaim engine that holds the up and down reclaims.
+ * @param checkPreviousBar When true, uses the high and low of the previous bar instead of the CurrentPrice to update reclaims
+ * @param level Level of the reclaims in the threshold hierarchy, see `DrawReclaim`.
+ */
+void UpdateReclaims(SCStudyInterfaceRef sc, ReclaimDrawBuffer &drawBuffer, ReclaimEngine &engine, bool checkPreviousBar=false, int level=0)
+{
+	// get current price
+	float CurrentPrice = sc.LastTradePrice;
+	float CurrentHigh = CurrentPrice;
+	float CurrentLow = CurrentPrice;
+	float CurrentClose = sc.Close[sc.Index];
+
+	if(checkPreviousBar) {
+		CurrentHigh = sc.High[sc.Index-1];
+		CurrentLow = sc.Low[sc.Index-1];
+	}
+
+	// the trades since the last call reach the engine as this one price, or the range of the previous bar
+	if (level == 0 && drawBuffer.GetStats() != NULL)
+		drawBuffer.GetStats()->Counters.Ticks++;
+
+	ChartReclaimListener listener(drawBuffer, engine, level);
+	engine.UpdateReclaims(CurrentHigh, CurrentLow, CurrentClose, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &listener);
+}
+
+/**
+ * @brief Records every active reclaim of the engine as a new rectangle.
+ *
+ * Used after the engine was computed without drawing, for example from the .scid tick history.
+ *
+ * @param drawBuffer Drawing buffer of the call, see `ReclaimDrawBuffer`.
+ * @param engine The reclaim engine that holds the up and down reclaims.
+ * @param level Level of the reclaims in the threshold hierarchy, see `DrawReclaim`.
+ */
+void DrawAllReclaims(ReclaimDrawBuffer &drawBuffer, ReclaimEngine &engine, int level=0)
+{
+	Reclaim *upReclaims = engine.GetUpReclaims();
+	Reclaim *downReclaims = engine.GetDownReclaims();
+
+	for (int i = 0; i < engine.GetSize(); i++)
+	{
+		if (!upReclaims[i].Deleted)
+			drawBuffer.Create(engine, upReclaims[i], i, level);
+
+		if (!downReclaims[i].Deleted)
+			drawBuffer.Create(engine, downReclaims[i], i, level);
+	}
+}
+
+/**
+ * @brief Records the redraw of every active reclaim of the engine, so their rectangles extend to the new bar.
+ *
+ * `ReclaimEngine::UpdateReclaims` only reports the older reclaims that a new high or low reaches, the
+ * others keep the end date of their last redraw otherwise. Called once per bar, after the updates.
+ *
+ * @param drawBuffer Drawing buffer of the call, see `ReclaimDrawBuffer`.
+ * @param engine The reclaim engine that holds the up and down reclaims.
+ * @param level Level of the reclaims in the threshold hierarchy, see `DrawReclaim`.
+ */
+void ExtendReclaims(ReclaimDrawBuffer &drawBuffer, ReclaimEngine &engine, int level=0)
+{
+	Reclaim *upReclaims = engine.GetUpReclaims();
+	Reclaim *downReclaims = engine.GetDownReclaims();
+
+	for (int i = 0; i < engine.GetSize(); i++)
+	{
+		if (!upReclaims[i].Deleted)
+			drawBuffer.Update(engine, upReclaims[i], i, level);
+
+		if (!downReclaims[i].Deleted)
+			drawBuffer.Update(engine, downReclaims[i], i, level);
+	}
+}
+
+/**
+ * @brief Returns the thresholds of the intermediate and major reclaims that are enabled.
+ *
+ * The study threshold is the minor level, the other levels are only computed when their threshold is set.
+ */
+std::vector<int> GetLevelThresholds(SCStudyInterfaceRef sc)
+{
+	std::vector<int> thresholds;
+	for (int input = 16; input <= 17; input++)
+	{
+		if (sc.Input[input].GetInt() > 0)
+			thresholds.push_back(sc.Input[input].GetInt());
+	}
+	return thresholds;
+}
+
+/**
+ * @brief Returns the drawing level of a level of the threshold hierarchy, see `DrawReclaim`.
+ */
+int GetLevelStyle(SCStudyInterfaceRef sc, int level)
+{
+	// without an intermediate threshold the only level is the major one
+	return sc.Input[16].GetInt() > 0 ? level + 1 : level + 2;
+}
+
+/**
+ * @brief Returns the path of the .scid intraday data file of the chart symbol.
+ */
+SCString GetScidFilePath(SCStudyInterfaceRef sc)
+{
+	SCString path;
+	path.Format("%s\\%s.scid", sc.DataFilesFolder().GetChars(), sc.Symbol.GetChars());
+	return path;
+}
+
+/**
+ * @brief States of the tick history computation, stored in a persistent int.
+ */
+enum TickHistoryStates
+{
+	TICK_HISTORY_NONE = 0,      // history is computed from the chart bars
+	TICK_HISTORY_COMPUTING = 1, // the worker thread is computing the history from the .scid file
+	TICK_HISTORY_LOADED = 2     // the history was computed from the .scid file
+};
+
+/**
+ * @brief Writes the latency percentiles and the counters of the study to the message log.
+ *
+ * @param sc A reference to the study interface.
+ * @param stats Statistics of the study instance.
+ */
+void LogStatistics(SCStudyInterfaceRef sc, const ReclaimStats &stats)
+{
+	SCString name;
+	name.Format("FatCat reclaims %s chart %d", sc.Symbol.GetChars(), sc.ChartNumber);
+
+	std::vector<std::string> lines = stats.Format(name.GetChars());
+	for (size_t i = 0; i < lines.size(); i++)
+		sc.AddMessageToLog(lines[i].c_str(), 0);
+}
+
+/**
+ * @brief Stores the number of reclaims that cover the close of the current bar in the coverage subgraphs.
+ *
+ * @param sc A reference to the study interface, providing access to chart data.
+ * @param upCoverage Number of bullish reclaims that cover the close.
+ * @param downCoverage Number of bearish reclaims that cover the close.
+ */
+void SetCoverageAtClose(SCStudyInterfaceRef sc, int upCoverage, int downCoverage)
+{
+	sc.Subgraph[0][sc.Index] = (float)upCoverage;
+	sc.Subgraph[1][sc.Index] = (float)downCoverage;
+	sc.Subgraph[2][sc.Index] = (float)(upCoverage + downCoverage);
+}
+
+/**
+ * @class ReclaimHistoryWorker
+ * @brief Computes the reclaims of the chart history from the .scid file on a worker thread.
+ *
+ * Chart bars discard the order of the trades inside a bar, so the bar based calculation cannot
+ * reproduce what the study computes live. The worker memory maps the .scid file and feeds every
+ * recorded trade from the chart start date to its own engine, mapping each trade to the chart bar
+ * that contains it, while the chart thread stays responsive. Nothing is drawn by the worker.
+ *
+ * The intermediate and major reclaims are computed in the same pass, by a `ReclaimHierarchy` whose
+ * first level is the study threshold.
+ *
+ * The worker is owned by the study instance. When `IsDone` returns true the chart thread takes the
+ * engines with `Finish`, which also processes the trades recorded while the worker was running.
+ */
+class ReclaimHistoryWorker
+{
+public:
+	ReclaimHistoryWorker()
+		: m_Cancel(false)
+		, m_Done(false)
+		, m_TimeOffset(0)
+		, m_FirstRecord(0)
+		, m_NextRecord(0)
+		, m_BarIndex(-1)
+	{
+	}
+
+	~ReclaimHistoryWorker() { Cancel(); }
+
+	/**
+	 * @brief Opens the .scid file and starts computing the history on the worker thread.
+	 *
+	 * @param path Path of the .scid file.
+	 * @param engine The chart engine, whose level index and volume options the history engine copies.
+	 * @param settings Settings of the engine.
+	 * @param levelThresholds Thresholds of the intermediate and major reclaims, see `GetLevelThresholds`.
+	 * @param barStartTimes Start times of the chart bars in the chart time zone.
+	 * @param timeOffset Offset in days from UTC to the chart time zone.
+	 * @return `false` if the .scid file could not be read.
+	 */
+	bool Start(const char *path, const ReclaimEngine &engine, const ReclaimSettings &settings, const std::vector<int> &levelThresholds,
+		const std::vector<double> &barStartTimes, double timeOffset)
+	{
+		Cancel();
+
+		if (barStartTimes.empty() || !m_ScidFile.Open(path))
+			return false;
+
+		std::vector<int> thresholds(1, settings.NewReclaimThreshold);
+		thresholds.insert(thresholds.end(), levelThresholds.begin(), levelThresholds.end());
+
+		m_Levels.Reset(settings, thresholds.data(), (int)thresholds.size());
+		m_Levels.GetLevel(0).EnableLevelIndex(engine.IsLevelIndexEnabled());
+		m_Levels.GetLevel(0).EnableVolume(engine.IsVolumeEnabled());
+		m_BarStartTimes = barStartTimes;
+		m_TimeOffset = timeOffset;
+		m_NextRecord = m_ScidFile.FindFirstRecord(DateTimeToScidTime(barStartTimes[0] - timeOffset));
+		m_FirstRecord = m_NextRecord;
+		m_BarIndex = -1;
+		m_Cancel.store(false);
+		m_Done.store(false);
+
+		m_Thread = std::thread(&ReclaimHistoryWorker::Run, this);
+		return true;
+	}
+
+	/**
+	 * @brief Stops the worker thread and waits for it to exit.
+	 */
+	void Cancel()
+	{
+		m_Cancel.store(true);
+		if (m_Thread.joinable())
+			m_Thread.join();
+		m_ScidFile.Close();
+	}
+
+	/**
+	 * @brief Returns true when the worker thread has processed the history.
+	 */
+	bool IsDone() const { return m_Done.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Hands the computed reclaims over to the chart thread.
+	 *
+	 * Must only be called once `IsDone` returns true. The trades appended to the .scid file while the
+	 * worker was running are processed first, using the current chart bars, so live updates can
+	 * continue from the end of the file. The result is swapped into `engine` and `levels`.
+	 *
+	 * @param engine Receives the computed reclaims.
+	 * @param levels Receives the computed intermediate and major reclaims, reset with the thresholds passed to `Start`.
+	 * @param barStartTimes Current start times of the chart bars in the chart time zone.
+	 * @return The number of trades of the .scid file processed by the engine.
+	 */
+	int64_t Finish(ReclaimEngine &engine, ReclaimHierarchy &levels, const std::vector<double> &barStartTimes)
+	{
+		if (m_Thread.joinable())
+			m_Thread.join();
+
+		if (m_ScidFile.Refresh())
+		{
+			ChartBarClock clock(barStartTimes.data(), (int)barStartTimes.size());
+			clock.BarIndex = m_BarIndex;
+			ReplayScidRecords(m_Levels, m_ScidFile.GetRecords(), m_NextRecord, m_ScidFile.GetRecordCount(), clock, m_TimeOffset);
+			m_NextRecord = m_ScidFile.GetRecordCount();
+		}
+		m_ScidFile.Close();
+
+		// the coverage and the trace are options of the chart engine, not of the computed reclaims
+		bool coverage = engine.IsCoverageEnabled();
+		ReclaimTrace *trace = engine.GetTrace();
+		std::swap(engine, m_Levels.GetLevel(0));
+		engine.EnableCoverage(coverage);
+		engine.SetTrace(trace);
+
+		for (int level = 1; level < m_Levels.GetLevelCount() && level <= levels.GetLevelCount(); level++)
+			std::swap(levels.GetLevel(level - 1), m_Levels.GetLevel(level));
+
+		return m_NextRecord - m_FirstRecord;
+	}
+
+private:
+	void Run()
+	{
+		// process the records in chunks so a cancellation is noticed quickly
+		const int64_t chunkSize = 1 << 16;
+
+		ChartBarClock clock(m_BarStartTimes.data(), (int)m_BarStartTimes.size());
+		const ScidRecord *records = m_ScidFile.GetRecords();
+		int64_t recordCount = m_ScidFile.GetRecordCount();
+
+		while (m_NextRecord < recordCount && !m_Cancel.load(std::memory_order_relaxed))
+		{
+			int64_t end = std::min(m_NextRecord + chunkSize, recordCount);
+			ReplayScidRecords(m_Levels, records, m_NextRecord, end, clock, m_TimeOffset);
+			m_NextRecord = end;
+		}
+
+		m_BarIndex = clock.BarIndex;
+		m_Done.store(true, std::memory_order_release);
+	}
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Cancel;
+	std::atomic<bool> m_Done;
+
+	ScidFile m_ScidFile;
+	ReclaimHierarchy m_Levels;
+	std::vector<double> m_BarStartTimes;
+	double m_TimeOffset;
+
+	// first record inside the chart, and hand over point: first record and bar that were not processed by the worker thread
+	int64_t m_FirstRecord;
+	int64_t m_NextRecord;
+	int m_BarIndex;
+};
+
+/**
+ * @brief Returns the start times of the chart bars as SCDateTime values.
+ */
+std::vector<double> GetBarStartTimes(SCStudyInterfaceRef sc)
+{
+	std::vector<double> barStartTimes(sc.ArraySize);
+	for (int i = 0; i < sc.ArraySize; i++)
+		barStartTimes[i] = sc.BaseDateTimeIn[i].GetAsDouble();
+	return barStartTimes;
+}
+
+/**
+ * @brief Draws or removes the text that tells the history is being computed.
+ *
+ * @param sc A reference to the study interface, providing access to chart data and tools.
+ * @param lineNumber The LineNumber of the text drawing, 0 when it does not exist. Updated by the function.
+ * @param show `true` to draw the text, `false` to delete it.
+ */
+void DrawComputingState(SCStudyInterfaceRef sc, int &lineNumber, bool show)
+{
+	if (!show)
+	{
+		if (lineNumber != 0)
+			sc.DeleteACSChartDrawing(sc.ChartNumber, TOOL_DELETE_CHARTDRAWING, lineNumber);
+		lineNumber = 0;
+		return;
+	}
+
+	s_UseTool TextTool;
+	TextTool.Clear();
+
+	TextTool.ChartNumber = sc.ChartNumber;
+	TextTool.DrawingType = DRAWING_TEXT;
+	TextTool.AddAsUserDrawnDrawing = 0;
+	TextTool.Region = 0;
+	TextTool.UseRelativeVerticalValues = 1;
+	TextTool.BeginDateTime = sc.BaseDateTimeIn[sc.ArraySize - 1];
+	TextTool.BeginValue = 95;
+	TextTool.Color = sc.Input[6].GetColor();
+	TextTool.FontSize = 10;
+	TextTool.Text = "FatCat reclaims: computing history from tick data...";
+
+	if (lineNumber != 0)
+		TextTool.LineNumber = lineNumber;
+
+	sc.UseTool(TextTool);
+	lineNumber = TextTool.LineNumber;
+}
+
+/**
+ * @class SharedReclaimView
+ * @brief Draws the reclaims of a `SharedReclaimEngine` on one chart.
+ *
+ * The shared engine does not know the drawings of the charts that use it, so each view keeps its own
+ * map from reclaim id to LineNumber and diffs the reclaims every time the engine version changes.
+ */
+class SharedReclaimView
+{
+public:
+	SharedReclaimView()
+		: m_Engine(NULL)
+		, m_RenderedVersion(0)
+		, m_RenderedArraySize(0)
+	{
+	}
+
+	~SharedReclaimView()
+	{
+		if (m_Engine != NULL)
+			SharedReclaimRegistry::Release(m_Engine);
+	}
+
+	/**
+	 * @brief Starts drawing the shared engine of the chart symbol with the given settings.
+	 *
+	 * @param volume Whether the chart publishes or queries the volume of the reclaims.
+	 * @return `false` if the shared engine could not be started.
+	 */
+	bool Attach(SCStudyInterfaceRef sc, const ReclaimSettings &settings, int barPeriodSeconds, bool volume)
+	{
+		Detach(sc);
+
+		SCString path = GetScidFilePath(sc);
+		m_Engine = SharedReclaimRegistry::Acquire(sc.Symbol.GetChars(), path.GetChars(), settings, barPeriodSeconds, volume);
+		m_RenderedVersion = 0;
+		m_RenderedArraySize = 0;
+		return m_Engine != NULL;
+	}
+
+	/**
+	 * @brief Deletes the drawings of the view and releases the shared engine.
+	 */
+	void Detach(SCStudyInterfaceRef sc)
+	{
+		for (std::unordered_map<int64_t, int>::iterator it = m_LineNumbers.begin(); it != m_LineNumbers.end(); ++it)
+			sc.DeleteACSChartDrawing(sc.ChartNumber, TOOL_DELETE_CHARTDRAWING, it->second);
+		m_LineNumbers.clear();
+
+		if (m_Engine != NULL)
+		{
+			SharedReclaimRegistry::Release(m_Engine);
+			m_Engine = NULL;
+		}
+	}
+
+	bool IsAttached() const { return m_Engine != NULL; }
+
+	/**
+	 * @brief Makes the shared engine publish its reclaims in shared memory.
+	 */
+	bool EnablePublishing(const std::string &name) { return m_Engine->EnablePublishing(name); }
+
+	/**
+	 * @brief Makes the shared engine count the reclaims that cover each price tick.
+	 */
+	void EnableCoverage() { m_Engine->EnableCoverage(); }
+
+	/**
+	 * @brief Makes the shared engine answer the exported queries of the chart symbol.
+	 */
+	void EnableQueries(SCStudyInterfaceRef sc) { m_Engine->EnableQueries(sc.Symbol.GetChars()); }
+
+	/**
+	 * @brief Returns the number of shared reclaims of one side that cover a price.
+	 */
+	int GetCoverage(int type, float price) { return m_Engine->GetCoverage(type, price); }
+
+	/**
+	 * @brief Draws the reclaims if the engine changed since the last call, or a new bar was added.
+	 *
+	 * @param sc A reference to the study interface, providing access to chart data and tools.
+	 * @param computingTextLineNumber LineNumber of the "computing" text, see `DrawComputingState`.
+	 */
+	void Update(SCStudyInterfaceRef sc, int &computingTextLineNumber)
+	{
+		m_Engine->Poke();
+
+		if (!m_Engine->IsReady())
+		{
+			DrawComputingState(sc, computingTextLineNumber, true);
+			sc.UpdateAlways = 1;
+			return;
+		}
+
+		if (computingTextLineNumber != 0)
+		{
+			DrawComputingState(sc, computingTextLineNumber, false);
+			sc.UpdateAlways = 0;
+		}
+
+		// the rectangles extend from the last bar, so they are also redrawn on new bars
+		if (m_Engine->GetVersion() == m_RenderedVersion && sc.ArraySize == m_RenderedArraySize)
+			return;
+
+		m_RenderedVersion = m_Engine->CopyReclaims(m_UpReclaims, m_DownReclaims);
+		m_RenderedArraySize = sc.ArraySize;
+
+		// the engine works in UTC
+		double timeOffset = sc.TimeScaleAdjustment.GetAsDouble();
+
+		std::unordered_map<int64_t, int> lineNumbers;
+		lineNumbers.reserve(m_LineNumbers.size() + 2);
+		Render(sc, m_UpReclaims, timeOffset, lineNumbers);
+		Render(sc, m_DownReclaims, timeOffset, lineNumbers);
+
+		// delete the drawings of the reclaims that are no longer active
+		for (std::unordered_map<int64_t, int>::iterator it = m_LineNumbers.begin(); it != m_LineNumbers.end(); ++it)
+		{
+			if (lineNumbers.find(it->first) == lineNumbers.end())
+				sc.DeleteACSChartDrawing(sc.ChartNumber, TOOL_DELETE_CHARTDRAWING, it->second);
+		}
+
+		m_LineNumbers.swap(lineNumbers);
+	}
+
+private:
+	void Render(SCStudyInterfaceRef sc, std::vector<Reclaim> &reclaims, double timeOffset, std::unordered_map<int64_t, int> &lineNumbers)
+	{
+		for (int i = 0; i < (int)reclaims.size(); i++)
+		{
+			Reclaim &reclaim = reclaims[i];
+			if (reclaim.Deleted)
+				continue;
+
+			reclaim.StartDate += timeOffset;
+
+			std::unordered_map<int64_t, int>::iterator found = m_LineNumbers.find(reclaim.Id);
+			if (found != m_LineNumbers.end())
+			{
+				reclaim.LineNumber = found->second;
+				DrawReclaim(sc, reclaim, false, i);
+			}
+			else
+			{
+				reclaim.LineNumber = DrawReclaim(sc, reclaim, true, i);
+			}
+
+			lineNumbers[reclaim.Id] = reclaim.LineNumber;
+		}
+	}
+
+	SharedReclaimEngine *m_Engine;
+	uint64_t m_RenderedVersion;
+	int m_RenderedArraySize;
+
+	// LineNumber of the drawing of each reclaim id
+	std::unordered_map<int64_t, int> m_LineNumbers;
+
+	// copies of the engine reclaims
+	std::vector<Reclaim> m_UpReclaims;
+	std::vector<Reclaim> m_DownReclaims;
+};
+
+/**
+ * @brief A Sierra Chart study function that manages the drawing of reclaim rectangles on the chart.
+ *
+ * This function tracks price movements to identify and visualize "reclaim" areas on the chart.
+ * The function handles the initialization, updating, and deletion of
+ * these reclaim rectangles, as well as memory management.
+ *
+ * @param sc A reference to the study interface, providing access to chart data, user inputs,
+ *           and drawing tools.
+ */
+SCSFExport scsf_Reclaims(SCStudyInterfaceRef sc)
+{
+	// user inputs
+	SCInputRef MaxNumberOfReclaims = sc.Input[0];	   // length of the up and down reclaims arrays
+	SCInputRef NewReclaimThreshold = sc.Input[1];	   // Minimum size in ticks that an existing reclaim must be to start creating new ones (if there is enough bar overlap)
+	SCInputRef RectangleExtendBars = sc.Input[2];	   // How many bars the rectangles should extend to the right
+	SCInputRef UpReclaimsColor = sc.Input[3];		   // color of bullish reclaims
+	SCInputRef DownReclaimsColor = sc.Input[4];		   // color of bearish reclaims
+	SCInputRef UpdateOnBarClose = sc.Input[5];		   // When true, only update reclaims on bar close
+	SCInputRef UpCurrentReclaimColor = sc.Input[6];		// Color of the most recent bullish reclaim
+	SCInputRef DownCurrentReclaimColor = sc.Input[7];		// Color of the most recent bearish reclaim
+	SCInputRef OldReclaimsTransparency = sc.Input[8];		// Transparency of old reclaims from 0 (opaque) to 100 (transparent)
+	SCInputRef CurrentReclaimsTransparency = sc.Input[9];		// Transparency of current reclaims from 0 (opaque) to 100 (transparent)
+	SCInputRef MinReclaimSize = sc.Input[10];		// Display the reclaim being build when set to true
+	SCInputRef UseTickHistory = sc.Input[11];		// When true, history is computed from every trade in the .scid file instead of the chart bars
+	SCInputRef ShareEngine = sc.Input[12];		// When true, one engine per symbol and settings is shared by every chart that sets this input
+	SCInputRef SharedBarPeriod = sc.Input[13];		// Length in seconds of the bars of the shared engine
+	SCInputRef PublishToSharedMemory = sc.Input[14];		// When true, the live reclaims are published in shared memory for other processes
+	SCInputRef ComputeCoverage = sc.Input[15];		// When true, the coverage subgraphs are filled with the number of reclaims that cover the close
+	SCInputRef IntermediateThreshold = sc.Input[16];		// Threshold tick size of the intermediate reclaims, 0 to disable them
+	SCInputRef MajorThreshold = sc.Input[17];		// Threshold tick size of the major reclaims, 0 to disable them
+	SCInputRef IntermediateUpColor = sc.Input[18];		// color of intermediate bullish reclaims
+	SCInputRef IntermediateDownColor = sc.Input[19];		// color of intermediate bearish reclaims
+	SCInputRef MajorUpColor = sc.Input[20];		// color of major bullish reclaims
+	SCInputRef MajorDownColor = sc.Input[21];		// color of major bearish reclaims
+	SCInputRef IntermediateTransparency = sc.Input[22];		// Transparency of intermediate reclaims from 0 (opaque) to 100 (transparent)
+	SCInputRef MajorTransparency = sc.Input[23];		// Transparency of major reclaims from 0 (opaque) to 100 (transparent)
+	SCInputRef AdaptiveThresholdFactor = sc.Input[24];		// Threshold as a fraction of the average true range, 0 for the fixed threshold
+	SCInputRef AdaptiveThresholdBars = sc.Input[25];		// Number of bars of the average true range of the adaptive threshold
+	SCInputRef CollectStatistics = sc.Input[26];		// When true, the latency of every call and the work done are recorded
+	SCInputRef WriteTrace = sc.Input[27];		// When true, the phases of every call are written to a trace file in the data folder
+	SCInputRef StreamChanges = sc.Input[28];		// When true, the changes of the live reclaims are streamed over a Unix domain socket
+	SCInputRef ExportQueries = sc.Input[29];		// When true, the reclaims are indexed for the queries exported from the DLL
+
+	SCSubgraphRef UpCoverage = sc.Subgraph[0];		// number of bullish reclaims that cover the close of the bar
+	SCSubgraphRef DownCoverage = sc.Subgraph[1];		// number of bearish reclaims that cover the close of the bar
+	SCSubgraphRef TotalCoverage = sc.Subgraph[2];		// sum of both
+	SCSubgraphRef CreationThreshold = sc.Subgraph[3];		// retracement in ticks that creates a new reclaim on the bar
+
+
+	// Persistent variables to store the previous price (required to only update reclaims if price has changed)
+	float &PreviousPrice = sc.GetPersistentFloat(0);
+
+	// Volume of the current bar at the last call, the difference is added to the reclaims
+	float &PreviousVolume = sc.GetPersistentFloat(1);
+
+	// Persistent pointer to the reclaim engine that holds the up and down reclaims
+	ReclaimEngine *p_Engine = (ReclaimEngine *)sc.GetPersistentPointer(1);
+	int &lastIndex = sc.GetPersistentInt(3); 
+	int &TickHistoryState = sc.GetPersistentInt(4); // one of the TICK_HISTORY_ values
+	int &ComputingTextLineNumber = sc.GetPersistentInt(5); // LineNumber of the "computing" text
+
+	// Persistent pointer to the worker thread that computes the history from the .scid file
+	ReclaimHistoryWorker *p_HistoryWorker = (ReclaimHistoryWorker *)sc.GetPersistentPointer(2);
+
+	// Persistent pointer to the view that draws the reclaims of the shared engine
+	SharedReclaimView *p_SharedView = (SharedReclaimView *)sc.GetPersistentPointer(3);
+
+	// Persistent pointer to the shared memory publisher of the reclaims
+	ReclaimShmPublisher *p_Publisher = (ReclaimShmPublisher *)sc.GetPersistentPointer(4);
+
+	// Persistent pointer to the mutex that guards the engine against the exported queries
+	std::mutex *p_EngineMutex = (std::mutex *)sc.GetPersistentPointer(5);
+
+	// Persistent pointer to the engines of the intermediate and major reclaims
+	ReclaimHierarchy *p_Levels = (ReclaimHierarchy *)sc.GetPersistentPointer(6);
+
+	// Persistent pointer to the latency statistics, NULL when they are not collected
+	ReclaimStats *p_Stats = (ReclaimStats *)sc.GetPersistentPointer(7);
+	int &StatisticsMenuID = sc.GetPersistentInt(6); // id of the chart menu item that logs the statistics
+
+	// Persistent pointer to the trace of the study phases, NULL when tracing is off
+	ReclaimTrace *p_Trace = (ReclaimTrace *)sc.GetPersistentPointer(8);
+
+	// Persistent pointer to the handles of the drawn reclaims by LineNumber, for FatCatReclaims_FindByLineNumber
+	ReclaimLineNumberMap *p_LineNumbers = (ReclaimLineNumberMap *)sc.GetPersistentPointer(9);
+
+	// Persistent pointer to the stream of the reclaim changes, NULL until it is enabled
+	ReclaimStreamServer *p_Stream = (ReclaimStreamServer *)sc.GetPersistentPointer(10);
+
+	// Set default study properties
+	if (sc.SetDefaults)
+	{
+
+		sc.GraphName = "FatCat reclaims";
+		sc.StudyDescription = "Draws reclaims on the chart";
+		sc.GraphRegion = 0;
+
+		// Inputs default values
+		MaxNumberOfReclaims.Name = "Max active reclaims";
+		MaxNumberOfReclaims.SetInt(100);			  
+		MaxNumberOfReclaims.SetIntLimits(1, 1000); 
+
+		// Inputs default values
+		NewReclaimThreshold.Name = "Threshold tick size";
+		NewReclaimThreshold.SetInt(2); 
+		NewReclaimThreshold.SetIntLimits(1,1000);
+
+		// Inputs default values
+		RectangleExtendBars.Name = "Extend right amount";
+		RectangleExtendBars.SetInt(10000); // Default to 10 bars extension
+        RectangleExtendBars.SetIntLimits(0, 10000); // Allow extension to a maximum of 500 bars
+
+		UpReclaimsColor.Name = "Existing bullish reclaims color";
+		UpReclaimsColor.SetColor(RGB(0, 100, 255)); 
+
+		DownReclaimsColor.Name = "Existing bearish reclaims color";
+		DownReclaimsColor.SetColor(RGB(255, 100, 0)); 
+
+		UpdateOnBarClose.Name = "Only update on bar close";
+		UpdateOnBarClose.SetYesNo(0); 
+
+		UpCurrentReclaimColor.Name="Current bullish reclaim color";		
+		UpCurrentReclaimColor.SetColor(RGB(0, 100, 255)); 
+
+		DownCurrentReclaimColor.Name="Current bearish reclaim color";		
+		DownCurrentReclaimColor.SetColor(RGB(255, 100, 0)); 
+
+		OldReclaimsTransparency.Name="Transparency of existing reclaims"; 
+		OldReclaimsTransparency.SetInt(70); 
+        OldReclaimsTransparency.SetIntLimits(0, 100); 
+
+		CurrentReclaimsTransparency.Name="Transparency of current reclaims"; 
+		CurrentReclaimsTransparency.SetInt(70); 
+        CurrentReclaimsTransparency.SetIntLimits(0, 100); 
+
+		MinReclaimSize.Name = "Hide reclaims smaller than (ticks)";
+		MinReclaimSize.SetInt(2); 
+        MinReclaimSize.SetIntLimits(0, 10000); 
+
+		UseTickHistory.Name = "Compute history from .scid tick data";
+		UseTickHistory.SetYesNo(0);
+
+		ShareEngine.Name = "Share reclaims with other charts of the symbol";
+		ShareEngine.SetYesNo(0);
+
+		SharedBarPeriod.Name = "Shared reclaims bar period (seconds)";
+		SharedBarPeriod.SetInt(60);
+		SharedBarPeriod.SetIntLimits(1, 86400);
+
+		PublishToSharedMemory.Name = "Publish reclaims to shared memory";
+		PublishToSharedMemory.SetYesNo(0);
+
+		ComputeCoverage.Name = "Compute reclaim coverage at close";
+		ComputeCoverage.SetYesNo(0);
+
+		IntermediateThreshold.Name = "Intermediate threshold tick size (0 = off)";
+		IntermediateThreshold.SetInt(0);
+		IntermediateThreshold.SetIntLimits(0, 1000);
+
+		MajorThreshold.Name = "Major threshold tick size (0 = off)";
+		MajorThreshold.SetInt(0);
+		MajorThreshold.SetIntLimits(0, 1000);
+
+		IntermediateUpColor.Name = "Intermediate bullish reclaims color";
+		IntermediateUpColor.SetColor(RGB(0, 60, 180));
+
+		IntermediateDownColor.Name = "Intermediate bearish reclaims color";
+		IntermediateDownColor.SetColor(RGB(180, 60, 0));
+
+		MajorUpColor.Name = "Major bullish reclaims color";
+		MajorUpColor.SetColor(RGB(0, 30, 120));
+
+		MajorDownColor.Name = "Major bearish reclaims color";
+		MajorDownColor.SetColor(RGB(120, 30, 0));
+
+		IntermediateTransparency.Name = "Transparency of intermediate reclaims";
+		IntermediateTransparency.SetInt(60);
+		IntermediateTransparency.SetIntLimits(0, 100);
+
+		MajorTransparency.Name = "Transparency of major reclaims";
+		MajorTransparency.SetInt(50);
+		MajorTransparency.SetIntLimits(0, 100);
+
+		AdaptiveThresholdFactor.Name = "Adaptive threshold (fraction of average bar range, 0 = off)";
+		AdaptiveThresholdFactor.SetFloat(0);
+		AdaptiveThresholdFactor.SetFloatLimits(0, 100);
+
+		AdaptiveThresholdBars.Name = "Adaptive threshold average bars";
+		AdaptiveThresholdBars.SetInt(20);
+		AdaptiveThresholdBars.SetIntLimits(1, 1000);
+
+		CollectStatistics.Name = "Collect latency statistics";
+		CollectStatistics.SetYesNo(0);
+
+		WriteTrace.Name = "Write trace events to the data folder";
+		WriteTrace.SetYesNo(0);
+
+		StreamChanges.Name = "Stream reclaim changes to a Unix socket (not with shared reclaims)";
+		StreamChanges.SetYesNo(0);
+
+		ExportQueries.Name = "Answer reclaim queries from other studies and DLLs";
+		ExportQueries.SetYesNo(0);
+
+		// the counts are not prices, they are available to other studies and in the data window
+		UpCoverage.Name = "Bullish coverage";
+		UpCoverage.DrawStyle = DRAWSTYLE_IGNORE;
+		UpCoverage.PrimaryColor = RGB(0, 100, 255);
+
+		DownCoverage.Name = "Bearish coverage";
+		DownCoverage.DrawStyle = DRAWSTYLE_IGNORE;
+		DownCoverage.PrimaryColor = RGB(255, 100, 0);
+
+		TotalCoverage.Name = "Total coverage";
+		TotalCoverage.DrawStyle = DRAWSTYLE_IGNORE;
+		TotalCoverage.PrimaryColor = RGB(128, 128, 128);
+
+		CreationThreshold.Name = "Creation threshold";
+		CreationThreshold.DrawStyle = DRAWSTYLE_IGNORE;
+		CreationThreshold.PrimaryColor = RGB(128, 128, 128);
+
+		return;
+	}
+
+	// Memory management: Deallocate when the study is unloaded
+	if (sc.LastCallToFunction)
+	{
+		if (p_Publisher != NULL)
+		{
+			delete p_Publisher;
+			sc.SetPersistentPointer(4, NULL);
+		}
+
+		if (p_Stream != NULL)
+		{
+			delete p_Stream;
+			sc.SetPersistentPointer(10, NULL);
+		}
+
+		if (p_SharedView != NULL)
+		{
+			p_SharedView->Detach(sc);
+			delete p_SharedView;
+			sc.SetPersistentPointer(3, NULL);
+		}
+
+		// stop the worker thread before anything it uses is released
+		if (p_HistoryWorker != NULL)
+		{
+			delete p_HistoryWorker;
+			sc.SetPersistentPointer(2, NULL);
+		}
+
+		if (p_Engine != NULL)
+		{
+			ReclaimQueryRegistry::Unregister(p_Engine);
+			delete p_Engine;
+			sc.SetPersistentPointer(1, NULL);
+		}
+
+		if (p_LineNumbers != NULL)
+		{
+			delete p_LineNumbers;
+			sc.SetPersistentPointer(9, NULL);
+		}
+
+		if (p_EngineMutex != NULL)
+		{
+			delete p_EngineMutex;
+			sc.SetPersistentPointer(5, NULL);
+		}
+
+		if (p_Levels != NULL)
+		{
+			delete p_Levels;
+			sc.SetPersistentPointer(6, NULL);
+		}
+
+		if (p_Stats != NULL)
+		{
+			sc.RemoveACSChartShortcutMenuItem(sc.ChartNumber, StatisticsMenuID);
+			delete p_Stats;
+			sc.SetPersistentPointer(7, NULL);
+		}
+
+		// the engines no longer exist, the remaining spans are written by the destructor
+		if (p_Trace != NULL)
+		{
+			delete p_Trace;
+			sc.SetPersistentPointer(8, NULL);
+		}
+
+		return;
+	}
+
+	if (p_Engine == NULL)
+	{
+		p_Engine = new ReclaimEngine;
+		sc.SetPersistentPointer(1, p_Engine);
+
+		p_EngineMutex = new std::mutex;
+		sc.SetPersistentPointer(5, p_EngineMutex);
+
+		p_Levels = new ReclaimHierarchy;
+		sc.SetPersistentPointer(6, p_Levels);
+
+		p_LineNumbers = new ReclaimLineNumberMap;
+		sc.SetPersistentPointer(9, p_LineNumbers);
+	}
+
+	// the statistics only exist while they are collected, the chart menu logs them on demand
+	if (CollectStatistics.GetYesNo() && p_Stats == NULL)
+	{
+		p_Stats = new ReclaimStats;
+		sc.SetPersistentPointer(7, p_Stats);
+		StatisticsMenuID = sc.AddACSChartShortcutMenuItem(sc.ChartNumber, "Log FatCat reclaims statistics");
+	}
+	else if (!CollectStatistics.GetYesNo() && p_Stats != NULL)
+	{
+		sc.RemoveACSChartShortcutMenuItem(sc.ChartNumber, StatisticsMenuID);
+		delete p_Stats;
+		p_Stats = NULL;
+		sc.SetPersistentPointer(7, NULL);
+	}
+
+	if (p_Stats != NULL && StatisticsMenuID > 0 && sc.MenuEventID == StatisticsMenuID)
+	{
+		LogStatistics(sc, *p_Stats);
+		return;
+	}
+
+	// the trace file is written by its own thread, a chart recalculation starts a new one
+	if (sc.Index == 0)
+	{
+		if (WriteTrace.GetYesNo())
+		{
+			if (p_Trace == NULL)
+			{
+				p_Trace = new ReclaimTrace;
+				sc.SetPersistentPointer(8, p_Trace);
+			}
+
+			std::string path = std::string(sc.DataFilesFolder().GetChars()) + "\\" + GetReclaimShmName(sc.Symbol.GetChars());
+			path += "_chart" + std::to_string(sc.ChartNumber) + ".trace.json";
+
+			SCString processName;
+			processName.Format("FatCat reclaims %s chart %d", sc.Symbol.GetChars(), sc.ChartNumber);
+
+			if (!p_Trace->Open(path, sc.ChartNumber, processName.GetChars()))
+			{
+				SCString message;
+				message.Format("FatCat reclaims: unable to create trace file %s", path.c_str());
+				sc.AddMessageToLog(message, 0);
+			}
+		}
+		else if (p_Trace != NULL)
+		{
+			delete p_Trace;
+			p_Trace = NULL;
+			sc.SetPersistentPointer(8, NULL);
+		}
+
+		p_Engine->SetTrace(p_Trace != NULL && p_Trace->IsOpen() ? p_Trace : NULL);
+	}
+
+	// measures the rest of the call, including the wait for the queries that hold the engine
+	ReclaimLatencyTimer latencyTimer(p_Stats);
+	ReclaimTrace *trace = p_Engine->GetTrace();
+	ReclaimTraceSpan callSpan(trace, "call");
+
+	// the symbol may have changed, registration must happen before the engine is locked
+	if (sc.Index == 0)
+	{
+		if (ShareEngine.GetYesNo() || !ExportQueries.GetYesNo())
+			ReclaimQueryRegistry::Unregister(p_Engine);
+		else
+			ReclaimQueryRegistry::Register(sc.Symbol.GetChars(), p_Engine, p_EngineMutex, sc.ChartbookName().GetChars(), sc.ChartNumber,
+				p_LineNumbers);
+	}
+
+	// the exported queries read the engine from other threads
+	ReclaimTraceSpan lockSpan(trace, "lock");
+	std::lock_guard<std::mutex> engineLock(*p_EngineMutex);
+	lockSpan.End();
+
+	// the rectangles are drawn once when the call returns, while the engine is still locked
+	// the bars of a full recalculation are not streamed, the subscribers get the whole state once it is done
+	bool stream = p_Stream != NULL && p_Stream->IsOpen() && !sc.IsFullRecalculation && TickHistoryState != TICK_HISTORY_COMPUTING;
+	if (stream && p_Stream->NeedsResync())
+	{
+		ReclaimTraceSpan resyncSpan(trace, "stream resync");
+		p_Stream->Resync(*p_Engine);
+	}
+
+	ReclaimDrawBuffer drawBuffer(sc, p_Stats, trace, p_LineNumbers, stream ? p_Stream : NULL);
+
+	// Initialize stuff on the first run
+	if (sc.Index == 0)
+	{
+		ReclaimTraceSpan inputsSpan(trace, "inputs");
+
+		PreviousPrice = sc.LastTradePrice;
+		TickHistoryState = TICK_HISTORY_NONE;
+
+		// the settings may have changed, so the engine always starts from scratch
+		ReclaimSettings settings;
+		settings.MaxNumberOfReclaims = MaxNumberOfReclaims.GetInt();
+		settings.NewReclaimThreshold = NewReclaimThreshold.GetInt();
+		settings.TickSize = sc.TickSize;
+		settings.UpdateOnBarClose = UpdateOnBarClose.GetYesNo() != 0;
+		settings.AdaptiveThresholdBars = AdaptiveThresholdBars.GetInt();
+		settings.AdaptiveThresholdFactor = AdaptiveThresholdFactor.GetFloat();
+		p_Engine->EnableCoverage(ComputeCoverage.GetYesNo() != 0);
+		// the volume is only read by the queries, the shared memory and the stream, it enables the index too
+		bool volume = ExportQueries.GetYesNo() || PublishToSharedMemory.GetYesNo() || (StreamChanges.GetYesNo() && !ShareEngine.GetYesNo());
+		p_Engine->EnableLevelIndex(ExportQueries.GetYesNo() != 0);
+		p_Engine->EnableVolume(volume);
+		p_Engine->Reset(settings);
+		p_LineNumbers->clear();
+		if (p_Stream != NULL)
+			p_Stream->Invalidate();
+
+		// the intermediate and major reclaims are updated with the same prices as the study threshold
+		std::vector<int> levelThresholds = GetLevelThresholds(sc);
+		p_Levels->Reset(settings, levelThresholds.data(), (int)levelThresholds.size());
+
+		// a computation started with the previous settings is no longer needed
+		if (p_HistoryWorker != NULL)
+			p_HistoryWorker->Cancel();
+
+		// region name is derived from the symbol and the chart, see GetReclaimShmName
+		std::string shmName = GetReclaimShmName(sc.Symbol.GetChars(), ("chart" + std::to_string(sc.ChartNumber)).c_str());
+
+		if (p_Publisher != NULL)
+			p_Publisher->Close();
+
+		if (PublishToSharedMemory.GetYesNo() && !ShareEngine.GetYesNo())
+		{
+			if (p_Publisher == NULL)
+			{
+				p_Publisher = new ReclaimShmPublisher;
+				sc.SetPersistentPointer(4, p_Publisher);
+			}
+
+			if (!p_Publisher->Open(shmName))
+			{
+				SCString message;
+				if (ReclaimShmPublisher::IsPublished(shmName))
+					message.Format("FatCat reclaims: shared memory region %s is already published by another chart", shmName.c_str());
+				else
+					message.Format("FatCat reclaims: unable to create shared memory region %s", shmName.c_str());
+				sc.AddMessageToLog(message, 0);
+			}
+		}
+
+		if (p_Stream != NULL)
+			p_Stream->Close();
+
+		if (StreamChanges.GetYesNo() && !ShareEngine.GetYesNo())
+		{
+			if (p_Stream == NULL)
+			{
+				p_Stream = new ReclaimStreamServer;
+				sc.SetPersistentPointer(10, p_Stream);
+			}
+
+			// like the shared memory regions, every chart streams to its own socket
+			std::string streamPath = GetReclaimStreamPath(sc.Symbol.GetChars(),
+				GetReclaimChartSuffix(sc.ChartbookName().GetChars(), sc.ChartNumber).c_str());
+			if (!p_Stream->Open(streamPath))
+			{
+				SCString message;
+				if (ReclaimStreamServer::IsServed(streamPath))
+					message.Format("FatCat reclaims: stream socket %s is already served by another study", streamPath.c_str());
+				else
+					message.Format("FatCat reclaims: unable to create stream socket %s", streamPath.c_str());
+				sc.AddMessageToLog(message, 0);
+			}
+		}
+		else if (StreamChanges.GetYesNo())
+			sc.AddMessageToLog("FatCat reclaims: the changes of shared reclaims are not streamed, turn off sharing to stream them", 0);
+
+		if (ShareEngine.GetYesNo())
+		{
+			if (p_SharedView == NULL)
+			{
+				p_SharedView = new SharedReclaimView;
+				sc.SetPersistentPointer(3, p_SharedView);
+			}
+
+			// the shared engine computes the reclaims, this chart only draws them
+			if (p_SharedView->Attach(sc, settings, SharedBarPeriod.GetInt(), volume))
+			{
+				if (ComputeCoverage.GetYesNo())
+					p_SharedView->EnableCoverage();
+				if (ExportQueries.GetYesNo())
+					p_SharedView->EnableQueries(sc);
+
+				// the shared engine publishes from its own thread, the engines of a symbol differ by their bar period
+				std::string sharedShmName = GetReclaimShmName(sc.Symbol.GetChars(), (std::to_string(SharedBarPeriod.GetInt()) + "s").c_str());
+				if (PublishToSharedMemory.GetYesNo() && !p_SharedView->EnablePublishing(sharedShmName))
+				{
+					SCString message;
+					if (ReclaimShmPublisher::IsPublished(sharedShmName))
+						message.Format("FatCat reclaims: shared memory region %s is already published by a shared engine with other settings", sharedShmName.c_str());
+					else
+						message.Format("FatCat reclaims: unable to create shared memory region %s", sharedShmName.c_str());
+					sc.AddMessageToLog(message, 0);
+				}
+				return;
+			}
+
+			SCString message;
+			message.Format("FatCat reclaims: unable to read %s, reclaims are not shared", GetScidFilePath(sc).GetChars());
+			sc.AddMessageToLog(message, 0);
+		}
+		else if (p_SharedView != NULL)
+		{
+			p_SharedView->Detach(sc);
+		}
+
+		if (UseTickHistory.GetYesNo())
+		{
+			if (p_HistoryWorker == NULL)
+			{
+				p_HistoryWorker = new ReclaimHistoryWorker;
+				sc.SetPersistentPointer(2, p_HistoryWorker);
+			}
+
+			SCString path = GetScidFilePath(sc);
+			if (p_HistoryWorker->Start(path.GetChars(), *p_Engine, settings, levelThresholds, GetBarStartTimes(sc), sc.TimeScaleAdjustment.GetAsDouble()))
+			{
+				// the chart keeps running while the worker thread computes the history
+				TickHistoryState = TICK_HISTORY_COMPUTING;
+				DrawComputingState(sc, ComputingTextLineNumber, true);
+
+				// make sure the study is called to pick up the result even if no data arrives
+				sc.UpdateAlways = 1;
+				return;
+			}
+
+			SCString message;
+			message.Format("FatCat reclaims: unable to read %s, using chart bars for history", path.GetChars());
+			sc.AddMessageToLog(message, 0);
+		}
+
+		// initialize values for first reclaims and draw them
+		ChartReclaimListener listener(drawBuffer, *p_Engine);
+		p_Engine->Start(sc.LastTradePrice, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &listener);
+
+		for (int level = 0; level < p_Levels->GetLevelCount(); level++)
+		{
+			ChartReclaimListener levelListener(drawBuffer, p_Levels->GetLevel(level), GetLevelStyle(sc, level));
+			p_Levels->GetLevel(level).Start(sc.LastTradePrice, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &levelListener);
+		}
+
+		return;
+	}
+
+	if (p_SharedView != NULL && p_SharedView->IsAttached())
+	{
+		// draw once at the end of a full recalculation
+		if (sc.IsFullRecalculation && sc.Index < sc.ArraySize - 1)
+			return;
+
+		p_SharedView->Update(sc, ComputingTextLineNumber);
+
+		if (ComputeCoverage.GetYesNo())
+		{
+			float close = sc.Close[sc.Index];
+			SetCoverageAtClose(sc, p_SharedView->GetCoverage(0, close), p_SharedView->GetCoverage(1, close));
+		}
+		return;
+	}
+
+	if (TickHistoryState == TICK_HISTORY_COMPUTING)
+	{
+		// the bars of a full recalculation are covered by the tick history
+		if (sc.IsFullRecalculation || !p_HistoryWorker->IsDone())
+			return;
+
+		// swap in the finished reclaims and continue from the hand over point
+		ReclaimTraceSpan historySpan(trace, "history");
+		int64_t historyTrades = p_HistoryWorker->Finish(*p_Engine, *p_Levels, GetBarStartTimes(sc));
+		historySpan.End();
+		if (p_Stats != NULL)
+			p_Stats->Counters.Ticks += historyTrades;
+
+		TickHistoryState = TICK_HISTORY_LOADED;
+		sc.UpdateAlways = 0;
+		DrawComputingState(sc, ComputingTextLineNumber, false);
+
+		if (!p_Engine->IsStarted())
+		{
+			// the .scid file had no trades inside the chart
+			ChartReclaimListener listener(drawBuffer, *p_Engine);
+			p_Engine->Start(sc.LastTradePrice, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &listener);
+
+			for (int level = 0; level < p_Levels->GetLevelCount(); level++)
+			{
+				ChartReclaimListener levelListener(drawBuffer, p_Levels->GetLevel(level), GetLevelStyle(sc, level));
+				p_Levels->GetLevel(level).Start(sc.LastTradePrice, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &levelListener);
+			}
+		}
+		else
+		{
+			ReclaimTraceSpan drawSpan(trace, "draw history");
+			DrawAllReclaims(drawBuffer, *p_Engine);
+
+			for (int level = 0; level < p_Levels->GetLevelCount(); level++)
+				DrawAllReclaims(drawBuffer, p_Levels->GetLevel(level), GetLevelStyle(sc, level));
+
+			drawBuffer.Flush();
+		}
+
+		if (ComputeCoverage.GetYesNo())
+			SetCoverageAtClose(sc, p_Engine->GetCoverage(0, sc.Close[sc.Index]), p_Engine->GetCoverage(1, sc.Close[sc.Index]));
+		CreationThreshold[sc.Index] = (float)p_Engine->GetThreshold();
+
+		// the volume of the current bar so far is in the tick history
+		PreviousVolume = sc.Volume[sc.Index];
+		lastIndex = sc.Index;
+		return;
+	}
+
+	// the bars of a full recalculation were already processed from the tick history
+	if (TickHistoryState == TICK_HISTORY_LOADED && sc.IsFullRecalculation)
+	{
+		return;
+	}
+
+	// the volume traded since the last call is attributed to the last price, bars of a full
+	// recalculation only have their total volume and are skipped
+	if (!sc.IsFullRecalculation)
+		p_Engine->AddVolume(sc.LastTradePrice, sc.Volume[sc.Index] - (lastIndex == sc.Index ? PreviousVolume : 0));
+	PreviousVolume = sc.Volume[sc.Index];
+
+	if(!UpdateOnBarClose.GetYesNo()) {
+		// update existing reclaims using currentPrice
+		UpdateReclaims(sc, drawBuffer, *p_Engine);
+
+		ReclaimTraceSpan levelsSpan(trace, "levels");
+		for (int level = 0; level < p_Levels->GetLevelCount(); level++)
+			UpdateReclaims(sc, drawBuffer, p_Levels->GetLevel(level), false, GetLevelStyle(sc, level));
+	}
+
+	// publish the live reclaims, history is published once it is complete
+	bool publish = p_Publisher != NULL && p_Publisher->IsOpen() && !sc.IsFullRecalculation;
+
+	// return if no new bar has formed 
+	if (lastIndex == sc.Index) { 
+		if (ComputeCoverage.GetYesNo())
+			SetCoverageAtClose(sc, p_Engine->GetCoverage(0, sc.Close[sc.Index]), p_Engine->GetCoverage(1, sc.Close[sc.Index]));
+		if (publish)
+		{
+			ReclaimTraceSpan publishSpan(trace, "publish");
+			p_Publisher->Publish(*p_Engine);
+		}
+        return; 
+    } 
+
+	// from this point on code is only executed once per bar
+
+    lastIndex = sc.Index; 
+
+	// If the price has changed, update stuff
+	// store new value for PreviousPrice
+	PreviousPrice = sc.LastTradePrice;
+
+	// the threshold follows the volatility of the closed bars
+	p_Engine->CloseBar(sc.High[sc.Index - 1], sc.Low[sc.Index - 1], sc.Close[sc.Index - 1]);
+	CreationThreshold[sc.Index] = (float)p_Engine->GetThreshold();
+
+	// Check if we need to create new bullish or bearish reclaims
+	ChartReclaimListener listener(drawBuffer, *p_Engine);
+	p_Engine->CreateReclaims(sc.LastTradePrice, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &listener);
+
+	// update existing reclaims
+	UpdateReclaims(sc, drawBuffer, *p_Engine, true);
+
+	// the rectangles extend from the last bar, as in SharedReclaimView::Update
+	if (!sc.IsFullRecalculation)
+		ExtendReclaims(drawBuffer, *p_Engine);
+
+	// the intermediate and major reclaims follow the same bar
+	ReclaimTraceSpan levelsSpan(trace, "levels");
+	for (int level = 0; level < p_Levels->GetLevelCount(); level++)
+	{
+		ChartReclaimListener levelListener(drawBuffer, p_Levels->GetLevel(level), GetLevelStyle(sc, level));
+		p_Levels->GetLevel(level).CloseBar(sc.High[sc.Index - 1], sc.Low[sc.Index - 1], sc.Close[sc.Index - 1]);
+		p_Levels->GetLevel(level).CreateReclaims(sc.LastTradePrice, sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble(), &levelListener);
+		UpdateReclaims(sc, drawBuffer, p_Levels->GetLevel(level), true, GetLevelStyle(sc, level));
+		if (!sc.IsFullRecalculation)
+			ExtendReclaims(drawBuffer, p_Levels->GetLevel(level), GetLevelStyle(sc, level));
+	}
+	levelsSpan.End();
+
+	if (ComputeCoverage.GetYesNo())
+		SetCoverageAtClose(sc, p_Engine->GetCoverage(0, sc.Close[sc.Index]), p_Engine->GetCoverage(1, sc.Close[sc.Index]));
+
+	if (publish)
+	{
+		ReclaimTraceSpan publishSpan(trace, "publish");
+		p_Publisher->Publish(*p_Engine);
+	}
+}
+
+
+/**
+ * Queries exported from the study DLL.
+ *
+ * Other studies and DLLs load them with GetProcAddress, see the `FatCatReclaims_` typedefs in
+ * reclaims_query.h. The symbol is the chart symbol of the study instance (or of the shared engine).
+ * `type` is 0 for bullish reclaims and 1 for bearish reclaims. Every function returns -1 when no
+ * study instance computes reclaims for the symbol.
+ * `FatCatReclaims_FindByLineNumber` finds the reclaim of a rectangle drawn by the study on a chart
+ * (sc.ChartbookName(), sc.ChartNumber and the LineNumber of the drawing), in O(1).
+ */
+
+FATCAT_RECLAIMS_EXPORT int FatCatReclaims_FindNearest(const char *symbol, int type, float price, int above, FatCatReclaimLevel *level)
+{
+	return ReclaimQueryRegistry::FindNearest(symbol, type, price, above != 0, *level);
+}
+
+FATCAT_RECLAIMS_EXPORT int FatCatReclaims_FindKNearest(const char *symbol, int type, float price, int k, FatCatReclaimLevel *levels)
+{
+	return ReclaimQueryRegistry::FindKNearest(symbol, type, price, k, levels);
+}
+
+FATCAT_RECLAIMS_EXPORT int FatCatReclaims_FindInRange(const char *symbol, int type, float low, float high, FatCatReclaimLevel *levels, int maxLevels)
+{
+	return ReclaimQueryRegistry::FindInRange(symbol, type, low, high, levels, maxLevels);
+}
+
+FATCAT_RECLAIMS_EXPORT int FatCatReclaims_FindByLineNumber(const char *chartbook, int chartNumber, int lineNumber, FatCatReclaimLevel *level)
+{
+	return ReclaimQueryRegistry::FindByLineNumber(chartbook, chartNumber, lineNumber, *level);
+}
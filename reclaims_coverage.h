@@ -0,0 +1,113 @@
+/*
+ * @file reclaims_coverage.h
+ * @brief Number of active reclaims that cover each price tick.
+ *
+ * Every active reclaim covers the ticks between its fixed side and its active side. The coverage
+ * is kept in a Fenwick tree over the differences of the per tick counts, so adding or removing the
+ * ticks of a reclaim and reading the coverage of one tick are both O(log P), where P is the number
+ * of ticks in the tree. The engine updates it whenever a reclaim is created, shrinks or is removed.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class ReclaimCoverage
+ * @brief Per tick coverage counts of one side, on a window of ticks that moves with the prices.
+ *
+ * When a reclaim falls outside the window, `AddRange` fails and the owner rebuilds the tree around
+ * the prices of all active reclaims with `Rebuild` and `AddRange`.
+ */
+class ReclaimCoverage
+{
+public:
+	ReclaimCoverage()
+		: m_TickSize(1)
+		, m_FirstTick(0)
+	{
+	}
+
+	/**
+	 * @brief Empties the tree and sets the tick size used to convert prices to ticks.
+	 */
+	void Reset(float tickSize)
+	{
+		m_TickSize = tickSize > 0 ? tickSize : 1;
+		m_FirstTick = 0;
+		m_Tree.clear();
+	}
+
+	/**
+	 * @brief Empties the tree and places its window over a range of ticks, with room on both sides.
+	 */
+	void Rebuild(int64_t lowTick, int64_t highTick)
+	{
+		// at least four times the range, so prices can move before the next rebuild
+		int64_t size = 4096;
+		while (size < 4 * (highTick - lowTick + 1))
+			size *= 2;
+
+		m_FirstTick = lowTick - (size - (highTick - lowTick + 1)) / 2;
+		m_Tree.assign((size_t)size + 1, 0);
+	}
+
+	/**
+	 * @brief Converts a price to a tick number.
+	 */
+	int64_t GetTick(float price) const { return (int64_t)std::floor(price / m_TickSize + 0.5f); }
+
+	/**
+	 * @brief Adds `count` to the coverage of every tick between two prices, in any order.
+	 *
+	 * @return `false` if the range is outside the window, in which case nothing was changed.
+	 */
+	bool AddRange(float price1, float price2, int count)
+	{
+		int64_t lowTick = GetTick(std::min(price1, price2));
+		int64_t highTick = GetTick(std::max(price1, price2));
+
+		int64_t size = (int64_t)m_Tree.size() - 1;
+		if (size <= 0 || lowTick < m_FirstTick || highTick >= m_FirstTick + size)
+			return false;
+
+		Add(lowTick - m_FirstTick + 1, count);
+		Add(highTick - m_FirstTick + 2, -count);
+		return true;
+	}
+
+	/**
+	 * @brief Returns the number of reclaims that cover the tick of a price.
+	 */
+	int GetCount(float price) const
+	{
+		int64_t position = GetTick(price) - m_FirstTick + 1;
+		if (position < 1 || position >= (int64_t)m_Tree.size())
+			return 0;
+
+		int count = 0;
+		for (; position > 0; position -= position & -position)
+			count += m_Tree[(size_t)position];
+		return count;
+	}
+
+private:
+	void Add(int64_t position, int value)
+	{
+		for (; position < (int64_t)m_Tree.size(); position += position & -position)
+			m_Tree[(size_t)position] += value;
+	}
+
+	float m_TickSize;
+
+	// tick of the first position of the tree
+	int64_t m_FirstTick;
+
+	// Fenwick tree of the coverage differences, 1 based
+	std::vector<int> m_Tree;
+};
@@ -0,0 +1,1310 @@
+/*
+ * @file reclaims_engine.h
+ * @brief Sierra Chart independent reclaim engine.
+ *
+ * This file contains the reclaim data structure and the logic that creates, updates and
+ * reclaims bullish and bearish reclaims. It does not depend on sierrachart.h, so the same
+ * code drives the chart study (reclaims.cpp) and the offline tools.
+ *
+ * Drawing is not done here: the engine reports what happened to each reclaim through a
+ * `ReclaimListener`, and the chart study turns those notifications into drawings.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "reclaims_coverage.h"
+#include "reclaims_trace.h"
+#include "reclaims_volatility.h"
+
+/**
+ * @brief Generational handle of a reclaim, see `ReclaimEngine::Resolve`. `0` is never a valid handle.
+ */
+typedef uint64_t ReclaimHandle;
+
+/**
+ * @struct Reclaim
+ * @brief Represents a reclaim
+ *
+ * This structure holds information about a specific rectangle on a financial chart,
+ * including pricing on fixed and active sides, the start date, and additional metadata.
+ */
+struct Reclaim
+{
+	/**
+	 * @brief Price on the fixed side of the rectangle.
+	 *
+	 * This is the price that remains constant along one side of the rectangle.
+	 */
+	float FixedSidePrice;
+
+	/**
+	 * @brief Price on the active side of the rectangle.
+	 *
+	 * This is the price that may vary or move during the period the rectangle is active.
+	 */
+	float ActiveSidePrice;
+
+	/**
+	 * @brief The maximum height in ticks that the reclaims got to be during its existance
+	 *
+	 * when the current rectangle height is smaller than MaxHeight by a certain number of ticks,
+	 * a new reclaim should be created.
+	 */
+	int MaxHeight;
+
+	/**
+	 * @brief The current height in ticks of the reclaim
+	 *
+	 * This is calcuated as abs(ActiveSidePrice-FixedSidePrice)
+	 */
+	int CurrentHeight;
+
+	/**
+	 * @brief The maximum retracement (How many ticks smaller the reclaim got from the MaxHeight)
+	 *
+	 */
+	int MaxRetracement;
+
+	/**
+	 * @brief The start date and time when the rectangle is created.
+	 *
+	 * Represents the left anchor of the rectangle. The value is an SCDateTime stored as a
+	 * double (days since 1899-12-30), so the engine does not need sierrachart.h.
+	 */
+	double StartDate;
+
+	/**
+	 * @brief Volume traded inside the rectangle while the reclaim was active.
+	 *
+	 * Only accumulated when the engine has volume enabled, see `ReclaimEngine::EnableVolume`.
+	 */
+	double Volume;
+
+	/**
+	 * @brief The line number associated with the rectangle.
+	 *
+	 * This is the sierra chart LineNumber of the rectangle drawing that corresplonds to the reclaim
+	 */
+	int LineNumber;
+
+	/**
+	 * @brief Unique id of the reclaim within its engine.
+	 *
+	 * Assigned when the reclaim is created and kept while the reclaim moves in the array, so views
+	 * that draw the reclaims of a shared engine can tell them apart.
+	 */
+	int64_t Id;
+
+	/**
+	 * @brief Handle of the reclaim, resolved to the reclaim in O(1) by `ReclaimEngine::Resolve`.
+	 *
+	 * Unlike the array position it does not change when the array is shifted, and unlike `Id` it
+	 * is unique across the engines of the process and tells which side the reclaim is on.
+	 */
+	ReclaimHandle Handle;
+
+	/**
+	 * @brief Flag indicating if the rectangle has been deleted.
+	 *
+	 * When set to `true`, the rectangle is considered deleted and should no longer be displayed.
+	 */
+	bool Deleted;
+
+	/**
+	 * @brief Type of the reclaim.
+	 *
+	 * Defines the type of reclaim:
+	 * - `0`: Bullish reclaim
+	 * - `1`: Bearish reclaim
+	 */
+	int Type;
+};
+
+/**
+ * @struct ReclaimBounds
+ * @brief The fields of a reclaim that the update of the older reclaims reads, 12 bytes.
+ *
+ * The engine keeps them in arrays next to the `Reclaim` arrays. The older reclaims only move their
+ * active side, so a price that goes through them scans these arrays and only touches the full
+ * `Reclaim` of the reclaims that change. With 1000 reclaims per side both arrays fit in 24 KB of
+ * L1 cache, the `Reclaim` arrays take 128 KB. The prices stay floats, so the results do not depend
+ * on the prices being on the tick grid.
+ */
+struct ReclaimBounds
+{
+	float FixedSidePrice;
+	float ActiveSidePrice;
+	uint32_t Deleted;
+};
+
+/**
+ * @struct ReclaimSettings
+ * @brief The study inputs that change how reclaims are computed.
+ */
+struct ReclaimSettings
+{
+	/**
+	 * @brief Length of the up and down reclaims arrays ("Max active reclaims").
+	 */
+	int MaxNumberOfReclaims;
+
+	/**
+	 * @brief Retracement in ticks of the current reclaim that creates a new one ("Threshold tick size").
+	 */
+	int NewReclaimThreshold;
+
+	/**
+	 * @brief Tick size of the instrument.
+	 */
+	float TickSize;
+
+	/**
+	 * @brief When true, reclaims are only updated with the high and low of closed bars.
+	 */
+	bool UpdateOnBarClose;
+
+	/**
+	 * @brief Number of bars of the average true range that scales the threshold, 0 for a fixed threshold.
+	 */
+	int AdaptiveThresholdBars;
+
+	/**
+	 * @brief Adaptive threshold as a fraction of the average true range.
+	 *
+	 * A new reclaim is created when the current one retraced this fraction of a typical bar, so
+	 * reclaims are created at about the same rate in quiet and in volatile sessions.
+	 */
+	float AdaptiveThresholdFactor;
+};
+
+/**
+ * @class ReclaimListener
+ * @brief Receives notifications about reclaim changes from a `ReclaimEngine`.
+ *
+ * All methods have an empty default implementation, so a listener only overrides what it needs.
+ */
+class ReclaimListener
+{
+public:
+	virtual ~ReclaimListener() {}
+
+	/**
+	 * @brief Called when a reclaim becomes the current reclaim of its side (index 0).
+	 *
+	 * The listener may set `reclaim.LineNumber`.
+	 */
+	virtual void OnReclaimCreated(Reclaim & /* reclaim */) {}
+
+	/**
+	 * @brief Called for every reclaim that is still active after an update.
+	 *
+	 * @param reclaim The updated reclaim.
+	 * @param reclaimIndex The index of the reclaim in its array. Index 0 is the current reclaim.
+	 */
+	virtual void OnReclaimUpdated(const Reclaim & /* reclaim */, int /* reclaimIndex */) {}
+
+	/**
+	 * @brief Called when price crosses the fixed side of a reclaim.
+	 */
+	virtual void OnReclaimReclaimed(const Reclaim & /* reclaim */) {}
+
+	/**
+	 * @brief Called when an active reclaim is pushed out of the end of its array by a new one.
+	 */
+	virtual void OnReclaimEvicted(const Reclaim & /* reclaim */) {}
+};
+
+/**
+ * @class ReclaimLevelIndex
+ * @brief Active reclaims of one side ordered by the price of their active side.
+ *
+ * Used to answer nearest level and range queries in O(log n). Each entry stores the reclaim id and
+ * the number of times the reclaims array had been shifted when the reclaim was created, which gives
+ * the current array index of the reclaim without a scan.
+ */
+class ReclaimLevelIndex
+{
+public:
+	typedef std::pair<float, int64_t> Key;           // active side price, reclaim id
+	typedef std::map<Key, int64_t> Levels;           // value: shift count at creation
+	typedef Levels::const_iterator Iterator;
+
+	void Clear() { m_Levels.clear(); }
+
+	void Insert(float price, int64_t id, int64_t creationShift) { m_Levels[Key(price, id)] = creationShift; }
+
+	void Erase(float price, int64_t id) { m_Levels.erase(Key(price, id)); }
+
+	/**
+	 * @brief Moves a reclaim whose active side price changed.
+	 */
+	void Move(float oldPrice, float newPrice, int64_t id)
+	{
+		if (oldPrice == newPrice)
+			return;
+
+		Levels::iterator found = m_Levels.find(Key(oldPrice, id));
+		if (found == m_Levels.end())
+			return;
+
+		// reuses the node of the level, a price change does not allocate
+		Levels::node_type node = m_Levels.extract(found);
+		node.key() = Key(newPrice, id);
+		m_Levels.insert(std::move(node));
+	}
+
+	/**
+	 * @brief Returns the first level with a price at or above `price`.
+	 */
+	Iterator LowerBound(float price) const { return m_Levels.lower_bound(Key(price, INT64_MIN)); }
+
+	/**
+	 * @brief Returns the first level with a price above `price`.
+	 */
+	Iterator UpperBound(float price) const { return m_Levels.upper_bound(Key(price, INT64_MAX)); }
+
+	Iterator Begin() const { return m_Levels.begin(); }
+	Iterator End() const { return m_Levels.end(); }
+	int GetCount() const { return (int)m_Levels.size(); }
+
+private:
+	Levels m_Levels;
+};
+
+/**
+ * @struct ReclaimEngineState
+ * @brief Everything a `ReclaimEngine` needs to continue from a point of a replay.
+ */
+struct ReclaimEngineState
+{
+	std::vector<Reclaim> UpReclaims;
+	std::vector<Reclaim> DownReclaims;
+	bool Started;
+	int64_t NextId;
+
+	// high, low and last price of the bar that is being built by ProcessTrade
+	float BarHigh;
+	float BarLow;
+	float BarClose;
+
+	// adaptive threshold, see ReclaimSettings::AdaptiveThresholdBars
+	int Threshold;
+	ReclaimVolatility Volatility;
+};
+
+/**
+ * @class ReclaimEngine
+ * @brief Holds the up and down reclaims arrays and updates them from prices.
+ *
+ * The engine can be driven bar by bar (`UpdateReclaims` + `CreateReclaims`, like the chart study
+ * does on bar data) or trade by trade (`ProcessTrade`), which reproduces what the study computes
+ * when it runs live on every trade.
+ */
+class ReclaimEngine
+{
+public:
+	ReclaimEngine()
+		: m_Started(false)
+		, m_IndexEnabled(false)
+		, m_VolumeEnabled(false)
+		, m_CoverageEnabled(false)
+		, m_UpShifts(0)
+		, m_DownShifts(0)
+		, m_UpFloor(std::numeric_limits<float>::infinity())
+		, m_DownCeiling(-std::numeric_limits<float>::infinity())
+		, m_NextId(1)
+		, m_BarHigh(0)
+		, m_BarLow(0)
+		, m_BarClose(0)
+		, m_Threshold(1)
+		, m_Generation(NextGeneration())
+		, p_Trace(NULL)
+	{
+		m_Settings.MaxNumberOfReclaims = 1;
+		m_Settings.NewReclaimThreshold = 1;
+		m_Settings.TickSize = 1;
+		m_Settings.UpdateOnBarClose = false;
+		m_Settings.AdaptiveThresholdBars = 0;
+		m_Settings.AdaptiveThresholdFactor = 0;
+	}
+
+	/**
+	 * @brief Clears all reclaims and applies new settings.
+	 *
+	 * The engine does not hold any reclaim until `Start` is called (or the first trade is processed).
+	 */
+	void Reset(const ReclaimSettings &settings)
+	{
+		m_Settings = settings;
+		m_Started = false;
+		m_NextId = 1;
+		m_Generation = NextGeneration();
+
+		m_UpReclaims.assign(settings.MaxNumberOfReclaims, EmptyReclaim(0));
+		m_DownReclaims.assign(settings.MaxNumberOfReclaims, EmptyReclaim(1));
+		RebuildBounds();
+
+		m_UpIndex.Clear();
+		m_DownIndex.Clear();
+		m_UpShifts = 0;
+		m_DownShifts = 0;
+		m_UpFloor = std::numeric_limits<float>::infinity();
+		m_DownCeiling = -std::numeric_limits<float>::infinity();
+
+		m_UpCoverage.Reset(settings.TickSize);
+		m_DownCoverage.Reset(settings.TickSize);
+
+		m_Threshold = settings.NewReclaimThreshold;
+		m_Volatility.Reset(settings.AdaptiveThresholdFactor > 0 ? settings.AdaptiveThresholdBars : 0);
+	}
+
+	/**
+	 * @brief Enables the ordered level indexes used by `FindNearest`, `FindKNearest` and `FindInRange`.
+	 *
+	 * The indexes cost O(log n) per reclaim change, so they are off unless a consumer needs them. When
+	 * enabled on an engine that already has reclaims, the indexes are built from the reclaims arrays.
+	 */
+	void EnableLevelIndex(bool enable)
+	{
+		if (enable == m_IndexEnabled)
+			return;
+
+		m_IndexEnabled = enable;
+		RebuildIndex(0);
+		RebuildIndex(1);
+	}
+
+	bool IsLevelIndexEnabled() const { return m_IndexEnabled; }
+
+	/**
+	 * @brief Enables the per tick coverage counts returned by `GetCoverage`.
+	 *
+	 * Each reclaim change costs O(log P) in the number of ticks covered by the reclaims. When enabled
+	 * on an engine that already has reclaims, the counts are built from the reclaims arrays.
+	 */
+	void EnableCoverage(bool enable)
+	{
+		if (enable && !m_CoverageEnabled)
+		{
+			m_UpCoverage.Reset(m_Settings.TickSize);
+			m_DownCoverage.Reset(m_Settings.TickSize);
+			RebuildCoverage(0);
+			RebuildCoverage(1);
+		}
+		m_CoverageEnabled = enable;
+	}
+
+	bool IsCoverageEnabled() const { return m_CoverageEnabled; }
+
+	/**
+	 * @brief Sets the trace that receives the spans of the up and down updates, `NULL` to stop tracing.
+	 *
+	 * The trace is not owned by the engine and is not part of its state.
+	 */
+	void SetTrace(ReclaimTrace *trace) { p_Trace = trace; }
+
+	ReclaimTrace *GetTrace() const { return p_Trace; }
+
+	/**
+	 * @brief Enables the volume accumulated in `Reclaim::Volume` by `ProcessTrade` and `AddVolume`.
+	 *
+	 * Enabling volume also enables the level indexes, which `AddVolume` uses to find the reclaims that
+	 * contain a trade. Enabled after `Start`, the reclaims only count the volume of the later trades.
+	 */
+	void EnableVolume(bool enable)
+	{
+		m_VolumeEnabled = enable;
+		if (enable)
+			EnableLevelIndex(true);
+	}
+
+	bool IsVolumeEnabled() const { return m_VolumeEnabled; }
+
+	/**
+	 * @brief Returns the number of active reclaims of one side whose area contains a price.
+	 *
+	 * Requires `EnableCoverage`. O(log P).
+	 *
+	 * @param type `0` for bullish reclaims, `1` for bearish reclaims.
+	 */
+	int GetCoverage(int type, float price) const { return (type == 0 ? m_UpCoverage : m_DownCoverage).GetCount(price); }
+
+	/**
+	 * @brief Creates the first bullish and bearish reclaims at the given price.
+	 *
+	 * @param price Price of both reclaims.
+	 * @param dateTime Start date of both reclaims.
+	 * @param listener Optional listener notified about the two new reclaims.
+	 */
+	void Start(float price, double dateTime, ReclaimListener *listener = NULL)
+	{
+		StartReclaim(m_UpReclaims[0], price, dateTime);
+		StartReclaim(m_DownReclaims[0], price, dateTime);
+		CopyBounds(m_UpReclaims[0], m_UpBounds[0]);
+		CopyBounds(m_DownReclaims[0], m_DownBounds[0]);
+		LevelAdded(0, m_UpReclaims[0]);
+		LevelAdded(1, m_DownReclaims[0]);
+
+		m_BarHigh = price;
+		m_BarLow = price;
+		m_BarClose = price;
+		m_Started = true;
+
+		if (listener != NULL)
+		{
+			listener->OnReclaimCreated(m_UpReclaims[0]);
+			listener->OnReclaimCreated(m_DownReclaims[0]);
+		}
+	}
+
+	/**
+	 * @brief Updates all reclaims with a price range.
+	 *
+	 * If a reclaim has been fully reclaimed (price crosses the fixed side), it is marked as deleted.
+	 * The older reclaims are skipped, and not reported to the listener, when the range cannot change
+	 * any of them, which is the case for most trades.
+	 *
+	 * @param high Highest price since the last update.
+	 * @param low Lowest price since the last update.
+	 * @param close Close of the current bar, used for the retracement of the current reclaims.
+	 * @param dateTime Start date of the current bar, used when a current reclaim is restarted.
+	 * @param listener Optional listener notified about every change.
+	 */
+	void UpdateReclaims(float high, float low, float close, double dateTime, ReclaimListener *listener = NULL)
+	{
+		const float tickSize = m_Settings.TickSize;
+
+		// the older reclaims were updated with every price since the last shift, so their active side
+		// is at or below the lowest of them and only a lower low can change or reclaim one of them
+		const bool updateOlderUp = low < m_UpFloor;
+		const bool updateOlderDown = high > m_DownCeiling;
+		m_UpFloor = std::min(m_UpFloor, low);
+		m_DownCeiling = std::max(m_DownCeiling, high);
+
+		ReclaimTraceSpan upSpan(p_Trace, "update up");
+
+		// update the current up reclaim according to the price range
+		{
+			Reclaim &reclaim = m_UpReclaims[0];
+			float oldFixedSidePrice = reclaim.FixedSidePrice;
+			float oldActiveSidePrice = reclaim.ActiveSidePrice;
+
+			// update active side of first rectangle
+			reclaim.ActiveSidePrice = high;
+
+			// update reclaim max height parameter if it got bigger
+			reclaim.CurrentHeight = (int)((reclaim.ActiveSidePrice - reclaim.FixedSidePrice) / tickSize);
+
+			int newMaxHeight = int((high - reclaim.FixedSidePrice) / tickSize);
+			if (newMaxHeight > reclaim.MaxHeight)
+			{
+				reclaim.MaxHeight = newMaxHeight;
+			}
+
+			int newMaxRetracement = int((reclaim.FixedSidePrice + reclaim.MaxHeight * tickSize - close) / tickSize);
+			if (newMaxRetracement > reclaim.MaxRetracement)
+			{
+				reclaim.MaxRetracement = newMaxRetracement;
+			}
+
+			if (low <= reclaim.FixedSidePrice)
+			{
+				// update fixed side as well
+				reclaim.FixedSidePrice = low;
+				reclaim.ActiveSidePrice = low;
+				reclaim.StartDate = dateTime;
+				reclaim.CurrentHeight = 0;
+				reclaim.MaxHeight = 0;
+				reclaim.MaxRetracement = 0;
+				reclaim.Volume = 0;
+			}
+
+			CopyBounds(reclaim, m_UpBounds[0]);
+			LevelChanged(0, oldFixedSidePrice, oldActiveSidePrice, reclaim);
+
+			if (listener != NULL)
+				listener->OnReclaimUpdated(reclaim, 0);
+		}
+
+		if (updateOlderUp)
+			UpdateOlderReclaims(0, high, low, listener);
+
+		upSpan.End();
+		ReclaimTraceSpan downSpan(p_Trace, "update down");
+
+		// update the current down reclaim according to the price range
+		{
+			Reclaim &reclaim = m_DownReclaims[0];
+			float oldFixedSidePrice = reclaim.FixedSidePrice;
+			float oldActiveSidePrice = reclaim.ActiveSidePrice;
+
+			// update active side of first rectangle
+			reclaim.ActiveSidePrice = low;
+
+			reclaim.CurrentHeight = (int)((reclaim.FixedSidePrice - reclaim.ActiveSidePrice) / tickSize);
+
+			// update reclaim max height parameter if it got bigger
+			int newMaxHeight = int((reclaim.FixedSidePrice - low) / tickSize);
+			if (newMaxHeight > reclaim.MaxHeight)
+			{
+				reclaim.MaxHeight = newMaxHeight;
+			}
+
+			int newMaxRetracement = int((close - (reclaim.FixedSidePrice - reclaim.MaxHeight * tickSize)) / tickSize);
+			if (newMaxRetracement > reclaim.MaxRetracement)
+			{
+				reclaim.MaxRetracement = newMaxRetracement;
+			}
+
+			if (high >= reclaim.FixedSidePrice)
+			{
+				// update fixed side as well
+				reclaim.FixedSidePrice = high;
+				reclaim.StartDate = dateTime;
+				reclaim.CurrentHeight = 0;
+				reclaim.MaxHeight = 0;
+				reclaim.MaxRetracement = 0;
+				reclaim.Volume = 0;
+			}
+
+			CopyBounds(reclaim, m_DownBounds[0]);
+			LevelChanged(1, oldFixedSidePrice, oldActiveSidePrice, reclaim);
+
+			if (listener != NULL)
+				listener->OnReclaimUpdated(reclaim, 0);
+		}
+
+		if (updateOlderDown)
+			UpdateOlderReclaims(1, high, low, listener);
+	}
+
+	/**
+	 * @brief Creates new current reclaims when the current ones retraced enough.
+	 *
+	 * This is evaluated once per bar. When a new reclaim is created, the reclaims array is shifted
+	 * to the right and the last reclaim is dropped.
+	 *
+	 * @param price Price of the new reclaims.
+	 * @param dateTime Start date of the new reclaims.
+	 * @param listener Optional listener notified about every change.
+	 */
+	void CreateReclaims(float price, double dateTime, ReclaimListener *listener = NULL)
+	{
+		ReclaimTraceSpan span(p_Trace, "create");
+
+		// Check if we need to create a new bullish reclaim
+		if (m_UpReclaims[0].MaxRetracement >= m_Threshold)
+		{
+			ShiftAndCreate(m_UpReclaims, price, dateTime, listener);
+		}
+
+		// Check if we need to create a new bearish reclaim
+		if (m_DownReclaims[0].MaxRetracement >= m_Threshold)
+		{
+			ShiftAndCreate(m_DownReclaims, price, dateTime, listener);
+		}
+	}
+
+	/**
+	 * @brief Adds a closed bar to the average true range and updates the adaptive threshold.
+	 *
+	 * Does nothing with a fixed threshold. Called before `CreateReclaims` on every new bar. O(1).
+	 */
+	void CloseBar(float high, float low, float close)
+	{
+		if (m_Settings.AdaptiveThresholdFactor <= 0 || m_Settings.AdaptiveThresholdBars <= 0)
+			return;
+
+		m_Volatility.AddBar(high, low, close);
+
+		double ticks = m_Volatility.GetAverageRange() * m_Settings.AdaptiveThresholdFactor / m_Settings.TickSize;
+		m_Threshold = std::max(1, (int)std::floor(ticks + 0.5));
+	}
+
+	/**
+	 * @brief Returns the retracement in ticks that creates a new reclaim, see `CloseBar`.
+	 */
+	int GetThreshold() const { return m_Threshold; }
+
+	/**
+	 * @brief Processes a single trade the same way the chart study processes live updates.
+	 *
+	 * Every trade updates the reclaims (unless UpdateOnBarClose is set). The first trade of a new
+	 * bar also creates new reclaims and updates the reclaims with the high and low of the bar that
+	 * just closed.
+	 *
+	 * @param price Trade price.
+	 * @param volume Trade volume, added to the reclaims that contain the price when volume is enabled.
+	 * @param barDateTime Start date of the bar that contains the trade.
+	 * @param newBar True if this is the first trade of a new bar.
+	 * @param listener Optional listener notified about every change.
+	 */
+	void ProcessTrade(float price, float volume, double barDateTime, bool newBar, ReclaimListener *listener = NULL)
+	{
+		if (!m_Started)
+		{
+			Start(price, barDateTime, listener);
+			AddVolume(price, volume);
+			return;
+		}
+
+		// the trade is inside the reclaims before they are updated with its price
+		AddVolume(price, volume);
+
+		if (!m_Settings.UpdateOnBarClose)
+		{
+			UpdateReclaims(price, price, price, barDateTime, listener);
+		}
+
+		if (newBar)
+		{
+			CloseBar(m_BarHigh, m_BarLow, m_BarClose);
+			CreateReclaims(price, barDateTime, listener);
+			UpdateReclaims(m_BarHigh, m_BarLow, price, barDateTime, listener);
+
+			m_BarHigh = price;
+			m_BarLow = price;
+			m_BarClose = price;
+			return;
+		}
+
+		if (price > m_BarHigh)
+			m_BarHigh = price;
+		if (price < m_BarLow)
+			m_BarLow = price;
+		m_BarClose = price;
+	}
+
+	/**
+	 * @brief Updates a reclaim that is not the current one with a price range.
+	 *
+	 * The active side of a bullish reclaim moves down to the low, the active side of a bearish
+	 * reclaim moves up to the high, and the reclaim is reclaimed when the price reaches its fixed side.
+	 *
+	 * @return `true` if the reclaim has been reclaimed. The caller marks it as deleted.
+	 */
+	static bool UpdateOlderReclaim(Reclaim &reclaim, float high, float low)
+	{
+		ReclaimBounds bounds;
+		CopyBounds(reclaim, bounds);
+
+		bool reclaimed = UpdateOlderBounds(bounds, reclaim.Type, high, low);
+		reclaim.ActiveSidePrice = bounds.ActiveSidePrice;
+		return reclaimed;
+	}
+
+	/**
+	 * @brief Copies the reclaims and the trade processing state.
+	 */
+	void SaveState(ReclaimEngineState &state) const
+	{
+		state.UpReclaims = m_UpReclaims;
+		state.DownReclaims = m_DownReclaims;
+		state.Started = m_Started;
+		state.NextId = m_NextId;
+		state.BarHigh = m_BarHigh;
+		state.BarLow = m_BarLow;
+		state.BarClose = m_BarClose;
+		state.Threshold = m_Threshold;
+		state.Volatility = m_Volatility;
+	}
+
+	/**
+	 * @brief Continues from a state saved by an engine with the same settings.
+	 *
+	 * The level indexes and the coverage are rebuilt from the reclaims.
+	 */
+	void RestoreState(const ReclaimEngineState &state)
+	{
+		m_UpReclaims = state.UpReclaims;
+		m_DownReclaims = state.DownReclaims;
+		RebuildBounds();
+		m_Started = state.Started;
+		m_NextId = state.NextId;
+		m_BarHigh = state.BarHigh;
+		m_BarLow = state.BarLow;
+		m_BarClose = state.BarClose;
+		m_Threshold = state.Threshold;
+		m_Volatility = state.Volatility;
+
+		// with no shift yet, the reclaim at index i was created -i shifts ago
+		m_UpShifts = 0;
+		m_DownShifts = 0;
+		m_UpFloor = std::numeric_limits<float>::infinity();
+		m_DownCeiling = -std::numeric_limits<float>::infinity();
+
+		// the handles of the saved state belong to another generation
+		m_Generation = NextGeneration();
+		for (int i = 0; i < (int)m_UpReclaims.size(); i++)
+		{
+			m_UpReclaims[i].Handle = m_UpReclaims[i].Deleted ? 0 : MakeHandle(0, -i);
+			m_DownReclaims[i].Handle = m_DownReclaims[i].Deleted ? 0 : MakeHandle(1, -i);
+		}
+
+		RebuildIndex(0);
+		RebuildIndex(1);
+
+		if (m_CoverageEnabled)
+		{
+			RebuildCoverage(0);
+			RebuildCoverage(1);
+		}
+	}
+
+	/**
+	 * @brief Returns the id the next created reclaim will get.
+	 */
+	int64_t GetNextId() const { return m_NextId; }
+
+	/**
+	 * @brief Returns the active reclaim of a handle, or NULL once it is reclaimed or evicted. O(1).
+	 *
+	 * A handle holds the generation of the engine, the side and the number of shifts of its array
+	 * when the reclaim was created, so the position of the reclaim is the number of shifts since
+	 * then. `Reset` and `RestoreState` start a new generation, handles of other generations and
+	 * other engines resolve to NULL.
+	 */
+	const Reclaim *Resolve(ReclaimHandle handle) const
+	{
+		if ((uint32_t)(handle >> HANDLE_GENERATION_SHIFT) != m_Generation)
+			return NULL;
+
+		int type = (int)((handle >> HANDLE_TYPE_SHIFT) & 1);
+
+		// the creation shift is a signed 47 bit number, negative for the reclaims of a restored state
+		int64_t creationShift = (int64_t)(handle << (64 - HANDLE_TYPE_SHIFT)) >> (64 - HANDLE_TYPE_SHIFT);
+		int64_t index = (type == 0 ? m_UpShifts : m_DownShifts) - creationShift;
+		if (index < 0 || index >= GetSize())
+			return NULL;
+
+		const Reclaim &reclaim = (type == 0 ? m_UpReclaims : m_DownReclaims)[(size_t)index];
+		return reclaim.Handle == handle && !reclaim.Deleted ? &reclaim : NULL;
+	}
+
+	Reclaim *Resolve(ReclaimHandle handle) { return const_cast<Reclaim *>(static_cast<const ReclaimEngine *>(this)->Resolve(handle)); }
+
+	/**
+	 * @brief Returns the number of reclaims created on one side since the last reset or restore, not counting `Start`.
+	 */
+	int64_t GetCreatedCount(int type) const { return type == 0 ? m_UpShifts : m_DownShifts; }
+
+	float GetBarHigh() const { return m_BarHigh; }
+	float GetBarLow() const { return m_BarLow; }
+
+	/**
+	 * @brief Adds the volume of a trade to every active reclaim whose area contains its price.
+	 *
+	 * Does nothing unless volume is enabled. Bullish reclaims contain the price when their active
+	 * side is at or above it, bearish reclaims when it is at or below it, so only those reclaims are
+	 * visited through the level indexes and checked against their fixed side.
+	 *
+	 * @param price Trade price.
+	 * @param volume Trade volume.
+	 */
+	void AddVolume(float price, float volume)
+	{
+		if (!m_VolumeEnabled || volume <= 0)
+			return;
+
+		for (ReclaimLevelIndex::Iterator it = m_UpIndex.LowerBound(price); it != m_UpIndex.End(); ++it)
+		{
+			Reclaim *reclaim = GetIndexedReclaim(0, it);
+			if (reclaim->FixedSidePrice <= price)
+				reclaim->Volume += volume;
+		}
+
+		ReclaimLevelIndex::Iterator end = m_DownIndex.UpperBound(price);
+		for (ReclaimLevelIndex::Iterator it = m_DownIndex.Begin(); it != end; ++it)
+		{
+			Reclaim *reclaim = GetIndexedReclaim(1, it);
+			if (reclaim->FixedSidePrice >= price)
+				reclaim->Volume += volume;
+		}
+	}
+
+	/**
+	 * @brief Returns true once the first reclaims have been created.
+	 */
+	bool IsStarted() const { return m_Started; }
+
+	/**
+	 * @brief Returns the settings the engine was last reset with.
+	 */
+	const ReclaimSettings &GetSettings() const { return m_Settings; }
+
+	/**
+	 * @brief Returns the length of the up and down reclaims arrays.
+	 */
+	int GetSize() const { return m_Settings.MaxNumberOfReclaims; }
+
+	/**
+	 * @brief Bullish reclaims. Index 0 is the current reclaim.
+	 */
+	Reclaim *GetUpReclaims() { return m_UpReclaims.data(); }
+	const Reclaim *GetUpReclaims() const { return m_UpReclaims.data(); }
+
+	/**
+	 * @brief Bearish reclaims. Index 0 is the current reclaim.
+	 */
+	Reclaim *GetDownReclaims() { return m_DownReclaims.data(); }
+	const Reclaim *GetDownReclaims() const { return m_DownReclaims.data(); }
+
+	/**
+	 * @brief Finds the active reclaim whose active side is nearest to a price in one direction.
+	 *
+	 * Requires `EnableLevelIndex`. O(log n).
+	 *
+	 * @param type `0` for bullish reclaims, `1` for bearish reclaims.
+	 * @param price Reference price.
+	 * @param above `true` for the nearest active side at or above `price`, `false` for at or below.
+	 * @return The reclaim, or NULL if there is none.
+	 */
+	const Reclaim *FindNearest(int type, float price, bool above) const
+	{
+		const ReclaimLevelIndex &index = GetIndex(type);
+
+		if (above)
+		{
+			ReclaimLevelIndex::Iterator found = index.LowerBound(price);
+			return found != index.End() ? GetIndexedReclaim(type, found) : NULL;
+		}
+
+		ReclaimLevelIndex::Iterator found = index.UpperBound(price);
+		if (found == index.Begin())
+			return NULL;
+		--found;
+		return GetIndexedReclaim(type, found);
+	}
+
+	/**
+	 * @brief Finds the `k` active reclaims whose active sides are nearest to a price, nearest first.
+	 *
+	 * Requires `EnableLevelIndex`. O(log n + k).
+	 *
+	 * @param type `0` for bullish reclaims, `1` for bearish reclaims.
+	 * @param price Reference price.
+	 * @param k Maximum number of results.
+	 * @param results Receives up to `k` reclaims.
+	 * @return The number of results.
+	 */
+	int FindKNearest(int type, float price, int k, const Reclaim **results) const
+	{
+		const ReclaimLevelIndex &index = GetIndex(type);
+
+		ReclaimLevelIndex::Iterator above = index.LowerBound(price);
+		ReclaimLevelIndex::Iterator below = above;
+
+		int count = 0;
+		while (count < k)
+		{
+			bool hasAbove = above != index.End();
+			bool hasBelow = below != index.Begin();
+			if (!hasAbove && !hasBelow)
+				break;
+
+			ReclaimLevelIndex::Iterator previous = below;
+			if (hasBelow)
+				--previous;
+
+			if (hasAbove && (!hasBelow || above->first.first - price <= price - previous->first.first))
+			{
+				results[count++] = GetIndexedReclaim(type, above);
+				++above;
+			}
+			else
+			{
+				results[count++] = GetIndexedReclaim(type, previous);
+				below = previous;
+			}
+		}
+
+		return count;
+	}
+
+	/**
+	 * @brief Finds the active reclaims whose active side is inside a price range, lowest first.
+	 *
+	 * Requires `EnableLevelIndex`. O(log n + number of results).
+	 *
+	 * @param type `0` for bullish reclaims, `1` for bearish reclaims.
+	 * @param low Lowest price of the range.
+	 * @param high Highest price of the range.
+	 * @param results Receives up to `maxResults` reclaims.
+	 * @param maxResults Size of `results`.
+	 * @return The number of results.
+	 */
+	int FindInRange(int type, float low, float high, const Reclaim **results, int maxResults) const
+	{
+		const ReclaimLevelIndex &index = GetIndex(type);
+
+		int count = 0;
+		ReclaimLevelIndex::Iterator end = index.UpperBound(high);
+		for (ReclaimLevelIndex::Iterator it = index.LowerBound(low); it != end && count < maxResults; ++it)
+			results[count++] = GetIndexedReclaim(type, it);
+
+		return count;
+	}
+
+private:
+	static Reclaim EmptyReclaim(int type)
+	{
+		Reclaim reclaim;
+		reclaim.FixedSidePrice = 0;
+		reclaim.ActiveSidePrice = 0;
+		reclaim.MaxHeight = 0;
+		reclaim.CurrentHeight = 0;
+		reclaim.MaxRetracement = 0;
+		reclaim.StartDate = 0;
+		reclaim.Volume = 0;
+		reclaim.LineNumber = 0;
+		reclaim.Id = 0;
+		reclaim.Handle = 0;
+		reclaim.Deleted = true;
+		reclaim.Type = type;
+		return reclaim;
+	}
+
+	void StartReclaim(Reclaim &reclaim, float price, double dateTime)
+	{
+		reclaim.Id = m_NextId++;
+		reclaim.Handle = MakeHandle(reclaim.Type, GetShifts(reclaim.Type));
+		reclaim.FixedSidePrice = price;
+		reclaim.ActiveSidePrice = price;
+		reclaim.StartDate = dateTime;
+		reclaim.MaxHeight = 0;
+		reclaim.CurrentHeight = 0;
+		reclaim.MaxRetracement = 0;
+		reclaim.Volume = 0;
+		reclaim.Deleted = false;
+	}
+
+	void ShiftAndCreate(std::vector<Reclaim> &reclaims, float price, double dateTime, ReclaimListener *listener)
+	{
+		const int size = m_Settings.MaxNumberOfReclaims;
+
+		const int type = reclaims[0].Type;
+
+		// the last array element is dropped
+		if (!reclaims[size - 1].Deleted)
+		{
+			LevelRemoved(type, reclaims[size - 1].FixedSidePrice, reclaims[size - 1].ActiveSidePrice, reclaims[size - 1].Id);
+			if (listener != NULL)
+				listener->OnReclaimEvicted(reclaims[size - 1]);
+		}
+
+		// Shift elements of the array to the right
+		std::vector<ReclaimBounds> &bounds = GetBounds(type);
+		for (int i = size - 1; i > 0; --i)
+		{
+			reclaims[i] = reclaims[i - 1];
+			bounds[i] = bounds[i - 1];
+		}
+
+		GetShifts(type)++;
+
+		// the shifted reclaim has not seen any price as an older reclaim yet
+		if (type == 0)
+			m_UpFloor = std::numeric_limits<float>::infinity();
+		else
+			m_DownCeiling = -std::numeric_limits<float>::infinity();
+
+		// first member of the array is now the new reclaim
+		StartReclaim(reclaims[0], price, dateTime);
+		CopyBounds(reclaims[0], bounds[0]);
+		LevelAdded(type, reclaims[0]);
+
+		if (listener != NULL)
+			listener->OnReclaimCreated(reclaims[0]);
+	}
+
+	/**
+	 * @brief Updates the older reclaims of one side (index 1 and up) with a price range.
+	 *
+	 * Only the bounds are read for the reclaims the range does not change. Without a listener
+	 * their `Reclaim` is not touched at all.
+	 */
+	void UpdateOlderReclaims(int type, float high, float low, ReclaimListener *listener)
+	{
+		std::vector<Reclaim> &reclaims = type == 0 ? m_UpReclaims : m_DownReclaims;
+		std::vector<ReclaimBounds> &bounds = GetBounds(type);
+		const int size = m_Settings.MaxNumberOfReclaims;
+
+		for (int i = 1; i < size; i++)
+		{
+			ReclaimBounds &reclaimBounds = bounds[i];
+
+			// reclaimed reclaims stay in the array until they are shifted out
+			if (reclaimBounds.Deleted)
+				continue;
+
+			float oldActiveSidePrice = reclaimBounds.ActiveSidePrice;
+			bool reclaimed = UpdateOlderBounds(reclaimBounds, type, high, low);
+			if (!reclaimed && reclaimBounds.ActiveSidePrice == oldActiveSidePrice && listener == NULL)
+				continue;
+
+			Reclaim &reclaim = reclaims[i];
+			reclaim.ActiveSidePrice = reclaimBounds.ActiveSidePrice;
+
+			if (reclaimed)
+			{
+				// the reclaim has been reclaimed
+				reclaimBounds.Deleted = 1;
+				reclaim.Deleted = true;
+				LevelRemoved(type, reclaim.FixedSidePrice, oldActiveSidePrice, reclaim.Id);
+				if (listener != NULL)
+					listener->OnReclaimReclaimed(reclaim);
+				continue;
+			}
+
+			LevelChanged(type, reclaim.FixedSidePrice, oldActiveSidePrice, reclaim);
+
+			if (listener != NULL)
+				listener->OnReclaimUpdated(reclaim, i);
+		}
+	}
+
+	/**
+	 * @brief `UpdateOlderReclaim` on the bounds of a reclaim of the given type.
+	 */
+	static bool UpdateOlderBounds(ReclaimBounds &bounds, int type, float high, float low)
+	{
+		if (type == 0)
+		{
+			if (low < bounds.ActiveSidePrice)
+			{
+				bounds.ActiveSidePrice = std::max(low, bounds.FixedSidePrice);
+			}
+
+			return low <= bounds.FixedSidePrice || bounds.ActiveSidePrice <= bounds.FixedSidePrice;
+		}
+
+		if (high > bounds.ActiveSidePrice)
+		{
+			bounds.ActiveSidePrice = std::min(high, bounds.FixedSidePrice);
+		}
+
+		return high >= bounds.FixedSidePrice || bounds.ActiveSidePrice >= bounds.FixedSidePrice;
+	}
+
+	static void CopyBounds(const Reclaim &reclaim, ReclaimBounds &bounds)
+	{
+		bounds.FixedSidePrice = reclaim.FixedSidePrice;
+		bounds.ActiveSidePrice = reclaim.ActiveSidePrice;
+		bounds.Deleted = reclaim.Deleted ? 1 : 0;
+	}
+
+	/**
+	 * @brief Copies the bounds of every reclaim after the reclaims arrays were replaced.
+	 */
+	void RebuildBounds()
+	{
+		m_UpBounds.resize(m_UpReclaims.size());
+		m_DownBounds.resize(m_DownReclaims.size());
+		for (size_t i = 0; i < m_UpReclaims.size(); i++)
+			CopyBounds(m_UpReclaims[i], m_UpBounds[i]);
+		for (size_t i = 0; i < m_DownReclaims.size(); i++)
+			CopyBounds(m_DownReclaims[i], m_DownBounds[i]);
+	}
+
+	std::vector<ReclaimBounds> &GetBounds(int type) { return type == 0 ? m_UpBounds : m_DownBounds; }
+
+	// handle bits: generation (16), type (1), creation shift (47)
+	static const int HANDLE_TYPE_SHIFT = 47;
+	static const int HANDLE_GENERATION_SHIFT = 48;
+
+	ReclaimHandle MakeHandle(int type, int64_t creationShift) const
+	{
+		return ((ReclaimHandle)m_Generation << HANDLE_GENERATION_SHIFT) | ((ReclaimHandle)type << HANDLE_TYPE_SHIFT)
+			| ((ReclaimHandle)creationShift & (((ReclaimHandle)1 << HANDLE_TYPE_SHIFT) - 1));
+	}
+
+	/**
+	 * @brief Returns a generation that no engine of the process used recently, never 0.
+	 */
+	static uint32_t NextGeneration()
+	{
+		static std::atomic<uint32_t> counter(0);
+
+		uint32_t generation;
+		do
+		{
+			generation = (counter.fetch_add(1, std::memory_order_relaxed) + 1) & 0xFFFF;
+		} while (generation == 0);
+
+		return generation;
+	}
+
+	ReclaimLevelIndex &GetIndex(int type) { return type == 0 ? m_UpIndex : m_DownIndex; }
+	const ReclaimLevelIndex &GetIndex(int type) const { return type == 0 ? m_UpIndex : m_DownIndex; }
+	int64_t &GetShifts(int type) { return type == 0 ? m_UpShifts : m_DownShifts; }
+
+	ReclaimCoverage &GetCoverageCounts(int type) { return type == 0 ? m_UpCoverage : m_DownCoverage; }
+
+	/**
+	 * @brief Adds a new active reclaim to the indexes and the coverage.
+	 */
+	void LevelAdded(int type, const Reclaim &reclaim)
+	{
+		if (m_IndexEnabled)
+			GetIndex(type).Insert(reclaim.ActiveSidePrice, reclaim.Id, GetShifts(type));
+
+		if (m_CoverageEnabled && !GetCoverageCounts(type).AddRange(reclaim.FixedSidePrice, reclaim.ActiveSidePrice, 1))
+			RebuildCoverage(type);
+	}
+
+	/**
+	 * @brief Updates the indexes and the coverage after the sides of an active reclaim moved.
+	 */
+	void LevelChanged(int type, float oldFixedSidePrice, float oldActiveSidePrice, const Reclaim &reclaim)
+	{
+		// the current reclaims can be updated before Start, when they are not active yet
+		if (reclaim.Deleted || (oldFixedSidePrice == reclaim.FixedSidePrice && oldActiveSidePrice == reclaim.ActiveSidePrice))
+			return;
+
+		if (m_IndexEnabled)
+			GetIndex(type).Move(oldActiveSidePrice, reclaim.ActiveSidePrice, reclaim.Id);
+
+		if (m_CoverageEnabled)
+		{
+			ReclaimCoverage &coverage = GetCoverageCounts(type);
+			coverage.AddRange(oldFixedSidePrice, oldActiveSidePrice, -1);
+			if (!coverage.AddRange(reclaim.FixedSidePrice, reclaim.ActiveSidePrice, 1))
+				RebuildCoverage(type);
+		}
+	}
+
+	/**
+	 * @brief Removes a reclaimed or evicted reclaim from the indexes and the coverage.
+	 */
+	void LevelRemoved(int type, float fixedSidePrice, float activeSidePrice, int64_t id)
+	{
+		if (m_IndexEnabled)
+			GetIndex(type).Erase(activeSidePrice, id);
+
+		if (m_CoverageEnabled)
+			GetCoverageCounts(type).AddRange(fixedSidePrice, activeSidePrice, -1);
+	}
+
+	/**
+	 * @brief Rebuilds the level index of one side from the reclaims array, empty when it is disabled.
+	 */
+	void RebuildIndex(int type)
+	{
+		ReclaimLevelIndex &index = GetIndex(type);
+		const std::vector<Reclaim> &reclaims = type == 0 ? m_UpReclaims : m_DownReclaims;
+
+		// the reclaim at index i was created i shifts ago, the current reclaims are added by Start
+		index.Clear();
+		for (int i = 0; i < (int)reclaims.size() && m_IndexEnabled && m_Started; i++)
+		{
+			if (!reclaims[i].Deleted)
+				index.Insert(reclaims[i].ActiveSidePrice, reclaims[i].Id, GetShifts(type) - i);
+		}
+	}
+
+	/**
+	 * @brief Rebuilds the coverage of one side from the reclaims array, around the prices of its active reclaims.
+	 */
+	void RebuildCoverage(int type)
+	{
+		ReclaimCoverage &coverage = GetCoverageCounts(type);
+		const std::vector<Reclaim> &reclaims = type == 0 ? m_UpReclaims : m_DownReclaims;
+
+		int64_t lowTick = INT64_MAX;
+		int64_t highTick = INT64_MIN;
+		for (size_t i = 0; i < reclaims.size(); i++)
+		{
+			if (reclaims[i].Deleted)
+				continue;
+			lowTick = std::min(lowTick, coverage.GetTick(std::min(reclaims[i].FixedSidePrice, reclaims[i].ActiveSidePrice)));
+			highTick = std::max(highTick, coverage.GetTick(std::max(reclaims[i].FixedSidePrice, reclaims[i].ActiveSidePrice)));
+		}
+
+		if (lowTick > highTick)
+		{
+			coverage.Reset(m_Settings.TickSize);
+			return;
+		}
+
+		coverage.Rebuild(lowTick, highTick);
+		for (size_t i = 0; i < reclaims.size(); i++)
+		{
+			if (!reclaims[i].Deleted)
+				coverage.AddRange(reclaims[i].FixedSidePrice, reclaims[i].ActiveSidePrice, 1);
+		}
+	}
+
+	Reclaim *GetIndexedReclaim(int type, ReclaimLevelIndex::Iterator level)
+	{
+		std::vector<Reclaim> &reclaims = type == 0 ? m_UpReclaims : m_DownReclaims;
+		return &reclaims[(size_t)(GetShifts(type) - level->second)];
+	}
+
+	const Reclaim *GetIndexedReclaim(int type, ReclaimLevelIndex::Iterator level) const
+	{
+		// the array was shifted once for every reclaim created after this one
+		int64_t shifts = type == 0 ? m_UpShifts : m_DownShifts;
+		const std::vector<Reclaim> &reclaims = type == 0 ? m_UpReclaims : m_DownReclaims;
+		return &reclaims[(size_t)(shifts - level->second)];
+	}
+
+	ReclaimSettings m_Settings;
+	bool m_Started;
+
+	// ordered indexes of the active reclaims, see EnableLevelIndex
+	bool m_IndexEnabled;
+	ReclaimLevelIndex m_UpIndex;
+	ReclaimLevelIndex m_DownIndex;
+
+	// volume traded inside the reclaims, see EnableVolume
+	bool m_VolumeEnabled;
+
+	// number of active reclaims covering each price tick, see EnableCoverage
+	bool m_CoverageEnabled;
+	ReclaimCoverage m_UpCoverage;
+	ReclaimCoverage m_DownCoverage;
+
+	// number of times each reclaims array was shifted
+	int64_t m_UpShifts;
+	int64_t m_DownShifts;
+
+	// lowest low and highest high of the updates since the last shift, see UpdateReclaims
+	float m_UpFloor;
+	float m_DownCeiling;
+
+	// id of the next reclaim that is created
+	int64_t m_NextId;
+
+	// high, low and last price of the bar that is being built by ProcessTrade
+	float m_BarHigh;
+	float m_BarLow;
+	float m_BarClose;
+
+	// creation threshold and the average true range that scales it, see CloseBar
+	int m_Threshold;
+	ReclaimVolatility m_Volatility;
+
+	// generation of the handles, see Resolve
+	uint32_t m_Generation;
+
+	// spans of the updates, see SetTrace
+	ReclaimTrace *p_Trace;
+
+	std::vector<Reclaim> m_UpReclaims;
+	std::vector<Reclaim> m_DownReclaims;
+
+	// prices and state of the reclaims read by the updates, kept equal to the reclaims, see ReclaimBounds
+	std::vector<ReclaimBounds> m_UpBounds;
+	std::vector<ReclaimBounds> m_DownBounds;
+};
@@ -0,0 +1,726 @@
+/*
+ * @file reclaims_lifecycles.h
+ * @brief Columnar binary files of reclaim lifecycles, written off the hot path and read through a memory mapping.
+ *
+ * A lifecycle is one row per reclaim: its id, side, creation time, the time it was reclaimed or
+ * evicted, its lifetime, prices, MaxHeight, MaxRetracement and volume at that moment. Years of
+ * trades give hundreds of millions of rows, which is slow to write and to parse as CSV, so the rows
+ * are stored by column in chunks of `ReclaimLifecycleWriter::CHUNK_ROWS` rows:
+ *
+ *   header | chunk 0: column 0, column 1, ... | chunk 1: ... | footer index | tail
+ *
+ * Every column of a chunk starts on an 8 byte boundary. Integer columns are stored as they are, as
+ * zigzag varints, or as zigzag varints of the differences between consecutive values, whichever is
+ * the smallest: ids and times are close to the previous row and MaxHeight is small, so these columns
+ * shrink by 2 to 8 times. Prices and volumes are stored as they are. The footer index has, per chunk, the
+ * number of rows, the range of reclaim times and the offset, size and encoding of every column, and
+ * the tail at the end of the file points to the footer.
+ *
+ * `ReclaimLifecycleWriter` is a `ReclaimListener`: the engine thread only appends values to the
+ * columns of the current chunk, and a writer thread encodes and writes the full chunks.
+ * `ReclaimLifecycleReader` maps the file and returns the columns stored as they are without a copy,
+ * and decodes the others into a buffer of the caller.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "reclaims_engine.h"
+#include "reclaims_scid.h"
+
+/**
+ * @brief Version of the file layout, written in the header and the tail.
+ */
+static const uint32_t RECLAIM_LIFECYCLE_VERSION = 1;
+
+/**
+ * @brief Columns of a lifecycle file, in the order they are stored in every chunk.
+ */
+enum ReclaimLifecycleColumn
+{
+	RECLAIM_LIFECYCLE_ID = 0,                // int64, id of the reclaim in its engine
+	RECLAIM_LIFECYCLE_TYPE = 1,              // uint8, 0: bullish, 1: bearish
+	RECLAIM_LIFECYCLE_OUTCOME = 2,           // uint8, see ReclaimLifecycleOutcome
+	RECLAIM_LIFECYCLE_START_TIME = 3,        // int64, .scid time of the creation (microseconds since 1899-12-30)
+	RECLAIM_LIFECYCLE_END_TIME = 4,          // int64, .scid time of the reclaim or eviction
+	RECLAIM_LIFECYCLE_LIFETIME = 5,          // float, seconds between the creation and the end
+	RECLAIM_LIFECYCLE_FIXED_SIDE_PRICE = 6,  // float
+	RECLAIM_LIFECYCLE_ACTIVE_SIDE_PRICE = 7, // float, at the end
+	RECLAIM_LIFECYCLE_MAX_HEIGHT = 8,        // int32, ticks
+	RECLAIM_LIFECYCLE_MAX_RETRACEMENT = 9,   // int32, ticks
+	RECLAIM_LIFECYCLE_VOLUME = 10,           // double, volume traded inside the reclaim while it was active
+	RECLAIM_LIFECYCLE_COLUMN_COUNT = 11
+};
+
+/**
+ * @brief How a lifecycle ended.
+ */
+enum ReclaimLifecycleOutcome
+{
+	RECLAIM_LIFECYCLE_RECLAIMED = 0,
+	RECLAIM_LIFECYCLE_EVICTED = 1,
+	RECLAIM_LIFECYCLE_ACTIVE = 2 // still active at the last trade, the end time is the one of the last trade
+};
+
+/**
+ * @brief Encodings of a column in a chunk.
+ */
+enum ReclaimLifecycleEncoding
+{
+	RECLAIM_LIFECYCLE_RAW = 0,         // the values as they are in memory, read without a copy
+	RECLAIM_LIFECYCLE_VARINT = 1,      // zigzag LEB128 varints of the values
+	RECLAIM_LIFECYCLE_DELTA_VARINT = 2 // zigzag LEB128 varints of the difference with the previous value, the first with 0
+};
+
+/**
+ * @brief Returns the name of a column, as used by the tools.
+ */
+inline const char *GetReclaimLifecycleColumnName(int column)
+{
+	static const char *names[RECLAIM_LIFECYCLE_COLUMN_COUNT] = { "id", "type", "outcome", "start_time", "end_time", "lifetime",
+		"fixed_side_price", "active_side_price", "max_height", "max_retracement", "volume" };
+	return column >= 0 && column < RECLAIM_LIFECYCLE_COLUMN_COUNT ? names[column] : NULL;
+}
+
+/**
+ * @brief Returns the size in bytes of a value of a column.
+ */
+inline int GetReclaimLifecycleValueSize(int column)
+{
+	static const int sizes[RECLAIM_LIFECYCLE_COLUMN_COUNT] = { 8, 1, 1, 8, 8, 4, 4, 4, 4, 4, 8 };
+	return sizes[column];
+}
+
+/**
+ * @brief Returns true for the columns of integers, which can be stored as varints.
+ */
+inline bool IsReclaimLifecycleIntegerColumn(int column)
+{
+	return column == RECLAIM_LIFECYCLE_ID || column == RECLAIM_LIFECYCLE_START_TIME || column == RECLAIM_LIFECYCLE_END_TIME ||
+		column == RECLAIM_LIFECYCLE_MAX_HEIGHT || column == RECLAIM_LIFECYCLE_MAX_RETRACEMENT;
+}
+
+/**
+ * @struct ReclaimLifecycleFileHeader
+ * @brief Header at the start of a lifecycle file (16 bytes).
+ */
+struct ReclaimLifecycleFileHeader
+{
+	char Magic[4]; // "FCLC"
+	uint32_t Version;
+	uint32_t ColumnCount;
+	uint32_t ChunkRows; // most rows of a chunk
+};
+
+/**
+ * @struct ReclaimLifecycleColumnIndex
+ * @brief Where a column of a chunk is stored (24 bytes).
+ */
+struct ReclaimLifecycleColumnIndex
+{
+	uint64_t Offset; // from the start of the file, a multiple of 8
+	uint64_t Size;   // in bytes, without the padding
+	uint32_t Encoding; // see ReclaimLifecycleEncoding
+	uint32_t Reserved;
+};
+
+/**
+ * @struct ReclaimLifecycleChunkIndex
+ * @brief Entry of the footer index for one chunk (24 bytes + the columns).
+ */
+struct ReclaimLifecycleChunkIndex
+{
+	uint64_t RowCount;
+	int64_t MinEndTime;
+	int64_t MaxEndTime;
+	ReclaimLifecycleColumnIndex Columns[RECLAIM_LIFECYCLE_COLUMN_COUNT];
+};
+
+/**
+ * @struct ReclaimLifecycleFileTail
+ * @brief Last bytes of a lifecycle file (32 bytes), written once every chunk and the footer are.
+ */
+struct ReclaimLifecycleFileTail
+{
+	uint64_t FooterOffset; // first ReclaimLifecycleChunkIndex
+	uint64_t ChunkCount;
+	uint64_t RowCount;
+	char Magic[4]; // "FCLC"
+	uint32_t Version;
+};
+
+static_assert(sizeof(ReclaimLifecycleFileHeader) == 16, "the lifecycle file header is 16 bytes");
+static_assert(sizeof(ReclaimLifecycleColumnIndex) == 24, "the lifecycle column index entries are 24 bytes");
+static_assert(sizeof(ReclaimLifecycleFileTail) == 32, "the lifecycle file tail is 32 bytes");
+
+/**
+ * @class ReclaimLifecycleWriter
+ * @brief Records the lifecycle of every reclaim of an engine into a lifecycle file.
+ *
+ * Call `SetDateTime` with the time of every trade before it is processed, the reclaims that end
+ * during the trade get it as their end time. `WriteActive` adds the reclaims still active at the
+ * end, and `Close` writes the last chunk and the footer.
+ */
+class ReclaimLifecycleWriter : public ReclaimListener
+{
+public:
+	/**
+	 * @brief Rows of a chunk.
+	 */
+	static const uint32_t CHUNK_ROWS = 1 << 16;
+
+	/**
+	 * @brief Full chunks waiting for the writer thread before the engine thread waits for it.
+	 */
+	static const size_t MAX_QUEUED_CHUNKS = 8;
+
+	ReclaimLifecycleWriter()
+		: m_File(NULL)
+		, m_Compress(true)
+		, m_DateTime(0)
+		, m_RowCount(0)
+		, m_Offset(0)
+		, m_Stop(false)
+		, m_Failed(false)
+	{
+	}
+
+	~ReclaimLifecycleWriter() { Close(); }
+
+	/**
+	 * @brief Creates the file and starts the writer thread.
+	 *
+	 * @param compress `false` to store every column as it is, so every column is read without a copy.
+	 */
+	bool Open(const char *path, bool compress = true)
+	{
+		Close();
+
+		m_File = fopen(path, "wb");
+		if (m_File == NULL)
+			return false;
+
+		ReclaimLifecycleFileHeader header;
+		memcpy(header.Magic, "FCLC", 4);
+		header.Version = RECLAIM_LIFECYCLE_VERSION;
+		header.ColumnCount = RECLAIM_LIFECYCLE_COLUMN_COUNT;
+		header.ChunkRows = CHUNK_ROWS;
+
+		m_Compress = compress;
+		m_RowCount = 0;
+		m_Offset = 0;
+		m_Index.clear();
+		m_Stop = false;
+		m_Failed = !WriteBytes(&header, sizeof(header));
+		m_Current.Clear();
+
+		m_Thread = std::thread(&ReclaimLifecycleWriter::Run, this);
+		return true;
+	}
+
+	/**
+	 * @brief Writes the last chunk, the footer and the tail, and closes the file.
+	 *
+	 * @return `false` if a write failed.
+	 */
+	bool Close()
+	{
+		if (m_File == NULL)
+			return false;
+
+		if (m_Current.RowCount > 0)
+			Enqueue();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Wake.notify_all();
+		m_Thread.join();
+
+		ReclaimLifecycleFileTail tail;
+		tail.FooterOffset = m_Offset;
+		tail.ChunkCount = m_Index.size();
+		tail.RowCount = m_RowCount;
+		memcpy(tail.Magic, "FCLC", 4);
+		tail.Version = RECLAIM_LIFECYCLE_VERSION;
+
+		bool written = !m_Failed && (m_Index.empty() || WriteBytes(m_Index.data(), m_Index.size() * sizeof(ReclaimLifecycleChunkIndex))) &&
+			WriteBytes(&tail, sizeof(tail));
+		written = fclose(m_File) == 0 && written;
+		m_File = NULL;
+		return written;
+	}
+
+	/**
+	 * @brief Sets the time of the trade the engine processes next, as an SCDateTime.
+	 */
+	void SetDateTime(double dateTime) { m_DateTime = dateTime; }
+
+	void OnReclaimReclaimed(const Reclaim &reclaim) { Append(reclaim, RECLAIM_LIFECYCLE_RECLAIMED); }
+
+	void OnReclaimEvicted(const Reclaim &reclaim) { Append(reclaim, RECLAIM_LIFECYCLE_EVICTED); }
+
+	/**
+	 * @brief Adds a row for every reclaim still active in an engine, ending at the time set last.
+	 */
+	void WriteActive(const ReclaimEngine &engine)
+	{
+		for (int type = 0; type < 2; type++)
+		{
+			const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+			for (int i = 0; i < engine.GetSize(); i++)
+			{
+				if (!reclaims[i].Deleted)
+					Append(reclaims[i], RECLAIM_LIFECYCLE_ACTIVE);
+			}
+		}
+	}
+
+	/**
+	 * @brief Returns the number of rows added since `Open`.
+	 */
+	int64_t GetRowCount() const { return m_RowCount; }
+
+private:
+	/**
+	 * @brief The columns of the rows of a chunk, as they are in memory.
+	 */
+	struct Chunk
+	{
+		uint32_t RowCount;
+		std::vector<char> Columns[RECLAIM_LIFECYCLE_COLUMN_COUNT];
+
+		void Clear()
+		{
+			RowCount = 0;
+			for (int i = 0; i < RECLAIM_LIFECYCLE_COLUMN_COUNT; i++)
+			{
+				Columns[i].resize((size_t)CHUNK_ROWS * GetReclaimLifecycleValueSize(i));
+			}
+		}
+
+		template <class T>
+		void Set(int column, T value)
+		{
+			memcpy(Columns[column].data() + (size_t)RowCount * sizeof(T), &value, sizeof(T));
+		}
+	};
+
+	void Append(const Reclaim &reclaim, uint8_t outcome)
+	{
+		int64_t startTime = DateTimeToScidTime(reclaim.StartDate);
+		int64_t endTime = DateTimeToScidTime(m_DateTime);
+
+		m_Current.Set<int64_t>(RECLAIM_LIFECYCLE_ID, reclaim.Id);
+		m_Current.Set<uint8_t>(RECLAIM_LIFECYCLE_TYPE, (uint8_t)reclaim.Type);
+		m_Current.Set<uint8_t>(RECLAIM_LIFECYCLE_OUTCOME, outcome);
+		m_Current.Set<int64_t>(RECLAIM_LIFECYCLE_START_TIME, startTime);
+		m_Current.Set<int64_t>(RECLAIM_LIFECYCLE_END_TIME, endTime);
+		m_Current.Set<float>(RECLAIM_LIFECYCLE_LIFETIME, (float)((endTime - startTime) / 1e6));
+		m_Current.Set<float>(RECLAIM_LIFECYCLE_FIXED_SIDE_PRICE, reclaim.FixedSidePrice);
+		m_Current.Set<float>(RECLAIM_LIFECYCLE_ACTIVE_SIDE_PRICE, reclaim.ActiveSidePrice);
+		m_Current.Set<int32_t>(RECLAIM_LIFECYCLE_MAX_HEIGHT, reclaim.MaxHeight);
+		m_Current.Set<int32_t>(RECLAIM_LIFECYCLE_MAX_RETRACEMENT, reclaim.MaxRetracement);
+		m_Current.Set<double>(RECLAIM_LIFECYCLE_VOLUME, reclaim.Volume);
+
+		m_RowCount++;
+		if (++m_Current.RowCount == CHUNK_ROWS)
+			Enqueue();
+	}
+
+	/**
+	 * @brief Hands the current chunk to the writer thread and takes an empty one.
+	 */
+	void Enqueue()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Wake.wait(lock, [this] { return m_Queue.size() < MAX_QUEUED_CHUNKS; });
+
+		m_Queue.push_back(std::move(m_Current));
+		if (!m_Free.empty())
+		{
+			m_Current = std::move(m_Free.back());
+			m_Free.pop_back();
+		}
+		lock.unlock();
+
+		m_Wake.notify_all();
+		m_Current.Clear();
+	}
+
+	void Run()
+	{
+		std::vector<uint8_t> encoded;
+
+		while (true)
+		{
+			Chunk chunk;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Wake.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+				if (m_Queue.empty())
+					return;
+
+				chunk = std::move(m_Queue.front());
+				m_Queue.pop_front();
+			}
+			m_Wake.notify_all();
+
+			if (!m_Failed)
+				m_Failed = !WriteChunk(chunk, encoded);
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Free.push_back(std::move(chunk));
+		}
+	}
+
+	bool WriteChunk(const Chunk &chunk, std::vector<uint8_t> &encoded)
+	{
+		ReclaimLifecycleChunkIndex index;
+		memset(&index, 0, sizeof(index));
+		index.RowCount = chunk.RowCount;
+
+		const int64_t *endTimes = (const int64_t *)chunk.Columns[RECLAIM_LIFECYCLE_END_TIME].data();
+		index.MinEndTime = endTimes[0];
+		index.MaxEndTime = endTimes[0];
+		for (uint32_t i = 1; i < chunk.RowCount; i++)
+		{
+			index.MinEndTime = std::min(index.MinEndTime, endTimes[i]);
+			index.MaxEndTime = std::max(index.MaxEndTime, endTimes[i]);
+		}
+
+		for (int column = 0; column < RECLAIM_LIFECYCLE_COLUMN_COUNT; column++)
+		{
+			const char *values = chunk.Columns[column].data();
+			size_t rawSize = (size_t)chunk.RowCount * GetReclaimLifecycleValueSize(column);
+
+			ReclaimLifecycleColumnIndex &columnIndex = index.Columns[column];
+			columnIndex.Offset = m_Offset;
+			columnIndex.Encoding = RECLAIM_LIFECYCLE_RAW;
+			columnIndex.Size = rawSize;
+
+			// the smaller of the varints of the values and of their differences, when it is smaller than the values
+			if (m_Compress && IsReclaimLifecycleIntegerColumn(column))
+			{
+				size_t varintSize = EncodeVarints(values, chunk.RowCount, GetReclaimLifecycleValueSize(column), false, encoded);
+				size_t deltaSize = EncodeVarints(values, chunk.RowCount, GetReclaimLifecycleValueSize(column), true, encoded);
+				if (std::min(varintSize, deltaSize) < rawSize)
+				{
+					bool delta = deltaSize < varintSize;
+					if (!delta)
+						EncodeVarints(values, chunk.RowCount, GetReclaimLifecycleValueSize(column), false, encoded);
+
+					columnIndex.Encoding = delta ? RECLAIM_LIFECYCLE_DELTA_VARINT : RECLAIM_LIFECYCLE_VARINT;
+					columnIndex.Size = encoded.size();
+					values = (const char *)encoded.data();
+				}
+			}
+
+			static const char padding[8] = { 0 };
+			if (!WriteBytes(values, (size_t)columnIndex.Size) || !WriteBytes(padding, (size_t)((8 - columnIndex.Size % 8) % 8)))
+				return false;
+		}
+
+		m_Index.push_back(index);
+		return true;
+	}
+
+	/**
+	 * @brief Encodes integers of 4 or 8 bytes as zigzag LEB128 varints.
+	 *
+	 * @return The size of the encoded values.
+	 */
+	static size_t EncodeVarints(const char *values, uint32_t count, int valueSize, bool delta, std::vector<uint8_t> &encoded)
+	{
+		encoded.resize((size_t)count * 10);
+		uint8_t *output = encoded.data();
+		int64_t previous = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			int64_t value;
+			if (valueSize == 8)
+			{
+				memcpy(&value, values + (size_t)i * 8, 8);
+			}
+			else
+			{
+				int32_t value32;
+				memcpy(&value32, values + (size_t)i * 4, 4);
+				value = value32;
+			}
+
+			uint64_t zigzag = delta ? (uint64_t)(value - previous) : (uint64_t)value;
+			zigzag = (zigzag << 1) ^ (uint64_t)((int64_t)zigzag >> 63);
+			previous = value;
+
+			while (zigzag >= 0x80)
+			{
+				*output++ = (uint8_t)(zigzag | 0x80);
+				zigzag >>= 7;
+			}
+			*output++ = (uint8_t)zigzag;
+		}
+
+		encoded.resize(output - encoded.data());
+		return encoded.size();
+	}
+
+	bool WriteBytes(const void *data, size_t size)
+	{
+		if (size > 0 && fwrite(data, 1, size, m_File) != size)
+			return false;
+		m_Offset += size;
+		return true;
+	}
+
+	FILE *m_File;
+	bool m_Compress;
+	double m_DateTime;
+	int64_t m_RowCount;
+	Chunk m_Current;
+
+	// written by the writer thread until it exits, then by Close
+	uint64_t m_Offset;
+	std::vector<ReclaimLifecycleChunkIndex> m_Index;
+
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::deque<Chunk> m_Queue; // full chunks, oldest first
+	std::vector<Chunk> m_Free; // chunks written by the thread, reused by Enqueue
+	bool m_Stop;
+	bool m_Failed;
+};
+
+/**
+ * @class ReclaimLifecycleReader
+ * @brief Read only memory mapping of a lifecycle file.
+ */
+class ReclaimLifecycleReader
+{
+public:
+	ReclaimLifecycleReader()
+		: m_Data(NULL)
+		, m_Size(0)
+		, p_Tail(NULL)
+		, p_Index(NULL)
+#ifdef _WIN32
+		, m_File(INVALID_HANDLE_VALUE)
+		, m_Mapping(NULL)
+#else
+		, m_File(-1)
+#endif
+	{
+	}
+
+	~ReclaimLifecycleReader() { Close(); }
+
+	/**
+	 * @brief Opens and maps a lifecycle file.
+	 *
+	 * @return `true` if the file was mapped and its header, footer and columns are consistent, otherwise `false`.
+	 */
+	bool Open(const char *path)
+	{
+		Close();
+
+#ifdef _WIN32
+		m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+		if (m_File == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_File, &fileSize) || fileSize.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+		m_Size = (int64_t)fileSize.QuadPart;
+
+		m_Mapping = CreateFileMappingA(m_File, NULL, PAGE_READONLY, 0, 0, NULL);
+		m_Data = m_Mapping != NULL ? (const char *)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, (SIZE_T)m_Size) : NULL;
+#else
+		m_File = open(path, O_RDONLY);
+		if (m_File < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(m_File, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			Close();
+			return false;
+		}
+		m_Size = (int64_t)fileStat.st_size;
+
+		void *data = mmap(NULL, (size_t)m_Size, PROT_READ, MAP_SHARED, m_File, 0);
+		m_Data = data != MAP_FAILED ? (const char *)data : NULL;
+#endif
+
+		if (m_Data == NULL || !Validate())
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Unmaps and closes the file.
+	 */
+	void Close()
+	{
+#ifdef _WIN32
+		if (m_Data != NULL)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping != NULL)
+		{
+			CloseHandle(m_Mapping);
+			m_Mapping = NULL;
+		}
+		if (m_File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_File);
+			m_File = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_Data != NULL)
+			munmap((void *)m_Data, (size_t)m_Size);
+		if (m_File >= 0)
+		{
+			close(m_File);
+			m_File = -1;
+		}
+#endif
+		m_Data = NULL;
+		p_Tail = NULL;
+		p_Index = NULL;
+	}
+
+	bool IsOpen() const { return m_Data != NULL; }
+
+	int GetChunkCount() const { return (int)p_Tail->ChunkCount; }
+
+	int64_t GetRowCount() const { return (int64_t)p_Tail->RowCount; }
+
+	/**
+	 * @brief Returns the footer index entry of a chunk: its rows, its range of end times and its columns.
+	 */
+	const ReclaimLifecycleChunkIndex &GetChunk(int chunk) const { return p_Index[chunk]; }
+
+	/**
+	 * @brief Returns the values of a column stored as they are, `NULL` if the column is encoded.
+	 */
+	const void *GetRawColumn(int chunk, int column) const
+	{
+		const ReclaimLifecycleColumnIndex &columnIndex = p_Index[chunk].Columns[column];
+		return columnIndex.Encoding == RECLAIM_LIFECYCLE_RAW ? m_Data + columnIndex.Offset : NULL;
+	}
+
+	/**
+	 * @brief Returns the values of a column of a chunk, in the mapping when they are stored as they are, otherwise
+	 *        decoded into `buffer`.
+	 *
+	 * @tparam T The type of the values of the column, see `ReclaimLifecycleColumn`.
+	 * @return `NULL` if the size of `T` is not the one of the column.
+	 */
+	template <class T>
+	const T *GetColumn(int chunk, int column, std::vector<T> &buffer) const
+	{
+		if ((int)sizeof(T) != GetReclaimLifecycleValueSize(column))
+			return NULL;
+
+		const ReclaimLifecycleColumnIndex &columnIndex = p_Index[chunk].Columns[column];
+		if (columnIndex.Encoding == RECLAIM_LIFECYCLE_RAW)
+			return (const T *)(m_Data + columnIndex.Offset);
+
+		buffer.resize((size_t)p_Index[chunk].RowCount);
+		const uint8_t *input = (const uint8_t *)m_Data + columnIndex.Offset;
+		const uint8_t *end = input + columnIndex.Size;
+		int64_t previous = 0;
+
+		for (size_t i = 0; i < buffer.size(); i++)
+		{
+			uint64_t zigzag = 0;
+			int shift = 0;
+			while (input < end && (*input & 0x80) != 0 && shift < 63)
+			{
+				zigzag |= (uint64_t)(*input++ & 0x7f) << shift;
+				shift += 7;
+			}
+			if (input < end)
+				zigzag |= (uint64_t)*input++ << shift;
+
+			int64_t value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+			if (columnIndex.Encoding == RECLAIM_LIFECYCLE_DELTA_VARINT)
+				value += previous;
+			previous = value;
+			buffer[i] = (T)value;
+		}
+
+		return buffer.data();
+	}
+
+private:
+	/**
+	 * @brief Checks the header and the tail, and that every column is inside the file.
+	 */
+	bool Validate()
+	{
+		if (m_Size < (int64_t)(sizeof(ReclaimLifecycleFileHeader) + sizeof(ReclaimLifecycleFileTail)))
+			return false;
+
+		const ReclaimLifecycleFileHeader *header = (const ReclaimLifecycleFileHeader *)m_Data;
+		p_Tail = (const ReclaimLifecycleFileTail *)(m_Data + m_Size - sizeof(ReclaimLifecycleFileTail));
+		if (memcmp(header->Magic, "FCLC", 4) != 0 || header->Version != RECLAIM_LIFECYCLE_VERSION ||
+			header->ColumnCount != RECLAIM_LIFECYCLE_COLUMN_COUNT || memcmp(p_Tail->Magic, "FCLC", 4) != 0 ||
+			p_Tail->Version != RECLAIM_LIFECYCLE_VERSION)
+			return false;
+
+		// a file whose writer did not close it has no tail
+		uint64_t footerEnd = (uint64_t)m_Size - sizeof(ReclaimLifecycleFileTail);
+		if (p_Tail->FooterOffset > footerEnd || p_Tail->ChunkCount != (footerEnd - p_Tail->FooterOffset) / sizeof(ReclaimLifecycleChunkIndex) ||
+			(footerEnd - p_Tail->FooterOffset) % sizeof(ReclaimLifecycleChunkIndex) != 0 || p_Tail->FooterOffset % 8 != 0)
+			return false;
+
+		p_Index = (const ReclaimLifecycleChunkIndex *)(m_Data + p_Tail->FooterOffset);
+		uint64_t rowCount = 0;
+		for (uint64_t i = 0; i < p_Tail->ChunkCount; i++)
+		{
+			rowCount += p_Index[i].RowCount;
+			for (int column = 0; column < RECLAIM_LIFECYCLE_COLUMN_COUNT; column++)
+			{
+				const ReclaimLifecycleColumnIndex &columnIndex = p_Index[i].Columns[column];
+				if (columnIndex.Offset % 8 != 0 || columnIndex.Offset > p_Tail->FooterOffset ||
+					columnIndex.Size > p_Tail->FooterOffset - columnIndex.Offset || columnIndex.Encoding > RECLAIM_LIFECYCLE_DELTA_VARINT ||
+					(columnIndex.Encoding == RECLAIM_LIFECYCLE_RAW && columnIndex.Size != p_Index[i].RowCount * GetReclaimLifecycleValueSize(column)))
+					return false;
+			}
+		}
+
+		return rowCount == p_Tail->RowCount;
+	}
+
+	const char *m_Data;
+	int64_t m_Size;
+	const ReclaimLifecycleFileTail *p_Tail;
+	const ReclaimLifecycleChunkIndex *p_Index;
+
+#ifdef _WIN32
+	HANDLE m_File;
+	HANDLE m_Mapping;
+#else
+	int m_File;
+#endif
+};
@@ -0,0 +1,288 @@
+/*
+ * @file reclaims_query.h
+ * @brief Process wide registry used to query the reclaims of a symbol from outside the study.
+ *
+ * Every engine of the study registers itself by symbol with the mutex that guards it. Other
+ * studies, DLLs and tools query the nearest reclaims of a symbol through the registry, which
+ * uses the ordered level indexes of the engine (see `ReclaimEngine::EnableLevelIndex`), so a
+ * query is O(log n) in the number of active reclaims.
+ *
+ * The study exports the queries from its DLL as C functions, see the end of reclaims.cpp.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "reclaims_engine.h"
+
+#ifdef _WIN32
+#define FATCAT_RECLAIMS_EXPORT extern "C" __declspec(dllexport)
+#else
+#define FATCAT_RECLAIMS_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+/**
+ * @struct FatCatReclaimLevel
+ * @brief One reclaim as returned by the exported queries. Plain C layout.
+ */
+struct FatCatReclaimLevel
+{
+	int64_t Id;
+	double StartDate;
+	float FixedSidePrice;
+	float ActiveSidePrice;
+	int32_t Type;  // 0: bullish, 1: bearish
+	int32_t MaxHeight;
+	double Volume; // volume traded inside the reclaim while it was active
+};
+
+/**
+ * @brief Signatures of the functions exported by the study DLL, for GetProcAddress / dlsym.
+ */
+typedef int (*FatCatReclaims_FindNearestFunction)(const char *symbol, int type, float price, int above, FatCatReclaimLevel *level);
+typedef int (*FatCatReclaims_FindKNearestFunction)(const char *symbol, int type, float price, int k, FatCatReclaimLevel *levels);
+typedef int (*FatCatReclaims_FindInRangeFunction)(const char *symbol, int type, float low, float high, FatCatReclaimLevel *levels, int maxLevels);
+typedef int (*FatCatReclaims_FindByLineNumberFunction)(const char *chartbook, int chartNumber, int lineNumber, FatCatReclaimLevel *level);
+
+/**
+ * @brief Handle of the reclaim of every rectangle a study instance has drawn, by LineNumber.
+ */
+typedef std::unordered_map<int, ReclaimHandle> ReclaimLineNumberMap;
+
+/**
+ * @brief Copies a reclaim into the exported level layout.
+ */
+inline void CopyReclaimLevel(const Reclaim &reclaim, FatCatReclaimLevel &level)
+{
+	level.Id = reclaim.Id;
+	level.StartDate = reclaim.StartDate;
+	level.FixedSidePrice = reclaim.FixedSidePrice;
+	level.ActiveSidePrice = reclaim.ActiveSidePrice;
+	level.Type = reclaim.Type;
+	level.MaxHeight = reclaim.MaxHeight;
+	level.Volume = reclaim.Volume;
+}
+
+/**
+ * @class ReclaimQueryRegistry
+ * @brief Engines that can be queried, keyed by symbol.
+ *
+ * The registry lock is taken before the engine mutex, so an engine owner must not register or
+ * unregister while it holds its engine mutex.
+ */
+class ReclaimQueryRegistry
+{
+public:
+	/**
+	 * @brief Registers an engine or changes the symbol of a registered engine.
+	 *
+	 * The engine must have its level index enabled. When several engines are registered for a
+	 * symbol, queries use the first one.
+	 *
+	 * @param symbol Symbol of the engine.
+	 * @param engine The engine.
+	 * @param engineMutex Mutex held by the owner whenever it changes the engine.
+	 * @param chartbook Chartbook of the chart of the drawings of the engine, for `FindByLineNumber`.
+	 * @param chartNumber Chart of the drawings of the engine, unique within its chartbook only.
+	 * @param lineNumbers Optional map of the drawings, guarded by `engineMutex`.
+	 */
+	static void Register(const char *symbol, const ReclaimEngine *engine, std::mutex *engineMutex, const char *chartbook = "", int chartNumber = 0,
+		const ReclaimLineNumberMap *lineNumbers = NULL)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		std::vector<Entry> &entries = GetEntries();
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].Engine == engine)
+			{
+				entries[i].Symbol = symbol;
+				entries[i].EngineMutex = engineMutex;
+				entries[i].Chartbook = chartbook;
+				entries[i].ChartNumber = chartNumber;
+				entries[i].LineNumbers = lineNumbers;
+				return;
+			}
+		}
+
+		Entry entry;
+		entry.Symbol = symbol;
+		entry.Engine = engine;
+		entry.EngineMutex = engineMutex;
+		entry.Chartbook = chartbook;
+		entry.ChartNumber = chartNumber;
+		entry.LineNumbers = lineNumbers;
+		entries.push_back(entry);
+	}
+
+	/**
+	 * @brief Removes an engine. Must be called before the engine or its mutex is deleted.
+	 */
+	static void Unregister(const ReclaimEngine *engine)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		std::vector<Entry> &entries = GetEntries();
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].Engine == engine)
+			{
+				entries.erase(entries.begin() + i);
+				return;
+			}
+		}
+	}
+
+	/**
+	 * @brief Finds the reclaim whose active side is nearest to a price in one direction.
+	 *
+	 * @return `1` if a reclaim was found, `0` if there is none and `-1` if the symbol has no engine.
+	 */
+	static int FindNearest(const char *symbol, int type, float price, bool above, FatCatReclaimLevel &level)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		const Entry *entry = Find(symbol);
+		if (entry == NULL)
+			return -1;
+
+		std::lock_guard<std::mutex> engineLock(*entry->EngineMutex);
+		const Reclaim *reclaim = entry->Engine->FindNearest(type, price, above);
+		if (reclaim == NULL)
+			return 0;
+
+		CopyReclaimLevel(*reclaim, level);
+		return 1;
+	}
+
+	/**
+	 * @brief Finds the `k` reclaims whose active sides are nearest to a price, nearest first.
+	 *
+	 * @return The number of levels written to `levels`, or `-1` if the symbol has no engine.
+	 */
+	static int FindKNearest(const char *symbol, int type, float price, int k, FatCatReclaimLevel *levels)
+	{
+		std::vector<const Reclaim *> &found = GetResults(k);
+
+		std::lock_guard<std::mutex> lock(GetMutex());
+		const Entry *entry = Find(symbol);
+		if (entry == NULL)
+			return -1;
+
+		std::lock_guard<std::mutex> engineLock(*entry->EngineMutex);
+		int count = entry->Engine->FindKNearest(type, price, k, found.data());
+		for (int i = 0; i < count; i++)
+			CopyReclaimLevel(*found[i], levels[i]);
+		return count;
+	}
+
+	/**
+	 * @brief Finds the reclaims whose active side is inside a price range, lowest first.
+	 *
+	 * @return The number of levels written to `levels`, or `-1` if the symbol has no engine.
+	 */
+	static int FindInRange(const char *symbol, int type, float low, float high, FatCatReclaimLevel *levels, int maxLevels)
+	{
+		std::vector<const Reclaim *> &found = GetResults(maxLevels);
+
+		std::lock_guard<std::mutex> lock(GetMutex());
+		const Entry *entry = Find(symbol);
+		if (entry == NULL)
+			return -1;
+
+		std::lock_guard<std::mutex> engineLock(*entry->EngineMutex);
+		int count = entry->Engine->FindInRange(type, low, high, found.data(), maxLevels);
+		for (int i = 0; i < count; i++)
+			CopyReclaimLevel(*found[i], levels[i]);
+		return count;
+	}
+
+	/**
+	 * @brief Finds the reclaim drawn as a rectangle of a chart, for example the drawing a user clicked.
+	 *
+	 * A chart is identified by its chartbook and its number, as chart numbers are only unique within
+	 * a chartbook.
+	 *
+	 * O(1): the LineNumber maps to the handle of the reclaim, which resolves to its position.
+	 *
+	 * @return `1` if the rectangle is an active reclaim, `0` if it is not and `-1` if the chart has no engine.
+	 */
+	static int FindByLineNumber(const char *chartbook, int chartNumber, int lineNumber, FatCatReclaimLevel &level)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		const std::vector<Entry> &entries = GetEntries();
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const Entry &entry = entries[i];
+			if (entry.ChartNumber != chartNumber || entry.Chartbook != chartbook || entry.LineNumbers == NULL)
+				continue;
+
+			std::lock_guard<std::mutex> engineLock(*entry.EngineMutex);
+			ReclaimLineNumberMap::const_iterator found = entry.LineNumbers->find(lineNumber);
+			if (found == entry.LineNumbers->end())
+				return 0;
+
+			const Reclaim *reclaim = entry.Engine->Resolve(found->second);
+			if (reclaim == NULL)
+				return 0;
+
+			CopyReclaimLevel(*reclaim, level);
+			return 1;
+		}
+
+		return -1;
+	}
+
+private:
+	struct Entry
+	{
+		std::string Symbol;
+		const ReclaimEngine *Engine;
+		std::mutex *EngineMutex;
+		std::string Chartbook;
+		int ChartNumber;
+		const ReclaimLineNumberMap *LineNumbers;
+	};
+
+	// called with the registry lock held
+	static const Entry *Find(const char *symbol)
+	{
+		const std::vector<Entry> &entries = GetEntries();
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].Symbol == symbol)
+				return &entries[i];
+		}
+		return NULL;
+	}
+
+	/**
+	 * @brief Returns a per thread buffer for the query results, so queries do not allocate.
+	 */
+	static std::vector<const Reclaim *> &GetResults(int count)
+	{
+		thread_local std::vector<const Reclaim *> results;
+		if ((int)results.size() < count)
+			results.resize(count);
+		return results;
+	}
+
+	static std::mutex &GetMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<Entry> &GetEntries()
+	{
+		static std::vector<Entry> entries;
+		return entries;
+	}
+};
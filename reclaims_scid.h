@@ -0,0 +1,519 @@
+/*
+ * @file reclaims_scid.h
+ * @brief Reads Sierra Chart intraday (.scid) files and replays their trades into a `ReclaimEngine`.
+ *
+ * The .scid file is memory mapped and read sequentially, so every recorded trade can be fed to
+ * the engine without going through the chart bars. This is used by the chart study to compute
+ * tick-exact history and by the offline tools.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+// without winsock.h, which conflicts with the winsock2.h of reclaims_stream.h
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "reclaims_engine.h"
+
+/**
+ * @brief Number of microseconds in a day, used to convert .scid times to SCDateTime days.
+ */
+static const double SCID_MICROSECONDS_PER_DAY = 86400.0 * 1000000.0;
+
+/**
+ * @struct ScidFileHeader
+ * @brief Header at the start of every .scid file (56 bytes).
+ */
+struct ScidFileHeader
+{
+	char FileTypeUniqueHeaderID[4]; // "SCID"
+	uint32_t HeaderSize;
+	uint32_t RecordSize;
+	uint16_t Version;
+	uint16_t Unused1;
+	uint32_t UTCStartIndex;
+	char Reserve[36];
+};
+
+/**
+ * @struct ScidRecord
+ * @brief One record of a .scid file (40 bytes).
+ *
+ * For tick by tick data Close is the trade price, High is the ask and Low is the bid.
+ */
+struct ScidRecord
+{
+	/**
+	 * @brief Microseconds since 1899-12-30 in UTC.
+	 */
+	int64_t DateTime;
+
+	float Open;
+	float High;
+	float Low;
+	float Close;
+
+	uint32_t NumTrades;
+	uint32_t TotalVolume;
+	uint32_t BidVolume;
+	uint32_t AskVolume;
+};
+
+/**
+ * @brief Converts a .scid record time to an SCDateTime value (days since 1899-12-30).
+ */
+inline double ScidTimeToDateTime(int64_t scidTime)
+{
+	return (double)scidTime / SCID_MICROSECONDS_PER_DAY;
+}
+
+/**
+ * @brief Converts an SCDateTime value (days since 1899-12-30) to a .scid record time.
+ */
+inline int64_t DateTimeToScidTime(double dateTime)
+{
+	return (int64_t)(dateTime * SCID_MICROSECONDS_PER_DAY + 0.5);
+}
+
+/**
+ * @class ScidFile
+ * @brief Read only memory mapping of a .scid file.
+ *
+ * Sierra Chart keeps writing to the file while it is mapped, so the file is opened with write
+ * sharing and `Refresh` can be called to map records appended after `Open`.
+ */
+class ScidFile
+{
+public:
+	ScidFile()
+		: m_Data(NULL)
+		, m_Size(0)
+		, m_RecordCount(0)
+#ifdef _WIN32
+		, m_File(INVALID_HANDLE_VALUE)
+		, m_Mapping(NULL)
+#else
+		, m_File(-1)
+#endif
+	{
+	}
+
+	~ScidFile() { Close(); }
+
+	/**
+	 * @brief Opens and maps a .scid file.
+	 *
+	 * @param path Path of the .scid file.
+	 * @return `true` if the file was mapped and has a valid header, otherwise `false`.
+	 */
+	bool Open(const char *path)
+	{
+		Close();
+
+#ifdef _WIN32
+		m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (m_File == INVALID_HANDLE_VALUE)
+			return false;
+#else
+		m_File = open(path, O_RDONLY);
+		if (m_File < 0)
+			return false;
+#endif
+
+		if (!Map())
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Maps the records appended to the file since it was opened or last refreshed.
+	 *
+	 * Pointers returned by `GetRecords` before the call are no longer valid.
+	 *
+	 * @return `true` if the file is still mapped.
+	 */
+	bool Refresh()
+	{
+		// nothing to do if no record was appended
+		if (m_Data != NULL && GetFileSize() == m_Size)
+			return true;
+
+		Unmap();
+		return Map();
+	}
+
+	/**
+	 * @brief Unmaps and closes the file.
+	 */
+	void Close()
+	{
+		Unmap();
+
+#ifdef _WIN32
+		if (m_File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_File);
+			m_File = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_File >= 0)
+		{
+			close(m_File);
+			m_File = -1;
+		}
+#endif
+	}
+
+	bool IsOpen() const { return m_Data != NULL; }
+
+	/**
+	 * @brief Returns the first record of the file.
+	 */
+	const ScidRecord *GetRecords() const
+	{
+		const ScidFileHeader *header = (const ScidFileHeader *)m_Data;
+		return (const ScidRecord *)(m_Data + header->HeaderSize);
+	}
+
+	/**
+	 * @brief Returns the number of complete records in the mapping.
+	 */
+	int64_t GetRecordCount() const { return m_RecordCount; }
+
+	/**
+	 * @brief Returns the index of the first record at or after the given .scid time.
+	 *
+	 * Records are sorted by time, so this is a binary search.
+	 */
+	int64_t FindFirstRecord(int64_t scidTime) const
+	{
+		const ScidRecord *records = GetRecords();
+		int64_t first = 0;
+		int64_t count = m_RecordCount;
+
+		while (count > 0)
+		{
+			int64_t step = count / 2;
+			if (records[first + step].DateTime < scidTime)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+
+		return first;
+	}
+
+private:
+	/**
+	 * @brief Returns the current size of the open file, or -1 on error.
+	 */
+	int64_t GetFileSize() const
+	{
+#ifdef _WIN32
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_File, &fileSize))
+			return -1;
+		return (int64_t)fileSize.QuadPart;
+#else
+		struct stat fileStat;
+		if (fstat(m_File, &fileStat) != 0)
+			return -1;
+		return (int64_t)fileStat.st_size;
+#endif
+	}
+
+	bool Map()
+	{
+		m_Size = GetFileSize();
+		if (m_Size < (int64_t)sizeof(ScidFileHeader))
+			return false;
+
+#ifdef _WIN32
+		m_Mapping = CreateFileMappingA(m_File, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_Mapping == NULL)
+			return false;
+
+		m_Data = (const char *)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, (SIZE_T)m_Size);
+		if (m_Data == NULL)
+		{
+			Unmap();
+			return false;
+		}
+#else
+		void *data = mmap(NULL, (size_t)m_Size, PROT_READ, MAP_SHARED, m_File, 0);
+		if (data == MAP_FAILED)
+			return false;
+
+		// records are read front to back, let the kernel read ahead aggressively
+		madvise(data, (size_t)m_Size, MADV_SEQUENTIAL);
+		m_Data = (const char *)data;
+#endif
+
+		const ScidFileHeader *header = (const ScidFileHeader *)m_Data;
+		if (memcmp(header->FileTypeUniqueHeaderID, "SCID", 4) != 0
+			|| header->RecordSize != sizeof(ScidRecord)
+			|| header->HeaderSize < sizeof(ScidFileHeader)
+			|| (int64_t)header->HeaderSize > m_Size)
+		{
+			Unmap();
+			return false;
+		}
+
+		// Sierra Chart may be writing the last record, only count complete ones
+		m_RecordCount = (m_Size - header->HeaderSize) / (int64_t)sizeof(ScidRecord);
+		return true;
+	}
+
+	void Unmap()
+	{
+#ifdef _WIN32
+		if (m_Data != NULL)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping != NULL)
+		{
+			CloseHandle(m_Mapping);
+			m_Mapping = NULL;
+		}
+#else
+		if (m_Data != NULL)
+			munmap((void *)m_Data, (size_t)m_Size);
+#endif
+		m_Data = NULL;
+		m_RecordCount = 0;
+	}
+
+	const char *m_Data;
+	int64_t m_Size;
+	int64_t m_RecordCount;
+
+#ifdef _WIN32
+	HANDLE m_File;
+	HANDLE m_Mapping;
+#else
+	int m_File;
+#endif
+};
+
+/**
+ * @struct ChartBarClock
+ * @brief Maps trade times to the bars of a chart.
+ *
+ * The bar start times must be sorted and in the same time zone as the trade times passed to `Locate`.
+ */
+struct ChartBarClock
+{
+	const double *BarStartTimes;
+	int BarCount;
+
+	/**
+	 * @brief Index of the bar that contains the last located trade, -1 before the first trade.
+	 */
+	int BarIndex;
+
+	ChartBarClock(const double *barStartTimes, int barCount)
+		: BarStartTimes(barStartTimes)
+		, BarCount(barCount)
+		, BarIndex(-1)
+	{
+	}
+
+	/**
+	 * @brief Finds the bar that contains a trade.
+	 *
+	 * @param dateTime Trade time. Trades must be located in time order.
+	 * @param barDateTime Receives the start time of the bar that contains the trade.
+	 * @return `-1` if the trade is before the first bar, `1` if the trade starts a new bar, otherwise `0`.
+	 */
+	int Locate(double dateTime, double &barDateTime)
+	{
+		if (BarCount == 0 || dateTime < BarStartTimes[0])
+			return -1;
+
+		int previousBarIndex = BarIndex;
+		if (BarIndex < 0)
+			BarIndex = 0;
+
+		while (BarIndex + 1 < BarCount && dateTime >= BarStartTimes[BarIndex + 1])
+			BarIndex++;
+
+		barDateTime = BarStartTimes[BarIndex];
+		return BarIndex != previousBarIndex ? 1 : 0;
+	}
+};
+
+/**
+ * @struct FixedPeriodBarClock
+ * @brief Maps trade times to time based bars of a fixed length, for replays without a chart.
+ */
+struct FixedPeriodBarClock
+{
+	/**
+	 * @brief Bar length in days.
+	 */
+	double BarPeriod;
+
+	/**
+	 * @brief Start time of the bar that contains the last located trade.
+	 */
+	double BarDateTime;
+
+	bool HasBar;
+
+	explicit FixedPeriodBarClock(int barPeriodSeconds)
+		: BarPeriod(barPeriodSeconds / 86400.0)
+		, BarDateTime(0)
+		, HasBar(false)
+	{
+	}
+
+	/**
+	 * @brief Finds the bar that contains a trade.
+	 *
+	 * @return `1` if the trade starts a new bar, otherwise `0`.
+	 */
+	int Locate(double dateTime, double &barDateTime)
+	{
+		double barStart = BarPeriod > 0 ? std::floor(dateTime / BarPeriod) * BarPeriod : dateTime;
+		int newBar = !HasBar || barStart != BarDateTime ? 1 : 0;
+
+		HasBar = true;
+		BarDateTime = barStart;
+		barDateTime = barStart;
+		return newBar;
+	}
+};
+
+/**
+ * @brief Feeds the trades of a range of .scid records to a reclaim engine.
+ *
+ * Each record is processed as one trade at its Close price with its TotalVolume. Records before the first bar of the
+ * clock are skipped.
+ *
+ * @param engine The engine that receives the trades, a `ReclaimEngine` or a `ReclaimHierarchy`.
+ * @param records The .scid records.
+ * @param begin Index of the first record to process.
+ * @param end Index after the last record to process.
+ * @param clock Bar clock used to detect bar boundaries (`ChartBarClock` or `FixedPeriodBarClock`).
+ * @param timeOffset Offset in days added to the UTC record times before they are located.
+ * @param listener Optional listener passed to the engine.
+ * @return The number of trades processed.
+ */
+template <class TEngine, class TBarClock>
+int64_t ReplayScidRecords(TEngine &engine, const ScidRecord *records, int64_t begin, int64_t end,
+	TBarClock &clock, double timeOffset = 0, ReclaimListener *listener = NULL)
+{
+	int64_t processed = 0;
+
+	for (int64_t i = begin; i < end; i++)
+	{
+		const ScidRecord &record = records[i];
+
+		double barDateTime = 0;
+		int newBar = clock.Locate(ScidTimeToDateTime(record.DateTime) + timeOffset, barDateTime);
+		if (newBar < 0)
+			continue;
+
+		engine.ProcessTrade(record.Close, (float)record.TotalVolume, barDateTime, newBar != 0, listener);
+		processed++;
+	}
+
+	return processed;
+}
+
+/**
+ * @struct ScidTrade
+ * @brief A trade decoded from a .scid record, with the index of its bar (12 bytes).
+ *
+ * Tools that replay the same trades many times decode them once with `DecodeScidTrades`, so the
+ * bar clock and the record layout are not processed again for every replay.
+ */
+struct ScidTrade
+{
+	float Price;
+	float Volume;
+	int32_t BarIndex;
+};
+
+/**
+ * @brief Decodes a range of .scid records into trades and bar start times.
+ *
+ * @param records The .scid records.
+ * @param begin Index of the first record to decode.
+ * @param end Index after the last record to decode.
+ * @param clock Bar clock used to detect bar boundaries.
+ * @param trades Receives the trades, appended.
+ * @param barStartTimes Receives the start time of every new bar, appended. `ScidTrade::BarIndex` indexes it.
+ * @param timeOffset Offset in days added to the UTC record times before they are located.
+ */
+template <class TBarClock>
+void DecodeScidTrades(const ScidRecord *records, int64_t begin, int64_t end, TBarClock &clock,
+	std::vector<ScidTrade> &trades, std::vector<double> &barStartTimes, double timeOffset = 0)
+{
+	for (int64_t i = begin; i < end; i++)
+	{
+		const ScidRecord &record = records[i];
+
+		double barDateTime = 0;
+		int newBar = clock.Locate(ScidTimeToDateTime(record.DateTime) + timeOffset, barDateTime);
+		if (newBar < 0)
+			continue;
+		if (newBar > 0 || barStartTimes.empty())
+			barStartTimes.push_back(barDateTime);
+
+		ScidTrade trade;
+		trade.Price = record.Close;
+		trade.Volume = (float)record.TotalVolume;
+		trade.BarIndex = (int32_t)barStartTimes.size() - 1;
+		trades.push_back(trade);
+	}
+}
+
+/**
+ * @brief Feeds a range of decoded trades to a reclaim engine.
+ *
+ * Gives the same result as `ReplayScidRecords` on the records the trades were decoded from.
+ *
+ * @param engine The engine that receives the trades.
+ * @param trades The decoded trades.
+ * @param begin Index of the first trade to process.
+ * @param end Index after the last trade to process.
+ * @param barStartTimes Bar start times filled by `DecodeScidTrades`.
+ * @param listener Optional listener passed to the engine.
+ */
+inline void ReplayScidTrades(ReclaimEngine &engine, const ScidTrade *trades, int64_t begin, int64_t end,
+	const double *barStartTimes, ReclaimListener *listener = NULL)
+{
+	int32_t barIndex = begin > 0 ? trades[begin - 1].BarIndex : -1;
+
+	for (int64_t i = begin; i < end; i++)
+	{
+		const ScidTrade &trade = trades[i];
+		engine.ProcessTrade(trade.Price, trade.Volume, barStartTimes[trade.BarIndex], trade.BarIndex != barIndex, listener);
+		barIndex = trade.BarIndex;
+	}
+}
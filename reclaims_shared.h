@@ -0,0 +1,502 @@
+/*
+ * @file reclaims_shared.h
+ * @brief Process wide reclaim engines shared by every chart of the same symbol.
+ *
+ * When the study runs on several charts of the same symbol, each instance would process the same
+ * trades with its own engine. A `SharedReclaimEngine` computes the reclaims once, on its own thread,
+ * from the trades of the symbol's .scid file, and the chart instances only draw them.
+ *
+ * The engines of the same symbol and settings with different bar periods belong to one
+ * `SharedReclaimFeed`: one thread tails the .scid file and feeds every record to all of them in
+ * one pass, see `ReclaimTimeframes`, so a 1-min, a 5-min and a 30-min chart cost one read of the
+ * file instead of three.
+ *
+ * Feeds are registered in `SharedReclaimRegistry` by symbol and settings, their engines by bar
+ * period, and the engines are reference counted by the chart instances that use them.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "reclaims_engine.h"
+#include "reclaims_query.h"
+#include "reclaims_scid.h"
+#include "reclaims_shm.h"
+#include "reclaims_timeframes.h"
+
+class SharedReclaimFeed;
+
+/**
+ * @class SharedReclaimEngine
+ * @brief The reclaim engine of one bar period of a `SharedReclaimFeed`.
+ *
+ * The engine runs on UTC time based bars of a fixed length, so charts with different bar periods
+ * and time zones can draw the same reclaims. The feed thread processes the history first and then
+ * processes the records appended to the file. Readers copy the reclaims with `CopyReclaims`.
+ */
+class SharedReclaimEngine
+{
+public:
+	/**
+	 * @brief Wakes the feed thread up so it processes the new records of the file.
+	 *
+	 * Called by the chart instances on every update. Without it the thread polls the file a few
+	 * times per second.
+	 */
+	inline void Poke();
+
+	/**
+	 * @brief Publishes the reclaims into a shared memory region every time they change.
+	 *
+	 * @param name Name of the region, see `GetReclaimShmName`. The engines of a feed publish from the same thread,
+	 *             so every bar period needs its own name.
+	 * @return `false` if the region could not be created or is already published.
+	 */
+	inline bool EnablePublishing(const std::string &name);
+
+	/**
+	 * @brief Enables the per tick coverage counts of the engine, see `ReclaimEngine::EnableCoverage`.
+	 */
+	inline void EnableCoverage();
+
+	/**
+	 * @brief Returns the number of active reclaims of one side whose area contains a price.
+	 */
+	inline int GetCoverage(int type, float price);
+
+	/**
+	 * @brief Enables the level indexes of the engine and makes the reclaims queryable by symbol through
+	 *        `ReclaimQueryRegistry`. The registration lasts until the last chart releases the engine.
+	 */
+	inline void EnableQueries(const char *symbol);
+
+	int GetBarPeriod() const { return m_BarPeriodSeconds; }
+
+	/**
+	 * @brief Returns true once the history of the file has been processed.
+	 */
+	bool IsReady() const { return m_Ready.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Returns a number that changes every time the reclaims change.
+	 */
+	uint64_t GetVersion() const { return m_Version.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Copies the up and down reclaims arrays.
+	 *
+	 * @return The version of the copied reclaims.
+	 */
+	inline uint64_t CopyReclaims(std::vector<Reclaim> &upReclaims, std::vector<Reclaim> &downReclaims);
+
+private:
+	friend class SharedReclaimFeed;
+	friend class SharedReclaimRegistry;
+
+	SharedReclaimEngine(SharedReclaimFeed *feed, ReclaimEngine *engine, int barPeriodSeconds)
+		: p_Feed(feed)
+		, p_Engine(engine)
+		, m_BarPeriodSeconds(barPeriodSeconds)
+		, m_NextRecord(0)
+		, m_Changed(false)
+		, m_Ready(false)
+		, m_Version(0)
+	{
+	}
+
+	SharedReclaimFeed *p_Feed;
+	ReclaimEngine *p_Engine; // owned by the ReclaimTimeframes of the feed
+	int m_BarPeriodSeconds;
+
+	// guarded by the engine mutex of the feed
+	ReclaimShmPublisher m_Publisher;
+	int64_t m_NextRecord; // before the last chunk of records
+	bool m_Changed;       // since the version was last increased
+
+	std::atomic<bool> m_Ready;
+	std::atomic<uint64_t> m_Version;
+};
+
+/**
+ * @class SharedReclaimFeed
+ * @brief The shared engines of a symbol and settings, fed from a .scid file by a dedicated thread.
+ */
+class SharedReclaimFeed
+{
+public:
+	SharedReclaimFeed(const std::string &scidPath, const ReclaimSettings &settings)
+		: m_ScidPath(scidPath)
+		, m_Settings(settings)
+		, m_Poked(false)
+		, m_Stop(false)
+	{
+	}
+
+	~SharedReclaimFeed()
+	{
+		Stop();
+
+		for (size_t i = 0; i < m_Engines.size(); i++)
+			delete m_Engines[i];
+	}
+
+	/**
+	 * @brief Opens the .scid file and starts the feed thread.
+	 *
+	 * @return `false` if the .scid file could not be read.
+	 */
+	bool Start()
+	{
+		if (!m_ScidFile.Open(m_ScidPath.c_str()))
+			return false;
+
+		m_Thread = std::thread(&SharedReclaimFeed::Run, this);
+		return true;
+	}
+
+	/**
+	 * @brief Stops the feed thread and waits for it to exit.
+	 */
+	void Stop()
+	{
+		m_Stop.store(true);
+		Poke();
+
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+	/**
+	 * @brief Wakes the feed thread up so it processes the new records of the file.
+	 */
+	void Poke()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_Poked = true;
+		}
+		m_Wake.notify_one();
+	}
+
+	/**
+	 * @brief Returns the engine of a bar period, adding it if needed. A new engine processes the history of the
+	 *        file on the feed thread, while the others keep up with the new records.
+	 *
+	 * @param barPeriodSeconds Length of the engine bars.
+	 * @param volume Whether the engine accumulates the volume of the reclaims. Once enabled, it stays enabled.
+	 * @return `NULL` if the feed already has `ReclaimTimeframes::MAX_TIMEFRAMES` bar periods.
+	 */
+	SharedReclaimEngine *GetEngine(int barPeriodSeconds, bool volume)
+	{
+		SharedReclaimEngine *added;
+		{
+			std::lock_guard<std::mutex> lock(m_EngineMutex);
+
+			for (size_t i = 0; i < m_Engines.size(); i++)
+			{
+				if (m_Engines[i]->m_BarPeriodSeconds != barPeriodSeconds)
+					continue;
+
+				// the reclaims created before only count the volume of the later trades
+				if (volume)
+					m_Engines[i]->p_Engine->EnableVolume(true);
+				return m_Engines[i];
+			}
+
+			int timeframe = m_Timeframes.Add(m_Settings, barPeriodSeconds);
+			if (timeframe < 0)
+				return NULL;
+
+			ReclaimEngine &engine = m_Timeframes.GetEngine(timeframe);
+			engine.EnableVolume(volume);
+			added = new SharedReclaimEngine(this, &engine, barPeriodSeconds);
+			m_Engines.push_back(added);
+		}
+
+		Poke();
+		return added;
+	}
+
+	/**
+	 * @brief Deletes the engine of a bar period. It must already be unregistered from `ReclaimQueryRegistry`:
+	 *        the queries lock the registry and then the engine mutex, so it cannot be unregistered here.
+	 *
+	 * @return `true` if the feed has no engine left.
+	 */
+	bool RemoveEngine(SharedReclaimEngine *engine)
+	{
+		std::lock_guard<std::mutex> lock(m_EngineMutex);
+
+		for (size_t i = 0; i < m_Engines.size(); i++)
+		{
+			if (m_Engines[i] != engine)
+				continue;
+
+			int timeframe = m_Timeframes.Find(engine->m_BarPeriodSeconds);
+			delete engine;
+			m_Timeframes.Remove(timeframe);
+			m_Engines.erase(m_Engines.begin() + i);
+			break;
+		}
+
+		return m_Engines.empty();
+	}
+
+private:
+	friend class SharedReclaimEngine;
+
+	void Run()
+	{
+		// process the records in chunks so readers and Stop are not blocked for long
+		const int64_t chunkSize = 1 << 16;
+
+		while (!m_Stop.load())
+		{
+			bool mapped = m_ScidFile.Refresh();
+			int64_t recordCount = mapped ? m_ScidFile.GetRecordCount() : 0;
+
+			std::unique_lock<std::mutex> engineLock(m_EngineMutex);
+			while (mapped && !m_Stop.load(std::memory_order_relaxed))
+			{
+				for (size_t i = 0; i < m_Engines.size(); i++)
+					m_Engines[i]->m_NextRecord = GetNextRecord(*m_Engines[i]);
+
+				if (m_Timeframes.Replay(m_ScidFile.GetRecords(), recordCount, chunkSize) == 0)
+					break;
+
+				for (size_t i = 0; i < m_Engines.size(); i++)
+				{
+					SharedReclaimEngine &engine = *m_Engines[i];
+					if (GetNextRecord(engine) == engine.m_NextRecord)
+						continue;
+
+					if (engine.m_Publisher.IsOpen())
+						engine.m_Publisher.Publish(*engine.p_Engine);
+					engine.m_Changed = true;
+				}
+
+				// let the readers and the charts that add or remove an engine in
+				engineLock.unlock();
+				engineLock.lock();
+			}
+
+			for (size_t i = 0; i < m_Engines.size(); i++)
+			{
+				SharedReclaimEngine &engine = *m_Engines[i];
+				if (engine.m_Changed)
+					engine.m_Version.fetch_add(1, std::memory_order_release);
+				engine.m_Changed = false;
+
+				if (!engine.m_Ready.load(std::memory_order_relaxed) && GetNextRecord(engine) >= recordCount)
+					engine.m_Ready.store(true, std::memory_order_release);
+			}
+			engineLock.unlock();
+
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_Wake.wait_for(lock, std::chrono::milliseconds(250), [this] { return m_Poked; });
+			m_Poked = false;
+		}
+
+		m_ScidFile.Close();
+	}
+
+	int64_t GetNextRecord(const SharedReclaimEngine &engine) const
+	{
+		return m_Timeframes.GetNextRecord(m_Timeframes.Find(engine.m_BarPeriodSeconds));
+	}
+
+	std::string m_ScidPath;
+	ScidFile m_ScidFile;
+	ReclaimSettings m_Settings;
+
+	// guards m_Timeframes, m_Engines and the publishers, also used by the queries
+	std::mutex m_EngineMutex;
+	ReclaimTimeframes m_Timeframes;
+	std::vector<SharedReclaimEngine *> m_Engines;
+
+	std::thread m_Thread;
+	std::mutex m_WakeMutex;
+	std::condition_variable m_Wake;
+	bool m_Poked;
+
+	std::atomic<bool> m_Stop;
+};
+
+inline void SharedReclaimEngine::Poke() { p_Feed->Poke(); }
+
+inline bool SharedReclaimEngine::EnablePublishing(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(p_Feed->m_EngineMutex);
+
+	if (m_Publisher.IsOpen())
+		return true;
+	if (!m_Publisher.Open(name))
+		return false;
+
+	m_Publisher.Publish(*p_Engine);
+	return true;
+}
+
+inline void SharedReclaimEngine::EnableCoverage()
+{
+	std::lock_guard<std::mutex> lock(p_Feed->m_EngineMutex);
+	p_Engine->EnableCoverage(true);
+}
+
+inline int SharedReclaimEngine::GetCoverage(int type, float price)
+{
+	std::lock_guard<std::mutex> lock(p_Feed->m_EngineMutex);
+	return p_Engine->GetCoverage(type, price);
+}
+
+inline void SharedReclaimEngine::EnableQueries(const char *symbol)
+{
+	// the queries lock the registry and then the engine mutex, so the index is enabled first
+	{
+		std::lock_guard<std::mutex> lock(p_Feed->m_EngineMutex);
+		p_Engine->EnableLevelIndex(true);
+	}
+	ReclaimQueryRegistry::Register(symbol, p_Engine, &p_Feed->m_EngineMutex);
+}
+
+inline uint64_t SharedReclaimEngine::CopyReclaims(std::vector<Reclaim> &upReclaims, std::vector<Reclaim> &downReclaims)
+{
+	std::lock_guard<std::mutex> lock(p_Feed->m_EngineMutex);
+
+	upReclaims.assign(p_Engine->GetUpReclaims(), p_Engine->GetUpReclaims() + p_Engine->GetSize());
+	downReclaims.assign(p_Engine->GetDownReclaims(), p_Engine->GetDownReclaims() + p_Engine->GetSize());
+	return m_Version.load(std::memory_order_relaxed);
+}
+
+/**
+ * @class SharedReclaimRegistry
+ * @brief Process wide registry of shared reclaim feeds, keyed by symbol and settings.
+ */
+class SharedReclaimRegistry
+{
+public:
+	/**
+	 * @brief Returns the engine for a symbol, settings and bar period, creating and starting it if needed.
+	 *
+	 * Every successful call must be matched by a call to `Release`.
+	 *
+	 * @param symbol Symbol of the chart.
+	 * @param scidPath Path of the symbol's .scid file.
+	 * @param settings Settings of the engine.
+	 * @param barPeriodSeconds Length of the engine bars.
+	 * @param volume Whether the chart publishes or queries the volume of the reclaims, see `SharedReclaimFeed::GetEngine`.
+	 * @return The engine, or NULL if the .scid file could not be read or the feed of the symbol has too many
+	 *         bar periods.
+	 */
+	static SharedReclaimEngine *Acquire(const char *symbol, const char *scidPath, const ReclaimSettings &settings, int barPeriodSeconds,
+		bool volume = false)
+	{
+		std::string key = MakeKey(symbol, settings);
+
+		std::lock_guard<std::mutex> lock(GetMutex());
+		std::map<std::string, Entry> &entries = GetEntries();
+
+		std::map<std::string, Entry>::iterator found = entries.find(key);
+		if (found == entries.end())
+		{
+			SharedReclaimFeed *feed = new SharedReclaimFeed(scidPath, settings);
+			if (!feed->Start())
+			{
+				delete feed;
+				return NULL;
+			}
+
+			found = entries.insert(std::make_pair(key, Entry())).first;
+			found->second.Feed = feed;
+		}
+
+		Entry &entry = found->second;
+		SharedReclaimEngine *engine = entry.Feed->GetEngine(barPeriodSeconds, volume);
+		if (engine == NULL)
+			return NULL;
+
+		entry.RefCounts[engine]++;
+		return engine;
+	}
+
+	/**
+	 * @brief Releases an engine returned by `Acquire`. The last release deletes it, and stops and deletes its
+	 *        feed when it was the last engine of the feed.
+	 */
+	static void Release(SharedReclaimEngine *engine)
+	{
+		SharedReclaimFeed *unused = NULL;
+		{
+			std::lock_guard<std::mutex> lock(GetMutex());
+			std::map<std::string, Entry> &entries = GetEntries();
+
+			for (std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+			{
+				std::map<SharedReclaimEngine *, int>::iterator refCount = it->second.RefCounts.find(engine);
+				if (refCount == it->second.RefCounts.end())
+					continue;
+
+				if (--refCount->second == 0)
+				{
+					it->second.RefCounts.erase(refCount);
+
+					// before the engine mutex is taken, the queries lock the query registry and then the engine mutex
+					ReclaimQueryRegistry::Unregister(engine->p_Engine);
+					if (it->second.Feed->RemoveEngine(engine))
+					{
+						unused = it->second.Feed;
+						entries.erase(it);
+					}
+				}
+				break;
+			}
+		}
+
+		// joining the feed thread does not need the registry lock
+		delete unused;
+	}
+
+private:
+	struct Entry
+	{
+		Entry()
+			: Feed(NULL)
+		{
+		}
+
+		SharedReclaimFeed *Feed;
+		std::map<SharedReclaimEngine *, int> RefCounts;
+	};
+
+	static std::string MakeKey(const char *symbol, const ReclaimSettings &settings)
+	{
+		char parameters[128];
+		snprintf(parameters, sizeof(parameters), "|%d|%d|%g|%d|%g|%d", settings.MaxNumberOfReclaims,
+			settings.NewReclaimThreshold, settings.TickSize, settings.UpdateOnBarClose ? 1 : 0,
+			settings.AdaptiveThresholdFactor, settings.AdaptiveThresholdBars);
+		return std::string(symbol) + parameters;
+	}
+
+	static std::mutex &GetMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::map<std::string, Entry> &GetEntries()
+	{
+		static std::map<std::string, Entry> entries;
+		return entries;
+	}
+};
@@ -0,0 +1,551 @@
+/*
+ * @file reclaims_shm.h
+ * @brief Publishes the live reclaims into a shared memory region that other processes can read.
+ *
+ * The writer (the study) never waits for readers: the region is protected by a sequence lock.
+ * The writer makes the sequence odd, copies the active reclaims and makes it even again, and a
+ * reader retries its copy if the sequence was odd or changed while it was copying.
+ *
+ * The region holds the process id of its writer, which is cleared when the writer closes it. Readers
+ * check it with `ReclaimShmReader::IsWriterAlive`, so the last copy of a closed chart or of a crashed
+ * process is not taken for live reclaims.
+ *
+ * The same header is the reader library: include it and use `ReclaimShmReader`.
+ *
+ * On Linux the region is a POSIX shared memory object (shm_open), on Windows a named file mapping.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+// without winsock.h, which conflicts with the winsock2.h of reclaims_stream.h
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "reclaims_engine.h"
+
+/**
+ * @brief Identifies a reclaims shared memory region ("FCRC").
+ */
+static const uint32_t RECLAIM_SHM_MAGIC = 0x43524346;
+
+/**
+ * @brief Layout version of the region, increased on incompatible changes.
+ */
+static const uint32_t RECLAIM_SHM_LAYOUT_VERSION = 3;
+
+/**
+ * @brief Maximum number of reclaims per side in the region ("Max active reclaims" is limited to 1000).
+ */
+static const int RECLAIM_SHM_MAX_RECLAIMS = 1000;
+
+/**
+ * @struct ReclaimShmLevel
+ * @brief One active reclaim as published in shared memory (40 bytes).
+ */
+struct ReclaimShmLevel
+{
+	int64_t Id;
+	double StartDate;
+	float FixedSidePrice;
+	float ActiveSidePrice;
+	int32_t Type;  // 0: bullish, 1: bearish
+	int32_t Index; // index in the reclaims array, 0 is the current reclaim
+	double Volume; // volume traded inside the reclaim while it was active
+};
+
+/**
+ * @struct ReclaimShmRegion
+ * @brief Layout of the shared memory region.
+ */
+struct ReclaimShmRegion
+{
+	uint32_t Magic;
+	uint32_t LayoutVersion;
+
+	/**
+	 * @brief Sequence lock: odd while the writer is copying.
+	 */
+	std::atomic<uint32_t> Sequence;
+
+	/**
+	 * @brief Number of valid entries in `Levels`, bullish reclaims first.
+	 */
+	int32_t UpCount;
+	int32_t DownCount;
+
+	/**
+	 * @brief Process id of the writer, `0` once it closed the region.
+	 */
+	std::atomic<uint32_t> WriterProcessId;
+
+	/**
+	 * @brief Number of times the reclaims have been published.
+	 */
+	uint64_t PublishCount;
+
+	/**
+	 * @brief Sum of the level ids and prices, used by readers to verify a copy.
+	 */
+	double Checksum;
+
+	ReclaimShmLevel Levels[2 * RECLAIM_SHM_MAX_RECLAIMS];
+};
+
+/**
+ * @brief Computes the checksum stored in the region for a set of levels.
+ */
+inline double ComputeReclaimShmChecksum(const ReclaimShmLevel *levels, int count)
+{
+	double checksum = 0;
+	for (int i = 0; i < count; i++)
+		checksum += (double)levels[i].Id + levels[i].FixedSidePrice + levels[i].ActiveSidePrice;
+	return checksum;
+}
+
+/**
+ * @struct ReclaimShmSnapshot
+ * @brief A consistent copy of the region made by `ReclaimShmReader::Read`.
+ */
+struct ReclaimShmSnapshot
+{
+	uint64_t PublishCount;
+	int UpCount;
+	int DownCount;
+	double Checksum;
+	ReclaimShmLevel Levels[2 * RECLAIM_SHM_MAX_RECLAIMS];
+
+	/**
+	 * @brief Returns true if the levels match the checksum written by the writer.
+	 */
+	bool VerifyChecksum() const { return ComputeReclaimShmChecksum(Levels, UpCount + DownCount) == Checksum; }
+
+	const ReclaimShmLevel *GetUpLevels() const { return Levels; }
+	const ReclaimShmLevel *GetDownLevels() const { return Levels + UpCount; }
+};
+
+/**
+ * @brief Builds the region name for a symbol.
+ *
+ * Characters that are not allowed in shared memory names are replaced with '_'.
+ *
+ * @param suffix Tells apart the regions of the same symbol, such as "chart3" for the reclaims of chart 3,
+ *               or `NULL` for the name of the symbol alone.
+ */
+inline std::string GetReclaimShmName(const char *symbol, const char *suffix = NULL)
+{
+	std::string name = "fatcat_reclaims_";
+	for (const char *c = symbol; *c != 0; c++)
+	{
+		bool valid = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '.' || *c == '-';
+		name += valid ? *c : '_';
+	}
+
+	if (suffix != NULL)
+		name += std::string("_") + suffix;
+	return name;
+}
+
+/**
+ * @brief Returns the id of the current process, as stored in `ReclaimShmRegion::WriterProcessId`.
+ */
+inline uint32_t GetReclaimShmProcessId()
+{
+#ifdef _WIN32
+	return (uint32_t)GetCurrentProcessId();
+#else
+	return (uint32_t)getpid();
+#endif
+}
+
+/**
+ * @brief Returns true if a process with the given id is running.
+ *
+ * A crashed writer whose id was given to a new process is taken for alive.
+ */
+inline bool IsReclaimShmProcessAlive(uint32_t processId)
+{
+	if (processId == 0)
+		return false;
+
+#ifdef _WIN32
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)processId);
+	if (process == NULL)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	DWORD exitCode = 0;
+	bool alive = GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+	CloseHandle(process);
+	return alive;
+#else
+	return kill((pid_t)processId, 0) == 0 || errno == EPERM;
+#endif
+}
+
+/**
+ * @class ReclaimShmMapping
+ * @brief Maps a named shared memory region. Used by the writer and the reader.
+ */
+class ReclaimShmMapping
+{
+public:
+	ReclaimShmMapping()
+		: m_Region(NULL)
+#ifdef _WIN32
+		, m_Mapping(NULL)
+#endif
+	{
+	}
+
+	~ReclaimShmMapping() { Close(); }
+
+	/**
+	 * @brief Maps the region with the given name.
+	 *
+	 * @param name Name of the region, see `GetReclaimShmName`.
+	 * @param create `true` for the writer, which creates the region if needed.
+	 * @return `true` if the region is mapped.
+	 */
+	bool Open(const std::string &name, bool create)
+	{
+		Close();
+
+#ifdef _WIN32
+		std::string mappingName = "Local\\" + name;
+		if (create)
+			m_Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(ReclaimShmRegion), mappingName.c_str());
+		else
+			m_Mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName.c_str());
+		if (m_Mapping == NULL)
+			return false;
+
+		m_Region = (ReclaimShmRegion *)MapViewOfFile(m_Mapping, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(ReclaimShmRegion));
+		if (m_Region == NULL)
+		{
+			Close();
+			return false;
+		}
+#else
+		std::string shmName = "/" + name;
+		int file = shm_open(shmName.c_str(), create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+		if (file < 0)
+			return false;
+
+		if (create && ftruncate(file, sizeof(ReclaimShmRegion)) != 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void *region = mmap(NULL, sizeof(ReclaimShmRegion), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+		close(file);
+		if (region == MAP_FAILED)
+			return false;
+		m_Region = (ReclaimShmRegion *)region;
+#endif
+
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (m_Region != NULL)
+			UnmapViewOfFile(m_Region);
+		if (m_Mapping != NULL)
+		{
+			CloseHandle(m_Mapping);
+			m_Mapping = NULL;
+		}
+#else
+		if (m_Region != NULL)
+			munmap(m_Region, sizeof(ReclaimShmRegion));
+#endif
+		m_Region = NULL;
+	}
+
+	ReclaimShmRegion *GetRegion() const { return m_Region; }
+
+	/**
+	 * @brief Removes the name of a region, so it is no longer opened. The processes that mapped it keep it.
+	 *
+	 * A named file mapping of Windows is removed with its last handle, so only POSIX regions are unlinked.
+	 */
+	static void Unlink(const std::string &name)
+	{
+#ifndef _WIN32
+		shm_unlink(("/" + name).c_str());
+#else
+		(void)name;
+#endif
+	}
+
+private:
+	ReclaimShmRegion *m_Region;
+#ifdef _WIN32
+	HANDLE m_Mapping;
+#endif
+};
+
+/**
+ * @class ReclaimShmPublisher
+ * @brief Writer side: publishes the active reclaims of an engine.
+ */
+class ReclaimShmPublisher
+{
+public:
+	~ReclaimShmPublisher() { Close(); }
+
+	/**
+	 * @brief Creates or opens the region, marks it as valid and stores the id of the process as its writer.
+	 *
+	 * The region has a single writer: shm_open and CreateFileMapping open an existing region, so the
+	 * names published in the process are kept to refuse a second publisher of the same name, and a region
+	 * whose writer is another running process is refused too. The region of a crashed writer is reused.
+	 *
+	 * @return `false` if the region could not be created or another publisher already publishes it.
+	 */
+	bool Open(const std::string &name)
+	{
+		Close();
+
+		std::lock_guard<std::mutex> lock(GetMutex());
+		if (!GetNames().insert(name).second)
+			return false;
+
+		ReclaimShmRegion *region = m_Mapping.Open(name, true) ? m_Mapping.GetRegion() : NULL;
+		uint32_t writer = region != NULL && region->Magic == RECLAIM_SHM_MAGIC && region->LayoutVersion == RECLAIM_SHM_LAYOUT_VERSION
+			? region->WriterProcessId.load(std::memory_order_acquire) : 0;
+		if (region == NULL || (writer != GetReclaimShmProcessId() && IsReclaimShmProcessAlive(writer)))
+		{
+			m_Mapping.Close();
+			GetNames().erase(name);
+			return false;
+		}
+		m_Name = name;
+
+		region->Magic = RECLAIM_SHM_MAGIC;
+		region->LayoutVersion = RECLAIM_SHM_LAYOUT_VERSION;
+		region->WriterProcessId.store(GetReclaimShmProcessId(), std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Tells the readers that the reclaims are no longer published, and removes the region.
+	 */
+	void Close()
+	{
+		if (!IsOpen())
+			return;
+
+		std::lock_guard<std::mutex> lock(GetMutex());
+		m_Mapping.GetRegion()->WriterProcessId.store(0, std::memory_order_release);
+		m_Mapping.Close();
+		ReclaimShmMapping::Unlink(m_Name);
+
+		GetNames().erase(m_Name);
+		m_Name.clear();
+	}
+
+	/**
+	 * @brief Returns true if a publisher of the process publishes the region with the given name.
+	 */
+	static bool IsPublished(const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		return GetNames().count(name) > 0;
+	}
+
+	bool IsOpen() const { return m_Mapping.GetRegion() != NULL; }
+
+	/**
+	 * @brief Copies the active reclaims into the region.
+	 *
+	 * Only active reclaims are copied, so the cost depends on the number of live reclaims and not
+	 * on "Max active reclaims".
+	 */
+	void Publish(const Reclaim *upReclaims, const Reclaim *downReclaims, int size)
+	{
+		ReclaimShmRegion *region = m_Mapping.GetRegion();
+		if (region == NULL)
+			return;
+
+		if (size > RECLAIM_SHM_MAX_RECLAIMS)
+			size = RECLAIM_SHM_MAX_RECLAIMS;
+
+		uint32_t sequence = region->Sequence.load(std::memory_order_relaxed);
+		region->Sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		int upCount = CopyLevels(upReclaims, size, region->Levels);
+		int downCount = CopyLevels(downReclaims, size, region->Levels + upCount);
+
+		region->UpCount = upCount;
+		region->DownCount = downCount;
+		region->PublishCount++;
+		region->Checksum = ComputeReclaimShmChecksum(region->Levels, upCount + downCount);
+
+		region->Sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Publishes the active reclaims of an engine.
+	 */
+	void Publish(const ReclaimEngine &engine)
+	{
+		Publish(engine.GetUpReclaims(), engine.GetDownReclaims(), engine.GetSize());
+	}
+
+private:
+	static int CopyLevels(const Reclaim *reclaims, int size, ReclaimShmLevel *levels)
+	{
+		int count = 0;
+		for (int i = 0; i < size; i++)
+		{
+			const Reclaim &reclaim = reclaims[i];
+			if (reclaim.Deleted)
+				continue;
+
+			ReclaimShmLevel &level = levels[count++];
+			level.Id = reclaim.Id;
+			level.StartDate = reclaim.StartDate;
+			level.FixedSidePrice = reclaim.FixedSidePrice;
+			level.ActiveSidePrice = reclaim.ActiveSidePrice;
+			level.Type = reclaim.Type;
+			level.Index = i;
+			level.Volume = reclaim.Volume;
+		}
+		return count;
+	}
+
+	static std::mutex &GetMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::set<std::string> &GetNames()
+	{
+		static std::set<std::string> names;
+		return names;
+	}
+
+	ReclaimShmMapping m_Mapping;
+	std::string m_Name;
+};
+
+/**
+ * @class ReclaimShmReader
+ * @brief Reader side: makes consistent copies of the published reclaims without blocking the writer.
+ */
+class ReclaimShmReader
+{
+public:
+	/**
+	 * @brief Opens an existing region.
+	 *
+	 * @return `false` if the region does not exist, was not created by a compatible writer or its writer is gone.
+	 */
+	bool Open(const std::string &name)
+	{
+		if (!m_Mapping.Open(name, false))
+			return false;
+
+		ReclaimShmRegion *region = m_Mapping.GetRegion();
+		if (region->Magic != RECLAIM_SHM_MAGIC || region->LayoutVersion != RECLAIM_SHM_LAYOUT_VERSION || !IsWriterAlive())
+		{
+			m_Mapping.Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Close() { m_Mapping.Close(); }
+
+	/**
+	 * @brief Returns true while the writer publishes the region: it has not closed it and its process is running.
+	 *
+	 * A reader that keeps the region open checks it from time to time, the copies of a region whose writer
+	 * is gone are its last reclaims, not the live ones.
+	 */
+	bool IsWriterAlive() const
+	{
+		const ReclaimShmRegion *region = m_Mapping.GetRegion();
+		return region != NULL && IsReclaimShmProcessAlive(region->WriterProcessId.load(std::memory_order_acquire));
+	}
+
+	/**
+	 * @brief Copies the published reclaims.
+	 *
+	 * A copy made while the writer publishes is discarded and attempted again after yielding the
+	 * thread, so the writer can finish. A writer that publishes on every trade can still keep a
+	 * reader busy for all the attempts: `false` then only means the region was changing, the
+	 * caller keeps its previous copy and reads again later.
+	 *
+	 * @param snapshot Receives the copy.
+	 * @param maxAttempts Number of copies attempted while the writer is publishing.
+	 * @param retries Optional, receives the number of discarded copies.
+	 * @return `true` if a consistent copy was made, `false` if every attempt overlapped a publish.
+	 */
+	bool Read(ReclaimShmSnapshot &snapshot, int maxAttempts = 1000, int *retries = NULL)
+	{
+		const ReclaimShmRegion *region = m_Mapping.GetRegion();
+		if (region == NULL)
+			return false;
+
+		for (int attempt = 0; attempt < maxAttempts; attempt++)
+		{
+			if (retries != NULL)
+				*retries = attempt;
+
+			if (attempt > 0)
+				std::this_thread::yield();
+
+			uint32_t before = region->Sequence.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+
+			int upCount = region->UpCount;
+			int downCount = region->DownCount;
+			if (upCount < 0 || downCount < 0 || upCount + downCount > 2 * RECLAIM_SHM_MAX_RECLAIMS)
+				continue;
+
+			snapshot.PublishCount = region->PublishCount;
+			snapshot.UpCount = upCount;
+			snapshot.DownCount = downCount;
+			snapshot.Checksum = region->Checksum;
+			memcpy(snapshot.Levels, region->Levels, (upCount + downCount) * sizeof(ReclaimShmLevel));
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (region->Sequence.load(std::memory_order_relaxed) == before)
+				return true;
+		}
+
+		return false;
+	}
+
+private:
+	ReclaimShmMapping m_Mapping;
+};
@@ -0,0 +1,271 @@
+/*
+ * @file reclaims_stats.h
+ * @brief Latency histogram and counters of the study calls.
+ *
+ * The latency of every call is recorded in a log bucketed histogram, in the style of HdrHistogram:
+ * each power of two is split in 16 linear buckets, so a percentile is exact within about 6% for any
+ * value from nanoseconds to minutes, recording is O(1) and the histogram has a fixed size. The
+ * study only allocates the statistics when they are enabled, so they cost a null pointer test per
+ * call otherwise.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @class ReclaimLatencyHistogram
+ * @brief Log bucketed histogram of durations in nanoseconds.
+ */
+class ReclaimLatencyHistogram
+{
+public:
+	/**
+	 * @brief Number of bits of the linear buckets inside a power of two.
+	 */
+	static const int SUB_BUCKET_BITS = 4;
+	static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+	/**
+	 * @brief Number of buckets, enough for any 64 bit value.
+	 */
+	static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	ReclaimLatencyHistogram() { Reset(); }
+
+	void Reset()
+	{
+		memset(m_Counts, 0, sizeof(m_Counts));
+		m_Count = 0;
+		m_Sum = 0;
+		m_Min = UINT64_MAX;
+		m_Max = 0;
+	}
+
+	/**
+	 * @brief Adds one duration.
+	 */
+	void Record(uint64_t nanoseconds)
+	{
+		m_Counts[GetBucket(nanoseconds)]++;
+		m_Count++;
+		m_Sum += nanoseconds;
+		if (nanoseconds < m_Min)
+			m_Min = nanoseconds;
+		if (nanoseconds > m_Max)
+			m_Max = nanoseconds;
+	}
+
+	uint64_t GetCount() const { return m_Count; }
+	uint64_t GetMin() const { return m_Count > 0 ? m_Min : 0; }
+	uint64_t GetMax() const { return m_Max; }
+	double GetMean() const { return m_Count > 0 ? (double)m_Sum / m_Count : 0; }
+
+	/**
+	 * @brief Returns the duration below which the given percentage of the durations fall.
+	 *
+	 * The result is the upper bound of the bucket that contains the percentile, at most the maximum.
+	 *
+	 * @param percentile Percentage from 0 to 100.
+	 */
+	uint64_t GetPercentile(double percentile) const
+	{
+		if (m_Count == 0)
+			return 0;
+
+		uint64_t rank = (uint64_t)(percentile / 100.0 * m_Count + 0.5);
+		if (rank < 1)
+			rank = 1;
+		if (rank > m_Count)
+			rank = m_Count;
+
+		uint64_t seen = 0;
+		for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+		{
+			seen += m_Counts[bucket];
+			if (seen >= rank)
+			{
+				uint64_t upper = GetBucketStart(bucket + 1) - 1;
+				return upper < m_Max ? upper : m_Max;
+			}
+		}
+
+		return m_Max;
+	}
+
+	/**
+	 * @brief Returns the bucket of a duration.
+	 *
+	 * Values below `SUB_BUCKET_COUNT` have one bucket each, larger values are bucketed by their highest
+	 * bit and the `SUB_BUCKET_BITS` bits below it.
+	 */
+	static int GetBucket(uint64_t value)
+	{
+		if (value < SUB_BUCKET_COUNT)
+			return (int)value;
+
+		int shift = GetHighestBit(value) - SUB_BUCKET_BITS;
+		return (shift + 1) * SUB_BUCKET_COUNT + (int)(value >> shift) - SUB_BUCKET_COUNT;
+	}
+
+	/**
+	 * @brief Returns the smallest duration of a bucket.
+	 */
+	static uint64_t GetBucketStart(int bucket)
+	{
+		if (bucket < SUB_BUCKET_COUNT)
+			return (uint64_t)bucket;
+
+		int shift = bucket / SUB_BUCKET_COUNT - 1;
+		if (shift >= 64 - SUB_BUCKET_BITS)
+			return UINT64_MAX;
+
+		return (uint64_t)(SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT) << shift;
+	}
+
+private:
+	static int GetHighestBit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long bit;
+		_BitScanReverse64(&bit, value);
+		return (int)bit;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	uint64_t m_Counts[BUCKET_COUNT];
+	uint64_t m_Count;
+	uint64_t m_Sum;
+	uint64_t m_Min;
+	uint64_t m_Max;
+};
+
+/**
+ * @struct ReclaimCounters
+ * @brief What the study did since the statistics were enabled.
+ */
+struct ReclaimCounters
+{
+	int64_t Ticks;		  // prices processed by the engine: the trades of the tick history, then one per update
+	int64_t Created;	  // reclaims created
+	int64_t Reclaimed;	  // reclaims fully reclaimed
+	int64_t Evicted;	  // reclaims shifted out of the oldest position
+	int64_t UseToolCalls; // rectangles drawn or updated
+	int64_t DeleteCalls;  // rectangles deleted
+};
+
+/**
+ * @class ReclaimStats
+ * @brief Latency histogram of the calls and counters of one study instance or tool.
+ */
+class ReclaimStats
+{
+public:
+	ReclaimStats() { Reset(); }
+
+	void Reset()
+	{
+		m_Latency.Reset();
+		memset(&Counters, 0, sizeof(Counters));
+	}
+
+	/**
+	 * @brief Adds the duration of one call.
+	 */
+	void RecordLatency(uint64_t nanoseconds) { m_Latency.Record(nanoseconds); }
+
+	const ReclaimLatencyHistogram &GetLatency() const { return m_Latency; }
+
+	/**
+	 * @brief Formats the percentiles and the counters, one line per entry.
+	 *
+	 * @param name Prefix of every line, for example the symbol of the study instance.
+	 */
+	std::vector<std::string> Format(const char *name) const
+	{
+		static const double percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+
+		std::vector<std::string> lines;
+		char line[256];
+
+		snprintf(line, sizeof(line), "%s: %llu calls, mean %.0f ns, min %llu ns, max %llu ns", name,
+			(unsigned long long)m_Latency.GetCount(), m_Latency.GetMean(), (unsigned long long)m_Latency.GetMin(),
+			(unsigned long long)m_Latency.GetMax());
+		lines.push_back(line);
+
+		for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+		{
+			snprintf(line, sizeof(line), "%s: p%g %llu ns", name, percentiles[i],
+				(unsigned long long)m_Latency.GetPercentile(percentiles[i]));
+			lines.push_back(line);
+		}
+
+		snprintf(line, sizeof(line), "%s: %lld ticks, %lld created, %lld reclaimed, %lld evicted, %lld UseTool, %lld delete",
+			name, (long long)Counters.Ticks, (long long)Counters.Created, (long long)Counters.Reclaimed,
+			(long long)Counters.Evicted, (long long)Counters.UseToolCalls, (long long)Counters.DeleteCalls);
+		lines.push_back(line);
+
+		return lines;
+	}
+
+	/**
+	 * @brief Writes the statistics to a file, see `Format`.
+	 *
+	 * @return `false` if the file could not be written.
+	 */
+	bool WriteToFile(const char *path, const char *name) const
+	{
+		FILE *file = fopen(path, "w");
+		if (file == NULL)
+			return false;
+
+		std::vector<std::string> lines = Format(name);
+		for (size_t i = 0; i < lines.size(); i++)
+			fprintf(file, "%s\n", lines[i].c_str());
+
+		return fclose(file) == 0;
+	}
+
+	ReclaimCounters Counters;
+
+private:
+	ReclaimLatencyHistogram m_Latency;
+};
+
+/**
+ * @class ReclaimLatencyTimer
+ * @brief Records the time from its construction to its destruction, if it has statistics.
+ */
+class ReclaimLatencyTimer
+{
+public:
+	explicit ReclaimLatencyTimer(ReclaimStats *stats)
+		: p_Stats(stats)
+	{
+		if (p_Stats != NULL)
+			m_Start = std::chrono::steady_clock::now();
+	}
+
+	~ReclaimLatencyTimer()
+	{
+		if (p_Stats != NULL)
+			p_Stats->RecordLatency((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start).count());
+	}
+
+private:
+	ReclaimStats *p_Stats;
+	std::chrono::steady_clock::time_point m_Start;
+};
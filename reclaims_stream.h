@@ -0,0 +1,1016 @@
+/*
+ * @file reclaims_stream.h
+ * @brief Streams the changes of the reclaims to subscribers over a Unix domain socket.
+ *
+ * The study thread turns the engine notifications into fixed size binary messages (created,
+ * resized, reclaimed, evicted, identified by the reclaim handle) and stores them in a single
+ * producer ring. An I/O thread drains the ring, keeps a copy of the active reclaims, accepts
+ * subscribers and writes the messages to their sockets. A new subscriber first gets the active
+ * reclaims, then every change. The I/O thread sleeps in poll until a socket is ready or the study
+ * stores a message in the ring while it sleeps, which wakes it with a byte on a connected socket. The study thread never waits for the I/O thread or a socket: when
+ * the ring is full the messages are dropped and the study sends the whole state again on its next
+ * call, and a subscriber that does not read fast enough is disconnected.
+ *
+ * The same header is the subscriber library: include it and use `ReclaimStreamSubscriber` and
+ * `ReclaimStreamMirror`.
+ *
+ * Unix domain sockets are available on Linux and on Windows 10 version 1803 and later.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+// a windows.h included before without WIN32_LEAN_AND_MEAN brings winsock.h, which conflicts with winsock2.h
+#if defined(_WINSOCKAPI_) && !defined(_WINSOCK2API_)
+#error "include <winsock2.h> before <windows.h>, or define WIN32_LEAN_AND_MEAN"
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "reclaims_engine.h"
+
+/**
+ * @brief Version of the messages, sent in the `Id` of the hello message.
+ */
+static const int64_t RECLAIM_STREAM_PROTOCOL_VERSION = 1;
+
+/**
+ * @brief Kinds of stream messages.
+ */
+enum ReclaimStreamKind
+{
+	RECLAIM_STREAM_HELLO = 0,     // first message of a connection, `Sequence` is the last change in the snapshot
+	RECLAIM_STREAM_SNAPSHOT = 1,  // an active reclaim when the subscriber connected
+	RECLAIM_STREAM_CREATED = 2,   // a new reclaim
+	RECLAIM_STREAM_RESIZED = 3,   // the prices of an active reclaim changed
+	RECLAIM_STREAM_RECLAIMED = 4, // price crossed the fixed side, the reclaim is gone
+	RECLAIM_STREAM_EVICTED = 5,   // pushed out of the reclaims array by a new one, the reclaim is gone
+	RECLAIM_STREAM_RESET = 6      // every reclaim is gone, the active ones follow as created
+};
+
+/**
+ * @struct ReclaimStreamMessage
+ * @brief One change as written to the socket (48 bytes, little endian).
+ */
+struct ReclaimStreamMessage
+{
+	/**
+	 * @brief Number of the change, increased by one for every change sent by the study. The snapshot
+	 *        messages have the number of the hello message.
+	 */
+	uint32_t Sequence;
+
+	uint8_t Kind; // see ReclaimStreamKind
+	uint8_t Type; // 0: bullish, 1: bearish
+	uint16_t Reserved;
+
+	/**
+	 * @brief Handle of the reclaim, stable for its whole life, see `ReclaimEngine::Resolve`.
+	 */
+	uint64_t Handle;
+
+	int64_t Id;
+	double StartDate;
+	float FixedSidePrice;
+	float ActiveSidePrice;
+	double Volume;
+};
+
+static_assert(sizeof(ReclaimStreamMessage) == 48, "the stream messages are 48 bytes");
+
+/**
+ * @brief Returns the suffix of the socket of a chart, see `GetReclaimStreamPath`.
+ *
+ * Chart numbers are only unique within a chartbook, so the suffix holds both.
+ */
+inline std::string GetReclaimChartSuffix(const char *chartbook, int chartNumber)
+{
+	return std::string(chartbook) + "_chart" + std::to_string(chartNumber);
+}
+
+/**
+ * @brief Builds the default socket path for a symbol, next to the other temporary files.
+ *
+ * Characters that are not allowed in file names are replaced with '_'.
+ *
+ * @param suffix Tells apart the sockets of the same symbol, such as the `GetReclaimChartSuffix` of the
+ *               chart that streams, or `NULL` for the path of the symbol alone.
+ */
+inline std::string GetReclaimStreamPath(const char *symbol, const char *suffix = NULL)
+{
+	std::string path;
+#ifdef _WIN32
+	char folder[MAX_PATH];
+	DWORD length = GetTempPathA(MAX_PATH, folder);
+	path = length > 0 && length < MAX_PATH ? folder : ".\\";
+#else
+	path = "/tmp/";
+#endif
+
+	std::string name = symbol;
+	if (suffix != NULL)
+		name += std::string("_") + suffix;
+
+	path += "fatcat_reclaims_";
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		char c = name[i];
+		bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+		path += valid ? c : '_';
+	}
+	return path + ".sock";
+}
+
+/**
+ * @class ReclaimStreamSocket
+ * @brief Thin portable wrapper of the Unix domain socket calls.
+ */
+class ReclaimStreamSocket
+{
+public:
+#ifdef _WIN32
+	typedef SOCKET Handle;
+	static const Handle INVALID = INVALID_SOCKET;
+#else
+	typedef int Handle;
+	static const Handle INVALID = -1;
+#endif
+
+	/**
+	 * @brief Initializes the socket library once per process.
+	 */
+	static bool Startup()
+	{
+#ifdef _WIN32
+		static bool started = false;
+		static std::mutex mutex;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!started)
+		{
+			WSADATA data;
+			started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}
+		return started;
+#else
+		return true;
+#endif
+	}
+
+	/**
+	 * @brief Fills the address of a socket path.
+	 *
+	 * @return `false` if the path is too long.
+	 */
+	static bool GetAddress(const std::string &path, sockaddr_un &address)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			return false;
+		memcpy(address.sun_path, path.c_str(), path.size());
+		return true;
+	}
+
+	static Handle Create() { return socket(AF_UNIX, SOCK_STREAM, 0); }
+
+	static void Close(Handle socket)
+	{
+#ifdef _WIN32
+		closesocket(socket);
+#else
+		close(socket);
+#endif
+	}
+
+	static void RemovePath(const std::string &path)
+	{
+#ifdef _WIN32
+		DeleteFileA(path.c_str());
+#else
+		unlink(path.c_str());
+#endif
+	}
+
+	static bool SetNonBlocking(Handle socket)
+	{
+#ifdef _WIN32
+		u_long enable = 1;
+		return ioctlsocket(socket, FIONBIO, &enable) == 0;
+#else
+		int flags = fcntl(socket, F_GETFL, 0);
+		return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+	}
+
+	/**
+	 * @brief Sends without blocking.
+	 *
+	 * @return The number of bytes sent, 0 if the socket buffer is full and -1 if the connection is closed.
+	 */
+	static int Send(Handle socket, const char *data, size_t size)
+	{
+#ifdef _WIN32
+		int sent = send(socket, data, (int)size, 0);
+		if (sent < 0)
+			return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+#else
+		ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+		if (sent < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+#endif
+		return (int)sent;
+	}
+
+	/**
+	 * @brief Waits until one of the sockets is ready.
+	 */
+	static void Poll(std::vector<pollfd> &sockets, int milliseconds)
+	{
+#ifdef _WIN32
+		if (sockets.empty())
+			Sleep(milliseconds);
+		else
+			WSAPoll(sockets.data(), (ULONG)sockets.size(), milliseconds);
+#else
+		poll(sockets.data(), sockets.size(), milliseconds);
+#endif
+	}
+};
+
+/**
+ * @class ReclaimStreamServer
+ * @brief Study side: turns the engine notifications into messages and serves them to the subscribers.
+ *
+ * The `ReclaimListener` methods, `Resync` and `Invalidate` are called by one thread only, the
+ * chart thread of the study instance. Only the reclaims of one engine may be reported.
+ */
+class ReclaimStreamServer : public ReclaimListener
+{
+public:
+	/**
+	 * @brief Number of messages in the ring, a power of two.
+	 */
+	static const int CAPACITY = 1 << 16;
+
+	/**
+	 * @brief Bytes waiting for a subscriber before it is disconnected.
+	 */
+	static const size_t MAX_PENDING_BYTES = 16 << 20;
+
+	ReclaimStreamServer()
+		: m_Messages(CAPACITY)
+		, m_Head(0)
+		, m_Tail(0)
+		, m_Dropped(0)
+		, m_Resyncs(0)
+		, m_Sequence(0)
+		, m_NeedsResync(true)
+		, m_Listener(ReclaimStreamSocket::INVALID)
+		, m_WakeSender(ReclaimStreamSocket::INVALID)
+		, m_WakeReceiver(ReclaimStreamSocket::INVALID)
+		, m_Sleeping(false)
+		, m_Subscribers(0)
+		, m_Stop(false)
+	{
+	}
+
+	~ReclaimStreamServer() { Close(); }
+
+	/**
+	 * @brief Creates the socket and starts the I/O thread.
+	 *
+	 * A socket file left by a process that is gone is replaced, a socket that accepts connections is not.
+	 *
+	 * @return `false` if the socket could not be created or another process serves the path.
+	 */
+	bool Open(const std::string &path)
+	{
+		Close();
+
+		sockaddr_un address;
+		if (!ReclaimStreamSocket::Startup() || !ReclaimStreamSocket::GetAddress(path, address))
+			return false;
+
+		if (IsServed(path))
+			return false;
+		ReclaimStreamSocket::RemovePath(path);
+
+		m_Listener = ReclaimStreamSocket::Create();
+		if (m_Listener == ReclaimStreamSocket::INVALID)
+			return false;
+
+		if (bind(m_Listener, (const sockaddr *)&address, sizeof(address)) != 0 || listen(m_Listener, 16) != 0)
+		{
+			ReclaimStreamSocket::Close(m_Listener);
+			m_Listener = ReclaimStreamSocket::INVALID;
+			return false;
+		}
+
+		// the first connection is the wake up socket of the I/O thread
+		m_WakeSender = ReclaimStreamSocket::Create();
+		if (m_WakeSender == ReclaimStreamSocket::INVALID || connect(m_WakeSender, (const sockaddr *)&address, sizeof(address)) != 0 ||
+			(m_WakeReceiver = accept(m_Listener, NULL, NULL)) == ReclaimStreamSocket::INVALID ||
+			!ReclaimStreamSocket::SetNonBlocking(m_WakeSender) || !ReclaimStreamSocket::SetNonBlocking(m_WakeReceiver) ||
+			!ReclaimStreamSocket::SetNonBlocking(m_Listener))
+		{
+			m_Path = path;
+			CloseSockets();
+			return false;
+		}
+
+		m_Path = path;
+		m_Head.store(0);
+		m_Tail.store(0);
+		m_Dropped.store(0);
+		m_Resyncs = 0;
+		m_Sequence = 0;
+		m_NeedsResync = true;
+		m_Sent.clear();
+		m_Sleeping.store(false);
+		m_Stop.store(false);
+
+		m_Thread = std::thread(&ReclaimStreamServer::Run, this);
+		return true;
+	}
+
+	/**
+	 * @brief Returns true if a socket at the path accepts connections, from this process or another one.
+	 */
+	static bool IsServed(const std::string &path)
+	{
+		sockaddr_un address;
+		if (!ReclaimStreamSocket::Startup() || !ReclaimStreamSocket::GetAddress(path, address))
+			return false;
+
+		ReclaimStreamSocket::Handle probe = ReclaimStreamSocket::Create();
+		if (probe == ReclaimStreamSocket::INVALID)
+			return false;
+		bool served = connect(probe, (const sockaddr *)&address, sizeof(address)) == 0;
+		ReclaimStreamSocket::Close(probe);
+		return served;
+	}
+
+	/**
+	 * @brief Sends the remaining messages, disconnects the subscribers and removes the socket.
+	 */
+	void Close()
+	{
+		if (m_Thread.joinable())
+		{
+			m_Stop.store(true);
+			Wake();
+			m_Thread.join();
+		}
+
+		CloseSockets();
+	}
+
+	bool IsOpen() const { return m_Listener != ReclaimStreamSocket::INVALID; }
+
+	/**
+	 * @brief Returns true when the subscribers need the whole state again, see `Resync`.
+	 *
+	 * The changes are not sent until then.
+	 */
+	bool NeedsResync() const { return m_NeedsResync; }
+
+	/**
+	 * @brief Stops sending changes until the next `Resync`, for example when the engine is reset.
+	 */
+	void Invalidate() { m_NeedsResync = true; }
+
+	/**
+	 * @brief Sends a reset followed by every active reclaim of the engine.
+	 *
+	 * @return `false` if the ring has no room for them yet, the I/O thread is still sending older changes.
+	 */
+	bool Resync(const ReclaimEngine &engine)
+	{
+		uint64_t used = m_Head.load(std::memory_order_relaxed) - m_Tail.load(std::memory_order_acquire);
+		if (used + 2 * engine.GetSize() + 1 > (uint64_t)CAPACITY)
+			return false;
+
+		m_NeedsResync = false;
+		m_Resyncs++;
+		m_Sent.clear();
+
+		Reclaim empty;
+		memset(&empty, 0, sizeof(empty));
+		Push(RECLAIM_STREAM_RESET, empty);
+
+		for (int type = 0; type < 2; type++)
+		{
+			const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+			for (int i = 0; i < engine.GetSize(); i++)
+			{
+				if (!reclaims[i].Deleted)
+					OnReclaimCreated(const_cast<Reclaim &>(reclaims[i]));
+			}
+		}
+		return true;
+	}
+
+	void OnReclaimCreated(Reclaim &reclaim)
+	{
+		if (m_NeedsResync)
+			return;
+
+		m_Sent[reclaim.Handle] = SentPrices(reclaim);
+		Push(RECLAIM_STREAM_CREATED, reclaim);
+	}
+
+	/**
+	 * @brief Sends the reclaim if its prices changed, the engine reports every active reclaim after an update.
+	 */
+	void OnReclaimUpdated(const Reclaim &reclaim, int)
+	{
+		if (m_NeedsResync)
+			return;
+
+		SentPrices prices(reclaim);
+		SentPrices &sent = m_Sent[reclaim.Handle];
+		if (sent == prices)
+			return;
+
+		sent = prices;
+		Push(RECLAIM_STREAM_RESIZED, reclaim);
+	}
+
+	void OnReclaimReclaimed(const Reclaim &reclaim)
+	{
+		if (m_NeedsResync)
+			return;
+
+		m_Sent.erase(reclaim.Handle);
+		Push(RECLAIM_STREAM_RECLAIMED, reclaim);
+	}
+
+	void OnReclaimEvicted(const Reclaim &reclaim)
+	{
+		if (m_NeedsResync)
+			return;
+
+		m_Sent.erase(reclaim.Handle);
+		Push(RECLAIM_STREAM_EVICTED, reclaim);
+	}
+
+	/**
+	 * @brief Returns the sequence number of the last change stored in the ring.
+	 */
+	uint32_t GetSequence() const { return m_Sequence; }
+
+	/**
+	 * @brief Returns the number of changes dropped because the ring was full.
+	 */
+	int64_t GetDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Returns the number of times the whole state was sent.
+	 */
+	int64_t GetResyncCount() const { return m_Resyncs; }
+
+	/**
+	 * @brief Returns the number of connected subscribers.
+	 */
+	int GetSubscriberCount() const { return m_Subscribers.load(std::memory_order_relaxed); }
+
+private:
+	/**
+	 * @brief Prices of a reclaim when it was last sent.
+	 */
+	struct SentPrices
+	{
+		SentPrices()
+			: FixedSidePrice(0)
+			, ActiveSidePrice(0)
+			, StartDate(0)
+		{
+		}
+
+		explicit SentPrices(const Reclaim &reclaim)
+			: FixedSidePrice(reclaim.FixedSidePrice)
+			, ActiveSidePrice(reclaim.ActiveSidePrice)
+			, StartDate(reclaim.StartDate)
+		{
+		}
+
+		bool operator==(const SentPrices &other) const
+		{
+			return FixedSidePrice == other.FixedSidePrice && ActiveSidePrice == other.ActiveSidePrice && StartDate == other.StartDate;
+		}
+
+		float FixedSidePrice;
+		float ActiveSidePrice;
+		double StartDate;
+	};
+
+	/**
+	 * @brief A connected subscriber and the bytes not written to its socket yet.
+	 */
+	struct Subscriber
+	{
+		ReclaimStreamSocket::Handle Socket;
+		std::vector<char> Pending;
+		size_t Offset;
+	};
+
+	static void ToMessage(ReclaimStreamKind kind, const Reclaim &reclaim, uint32_t sequence, ReclaimStreamMessage &message)
+	{
+		message.Sequence = sequence;
+		message.Kind = (uint8_t)kind;
+		message.Type = (uint8_t)reclaim.Type;
+		message.Reserved = 0;
+		message.Handle = reclaim.Handle;
+		message.Id = reclaim.Id;
+		message.StartDate = reclaim.StartDate;
+		message.FixedSidePrice = reclaim.FixedSidePrice;
+		message.ActiveSidePrice = reclaim.ActiveSidePrice;
+		message.Volume = reclaim.Volume;
+	}
+
+	/**
+	 * @brief Stores a change, or drops it and asks for a resync if the I/O thread is behind.
+	 */
+	void Push(ReclaimStreamKind kind, const Reclaim &reclaim)
+	{
+		uint64_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) >= (uint64_t)CAPACITY)
+		{
+			m_Dropped.fetch_add(1, std::memory_order_relaxed);
+			m_NeedsResync = true;
+			return;
+		}
+
+		ToMessage(kind, reclaim, ++m_Sequence, m_Messages[head & (CAPACITY - 1)]);
+
+		// sequentially consistent with the I/O thread that announces its sleep and then checks the ring
+		m_Head.store(head + 1, std::memory_order_seq_cst);
+		if (m_Sleeping.load(std::memory_order_seq_cst) && m_Sleeping.exchange(false))
+			Wake();
+	}
+
+	/**
+	 * @brief Wakes the I/O thread up from its poll. Never blocks: a full socket buffer already wakes it.
+	 */
+	void Wake()
+	{
+		char byte = 0;
+		ReclaimStreamSocket::Send(m_WakeSender, &byte, 1);
+	}
+
+	void CloseSockets()
+	{
+		if (m_WakeSender != ReclaimStreamSocket::INVALID)
+		{
+			ReclaimStreamSocket::Close(m_WakeSender);
+			m_WakeSender = ReclaimStreamSocket::INVALID;
+		}
+		if (m_WakeReceiver != ReclaimStreamSocket::INVALID)
+		{
+			ReclaimStreamSocket::Close(m_WakeReceiver);
+			m_WakeReceiver = ReclaimStreamSocket::INVALID;
+		}
+		if (m_Listener != ReclaimStreamSocket::INVALID)
+		{
+			ReclaimStreamSocket::Close(m_Listener);
+			m_Listener = ReclaimStreamSocket::INVALID;
+			ReclaimStreamSocket::RemovePath(m_Path);
+		}
+	}
+
+	void Run()
+	{
+		std::vector<Subscriber> subscribers;
+		std::vector<pollfd> sockets;
+		std::vector<ReclaimStreamMessage> batch;
+		uint32_t lastSequence = 0;
+
+		// active reclaims as of lastSequence, sent to new subscribers
+		std::unordered_map<uint64_t, ReclaimStreamMessage> mirror;
+
+		while (true)
+		{
+			bool stop = m_Stop.load();
+
+			Accept(subscribers, mirror, lastSequence);
+			Drain(batch, mirror, lastSequence);
+
+			for (size_t i = 0; i < subscribers.size(); i++)
+			{
+				Subscriber &subscriber = subscribers[i];
+				if (!batch.empty())
+					subscriber.Pending.insert(subscriber.Pending.end(), (const char *)batch.data(), (const char *)(batch.data() + batch.size()));
+				Write(subscriber);
+			}
+			Disconnect(subscribers, stop);
+
+			if (stop)
+				break;
+
+			if (!batch.empty())
+				continue;
+
+			// sleep until a subscriber can take more bytes, connects, or the study stores changes
+			sockets.resize(subscribers.size() + 2);
+			sockets[0].fd = m_Listener;
+			sockets[0].events = POLLIN;
+			sockets[0].revents = 0;
+			sockets[1].fd = m_WakeReceiver;
+			sockets[1].events = POLLIN;
+			sockets[1].revents = 0;
+			for (size_t i = 0; i < subscribers.size(); i++)
+			{
+				sockets[i + 2].fd = subscribers[i].Socket;
+				sockets[i + 2].events = subscribers[i].Pending.size() > subscribers[i].Offset ? POLLOUT : 0;
+				sockets[i + 2].revents = 0;
+			}
+
+			// changes stored after the announcement wake the thread, the ones stored before are seen here
+			m_Sleeping.store(true, std::memory_order_seq_cst);
+			if (m_Head.load(std::memory_order_seq_cst) == m_Tail.load(std::memory_order_relaxed) && !m_Stop.load())
+				ReclaimStreamSocket::Poll(sockets, 1000);
+			m_Sleeping.store(false, std::memory_order_relaxed);
+
+			char bytes[64];
+			while (recv(m_WakeReceiver, bytes, (int)sizeof(bytes), 0) > 0)
+			{
+			}
+		}
+	}
+
+	/**
+	 * @brief Accepts the new subscribers and queues the hello message and the snapshot for them.
+	 */
+	void Accept(std::vector<Subscriber> &subscribers, const std::unordered_map<uint64_t, ReclaimStreamMessage> &mirror, uint32_t lastSequence)
+	{
+		while (true)
+		{
+			ReclaimStreamSocket::Handle socket = accept(m_Listener, NULL, NULL);
+			if (socket == ReclaimStreamSocket::INVALID)
+				return;
+
+			if (!ReclaimStreamSocket::SetNonBlocking(socket))
+			{
+				ReclaimStreamSocket::Close(socket);
+				continue;
+			}
+
+			std::vector<ReclaimStreamMessage> messages;
+			messages.reserve(mirror.size() + 1);
+
+			ReclaimStreamMessage hello;
+			memset(&hello, 0, sizeof(hello));
+			hello.Sequence = lastSequence;
+			hello.Kind = RECLAIM_STREAM_HELLO;
+			hello.Id = RECLAIM_STREAM_PROTOCOL_VERSION;
+			messages.push_back(hello);
+
+			for (std::unordered_map<uint64_t, ReclaimStreamMessage>::const_iterator it = mirror.begin(); it != mirror.end(); ++it)
+			{
+				messages.push_back(it->second);
+				messages.back().Sequence = lastSequence;
+				messages.back().Kind = RECLAIM_STREAM_SNAPSHOT;
+			}
+
+			Subscriber subscriber;
+			subscriber.Socket = socket;
+			subscriber.Pending.assign((const char *)messages.data(), (const char *)(messages.data() + messages.size()));
+			subscriber.Offset = 0;
+			subscribers.push_back(subscriber);
+			m_Subscribers.store((int)subscribers.size(), std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Moves the changes stored since the last call into the batch and applies them to the mirror.
+	 */
+	void Drain(std::vector<ReclaimStreamMessage> &batch, std::unordered_map<uint64_t, ReclaimStreamMessage> &mirror, uint32_t &lastSequence)
+	{
+		batch.clear();
+
+		uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+		uint64_t head = m_Head.load(std::memory_order_acquire);
+
+		for (; tail != head; tail++)
+		{
+			const ReclaimStreamMessage &message = m_Messages[tail & (CAPACITY - 1)];
+			batch.push_back(message);
+			lastSequence = message.Sequence;
+
+			switch (message.Kind)
+			{
+			case RECLAIM_STREAM_RESET:
+				mirror.clear();
+				break;
+
+			case RECLAIM_STREAM_CREATED:
+			case RECLAIM_STREAM_RESIZED:
+				mirror[message.Handle] = message;
+				break;
+
+			default:
+				mirror.erase(message.Handle);
+				break;
+			}
+		}
+
+		m_Tail.store(tail, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Writes the pending bytes of a subscriber until its socket buffer is full.
+	 */
+	static void Write(Subscriber &subscriber)
+	{
+		while (subscriber.Offset < subscriber.Pending.size())
+		{
+			int sent = ReclaimStreamSocket::Send(subscriber.Socket, subscriber.Pending.data() + subscriber.Offset,
+				subscriber.Pending.size() - subscriber.Offset);
+			if (sent <= 0)
+			{
+				if (sent < 0)
+					subscriber.Offset = SIZE_MAX;
+				return;
+			}
+			subscriber.Offset += sent;
+		}
+
+		subscriber.Pending.clear();
+		subscriber.Offset = 0;
+	}
+
+	/**
+	 * @brief Closes the connections that failed or fell too far behind, or all of them.
+	 */
+	void Disconnect(std::vector<Subscriber> &subscribers, bool all)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < subscribers.size(); i++)
+		{
+			Subscriber &subscriber = subscribers[i];
+			bool failed = subscriber.Offset == SIZE_MAX || subscriber.Pending.size() - subscriber.Offset > MAX_PENDING_BYTES;
+			if (all || failed)
+			{
+				ReclaimStreamSocket::Close(subscriber.Socket);
+				continue;
+			}
+
+			// the bytes already written are only erased once in a while
+			if (subscriber.Offset > MAX_PENDING_BYTES / 4)
+			{
+				subscriber.Pending.erase(subscriber.Pending.begin(), subscriber.Pending.begin() + subscriber.Offset);
+				subscriber.Offset = 0;
+			}
+
+			if (kept != i)
+				subscribers[kept] = std::move(subscriber);
+			kept++;
+		}
+
+		subscribers.resize(kept);
+		m_Subscribers.store((int)kept, std::memory_order_relaxed);
+	}
+
+	std::vector<ReclaimStreamMessage> m_Messages;
+
+	// written by the chart thread and the I/O thread, on separate cache lines
+	alignas(64) std::atomic<uint64_t> m_Head;
+	alignas(64) std::atomic<uint64_t> m_Tail;
+	alignas(64) std::atomic<int64_t> m_Dropped;
+
+	// only used by the chart thread
+	int64_t m_Resyncs;
+	uint32_t m_Sequence;
+	bool m_NeedsResync;
+	std::unordered_map<uint64_t, SentPrices> m_Sent;
+
+	std::string m_Path;
+	ReclaimStreamSocket::Handle m_Listener;
+
+	// connected pair: the chart thread writes a byte to wake the I/O thread up from its poll
+	ReclaimStreamSocket::Handle m_WakeSender;
+	ReclaimStreamSocket::Handle m_WakeReceiver;
+	std::atomic<bool> m_Sleeping;
+
+	std::atomic<int> m_Subscribers;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Stop;
+};
+
+/**
+ * @class ReclaimStreamMirror
+ * @brief Subscriber side: the active reclaims rebuilt from the stream messages.
+ */
+class ReclaimStreamMirror
+{
+public:
+	ReclaimStreamMirror()
+		: m_Sequence(0)
+		, m_Synchronized(false)
+		, m_Errors(0)
+	{
+	}
+
+	/**
+	 * @brief Applies a message.
+	 *
+	 * @return `false` if the message does not follow the previous ones: a protocol version that is not
+	 *         supported, a missing change, or a change of a reclaim that is not active.
+	 */
+	bool Apply(const ReclaimStreamMessage &message)
+	{
+		bool valid = true;
+
+		switch (message.Kind)
+		{
+		case RECLAIM_STREAM_HELLO:
+			m_Reclaims.clear();
+			m_Sequence = message.Sequence;
+			m_Synchronized = true;
+			valid = message.Id == RECLAIM_STREAM_PROTOCOL_VERSION;
+			break;
+
+		case RECLAIM_STREAM_SNAPSHOT:
+			valid = m_Synchronized && message.Sequence == m_Sequence && m_Reclaims.find(message.Handle) == m_Reclaims.end();
+			m_Reclaims[message.Handle] = message;
+			break;
+
+		default:
+			valid = m_Synchronized && message.Sequence == m_Sequence + 1;
+			m_Sequence = message.Sequence;
+
+			if (message.Kind == RECLAIM_STREAM_RESET)
+			{
+				m_Reclaims.clear();
+			}
+			else if (message.Kind == RECLAIM_STREAM_CREATED)
+			{
+				valid = valid && m_Reclaims.find(message.Handle) == m_Reclaims.end();
+				m_Reclaims[message.Handle] = message;
+			}
+			else if (message.Kind == RECLAIM_STREAM_RESIZED)
+			{
+				std::unordered_map<uint64_t, ReclaimStreamMessage>::iterator found = m_Reclaims.find(message.Handle);
+				valid = valid && found != m_Reclaims.end();
+				m_Reclaims[message.Handle] = message;
+			}
+			else
+			{
+				valid = valid && m_Reclaims.erase(message.Handle) == 1;
+			}
+			break;
+		}
+
+		if (!valid)
+			m_Errors++;
+		return valid;
+	}
+
+	/**
+	 * @brief Returns the active reclaims by handle, the last message of each.
+	 */
+	const std::unordered_map<uint64_t, ReclaimStreamMessage> &GetReclaims() const { return m_Reclaims; }
+
+	/**
+	 * @brief Returns the sequence number of the last change applied.
+	 */
+	uint32_t GetSequence() const { return m_Sequence; }
+
+	bool IsSynchronized() const { return m_Synchronized; }
+
+	int64_t GetErrorCount() const { return m_Errors; }
+
+private:
+	std::unordered_map<uint64_t, ReclaimStreamMessage> m_Reclaims;
+	uint32_t m_Sequence;
+	bool m_Synchronized;
+	int64_t m_Errors;
+};
+
+/**
+ * @class ReclaimStreamSubscriber
+ * @brief Subscriber side: connects to a study and reads its messages.
+ */
+class ReclaimStreamSubscriber
+{
+public:
+	/**
+	 * @brief Bytes read from the socket at once.
+	 */
+	static const size_t BUFFER_SIZE = 1 << 18;
+
+	ReclaimStreamSubscriber()
+		: m_Socket(ReclaimStreamSocket::INVALID)
+		, m_Buffer(BUFFER_SIZE)
+		, m_Size(0)
+	{
+	}
+
+	~ReclaimStreamSubscriber() { Close(); }
+
+	/**
+	 * @brief Connects to the socket of a study, see `GetReclaimStreamPath`.
+	 */
+	bool Open(const std::string &path)
+	{
+		Close();
+
+		sockaddr_un address;
+		if (!ReclaimStreamSocket::Startup() || !ReclaimStreamSocket::GetAddress(path, address))
+			return false;
+
+		m_Socket = ReclaimStreamSocket::Create();
+		if (m_Socket == ReclaimStreamSocket::INVALID)
+			return false;
+
+		if (connect(m_Socket, (const sockaddr *)&address, sizeof(address)) != 0)
+		{
+			Close();
+			return false;
+		}
+
+		m_Size = 0;
+		return true;
+	}
+
+	void Close()
+	{
+		if (m_Socket != ReclaimStreamSocket::INVALID)
+		{
+			ReclaimStreamSocket::Close(m_Socket);
+			m_Socket = ReclaimStreamSocket::INVALID;
+		}
+	}
+
+	bool IsOpen() const { return m_Socket != ReclaimStreamSocket::INVALID; }
+
+	/**
+	 * @brief Waits for messages and reads the ones that arrived.
+	 *
+	 * @param messages Receives the messages, replaced on every call.
+	 * @param milliseconds Longest wait for the first message.
+	 * @return `false` when the study closed the connection.
+	 */
+	bool Read(std::vector<ReclaimStreamMessage> &messages, int milliseconds)
+	{
+		messages.clear();
+		if (m_Socket == ReclaimStreamSocket::INVALID)
+			return false;
+
+		std::vector<pollfd> sockets(1);
+		sockets[0].fd = m_Socket;
+		sockets[0].events = POLLIN;
+		sockets[0].revents = 0;
+		ReclaimStreamSocket::Poll(sockets, milliseconds);
+		if (sockets[0].revents == 0)
+			return true;
+
+		int received = recv(m_Socket, m_Buffer.data() + m_Size, (int)(m_Buffer.size() - m_Size), 0);
+		if (received <= 0)
+		{
+			Close();
+			return false;
+		}
+		m_Size += received;
+
+		// a message may be split between two reads
+		size_t count = m_Size / sizeof(ReclaimStreamMessage);
+		messages.resize(count);
+		memcpy(messages.data(), m_Buffer.data(), count * sizeof(ReclaimStreamMessage));
+
+		size_t used = count * sizeof(ReclaimStreamMessage);
+		memmove(m_Buffer.data(), m_Buffer.data() + used, m_Size - used);
+		m_Size -= used;
+		return true;
+	}
+
+private:
+	ReclaimStreamSocket::Handle m_Socket;
+	std::vector<char> m_Buffer;
+	size_t m_Size;
+};
@@ -0,0 +1,169 @@
+/*
+ * @file reclaims_timeframes.h
+ * @brief Computes reclaims for several bar periods in one pass over the trades.
+ *
+ * Reclaims of the same trades on 1-min, 5-min or 30-min bars differ, so each bar period keeps its
+ * own engine and bar clock, but the trades are read and decoded once for all of them: a .scid record
+ * is loaded, converted and fed to every engine while it is in the cache, instead of once per chart.
+ * A bar period added later first replays the trades the others have already processed, on its own,
+ * and then joins the common pass.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "reclaims_engine.h"
+#include "reclaims_scid.h"
+
+/**
+ * @class ReclaimTimeframes
+ * @brief One reclaim engine per bar period, fed by a single pass over the trades of a .scid file.
+ *
+ * The engines keep their address while they are in the set, so they can be registered for queries.
+ */
+class ReclaimTimeframes
+{
+public:
+	/**
+	 * @brief Maximum number of bar periods.
+	 */
+	static const int MAX_TIMEFRAMES = 8;
+
+	ReclaimTimeframes()
+		: m_NextRecord(0)
+	{
+	}
+
+	int GetCount() const { return (int)m_Timeframes.size(); }
+
+	ReclaimEngine &GetEngine(int timeframe) { return *m_Timeframes[timeframe].Engine; }
+	const ReclaimEngine &GetEngine(int timeframe) const { return *m_Timeframes[timeframe].Engine; }
+
+	int GetBarPeriod(int timeframe) const { return m_Timeframes[timeframe].BarPeriodSeconds; }
+
+	/**
+	 * @brief Returns the index of the next record that the engine of a bar period processes.
+	 */
+	int64_t GetNextRecord(int timeframe) const { return m_Timeframes[timeframe].NextRecord; }
+
+	/**
+	 * @brief Returns the index of a bar period, or `-1` if it is not in the set.
+	 */
+	int Find(int barPeriodSeconds) const
+	{
+		for (size_t i = 0; i < m_Timeframes.size(); i++)
+		{
+			if (m_Timeframes[i].BarPeriodSeconds == barPeriodSeconds)
+				return (int)i;
+		}
+		return -1;
+	}
+
+	/**
+	 * @brief Adds a bar period. Its engine starts from the first record on the next `Replay`.
+	 *
+	 * The options of the engine, such as `EnableVolume`, can be enabled until then.
+	 *
+	 * @param settings Settings of the engine.
+	 * @param barPeriodSeconds Length of the bars in seconds, `0` for one bar per trade time.
+	 * @return The index of the bar period, or `-1` if the set is full.
+	 */
+	int Add(const ReclaimSettings &settings, int barPeriodSeconds)
+	{
+		if ((int)m_Timeframes.size() >= MAX_TIMEFRAMES)
+			return -1;
+
+		Timeframe timeframe(barPeriodSeconds);
+		timeframe.Engine->Reset(settings);
+		m_Timeframes.push_back(std::move(timeframe));
+		return (int)m_Timeframes.size() - 1;
+	}
+
+	/**
+	 * @brief Removes a bar period and deletes its engine. The indexes of the next bar periods move down by one.
+	 */
+	void Remove(int timeframe) { m_Timeframes.erase(m_Timeframes.begin() + timeframe); }
+
+	/**
+	 * @brief Processes at most `maxRecords` records of the file for every bar period.
+	 *
+	 * The bar periods that are behind the others catch up first, each on its own. Once they are all at the
+	 * same record, every record is decoded once and fed to all the engines. Call it until it returns `0`
+	 * to process every record up to `end`.
+	 *
+	 * @param records The .scid records.
+	 * @param end Index after the last record to process.
+	 * @param maxRecords Most records processed per bar period, so the caller does not hold its lock for long.
+	 * @return The number of records processed, added over the bar periods.
+	 */
+	int64_t Replay(const ScidRecord *records, int64_t end, int64_t maxRecords)
+	{
+		int64_t processed = 0;
+		for (size_t i = 0; i < m_Timeframes.size(); i++)
+		{
+			Timeframe &timeframe = m_Timeframes[i];
+			if (timeframe.NextRecord >= m_NextRecord)
+				continue;
+
+			int64_t catchUpEnd = std::min(timeframe.NextRecord + maxRecords, m_NextRecord);
+			ReplayScidRecords(*timeframe.Engine, records, timeframe.NextRecord, catchUpEnd, timeframe.Clock);
+			processed += catchUpEnd - timeframe.NextRecord;
+			timeframe.NextRecord = catchUpEnd;
+		}
+
+		// the common pass waits until nobody is behind, so the records are not decoded twice
+		if (processed > 0 || m_Timeframes.empty())
+			return processed;
+
+		int64_t commonEnd = std::min(m_NextRecord + maxRecords, end);
+		for (int64_t i = m_NextRecord; i < commonEnd; i++)
+		{
+			const ScidRecord &record = records[i];
+			double dateTime = ScidTimeToDateTime(record.DateTime);
+			float volume = (float)record.TotalVolume;
+
+			for (size_t j = 0; j < m_Timeframes.size(); j++)
+			{
+				Timeframe &timeframe = m_Timeframes[j];
+
+				double barDateTime = 0;
+				int newBar = timeframe.Clock.Locate(dateTime, barDateTime);
+				timeframe.Engine->ProcessTrade(record.Close, volume, barDateTime, newBar != 0);
+			}
+		}
+
+		for (size_t i = 0; i < m_Timeframes.size(); i++)
+			m_Timeframes[i].NextRecord = commonEnd;
+
+		processed = (commonEnd - m_NextRecord) * (int64_t)m_Timeframes.size();
+		m_NextRecord = commonEnd;
+		return processed;
+	}
+
+private:
+	struct Timeframe
+	{
+		explicit Timeframe(int barPeriodSeconds)
+			: Engine(new ReclaimEngine)
+			, Clock(barPeriodSeconds)
+			, BarPeriodSeconds(barPeriodSeconds)
+			, NextRecord(0)
+		{
+		}
+
+		std::unique_ptr<ReclaimEngine> Engine;
+		FixedPeriodBarClock Clock;
+		int BarPeriodSeconds;
+		int64_t NextRecord;
+	};
+
+	std::vector<Timeframe> m_Timeframes;
+
+	// next record of the common pass, the bar periods before it are catching up
+	int64_t m_NextRecord;
+};
@@ -0,0 +1,262 @@
+/*
+ * @file reclaims_trace.h
+ * @brief Trace event spans of the study phases, written in the Chrome trace event format.
+ *
+ * The chart thread only stores the name, start and duration of each span into a preallocated ring.
+ * A writer thread drains the ring every few milliseconds and appends the spans as JSON "complete"
+ * events to a file, which loads in chrome://tracing or https://ui.perfetto.dev. When the ring is
+ * full the new spans are dropped and counted, the chart thread never waits for the file.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct ReclaimTraceEvent
+ * @brief A span of the chart thread.
+ */
+struct ReclaimTraceEvent
+{
+	const char *Name; // string literal, the pointer is stored
+	int64_t Start;	  // nanoseconds, see ReclaimTrace::Now
+	int64_t Duration; // nanoseconds
+};
+
+/**
+ * @class ReclaimTrace
+ * @brief Single producer ring of spans and the thread that writes them to a trace file.
+ *
+ * `Add` is called by one thread only, the chart thread of the study instance.
+ */
+class ReclaimTrace
+{
+public:
+	/**
+	 * @brief Number of spans in the ring, a power of two.
+	 */
+	static const int CAPACITY = 1 << 16;
+
+	ReclaimTrace()
+		: m_Events(CAPACITY)
+		, m_Head(0)
+		, m_Tail(0)
+		, m_Dropped(0)
+		, m_File(NULL)
+		, m_ProcessId(0)
+		, m_Stop(false)
+	{
+	}
+
+	~ReclaimTrace() { Close(); }
+
+	/**
+	 * @brief Creates the trace file and starts the writer thread.
+	 *
+	 * @param path Path of the trace file, replaced if it exists.
+	 * @param processId Process id of the spans in the trace, the chart number for the study.
+	 * @param processName Name shown for the process in the trace viewer.
+	 * @return `false` if the file could not be created.
+	 */
+	bool Open(const std::string &path, int processId, const std::string &processName)
+	{
+		Close();
+
+		m_File = fopen(path.c_str(), "w");
+		if (m_File == NULL)
+			return false;
+
+		m_ProcessId = processId;
+		m_Head.store(0);
+		m_Tail.store(0);
+		m_Dropped.store(0);
+		m_Stop = false;
+
+		// the array format stays readable by the viewers if the closing bracket is never written
+		fprintf(m_File, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+			m_ProcessId, EscapeJson(processName).c_str());
+
+		m_Thread = std::thread(&ReclaimTrace::Run, this);
+		return true;
+	}
+
+	/**
+	 * @brief Writes the remaining spans, stops the writer thread and closes the file.
+	 */
+	void Close()
+	{
+		if (m_Thread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_StopMutex);
+				m_Stop = true;
+			}
+			m_StopCondition.notify_one();
+			m_Thread.join();
+		}
+
+		if (m_File != NULL)
+		{
+			Drain();
+			fprintf(m_File, "]\n");
+			fclose(m_File);
+			m_File = NULL;
+		}
+	}
+
+	bool IsOpen() const { return m_File != NULL; }
+
+	/**
+	 * @brief Stores a span, or drops it if the writer thread is behind.
+	 */
+	void Add(const char *name, int64_t start, int64_t duration)
+	{
+		uint64_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) >= (uint64_t)CAPACITY)
+		{
+			m_Dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		ReclaimTraceEvent &event = m_Events[head & (CAPACITY - 1)];
+		event.Name = name;
+		event.Start = start;
+		event.Duration = duration;
+		m_Head.store(head + 1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Returns the number of spans dropped because the ring was full.
+	 */
+	int64_t GetDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Returns the time of the spans in nanoseconds.
+	 */
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+private:
+	/**
+	 * @brief Escapes a string for a JSON string value, the symbol in the process name may contain any character.
+	 */
+	static std::string EscapeJson(const std::string &text)
+	{
+		std::string escaped;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			unsigned char c = (unsigned char)text[i];
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+				escaped += (char)c;
+			}
+			else if (c < 0x20)
+			{
+				char code[8];
+				snprintf(code, sizeof(code), "\\u%04x", c);
+				escaped += code;
+			}
+			else
+				escaped += (char)c;
+		}
+		return escaped;
+	}
+
+	void Run()
+	{
+		std::unique_lock<std::mutex> lock(m_StopMutex);
+		while (!m_Stop)
+		{
+			m_StopCondition.wait_for(lock, std::chrono::milliseconds(20));
+
+			lock.unlock();
+			Drain();
+			fflush(m_File);
+			lock.lock();
+		}
+	}
+
+	/**
+	 * @brief Writes the spans stored since the last call, on the writer thread.
+	 */
+	void Drain()
+	{
+		uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+		uint64_t head = m_Head.load(std::memory_order_acquire);
+
+		for (; tail != head; tail++)
+		{
+			const ReclaimTraceEvent &event = m_Events[tail & (CAPACITY - 1)];
+			fprintf(m_File, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":0}", EscapeJson(event.Name).c_str(),
+				event.Start / 1000.0, event.Duration / 1000.0, m_ProcessId);
+		}
+
+		m_Tail.store(tail, std::memory_order_release);
+	}
+
+	std::vector<ReclaimTraceEvent> m_Events;
+
+	// written by the chart thread and the writer thread, on separate cache lines
+	alignas(64) std::atomic<uint64_t> m_Head;
+	alignas(64) std::atomic<uint64_t> m_Tail;
+	alignas(64) std::atomic<int64_t> m_Dropped;
+
+	FILE *m_File;
+	int m_ProcessId;
+
+	std::thread m_Thread;
+	std::mutex m_StopMutex;
+	std::condition_variable m_StopCondition;
+	bool m_Stop;
+};
+
+/**
+ * @class ReclaimTraceSpan
+ * @brief Adds a span from its construction to `End` or its destruction, if it has a trace.
+ */
+class ReclaimTraceSpan
+{
+public:
+	/**
+	 * @param trace Trace of the study instance, `NULL` when tracing is off.
+	 * @param name Name of the span, a string literal.
+	 */
+	ReclaimTraceSpan(ReclaimTrace *trace, const char *name)
+		: p_Trace(trace)
+		, m_Name(name)
+		, m_Start(trace != NULL ? ReclaimTrace::Now() : 0)
+	{
+	}
+
+	~ReclaimTraceSpan() { End(); }
+
+	/**
+	 * @brief Ends the span before the end of the scope.
+	 */
+	void End()
+	{
+		if (p_Trace == NULL)
+			return;
+
+		p_Trace->Add(m_Name, m_Start, ReclaimTrace::Now() - m_Start);
+		p_Trace = NULL;
+	}
+
+private:
+	ReclaimTrace *p_Trace;
+	const char *m_Name;
+	int64_t m_Start;
+};
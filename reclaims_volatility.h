@@ -0,0 +1,93 @@
+/*
+ * @file reclaims_volatility.h
+ * @brief Average true range of the last bars, used by the adaptive reclaim threshold.
+ *
+ * The true ranges of the last N bars are kept in a ring buffer with their running sum, so adding a
+ * bar and reading the average are O(1). The sum is recomputed from the buffer every N bars so the
+ * rounding errors of the running sum do not accumulate.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @class ReclaimVolatility
+ * @brief Rolling average true range over a fixed number of bars.
+ */
+class ReclaimVolatility
+{
+public:
+	ReclaimVolatility()
+		: m_Next(0)
+		, m_Count(0)
+		, m_Sum(0)
+		, m_PreviousClose(0)
+	{
+	}
+
+	/**
+	 * @brief Forgets all bars and sets the number of bars of the average, 0 to disable it.
+	 */
+	void Reset(int bars)
+	{
+		m_Ranges.assign(std::max(bars, 0), 0.0);
+		m_Next = 0;
+		m_Count = 0;
+		m_Sum = 0;
+		m_PreviousClose = 0;
+	}
+
+	/**
+	 * @brief Adds a closed bar.
+	 *
+	 * The true range includes the gap from the close of the previous bar.
+	 */
+	void AddBar(float high, float low, float close)
+	{
+		if (m_Ranges.empty())
+			return;
+
+		double range = high - low;
+		if (m_Count > 0)
+			range = std::max(high, m_PreviousClose) - std::min(low, m_PreviousClose);
+		m_PreviousClose = close;
+
+		const int size = (int)m_Ranges.size();
+		if (m_Count == size)
+			m_Sum -= m_Ranges[m_Next];
+		else
+			m_Count++;
+
+		m_Ranges[m_Next] = range;
+		m_Sum += range;
+		m_Next = (m_Next + 1) % size;
+
+		if (m_Next == 0)
+		{
+			m_Sum = 0;
+			for (int i = 0; i < size; i++)
+				m_Sum += m_Ranges[i];
+		}
+	}
+
+	/**
+	 * @brief Returns the number of bars in the average, at most the number passed to `Reset`.
+	 */
+	int GetBarCount() const { return m_Count; }
+
+	/**
+	 * @brief Returns the average true range, 0 before the first bar.
+	 */
+	double GetAverageRange() const { return m_Count > 0 ? m_Sum / m_Count : 0; }
+
+private:
+	std::vector<double> m_Ranges;
+	int m_Next;
+	int m_Count;
+	double m_Sum;
+	float m_PreviousClose;
+};
@@ -0,0 +1,440 @@
+/*
+ * @file reclaims_daemon.cpp
+ * @brief Computes the reclaims of many symbols outside of Sierra Chart and serves them to local clients.
+ *
+ * The daemon reads ticks of any number of symbols from the Unix domain socket given with --feed, as
+ * the 32 byte records of reclaims_daemon.h, and tails the .scid files given with --scid, each one a
+ * symbol named after the file. Every symbol has its own engine, and the symbols are spread over
+ * --threads shards by the hash of their name. Clients of the --serve socket send `symbols`,
+ * `reclaims <symbol>` or `stats`, one per line, and get CSV lines followed by "end". With --report
+ * the ticks per second and the tick latency percentiles of every shard are printed every few seconds.
+ * SIGINT or SIGTERM stop the daemon and remove its sockets.
+ *
+ * With --bench the daemon runs in the process on temporary sockets, a sender thread writes the trades
+ * of --symbols synthetic markets to the feed socket, and the aggregate ticks per second from the first
+ * sent tick to the last processed one are printed with the latency of every shard. The reclaims of
+ * every symbol, read back from the query socket, are compared with a replay of its trades.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_daemon reclaims_daemon.cpp -pthread
+ *
+ * Usage:
+ *   reclaims_daemon [--feed <path>] [--scid <file.scid>]... [--serve <path>] [--threads 4] [--report 0]
+ *                   [--tick-size 0.25 | --tick-size <symbol>=<size>]... [--bar-seconds 60]
+ *                   [--max-reclaims 100] [--threshold 2]
+ *   reclaims_daemon --bench [--symbols 150] [--trades 3000000] [--regime chop] [--seed 1] [--threads 4]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <atomic>
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "reclaims_daemon.h"
+#include "reclaims_synthetic.h"
+
+/**
+ * @struct DaemonOptions
+ * @brief Command line options of the daemon.
+ */
+struct DaemonOptions
+{
+	const char *FeedPath;
+	const char *ServePath;
+	std::vector<const char *> ScidPaths;
+	std::vector<std::pair<std::string, float>> TickSizes;
+	int Threads;
+	int ReportSeconds;
+	bool Bench;
+	int Symbols;
+	int64_t Trades;
+	const char *Regime;
+	uint64_t Seed;
+	int BarPeriodSeconds;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_daemon [--feed <path>] [--scid <file.scid>]... [--serve <path>] [--threads 4] [--report 0]\n"
+		"                       [--tick-size 0.25 | --tick-size <symbol>=<size>]... [--bar-seconds 60]\n"
+		"                       [--max-reclaims 100] [--threshold 2]\n"
+		"       reclaims_daemon --bench [--symbols 150] [--trades 3000000] [--regime chop] [--seed 1] [--threads 4]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, DaemonOptions &options)
+{
+	options.FeedPath = NULL;
+	options.ServePath = NULL;
+	options.Threads = 4;
+	options.ReportSeconds = 0;
+	options.Bench = false;
+	options.Symbols = 150;
+	options.Trades = 3000000;
+	options.Regime = "chop";
+	options.Seed = 1;
+	options.BarPeriodSeconds = 60;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0.25f;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 20;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--feed") == 0 && hasValue)
+			options.FeedPath = argv[++i];
+		else if (strcmp(argv[i], "--serve") == 0 && hasValue)
+			options.ServePath = argv[++i];
+		else if (strcmp(argv[i], "--scid") == 0 && hasValue)
+			options.ScidPaths.push_back(argv[++i]);
+		else if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+		{
+			// either the default tick size or the one of a symbol
+			const char *value = argv[++i];
+			const char *separator = strchr(value, '=');
+			if (separator == NULL)
+				options.Settings.TickSize = (float)atof(value);
+			else
+				options.TickSizes.push_back(std::make_pair(std::string(value, separator - value), (float)atof(separator + 1)));
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.Threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--report") == 0 && hasValue)
+			options.ReportSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench") == 0)
+			options.Bench = true;
+		else if (strcmp(argv[i], "--symbols") == 0 && hasValue)
+			options.Symbols = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--trades") == 0 && hasValue)
+			options.Trades = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--regime") == 0 && hasValue)
+			options.Regime = argv[++i];
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else
+			return false;
+	}
+
+	if (options.Threads < 1 || options.BarPeriodSeconds <= 0 || options.Settings.MaxNumberOfReclaims < 2 ||
+		options.Settings.NewReclaimThreshold <= 0)
+		return false;
+
+	if (options.Bench)
+		return options.Symbols > 0 && options.Trades >= options.Symbols;
+
+	return options.Settings.TickSize > 0 && (options.FeedPath != NULL || !options.ScidPaths.empty());
+}
+
+/**
+ * @brief Returns the file name of a path without its extension, the symbol of a .scid file.
+ */
+static std::string GetScidSymbol(const char *path)
+{
+	const char *name = path;
+	for (const char *c = path; *c != 0; c++)
+	{
+		if (*c == '/' || *c == '\\')
+			name = c + 1;
+	}
+
+	const char *extension = strrchr(name, '.');
+	return extension != NULL ? std::string(name, extension - name) : std::string(name);
+}
+
+static std::atomic<bool> g_Stop(false);
+
+static void OnStopSignal(int) { g_Stop.store(true); }
+
+/**
+ * @brief Runs the daemon until SIGINT or SIGTERM.
+ *
+ * @return The process exit code.
+ */
+static int RunDaemon(const DaemonOptions &options)
+{
+	ReclaimDaemon daemon;
+	daemon.Init(options.Threads, options.Settings, options.BarPeriodSeconds);
+	for (size_t i = 0; i < options.TickSizes.size(); i++)
+		daemon.SetTickSize(options.TickSizes[i].first, options.TickSizes[i].second);
+	for (size_t i = 0; i < options.ScidPaths.size(); i++)
+		daemon.AddScidFile(GetScidSymbol(options.ScidPaths[i]), options.ScidPaths[i]);
+
+	if (!daemon.Listen(options.FeedPath != NULL ? options.FeedPath : "", options.ServePath != NULL ? options.ServePath : ""))
+	{
+		fprintf(stderr, "unable to create the sockets, or another daemon serves them\n");
+		return 1;
+	}
+
+	signal(SIGINT, OnStopSignal);
+	signal(SIGTERM, OnStopSignal);
+	signal(SIGPIPE, SIG_IGN);
+	daemon.Start();
+
+	std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+	while (!g_Stop.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (options.ReportSeconds > 0 && now - lastReport >= std::chrono::seconds(options.ReportSeconds))
+		{
+			std::vector<std::string> lines = daemon.FormatMetrics(std::chrono::duration<double>(now - lastReport).count());
+			for (size_t i = 0; i < lines.size(); i++)
+				fprintf(stderr, "%s\n", lines[i].c_str());
+			lastReport = now;
+		}
+	}
+
+	daemon.Stop();
+	return 0;
+}
+
+/**
+ * @brief Writes a whole buffer to a blocking socket.
+ */
+static bool WriteAll(ReclaimStreamSocket::Handle socket, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t written = send(socket, data, size, MSG_NOSIGNAL);
+		if (written <= 0)
+			return false;
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+/**
+ * @brief Connects a blocking socket to a path.
+ */
+static ReclaimStreamSocket::Handle Connect(const std::string &path)
+{
+	sockaddr_un address;
+	if (!ReclaimStreamSocket::GetAddress(path, address))
+		return ReclaimStreamSocket::INVALID;
+
+	ReclaimStreamSocket::Handle socket = ReclaimStreamSocket::Create();
+	if (socket != ReclaimStreamSocket::INVALID && connect(socket, (const sockaddr *)&address, sizeof(address)) != 0)
+	{
+		ReclaimStreamSocket::Close(socket);
+		socket = ReclaimStreamSocket::INVALID;
+	}
+	return socket;
+}
+
+/**
+ * @brief Sends a request to the query socket and reads the lines of the answer, without the final "end".
+ */
+static bool Query(ReclaimStreamSocket::Handle socket, const std::string &request, std::vector<std::string> &lines)
+{
+	std::string line = request + "\n";
+	if (!WriteAll(socket, line.data(), line.size()))
+		return false;
+
+	lines.clear();
+	line.clear();
+	char c;
+	while (recv(socket, &c, 1, 0) == 1)
+	{
+		if (c != '\n')
+		{
+			line += c;
+			continue;
+		}
+		if (line == "end")
+			return true;
+		lines.push_back(line);
+		line.clear();
+	}
+	return false;
+}
+
+/**
+ * @brief Compares the reclaims answered by the daemon with the active reclaims of an engine.
+ *
+ * @return The number of differences.
+ */
+static int CompareReclaims(const std::vector<std::string> &lines, const ReclaimEngine &engine)
+{
+	std::vector<std::string> expected;
+	char line[256];
+	for (int type = 0; type < 2; type++)
+	{
+		const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+		for (int i = 0; i < engine.GetSize(); i++)
+		{
+			const Reclaim &reclaim = reclaims[i];
+			if (reclaim.Deleted)
+				continue;
+
+			snprintf(line, sizeof(line), "%s,%lld,%.6f,%g,%g,%.0f", reclaim.Type == 0 ? "bullish" : "bearish", (long long)reclaim.Id,
+				reclaim.StartDate, reclaim.FixedSidePrice, reclaim.ActiveSidePrice, reclaim.Volume);
+			expected.push_back(line);
+		}
+	}
+
+	int differences = expected.size() != lines.size() ? 1 : 0;
+	for (size_t i = 0; i < std::min(expected.size(), lines.size()); i++)
+		differences += expected[i] != lines[i] ? 1 : 0;
+	return differences;
+}
+
+/**
+ * @brief Feeds synthetic markets to the daemon through its socket and checks the reclaims of every symbol.
+ *
+ * @return The process exit code.
+ */
+static int RunBenchmark(const DaemonOptions &options)
+{
+	SyntheticMarketSettings marketSettings;
+	if (!SyntheticMarket::GetRegimeSettings(options.Regime, marketSettings))
+	{
+		fprintf(stderr, "unknown regime %s\n", options.Regime);
+		return 2;
+	}
+
+	// every symbol has its own seed, the trades are interleaved by time as a real feed would be
+	int64_t tradesPerSymbol = options.Trades / options.Symbols;
+	std::vector<std::vector<SyntheticTrade>> trades(options.Symbols);
+	std::vector<std::string> names(options.Symbols);
+	for (int i = 0; i < options.Symbols; i++)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "SYM%04d", i);
+		names[i] = name;
+
+		SyntheticMarket market;
+		marketSettings.Seed = options.Seed + i;
+		market.Reset(marketSettings);
+		trades[i].resize((size_t)tradesPerSymbol);
+		for (size_t j = 0; j < trades[i].size(); j++)
+			market.Next(trades[i][j]);
+	}
+
+	std::vector<DaemonFeedTick> feed((size_t)(tradesPerSymbol * options.Symbols));
+	for (int64_t j = 0; j < tradesPerSymbol; j++)
+	{
+		for (int i = 0; i < options.Symbols; i++)
+		{
+			DaemonFeedTick &tick = feed[j * options.Symbols + i];
+			memset(tick.Symbol, 0, sizeof(tick.Symbol));
+			memcpy(tick.Symbol, names[i].data(), names[i].size());
+			tick.DateTime = trades[i][j].DateTime;
+			tick.Price = trades[i][j].Price;
+			tick.Volume = (float)trades[i][j].Volume;
+		}
+	}
+
+	ReclaimSettings settings = options.Settings;
+	settings.TickSize = marketSettings.TickSize;
+
+	std::string suffix = "." + std::to_string((long long)getpid());
+	std::string feedPath = GetReclaimStreamPath("DAEMON_FEED") + suffix;
+	std::string servePath = GetReclaimStreamPath("DAEMON_SERVE") + suffix;
+
+	ReclaimDaemon daemon;
+	daemon.Init(options.Threads, settings, options.BarPeriodSeconds);
+	if (!daemon.Listen(feedPath, servePath))
+	{
+		fprintf(stderr, "unable to create the sockets %s and %s\n", feedPath.c_str(), servePath.c_str());
+		return 1;
+	}
+	daemon.Start();
+
+	ReclaimStreamSocket::Handle sender = Connect(feedPath);
+	if (sender == ReclaimStreamSocket::INVALID)
+	{
+		fprintf(stderr, "unable to connect to %s\n", feedPath.c_str());
+		return 1;
+	}
+
+	// the sender writes blocks of ticks, as a feed handler forwarding the packets of an exchange
+	const size_t blockSize = 256;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool sent = true;
+	for (size_t i = 0; i < feed.size() && sent; i += blockSize)
+		sent = WriteAll(sender, (const char *)&feed[i], std::min(blockSize, feed.size() - i) * sizeof(DaemonFeedTick));
+	while (sent && daemon.GetProcessedCount() < (int64_t)feed.size())
+		std::this_thread::yield();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	ReclaimStreamSocket::Close(sender);
+
+	fprintf(stderr, "regime %s: %d symbols, %lld ticks, %d shards\n", options.Regime, options.Symbols, (long long)feed.size(), options.Threads);
+	fprintf(stderr, "%.3f s from the first sent tick to the last processed one: %.2f M ticks/s\n", seconds,
+		seconds > 0 ? feed.size() / seconds / 1e6 : 0.0);
+
+	std::vector<std::string> lines = daemon.FormatMetrics(seconds);
+	for (size_t i = 0; i < lines.size(); i++)
+		fprintf(stderr, "%s\n", lines[i].c_str());
+
+	// every symbol against a replay of its trades, through the query socket
+	int failed = sent ? 0 : options.Symbols;
+	ReclaimStreamSocket::Handle client = Connect(servePath);
+	for (int i = 0; i < options.Symbols && sent; i++)
+	{
+		ReclaimEngine engine;
+		engine.EnableVolume(true);
+		engine.Reset(settings);
+		FixedPeriodBarClock clock(options.BarPeriodSeconds);
+		for (size_t j = 0; j < trades[i].size(); j++)
+		{
+			double barDateTime = 0;
+			int newBar = clock.Locate(trades[i][j].DateTime, barDateTime);
+			engine.ProcessTrade(trades[i][j].Price, (float)trades[i][j].Volume, barDateTime, newBar != 0);
+		}
+
+		if (client == ReclaimStreamSocket::INVALID || !Query(client, "reclaims " + names[i], lines) || CompareReclaims(lines, engine) != 0)
+			failed++;
+	}
+
+	if (client != ReclaimStreamSocket::INVALID && Query(client, "symbols", lines))
+		fprintf(stderr, "%d symbols served, first: %s\n", (int)lines.size(), lines.empty() ? "" : lines[0].c_str());
+	if (client != ReclaimStreamSocket::INVALID)
+		ReclaimStreamSocket::Close(client);
+	daemon.Stop();
+
+	fprintf(stderr, "%d of %d symbols differ from a replay of their trades\n", failed, options.Symbols);
+	return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	DaemonOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	if (options.Bench)
+		return RunBenchmark(options);
+
+	return RunDaemon(options);
+}
@@ -0,0 +1,910 @@
+/*
+ * @file reclaims_daemon.h
+ * @brief Reclaim engines of many symbols, sharded across threads and fed from a tick socket or .scid files.
+ *
+ * Every symbol belongs to one shard, chosen from the hash of its name, and only the thread of that
+ * shard runs its engine. Ticks arrive on a Unix domain socket as fixed size binary records, and one
+ * feed thread routes them to the single producer ring of their shard. The .scid files of the other
+ * symbols are tailed by the thread of their shard, which processes the records appended since its
+ * last pass. A query thread answers the clients of a second socket with the current reclaims of a
+ * symbol, copied under the lock of the symbol, and with the metrics of the shards.
+ *
+ * Each shard measures the latency of its ticks, from the moment the feed thread read them to the
+ * moment the engine processed them, and the time it spends on each batch of ticks.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "reclaims_scid.h"
+#include "reclaims_stats.h"
+#include "reclaims_stream.h"
+#include "reclaims_trace.h"
+
+/**
+ * @struct DaemonFeedTick
+ * @brief A tick as written to the feed socket (32 bytes, little endian).
+ */
+struct DaemonFeedTick
+{
+	char Symbol[16]; // padded with zeros, not terminated when 16 characters long
+	double DateTime; // SCDateTime, days since 1899-12-30, UTC
+	float Price;
+	float Volume;
+};
+
+static_assert(sizeof(DaemonFeedTick) == 32, "the feed ticks are 32 bytes");
+
+/**
+ * @struct DaemonSymbol
+ * @brief The engine of one symbol and where its ticks come from.
+ */
+struct DaemonSymbol
+{
+	std::string Name;
+	int Shard;
+
+	/**
+	 * @brief Held by the shard while it processes ticks and by the query thread while it copies.
+	 */
+	std::mutex Mutex;
+	ReclaimEngine Engine;
+	FixedPeriodBarClock Clock;
+	int64_t Ticks;
+
+	// tailed .scid file, if the symbol is not fed from the socket
+	std::string ScidPath;
+	ScidFile Scid;
+	int64_t NextRecord;
+
+	DaemonSymbol(const std::string &name, int shard, const ReclaimSettings &settings, int barPeriodSeconds)
+		: Name(name)
+		, Shard(shard)
+		, Clock(barPeriodSeconds)
+		, Ticks(0)
+		, NextRecord(0)
+	{
+		Engine.EnableVolume(true);
+		Engine.Reset(settings);
+	}
+};
+
+/**
+ * @struct DaemonTick
+ * @brief A tick in the ring of a shard.
+ */
+struct DaemonTick
+{
+	DaemonSymbol *p_Symbol;
+	double DateTime;
+	float Price;
+	float Volume;
+	int64_t Received; // nanoseconds, see ReclaimTrace::Now
+};
+
+/**
+ * @struct DaemonShardMetrics
+ * @brief What a shard did since its metrics were last taken.
+ */
+struct DaemonShardMetrics
+{
+	int Symbols;
+	int64_t Ticks;
+	int64_t ScidRecords;
+	int64_t Batches;
+	int64_t MaxQueued; // most ticks waiting in the ring at the start of a batch
+	ReclaimLatencyHistogram TickLatency;  // from the feed thread to the engine, per tick
+	ReclaimLatencyHistogram BatchLatency; // processing time of a batch of ticks
+
+	void Reset()
+	{
+		Ticks = 0;
+		ScidRecords = 0;
+		Batches = 0;
+		MaxQueued = 0;
+		TickLatency.Reset();
+		BatchLatency.Reset();
+	}
+};
+
+/**
+ * @class DaemonShard
+ * @brief A thread that runs the engines of its symbols.
+ *
+ * `Push` is called by one thread only, the feed thread.
+ */
+class DaemonShard
+{
+public:
+	/**
+	 * @brief Number of ticks in the ring, a power of two.
+	 */
+	static const int CAPACITY = 1 << 16;
+
+	/**
+	 * @brief Most ticks processed before the ring position is released and the metrics are recorded.
+	 */
+	static const int BATCH_SIZE = 4096;
+
+	/**
+	 * @brief Most .scid records of a symbol processed at once, so the queries are not blocked for long.
+	 */
+	static const int64_t SCID_CHUNK_SIZE = 1 << 16;
+
+	DaemonShard()
+		: m_Ticks(CAPACITY)
+		, m_Head(0)
+		, m_Tail(0)
+		, m_Processed(0)
+		, m_Stop(false)
+	{
+		m_Metrics.Symbols = 0;
+		m_Metrics.Reset();
+	}
+
+	~DaemonShard() { Stop(); }
+
+	/**
+	 * @brief Adds a symbol whose .scid file the shard tails. Only before `Start`.
+	 */
+	void AddScidSymbol(DaemonSymbol *symbol) { m_ScidSymbols.push_back(symbol); }
+
+	/**
+	 * @brief Counts a new symbol of the shard.
+	 */
+	void AddSymbol()
+	{
+		std::lock_guard<std::mutex> lock(m_MetricsMutex);
+		m_Metrics.Symbols++;
+	}
+
+	void Start() { m_Thread = std::thread(&DaemonShard::Run, this); }
+
+	void Stop()
+	{
+		m_Stop.store(true);
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+	/**
+	 * @brief Stores a tick, waits while the ring is full.
+	 *
+	 * The shard never waits for the feed thread, the feed thread slows down the senders instead of
+	 * dropping ticks, which would change the reclaims.
+	 */
+	void Push(const DaemonTick &tick)
+	{
+		uint64_t head = m_Head.load(std::memory_order_relaxed);
+		while (head - m_Tail.load(std::memory_order_acquire) >= (uint64_t)CAPACITY)
+			std::this_thread::yield();
+
+		m_Ticks[head & (CAPACITY - 1)] = tick;
+		m_Head.store(head + 1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Returns the number of ticks processed since the start.
+	 */
+	int64_t GetProcessedCount() const { return m_Processed.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Copies the metrics and starts new ones.
+	 */
+	void TakeMetrics(DaemonShardMetrics &metrics)
+	{
+		std::lock_guard<std::mutex> lock(m_MetricsMutex);
+		metrics = m_Metrics;
+		m_Metrics.Reset();
+	}
+
+private:
+	void Run()
+	{
+		std::chrono::steady_clock::time_point nextScidPass = std::chrono::steady_clock::now();
+		int idlePasses = 0;
+
+		while (!m_Stop.load(std::memory_order_relaxed))
+		{
+			bool worked = ProcessTicks();
+
+			// the files are polled a few times per second, like the shared engines of the study
+			if (!m_ScidSymbols.empty() && std::chrono::steady_clock::now() >= nextScidPass)
+			{
+				if (ProcessScidFiles())
+					worked = true;
+				else
+					nextScidPass = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+			}
+
+			// spin a little while the ticks come in bursts, then sleep
+			if (worked)
+				idlePasses = 0;
+			else if (++idlePasses < 64)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+
+		for (size_t i = 0; i < m_ScidSymbols.size(); i++)
+			m_ScidSymbols[i]->Scid.Close();
+	}
+
+	/**
+	 * @brief Processes a batch of the ticks in the ring.
+	 *
+	 * @return `false` if the ring was empty.
+	 */
+	bool ProcessTicks()
+	{
+		uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+		uint64_t head = m_Head.load(std::memory_order_acquire);
+		if (head == tail)
+			return false;
+
+		uint64_t queued = head - tail;
+		uint64_t end = tail + std::min(queued, (uint64_t)BATCH_SIZE);
+		int64_t start = ReclaimTrace::Now();
+
+		// consecutive ticks of a symbol are processed under one lock
+		DaemonSymbol *locked = NULL;
+		for (uint64_t i = tail; i < end; i++)
+		{
+			const DaemonTick &tick = m_Ticks[i & (CAPACITY - 1)];
+			DaemonSymbol *symbol = tick.p_Symbol;
+			if (symbol != locked)
+			{
+				if (locked != NULL)
+					locked->Mutex.unlock();
+				symbol->Mutex.lock();
+				locked = symbol;
+			}
+
+			double barDateTime = 0;
+			int newBar = symbol->Clock.Locate(tick.DateTime, barDateTime);
+			symbol->Engine.ProcessTrade(tick.Price, tick.Volume, barDateTime, newBar != 0);
+			symbol->Ticks++;
+		}
+		if (locked != NULL)
+			locked->Mutex.unlock();
+
+		int64_t now = ReclaimTrace::Now();
+		{
+			std::lock_guard<std::mutex> lock(m_MetricsMutex);
+			for (uint64_t i = tail; i < end; i++)
+			{
+				int64_t latency = now - m_Ticks[i & (CAPACITY - 1)].Received;
+				m_Metrics.TickLatency.Record(latency > 0 ? (uint64_t)latency : 0);
+			}
+			m_Metrics.BatchLatency.Record((uint64_t)(now - start));
+			m_Metrics.Ticks += end - tail;
+			m_Metrics.Batches++;
+			m_Metrics.MaxQueued = std::max(m_Metrics.MaxQueued, (int64_t)queued);
+		}
+
+		m_Tail.store(end, std::memory_order_release);
+		m_Processed.fetch_add(end - tail, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Processes the records appended to the .scid files of the shard.
+	 *
+	 * @return `true` if a file still has records to process.
+	 */
+	bool ProcessScidFiles()
+	{
+		bool pending = false;
+		int64_t records = 0;
+
+		for (size_t i = 0; i < m_ScidSymbols.size(); i++)
+		{
+			DaemonSymbol &symbol = *m_ScidSymbols[i];
+			if (!(symbol.Scid.IsOpen() ? symbol.Scid.Refresh() : symbol.Scid.Open(symbol.ScidPath.c_str())))
+				continue;
+
+			int64_t recordCount = symbol.Scid.GetRecordCount();
+			if (symbol.NextRecord >= recordCount)
+				continue;
+
+			int64_t end = std::min(symbol.NextRecord + SCID_CHUNK_SIZE, recordCount);
+			{
+				std::lock_guard<std::mutex> lock(symbol.Mutex);
+				symbol.Ticks += ReplayScidRecords(symbol.Engine, symbol.Scid.GetRecords(), symbol.NextRecord, end, symbol.Clock);
+			}
+			records += end - symbol.NextRecord;
+			symbol.NextRecord = end;
+			pending = pending || end < recordCount;
+		}
+
+		if (records > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_MetricsMutex);
+			m_Metrics.ScidRecords += records;
+		}
+
+		return pending;
+	}
+
+	std::vector<DaemonTick> m_Ticks;
+
+	// written by the feed thread and the shard thread, on separate cache lines
+	alignas(64) std::atomic<uint64_t> m_Head;
+	alignas(64) std::atomic<uint64_t> m_Tail;
+	alignas(64) std::atomic<int64_t> m_Processed;
+
+	std::vector<DaemonSymbol *> m_ScidSymbols;
+
+	std::mutex m_MetricsMutex;
+	DaemonShardMetrics m_Metrics;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Stop;
+};
+
+/**
+ * @class ReclaimDaemon
+ * @brief The symbols, their shards, the feed thread and the query thread.
+ *
+ * Query protocol, one request per line, each answer ends with a line "end":
+ * - `symbols`: one line per symbol: name, shard, ticks, active bullish and bearish reclaims.
+ * - `reclaims <symbol>`: one line per active reclaim: type, id, start, fixed side, active side, volume.
+ * - `stats`: the metrics of every shard since the previous `stats`, see `FormatMetrics`.
+ */
+class ReclaimDaemon
+{
+public:
+	ReclaimDaemon()
+		: m_BarPeriodSeconds(60)
+		, m_FeedListener(ReclaimStreamSocket::INVALID)
+		, m_QueryListener(ReclaimStreamSocket::INVALID)
+		, m_Received(0)
+		, m_Stop(false)
+	{
+		memset(&m_Settings, 0, sizeof(m_Settings));
+	}
+
+	~ReclaimDaemon() { Stop(); }
+
+	/**
+	 * @brief Creates the shards. The threads start with `Start`.
+	 *
+	 * @param settings Settings of every engine. The tick size is the default one, see `SetTickSize`.
+	 */
+	void Init(int shardCount, const ReclaimSettings &settings, int barPeriodSeconds)
+	{
+		m_Settings = settings;
+		m_BarPeriodSeconds = barPeriodSeconds;
+		for (int i = 0; i < std::max(shardCount, 1); i++)
+			m_Shards.push_back(std::unique_ptr<DaemonShard>(new DaemonShard));
+	}
+
+	/**
+	 * @brief Sets the tick size of a symbol created later.
+	 */
+	void SetTickSize(const std::string &symbol, float tickSize) { m_TickSizes[symbol] = tickSize; }
+
+	/**
+	 * @brief Adds a symbol whose trades are read from a .scid file. Only before `Start`.
+	 */
+	void AddScidFile(const std::string &symbol, const std::string &path)
+	{
+		DaemonSymbol *added = GetSymbol(symbol);
+		added->ScidPath = path;
+		m_Shards[added->Shard]->AddScidSymbol(added);
+	}
+
+	/**
+	 * @brief Creates the feed and query sockets, either path may be empty.
+	 *
+	 * @return `false` if a socket could not be created.
+	 */
+	bool Listen(const std::string &feedPath, const std::string &queryPath)
+	{
+		if (!feedPath.empty() && !CreateListener(feedPath, m_FeedListener))
+			return false;
+		m_FeedPath = feedPath;
+
+		if (!queryPath.empty() && !CreateListener(queryPath, m_QueryListener))
+			return false;
+		m_QueryPath = queryPath;
+		return true;
+	}
+
+	void Start()
+	{
+		for (size_t i = 0; i < m_Shards.size(); i++)
+			m_Shards[i]->Start();
+
+		if (m_FeedListener != ReclaimStreamSocket::INVALID)
+			m_FeedThread = std::thread(&ReclaimDaemon::RunFeed, this);
+		if (m_QueryListener != ReclaimStreamSocket::INVALID)
+			m_QueryThread = std::thread(&ReclaimDaemon::RunQueries, this);
+	}
+
+	/**
+	 * @brief Stops the threads and removes the sockets.
+	 */
+	void Stop()
+	{
+		m_Stop.store(true);
+		if (m_FeedThread.joinable())
+			m_FeedThread.join();
+		if (m_QueryThread.joinable())
+			m_QueryThread.join();
+		for (size_t i = 0; i < m_Shards.size(); i++)
+			m_Shards[i]->Stop();
+
+		CloseListener(m_FeedListener, m_FeedPath);
+		CloseListener(m_QueryListener, m_QueryPath);
+	}
+
+	/**
+	 * @brief Returns the number of ticks of the feed processed by the shards.
+	 */
+	int64_t GetProcessedCount() const
+	{
+		int64_t processed = 0;
+		for (size_t i = 0; i < m_Shards.size(); i++)
+			processed += m_Shards[i]->GetProcessedCount();
+		return processed;
+	}
+
+	/**
+	 * @brief Returns the number of ticks read from the feed socket.
+	 */
+	int64_t GetReceivedCount() const { return m_Received.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Finds a symbol.
+	 *
+	 * @return `NULL` if no tick of the symbol was received.
+	 */
+	DaemonSymbol *FindSymbol(const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock(m_SymbolsMutex);
+		std::unordered_map<std::string, DaemonSymbol *>::iterator found = m_SymbolsByName.find(name);
+		return found != m_SymbolsByName.end() ? found->second : NULL;
+	}
+
+	/**
+	 * @brief Finds a symbol, or creates it with its tick size and assigns it to a shard.
+	 */
+	DaemonSymbol *GetSymbol(const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock(m_SymbolsMutex);
+		std::unordered_map<std::string, DaemonSymbol *>::iterator found = m_SymbolsByName.find(name);
+		if (found != m_SymbolsByName.end())
+			return found->second;
+
+		ReclaimSettings settings = m_Settings;
+		std::unordered_map<std::string, float>::const_iterator tickSize = m_TickSizes.find(name);
+		if (tickSize != m_TickSizes.end())
+			settings.TickSize = tickSize->second;
+
+		int shard = (int)(std::hash<std::string>()(name) % m_Shards.size());
+		DaemonSymbol *symbol = new DaemonSymbol(name, shard, settings, m_BarPeriodSeconds);
+		m_Symbols.push_back(std::unique_ptr<DaemonSymbol>(symbol));
+		m_SymbolsByName[name] = symbol;
+		m_Shards[shard]->AddSymbol();
+		return symbol;
+	}
+
+	/**
+	 * @brief Formats the metrics of every shard since they were last taken, one line per shard.
+	 *
+	 * @param seconds Time since the metrics were last taken, for the rates.
+	 */
+	std::vector<std::string> FormatMetrics(double seconds)
+	{
+		std::vector<std::string> lines;
+		char line[512];
+
+		for (size_t i = 0; i < m_Shards.size(); i++)
+		{
+			DaemonShardMetrics metrics;
+			m_Shards[i]->TakeMetrics(metrics);
+
+			snprintf(line, sizeof(line),
+				"shard %d: %d symbols, %.0f ticks/s, %.0f scid records/s, tick latency p50 %llu ns p99 %llu ns p99.9 %llu ns "
+				"max %llu ns, batch p99 %llu ns, %.1f ticks/batch, max queued %lld",
+				(int)i, metrics.Symbols, seconds > 0 ? metrics.Ticks / seconds : 0.0, seconds > 0 ? metrics.ScidRecords / seconds : 0.0,
+				(unsigned long long)metrics.TickLatency.GetPercentile(50), (unsigned long long)metrics.TickLatency.GetPercentile(99),
+				(unsigned long long)metrics.TickLatency.GetPercentile(99.9), (unsigned long long)metrics.TickLatency.GetMax(),
+				(unsigned long long)metrics.BatchLatency.GetPercentile(99), metrics.Batches > 0 ? (double)metrics.Ticks / metrics.Batches : 0.0,
+				(long long)metrics.MaxQueued);
+			lines.push_back(line);
+		}
+
+		return lines;
+	}
+
+	/**
+	 * @brief Formats the active reclaims of a symbol, one line per reclaim.
+	 *
+	 * @return `false` if the symbol is unknown.
+	 */
+	bool FormatReclaims(const std::string &name, std::vector<std::string> &lines)
+	{
+		DaemonSymbol *symbol = FindSymbol(name);
+		if (symbol == NULL)
+			return false;
+
+		std::vector<Reclaim> reclaims;
+		{
+			std::lock_guard<std::mutex> lock(symbol->Mutex);
+			const ReclaimEngine &engine = symbol->Engine;
+			reclaims.reserve(2 * engine.GetSize());
+			for (int i = 0; i < engine.GetSize(); i++)
+			{
+				if (!engine.GetUpReclaims()[i].Deleted)
+					reclaims.push_back(engine.GetUpReclaims()[i]);
+			}
+			for (int i = 0; i < engine.GetSize(); i++)
+			{
+				if (!engine.GetDownReclaims()[i].Deleted)
+					reclaims.push_back(engine.GetDownReclaims()[i]);
+			}
+		}
+
+		char line[256];
+		for (size_t i = 0; i < reclaims.size(); i++)
+		{
+			const Reclaim &reclaim = reclaims[i];
+			snprintf(line, sizeof(line), "%s,%lld,%.6f,%g,%g,%.0f", reclaim.Type == 0 ? "bullish" : "bearish", (long long)reclaim.Id,
+				reclaim.StartDate, reclaim.FixedSidePrice, reclaim.ActiveSidePrice, reclaim.Volume);
+			lines.push_back(line);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Formats the symbols, one line per symbol.
+	 */
+	std::vector<std::string> FormatSymbols()
+	{
+		std::vector<DaemonSymbol *> symbols;
+		{
+			std::lock_guard<std::mutex> lock(m_SymbolsMutex);
+			for (size_t i = 0; i < m_Symbols.size(); i++)
+				symbols.push_back(m_Symbols[i].get());
+		}
+
+		std::vector<std::string> lines;
+		char line[256];
+		for (size_t i = 0; i < symbols.size(); i++)
+		{
+			DaemonSymbol &symbol = *symbols[i];
+			std::lock_guard<std::mutex> lock(symbol.Mutex);
+			snprintf(line, sizeof(line), "%s,%d,%lld,%d,%d", symbol.Name.c_str(), symbol.Shard, (long long)symbol.Ticks,
+				CountActive(symbol.Engine.GetUpReclaims(), symbol.Engine.GetSize()),
+				CountActive(symbol.Engine.GetDownReclaims(), symbol.Engine.GetSize()));
+			lines.push_back(line);
+		}
+		return lines;
+	}
+
+private:
+	/**
+	 * @brief A connection of the feed or query socket and its unprocessed bytes.
+	 */
+	struct Connection
+	{
+		ReclaimStreamSocket::Handle Socket;
+		std::vector<char> Buffer;
+		size_t Size;
+	};
+
+	static int CountActive(const Reclaim *reclaims, int size)
+	{
+		int count = 0;
+		for (int i = 0; i < size; i++)
+			count += reclaims[i].Deleted ? 0 : 1;
+		return count;
+	}
+
+	/**
+	 * @brief Creates a listening socket, replacing a socket file left by a process that is gone.
+	 */
+	static bool CreateListener(const std::string &path, ReclaimStreamSocket::Handle &listener)
+	{
+		sockaddr_un address;
+		if (!ReclaimStreamSocket::Startup() || !ReclaimStreamSocket::GetAddress(path, address))
+			return false;
+
+		ReclaimStreamSocket::Handle probe = ReclaimStreamSocket::Create();
+		if (probe == ReclaimStreamSocket::INVALID)
+			return false;
+		bool served = connect(probe, (const sockaddr *)&address, sizeof(address)) == 0;
+		ReclaimStreamSocket::Close(probe);
+		if (served)
+			return false;
+		ReclaimStreamSocket::RemovePath(path);
+
+		listener = ReclaimStreamSocket::Create();
+		if (listener == ReclaimStreamSocket::INVALID)
+			return false;
+
+		if (bind(listener, (const sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 64) != 0 ||
+			!ReclaimStreamSocket::SetNonBlocking(listener))
+		{
+			ReclaimStreamSocket::Close(listener);
+			listener = ReclaimStreamSocket::INVALID;
+			return false;
+		}
+		return true;
+	}
+
+	static void CloseListener(ReclaimStreamSocket::Handle &listener, const std::string &path)
+	{
+		if (listener == ReclaimStreamSocket::INVALID)
+			return;
+
+		ReclaimStreamSocket::Close(listener);
+		listener = ReclaimStreamSocket::INVALID;
+		ReclaimStreamSocket::RemovePath(path);
+	}
+
+	/**
+	 * @brief Accepts new connections and waits until a connection has bytes to read.
+	 */
+	static void AcceptAndWait(ReclaimStreamSocket::Handle listener, std::vector<Connection> &connections, size_t bufferSize,
+		std::vector<pollfd> &sockets)
+	{
+		while (true)
+		{
+			ReclaimStreamSocket::Handle socket = accept(listener, NULL, NULL);
+			if (socket == ReclaimStreamSocket::INVALID)
+				break;
+
+			Connection connection;
+			connection.Socket = socket;
+			connection.Buffer.resize(bufferSize);
+			connection.Size = 0;
+			connections.push_back(connection);
+		}
+
+		sockets.resize(connections.size() + 1);
+		sockets[0].fd = listener;
+		sockets[0].events = POLLIN;
+		sockets[0].revents = 0;
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			sockets[i + 1].fd = connections[i].Socket;
+			sockets[i + 1].events = POLLIN;
+			sockets[i + 1].revents = 0;
+		}
+		ReclaimStreamSocket::Poll(sockets, 10);
+	}
+
+	/**
+	 * @brief Reads the ticks of the feed connections and routes them to the shards.
+	 */
+	void RunFeed()
+	{
+		std::vector<Connection> connections;
+		std::vector<pollfd> sockets;
+
+		// the symbols the feed thread already resolved, without the lock of the symbol table
+		std::unordered_map<std::string, DaemonSymbol *> symbols;
+
+		while (!m_Stop.load(std::memory_order_relaxed))
+		{
+			AcceptAndWait(m_FeedListener, connections, 1 << 16, sockets);
+
+			size_t kept = 0;
+			for (size_t i = 0; i < connections.size(); i++)
+			{
+				Connection &connection = connections[i];
+				bool open = sockets.size() <= i + 1 || sockets[i + 1].revents == 0 || ReadTicks(connection, symbols);
+				if (!open)
+				{
+					ReclaimStreamSocket::Close(connection.Socket);
+					continue;
+				}
+
+				if (kept != i)
+					connections[kept] = std::move(connection);
+				kept++;
+			}
+			connections.resize(kept);
+		}
+
+		for (size_t i = 0; i < connections.size(); i++)
+			ReclaimStreamSocket::Close(connections[i].Socket);
+	}
+
+	/**
+	 * @brief Reads the available ticks of a feed connection.
+	 *
+	 * @return `false` when the sender closed the connection.
+	 */
+	bool ReadTicks(Connection &connection, std::unordered_map<std::string, DaemonSymbol *> &symbols)
+	{
+		int received = recv(connection.Socket, connection.Buffer.data() + connection.Size, (int)(connection.Buffer.size() - connection.Size), 0);
+		if (received <= 0)
+			return false;
+		connection.Size += received;
+
+		// one time for the ticks of a read, the latency starts when they are read
+		DaemonTick tick;
+		tick.Received = ReclaimTrace::Now();
+
+		size_t count = connection.Size / sizeof(DaemonFeedTick);
+		const DaemonFeedTick *feedTicks = (const DaemonFeedTick *)connection.Buffer.data();
+		for (size_t i = 0; i < count; i++)
+		{
+			const DaemonFeedTick &feedTick = feedTicks[i];
+			std::string name(feedTick.Symbol, strnlen(feedTick.Symbol, sizeof(feedTick.Symbol)));
+
+			std::unordered_map<std::string, DaemonSymbol *>::iterator found = symbols.find(name);
+			if (found == symbols.end())
+				found = symbols.insert(std::make_pair(name, GetSymbol(name))).first;
+
+			tick.p_Symbol = found->second;
+			tick.DateTime = feedTick.DateTime;
+			tick.Price = feedTick.Price;
+			tick.Volume = feedTick.Volume;
+			m_Shards[tick.p_Symbol->Shard]->Push(tick);
+		}
+		m_Received.fetch_add(count, std::memory_order_release);
+
+		// a tick may be split between two reads
+		size_t used = count * sizeof(DaemonFeedTick);
+		memmove(connection.Buffer.data(), connection.Buffer.data() + used, connection.Size - used);
+		connection.Size -= used;
+		return true;
+	}
+
+	/**
+	 * @brief Answers the requests of the query connections.
+	 */
+	void RunQueries()
+	{
+		std::vector<Connection> connections;
+		std::vector<pollfd> sockets;
+		std::chrono::steady_clock::time_point lastMetrics = std::chrono::steady_clock::now();
+
+		while (!m_Stop.load(std::memory_order_relaxed))
+		{
+			AcceptAndWait(m_QueryListener, connections, 4096, sockets);
+
+			size_t kept = 0;
+			for (size_t i = 0; i < connections.size(); i++)
+			{
+				Connection &connection = connections[i];
+				bool open = sockets.size() <= i + 1 || sockets[i + 1].revents == 0 || ReadRequests(connection, lastMetrics);
+				if (!open)
+				{
+					ReclaimStreamSocket::Close(connection.Socket);
+					continue;
+				}
+
+				if (kept != i)
+					connections[kept] = std::move(connection);
+				kept++;
+			}
+			connections.resize(kept);
+		}
+
+		for (size_t i = 0; i < connections.size(); i++)
+			ReclaimStreamSocket::Close(connections[i].Socket);
+	}
+
+	/**
+	 * @brief Reads the requests of a query connection and writes the answers.
+	 *
+	 * @return `false` when the client closed the connection or sent a line that is too long.
+	 */
+	bool ReadRequests(Connection &connection, std::chrono::steady_clock::time_point &lastMetrics)
+	{
+		int received = recv(connection.Socket, connection.Buffer.data() + connection.Size, (int)(connection.Buffer.size() - connection.Size), 0);
+		if (received <= 0)
+			return false;
+		connection.Size += received;
+
+		size_t begin = 0;
+		for (size_t i = 0; i < connection.Size; i++)
+		{
+			if (connection.Buffer[i] != '\n')
+				continue;
+
+			std::string request(connection.Buffer.data() + begin, i - begin);
+			if (!request.empty() && request[request.size() - 1] == '\r')
+				request.resize(request.size() - 1);
+			begin = i + 1;
+
+			std::vector<std::string> lines;
+			if (request == "symbols")
+			{
+				lines = FormatSymbols();
+			}
+			else if (request == "stats")
+			{
+				std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				lines = FormatMetrics(std::chrono::duration<double>(now - lastMetrics).count());
+				lastMetrics = now;
+			}
+			else if (request.compare(0, 9, "reclaims ") == 0)
+			{
+				if (!FormatReclaims(request.substr(9), lines))
+					lines.push_back("error unknown symbol");
+			}
+			else
+			{
+				lines.push_back("error unknown request");
+			}
+
+			std::string answer;
+			for (size_t j = 0; j < lines.size(); j++)
+				answer += lines[j] + "\n";
+			answer += "end\n";
+			if (!SendAll(connection.Socket, answer))
+				return false;
+		}
+
+		memmove(connection.Buffer.data(), connection.Buffer.data() + begin, connection.Size - begin);
+		connection.Size -= begin;
+		return connection.Size < connection.Buffer.size();
+	}
+
+	/**
+	 * @brief Writes a whole answer, waiting while the socket buffer of the client is full.
+	 */
+	static bool SendAll(ReclaimStreamSocket::Handle socket, const std::string &data)
+	{
+		size_t sent = 0;
+		std::vector<pollfd> sockets(1);
+		while (sent < data.size())
+		{
+			int count = ReclaimStreamSocket::Send(socket, data.data() + sent, data.size() - sent);
+			if (count < 0)
+				return false;
+			if (count == 0)
+			{
+				sockets[0].fd = socket;
+				sockets[0].events = POLLOUT;
+				sockets[0].revents = 0;
+				ReclaimStreamSocket::Poll(sockets, 100);
+			}
+			sent += count;
+		}
+		return true;
+	}
+
+	ReclaimSettings m_Settings;
+	int m_BarPeriodSeconds;
+	std::unordered_map<std::string, float> m_TickSizes;
+
+	std::vector<std::unique_ptr<DaemonShard>> m_Shards;
+
+	// the symbols are only added, never removed while the daemon runs
+	std::mutex m_SymbolsMutex;
+	std::vector<std::unique_ptr<DaemonSymbol>> m_Symbols;
+	std::unordered_map<std::string, DaemonSymbol *> m_SymbolsByName;
+
+	std::string m_FeedPath;
+	std::string m_QueryPath;
+	ReclaimStreamSocket::Handle m_FeedListener;
+	ReclaimStreamSocket::Handle m_QueryListener;
+	std::atomic<int64_t> m_Received;
+
+	std::thread m_FeedThread;
+	std::thread m_QueryThread;
+	std::atomic<bool> m_Stop;
+};
@@ -0,0 +1,511 @@
+/*
+ * @file reclaims_fuzz.cpp
+ * @brief Differential fuzzer of the reclaim engine against the reference engine.
+ *
+ * Every case generates a random or adversarial trade stream (gaps, repeated prices, oscillations,
+ * retracements around the threshold, prices off the tick grid or too large for the float
+ * precision) with random settings, and feeds it to `ReclaimEngine`, to a `ReclaimHierarchy` and to
+ * `ReferenceReclaimEngine` (reclaims_reference.h). After every trade the lifecycle events, all the
+ * reclaims, the threshold, the volume, the coverage and the nearest reclaims of the engines must be
+ * identical, and the handle of every active reclaim must resolve to it. The first difference is printed with the case seed, so it can be replayed with
+ * --seed <seed> --cases 1.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_fuzz reclaims_fuzz.cpp
+ *
+ * Usage:
+ *   reclaims_fuzz [--cases 1000] [--trades 2000] [--seed 1] [--verbose]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "reclaims_hierarchy.h"
+#include "reclaims_reference.h"
+
+/**
+ * @struct FuzzOptions
+ * @brief Command line options of the fuzzer.
+ */
+struct FuzzOptions
+{
+	int Cases;
+	int Trades;
+	uint64_t Seed;
+	bool Verbose;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr, "usage: reclaims_fuzz [--cases 1000] [--trades 2000] [--seed 1] [--verbose]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, FuzzOptions &options)
+{
+	options.Cases = 1000;
+	options.Trades = 2000;
+	options.Seed = 1;
+	options.Verbose = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--cases") == 0 && hasValue)
+			options.Cases = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--trades") == 0 && hasValue)
+			options.Trades = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--verbose") == 0)
+			options.Verbose = true;
+		else
+			return false;
+	}
+
+	return options.Cases > 0 && options.Trades > 0;
+}
+
+/**
+ * @struct FuzzTrade
+ * @brief A trade of a generated stream.
+ */
+struct FuzzTrade
+{
+	float Price;
+	float Volume;
+	double BarDateTime;
+	bool NewBar;
+};
+
+/**
+ * @brief Shapes of the generated trade streams.
+ */
+enum FuzzScenario
+{
+	FUZZ_RANDOM_WALK = 0,     // small steps on the tick grid
+	FUZZ_GAPS,                // random walk with jumps of hundreds of ticks
+	FUZZ_REPEATED_PRICES,     // long runs of the same price
+	FUZZ_OSCILLATION,         // a few prices visited over and over
+	FUZZ_THRESHOLD_RETRACE,   // swings that retrace the threshold, one tick less or one tick more
+	FUZZ_OFF_GRID,            // prices that are not multiples of the tick size
+	FUZZ_LARGE_PRICES,        // prices where a float cannot hold every tick
+	FUZZ_ONE_TRADE_BARS,      // every trade opens a bar
+	FUZZ_SCENARIO_COUNT
+};
+
+static const char *ScenarioNames[FUZZ_SCENARIO_COUNT] = { "random walk", "gaps", "repeated prices", "oscillation",
+	"threshold retrace", "off grid", "large prices", "one trade bars" };
+
+/**
+ * @struct FuzzCase
+ * @brief Settings and trades of one case.
+ */
+struct FuzzCase
+{
+	uint64_t Seed;
+	FuzzScenario Scenario;
+	ReclaimSettings Settings;
+	int LevelThresholds[3];
+	std::vector<FuzzTrade> Trades;
+};
+
+/**
+ * @brief Generates the settings and the trades of a case from its seed.
+ */
+static void GenerateCase(uint64_t seed, int tradeCount, FuzzCase &fuzzCase)
+{
+	static const float tickSizes[] = { 0.25f, 0.01f, 0.1f, 1.0f, 0.00001f, 0.03125f, 0.5f, 5.0f };
+
+	std::mt19937_64 random(seed);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	#define FUZZ_RANDOM_INT(low, high) ((int)(low + (int64_t)(random() % (uint64_t)((high) - (low) + 1))))
+
+	fuzzCase.Seed = seed;
+	fuzzCase.Scenario = (FuzzScenario)(random() % FUZZ_SCENARIO_COUNT);
+
+	ReclaimSettings &settings = fuzzCase.Settings;
+	settings.TickSize = tickSizes[random() % (sizeof(tickSizes) / sizeof(tickSizes[0]))];
+	settings.MaxNumberOfReclaims = FUZZ_RANDOM_INT(1, 30);
+	settings.NewReclaimThreshold = FUZZ_RANDOM_INT(1, 12);
+	settings.UpdateOnBarClose = uniform(random) < 0.2;
+	settings.AdaptiveThresholdBars = 0;
+	settings.AdaptiveThresholdFactor = 0;
+	if (uniform(random) < 0.25)
+	{
+		settings.AdaptiveThresholdBars = FUZZ_RANDOM_INT(1, 30);
+		settings.AdaptiveThresholdFactor = (float)(0.2 + 2.8 * uniform(random));
+	}
+
+	fuzzCase.LevelThresholds[0] = settings.NewReclaimThreshold;
+	fuzzCase.LevelThresholds[1] = settings.NewReclaimThreshold + FUZZ_RANDOM_INT(1, 10);
+	fuzzCase.LevelThresholds[2] = fuzzCase.LevelThresholds[1] + FUZZ_RANDOM_INT(1, 20);
+
+	const double tick = settings.TickSize;
+	double basePrice = fuzzCase.Scenario == FUZZ_LARGE_PRICES ? 50000 + uniform(random) * 150000 : 10 + uniform(random) * 5000;
+	int64_t baseTick = (int64_t)(basePrice / tick);
+
+	// bars of a few trades on average, one minute each
+	double barProbability = fuzzCase.Scenario == FUZZ_ONE_TRADE_BARS ? 1.0 : 0.02 + uniform(random) * 0.3;
+	double barDateTime = 45000.0;
+
+	int64_t priceTick = baseTick;
+	int runLength = 0;
+	int direction = 1;
+	int swing = 0;
+	int oscillationStep = FUZZ_RANDOM_INT(1, 3 * settings.NewReclaimThreshold);
+
+	fuzzCase.Trades.resize(tradeCount);
+	for (int i = 0; i < tradeCount; i++)
+	{
+		switch (fuzzCase.Scenario)
+		{
+		case FUZZ_GAPS:
+			if (uniform(random) < 0.01)
+				priceTick += (random() % 2 == 0 ? 1 : -1) * FUZZ_RANDOM_INT(50, 2000);
+			else
+				priceTick += FUZZ_RANDOM_INT(-3, 3);
+			break;
+
+		case FUZZ_REPEATED_PRICES:
+			if (runLength-- <= 0)
+			{
+				runLength = FUZZ_RANDOM_INT(1, 50);
+				priceTick += FUZZ_RANDOM_INT(-4, 4);
+			}
+			break;
+
+		case FUZZ_OSCILLATION:
+			priceTick = baseTick + oscillationStep * FUZZ_RANDOM_INT(-1, 1);
+			break;
+
+		case FUZZ_THRESHOLD_RETRACE:
+			// move one way until the swing is done, then retrace about the threshold
+			if (swing <= 0)
+			{
+				direction = -direction;
+				swing = direction > 0 ? FUZZ_RANDOM_INT(5, 40) : settings.NewReclaimThreshold + FUZZ_RANDOM_INT(-1, 1);
+			}
+			priceTick += direction > 0 ? 1 : -1;
+			swing--;
+			break;
+
+		default:
+			priceTick += FUZZ_RANDOM_INT(-3, 3);
+			break;
+		}
+
+		// keep the prices positive
+		if (priceTick < 1)
+			priceTick = 1 + (1 - priceTick);
+
+		FuzzTrade &trade = fuzzCase.Trades[i];
+		trade.Price = (float)(priceTick * tick);
+		if (fuzzCase.Scenario == FUZZ_OFF_GRID)
+			trade.Price += (float)((uniform(random) - 0.5) * tick);
+		trade.Volume = (float)FUZZ_RANDOM_INT(1, 20);
+
+		trade.NewBar = i > 0 && uniform(random) < barProbability;
+		if (trade.NewBar)
+			barDateTime += 1.0 / 1440;
+		trade.BarDateTime = barDateTime;
+	}
+
+	#undef FUZZ_RANDOM_INT
+}
+
+/**
+ * @brief Formats a reclaim for the divergence report.
+ */
+static std::string FormatReclaim(const Reclaim *reclaim)
+{
+	if (reclaim == NULL)
+		return "none";
+
+	char text[256];
+	snprintf(text, sizeof(text), "{id %lld, %s, fixed %.9g, active %.9g, start %.9f, height %d/%d, retracement %d, volume %.9g%s}",
+		(long long)reclaim->Id, reclaim->Type == 0 ? "bullish" : "bearish", reclaim->FixedSidePrice, reclaim->ActiveSidePrice,
+		reclaim->StartDate, reclaim->CurrentHeight, reclaim->MaxHeight, reclaim->MaxRetracement, reclaim->Volume,
+		reclaim->Deleted ? ", deleted" : "");
+	return text;
+}
+
+/**
+ * @brief Compares every field of two reclaims except the drawing line number.
+ */
+static bool SameReclaim(const Reclaim &a, const Reclaim &b)
+{
+	return a.FixedSidePrice == b.FixedSidePrice && a.ActiveSidePrice == b.ActiveSidePrice && a.MaxHeight == b.MaxHeight
+		&& a.CurrentHeight == b.CurrentHeight && a.MaxRetracement == b.MaxRetracement && a.StartDate == b.StartDate
+		&& a.Volume == b.Volume && a.Id == b.Id && a.Deleted == b.Deleted && a.Type == b.Type;
+}
+
+/**
+ * @brief Compares the lifecycle events of a trade.
+ *
+ * @param difference Receives the description of the first difference.
+ * @return `true` if the events are identical.
+ */
+static bool CompareEvents(const std::vector<ReferenceEvent> &engineEvents, const std::vector<ReferenceEvent> &referenceEvents,
+	std::string &difference)
+{
+	static const char *eventNames[] = { "created", "reclaimed", "evicted" };
+	char text[512];
+
+	for (size_t i = 0; i < std::max(engineEvents.size(), referenceEvents.size()); i++)
+	{
+		if (i < engineEvents.size() && i < referenceEvents.size() && engineEvents[i].Kind == referenceEvents[i].Kind
+			&& SameReclaim(engineEvents[i].Snapshot, referenceEvents[i].Snapshot))
+			continue;
+
+		snprintf(text, sizeof(text), "event %zu: engine %s %s, reference %s %s", i,
+			i < engineEvents.size() ? eventNames[engineEvents[i].Kind] : "-",
+			i < engineEvents.size() ? FormatReclaim(&engineEvents[i].Snapshot).c_str() : "",
+			i < referenceEvents.size() ? eventNames[referenceEvents[i].Kind] : "-",
+			i < referenceEvents.size() ? FormatReclaim(&referenceEvents[i].Snapshot).c_str() : "");
+		difference = text;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Compares the state of an engine with its reference after a trade.
+ *
+ * @param checkQueries Also compare the nearest reclaims and the coverage, which need the level index and the coverage.
+ * @param difference Receives the description of the first difference.
+ * @return `true` if the engines agree.
+ */
+static bool CompareState(const ReclaimEngine &engine, const ReferenceReclaimEngine &reference, float price,
+	bool checkQueries, std::string &difference)
+{
+	char text[512];
+
+	if (engine.GetThreshold() != reference.GetThreshold())
+	{
+		snprintf(text, sizeof(text), "threshold: engine %d, reference %d", engine.GetThreshold(), reference.GetThreshold());
+		difference = text;
+		return false;
+	}
+
+	for (int type = 0; type < 2; type++)
+	{
+		const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+		const std::vector<Reclaim> &referenceReclaims = reference.GetReclaims(type);
+
+		for (int i = 0; i < engine.GetSize(); i++)
+		{
+			if (SameReclaim(reclaims[i], referenceReclaims[i]))
+				continue;
+
+			snprintf(text, sizeof(text), "%s reclaim %d: engine %s, reference %s", type == 0 ? "bullish" : "bearish", i,
+				FormatReclaim(&reclaims[i]).c_str(), FormatReclaim(&referenceReclaims[i]).c_str());
+			difference = text;
+			return false;
+		}
+
+		// the handle of an active reclaim resolves to it wherever it was shifted, others to nothing
+		for (int i = 0; i < engine.GetSize(); i++)
+		{
+			const Reclaim *resolved = engine.Resolve(reclaims[i].Handle);
+			if (resolved == (reclaims[i].Deleted ? NULL : &reclaims[i]))
+				continue;
+
+			snprintf(text, sizeof(text), "%s reclaim %d: handle %016llx resolves to %s", type == 0 ? "bullish" : "bearish", i,
+				(unsigned long long)reclaims[i].Handle, FormatReclaim(resolved).c_str());
+			difference = text;
+			return false;
+		}
+
+		if (!checkQueries)
+			continue;
+
+		if (engine.GetCoverage(type, price) != reference.GetCoverage(type, price))
+		{
+			snprintf(text, sizeof(text), "%s coverage at %.9g: engine %d, reference %d", type == 0 ? "bullish" : "bearish",
+				price, engine.GetCoverage(type, price), reference.GetCoverage(type, price));
+			difference = text;
+			return false;
+		}
+
+		for (int above = 0; above < 2; above++)
+		{
+			const Reclaim *nearest = engine.FindNearest(type, price, above != 0);
+			const Reclaim *referenceNearest = reference.FindNearest(type, price, above != 0);
+			if ((nearest == NULL) == (referenceNearest == NULL) && (nearest == NULL || nearest->Id == referenceNearest->Id))
+				continue;
+
+			snprintf(text, sizeof(text), "nearest %s %s %.9g: engine %s, reference %s", type == 0 ? "bullish" : "bearish",
+				above ? "above" : "below", price, FormatReclaim(nearest).c_str(), FormatReclaim(referenceNearest).c_str());
+			difference = text;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Prints the case and the trades before the divergence.
+ */
+static void PrintDivergence(const FuzzCase &fuzzCase, int tradeIndex, const char *engineName, const std::string &difference)
+{
+	const ReclaimSettings &settings = fuzzCase.Settings;
+
+	printf("DIVERGENCE in case seed %llu (%s): tick size %g, max reclaims %d, threshold %d, update on bar close %d, "
+		"adaptive %g x %d bars, level thresholds %d/%d/%d\n", (unsigned long long)fuzzCase.Seed,
+		ScenarioNames[fuzzCase.Scenario], settings.TickSize, settings.MaxNumberOfReclaims, settings.NewReclaimThreshold,
+		settings.UpdateOnBarClose ? 1 : 0, settings.AdaptiveThresholdFactor, settings.AdaptiveThresholdBars,
+		fuzzCase.LevelThresholds[0], fuzzCase.LevelThresholds[1], fuzzCase.LevelThresholds[2]);
+	printf("  %s, trade %d: %s\n", engineName, tradeIndex, difference.c_str());
+
+	printf("  last trades (index, price, volume, new bar):\n");
+	for (int i = std::max(0, tradeIndex - 15); i <= tradeIndex; i++)
+	{
+		const FuzzTrade &trade = fuzzCase.Trades[i];
+		printf("    %d %.9g %g %d\n", i, trade.Price, trade.Volume, trade.NewBar ? 1 : 0);
+	}
+}
+
+/**
+ * @brief Runs one case through the engines.
+ *
+ * @return `true` if every engine agreed with its reference on every trade.
+ */
+static bool RunCase(const FuzzCase &fuzzCase)
+{
+	const ReclaimSettings &settings = fuzzCase.Settings;
+
+	ReclaimEngine engine;
+	engine.EnableVolume(true);
+	engine.EnableCoverage(true);
+	engine.Reset(settings);
+
+	ReferenceReclaimEngine reference;
+	reference.Reset(settings);
+
+	// the levels are references with their own threshold and the scaled adaptive factor
+	const int levelCount = 3;
+	ReclaimHierarchy hierarchy;
+	hierarchy.Reset(settings, fuzzCase.LevelThresholds, levelCount);
+
+	ReferenceReclaimEngine levelReferences[levelCount];
+	for (int level = 0; level < levelCount; level++)
+	{
+		ReclaimSettings levelSettings = settings;
+		levelSettings.NewReclaimThreshold = fuzzCase.LevelThresholds[level];
+		levelSettings.AdaptiveThresholdFactor = settings.AdaptiveThresholdFactor * fuzzCase.LevelThresholds[level] / settings.NewReclaimThreshold;
+		levelReferences[level].Reset(levelSettings);
+		hierarchy.GetLevel(level).EnableVolume(true);
+	}
+
+	ReferenceEventRecorder engineRecorder;
+	ReferenceEventRecorder hierarchyRecorder;
+	std::vector<ReferenceEvent> referenceEvents;
+	std::string difference;
+
+	for (size_t i = 0; i < fuzzCase.Trades.size(); i++)
+	{
+		const FuzzTrade &trade = fuzzCase.Trades[i];
+
+		engineRecorder.Events.clear();
+		referenceEvents.clear();
+		engine.ProcessTrade(trade.Price, trade.Volume, trade.BarDateTime, trade.NewBar, &engineRecorder);
+		reference.ProcessTrade(trade.Price, trade.Volume, trade.BarDateTime, trade.NewBar, referenceEvents);
+
+		if (!CompareEvents(engineRecorder.Events, referenceEvents, difference)
+			|| !CompareState(engine, reference, trade.Price, true, difference))
+		{
+			PrintDivergence(fuzzCase, (int)i, "engine", difference);
+			return false;
+		}
+
+		for (size_t e = 0; e < engineRecorder.Events.size(); e++)
+		{
+			const ReferenceEvent &event = engineRecorder.Events[e];
+			if (event.Kind != REFERENCE_EVENT_CREATED && engine.Resolve(event.Snapshot.Handle) != NULL)
+			{
+				PrintDivergence(fuzzCase, (int)i, "engine", "the handle of a reclaimed or evicted reclaim still resolves");
+				return false;
+			}
+		}
+
+		// the hierarchy reports the events of all its levels to one listener, level after level
+		hierarchyRecorder.Events.clear();
+		hierarchy.ProcessTrade(trade.Price, trade.Volume, trade.BarDateTime, trade.NewBar, &hierarchyRecorder);
+
+		referenceEvents.clear();
+		for (int level = 0; level < levelCount; level++)
+			levelReferences[level].ProcessTrade(trade.Price, trade.Volume, trade.BarDateTime, trade.NewBar, referenceEvents);
+
+		if (!CompareEvents(hierarchyRecorder.Events, referenceEvents, difference))
+		{
+			PrintDivergence(fuzzCase, (int)i, "hierarchy", difference);
+			return false;
+		}
+
+		for (int level = 0; level < levelCount; level++)
+		{
+			if (!CompareState(hierarchy.GetLevel(level), levelReferences[level], trade.Price, false, difference))
+			{
+				char name[64];
+				snprintf(name, sizeof(name), "hierarchy level %d", level);
+				PrintDivergence(fuzzCase, (int)i, name, difference);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	FuzzOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	int scenarioCounts[FUZZ_SCENARIO_COUNT] = {};
+	FuzzCase fuzzCase;
+	for (int i = 0; i < options.Cases; i++)
+	{
+		GenerateCase(options.Seed + i, options.Trades, fuzzCase);
+		scenarioCounts[fuzzCase.Scenario]++;
+
+		if (options.Verbose)
+			fprintf(stderr, "case seed %llu: %s\n", (unsigned long long)fuzzCase.Seed, ScenarioNames[fuzzCase.Scenario]);
+
+		if (!RunCase(fuzzCase))
+			return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%d cases of %d trades identical in %.1f s (", options.Cases, options.Trades, seconds);
+	for (int scenario = 0; scenario < FUZZ_SCENARIO_COUNT; scenario++)
+		printf("%s%s %d", scenario > 0 ? ", " : "", ScenarioNames[scenario], scenarioCounts[scenario]);
+	printf(")\n");
+
+	return 0;
+}
@@ -0,0 +1,464 @@
+/*
+ * @file reclaims_generate.cpp
+ * @brief Generates synthetic trades, writes them to a .scid file and benchmarks the engine on them.
+ *
+ * The trades come from a named market regime (trend, chop, gaps, crash, jumps, bounce) whose
+ * parameters can be overridden on the command line, see reclaims_synthetic.h. With --output they are
+ * written as a .scid tick file that reclaims_replay and the other tools read. With --bench they are
+ * generated in memory first and then fed to the engine, on time based bars of a fixed length, and
+ * the trades per second and the number of reclaims created, reclaimed and evicted are printed.
+ * With --perf the trades are replayed again with the hardware counters of reclaims_perf.h read
+ * around the volume, update and creation phases of every trade, and the cycles, instructions,
+ * cache misses and branch misses of each phase are printed per trade.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_generate reclaims_generate.cpp
+ *
+ * Usage:
+ *   reclaims_generate [--regime chop] [--trades 1000000] [--seed 1] [--output <file.scid>] [--bench [--perf]]
+ *                     [--price 4000] [--tick-size 0.25] [--rate 50] [--volatility 0.012] [--drift 0]
+ *                     [--mean-reversion 200] [--jumps 30 --jump-size 0.004] [--session-hours 24]
+ *                     [--gap 0.015] [--crashes 2 --crash-depth 0.05 --crash-seconds 120]
+ *                     [--spread 1] [--bounce 0.5] [--max-volume 10]
+ *                     [--bar-seconds 60] [--max-reclaims 100] [--threshold 2] [--volume]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "reclaims_perf.h"
+#include "reclaims_scid.h"
+#include "reclaims_synthetic.h"
+
+/**
+ * @struct GenerateOptions
+ * @brief Command line options of the generator.
+ */
+struct GenerateOptions
+{
+	const char *Regime;
+	int64_t Trades;
+	const char *OutputPath;
+	bool Bench;
+	bool Perf;
+	int BarPeriodSeconds;
+	bool Volume;
+	SyntheticMarketSettings Market;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_generate [--regime chop] [--trades 1000000] [--seed 1] [--output <file.scid>]\n"
+		"                         [--bench [--perf]] [--price 4000] [--tick-size 0.25] [--rate 50]\n"
+		"                         [--volatility 0.012] [--drift 0] [--mean-reversion 200]\n"
+		"                         [--jumps 30 --jump-size 0.004] [--session-hours 24] [--gap 0.015]\n"
+		"                         [--crashes 2 --crash-depth 0.05 --crash-seconds 120] [--spread 1]\n"
+		"                         [--bounce 0.5] [--max-volume 10] [--bar-seconds 60]\n"
+		"                         [--max-reclaims 100] [--threshold 2] [--volume]\n"
+		"regimes: trend, chop, gaps, crash, jumps, bounce\n");
+}
+
+/**
+ * @brief Parses the command line. The regime is applied first and the other options override it.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, GenerateOptions &options)
+{
+	options.Regime = "chop";
+	options.Trades = 1000000;
+	options.OutputPath = NULL;
+	options.Bench = false;
+	options.Perf = false;
+	options.BarPeriodSeconds = 60;
+	options.Volume = false;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 20;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--regime") == 0)
+			options.Regime = argv[++i];
+	}
+
+	if (!SyntheticMarket::GetRegimeSettings(options.Regime, options.Market))
+		return false;
+
+	SyntheticMarketSettings &market = options.Market;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--regime") == 0 && hasValue)
+			i++;
+		else if (strcmp(argv[i], "--trades") == 0 && hasValue)
+			options.Trades = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			market.Seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+			options.OutputPath = argv[++i];
+		else if (strcmp(argv[i], "--bench") == 0)
+			options.Bench = true;
+		else if (strcmp(argv[i], "--perf") == 0)
+			options.Perf = true;
+		else if (strcmp(argv[i], "--price") == 0 && hasValue)
+			market.StartPrice = atof(argv[++i]);
+		else if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+			market.TickSize = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && hasValue)
+			market.TradesPerSecond = atof(argv[++i]);
+		else if (strcmp(argv[i], "--volatility") == 0 && hasValue)
+			market.Volatility = atof(argv[++i]);
+		else if (strcmp(argv[i], "--drift") == 0 && hasValue)
+			market.Drift = atof(argv[++i]);
+		else if (strcmp(argv[i], "--mean-reversion") == 0 && hasValue)
+		{
+			market.Model = SYNTHETIC_MEAN_REVERTING;
+			market.MeanReversion = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--jumps") == 0 && hasValue)
+		{
+			market.Model = SYNTHETIC_JUMP_DIFFUSION;
+			market.JumpsPerDay = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--jump-size") == 0 && hasValue)
+			market.JumpSize = atof(argv[++i]);
+		else if (strcmp(argv[i], "--session-hours") == 0 && hasValue)
+			market.SessionSeconds = atof(argv[++i]) * 3600;
+		else if (strcmp(argv[i], "--gap") == 0 && hasValue)
+			market.GapSize = atof(argv[++i]);
+		else if (strcmp(argv[i], "--crashes") == 0 && hasValue)
+			market.FlashCrashesPerDay = atof(argv[++i]);
+		else if (strcmp(argv[i], "--crash-depth") == 0 && hasValue)
+			market.FlashCrashDepth = atof(argv[++i]);
+		else if (strcmp(argv[i], "--crash-seconds") == 0 && hasValue)
+			market.FlashCrashSeconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--spread") == 0 && hasValue)
+			market.SpreadTicks = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bounce") == 0 && hasValue)
+			market.BounceProbability = atof(argv[++i]);
+		else if (strcmp(argv[i], "--max-volume") == 0 && hasValue)
+			market.MaxVolume = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--volume") == 0)
+			options.Volume = true;
+		else
+			return false;
+	}
+
+	options.Settings.TickSize = market.TickSize;
+
+	return (options.OutputPath != NULL || options.Bench)
+		&& (options.Bench || !options.Perf)
+		&& options.Trades > 0
+		&& market.StartPrice > 0
+		&& market.TickSize > 0
+		&& market.TradesPerSecond > 0
+		&& market.SessionSeconds > 0 && market.SessionSeconds <= 86400
+		&& market.FlashCrashDepth >= 0 && market.FlashCrashDepth < 1
+		&& market.SpreadTicks > 0
+		&& market.MaxVolume > 0
+		&& options.Settings.MaxNumberOfReclaims > 0
+		&& options.Settings.NewReclaimThreshold > 0
+		&& options.BarPeriodSeconds >= 0;
+}
+
+/**
+ * @brief Writes the trades of the market to a .scid file, in blocks of records.
+ *
+ * @return `false` if the file could not be written.
+ */
+static bool WriteScidFile(const char *path, SyntheticMarket &market, int64_t trades)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	ScidFileHeader header;
+	SyntheticMarket::InitScidHeader(header);
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	std::vector<ScidRecord> records(65536);
+	SyntheticTrade trade;
+	for (int64_t i = 0; i < trades && written; i += (int64_t)records.size())
+	{
+		size_t count = (size_t)std::min<int64_t>((int64_t)records.size(), trades - i);
+		for (size_t j = 0; j < count; j++)
+		{
+			market.Next(trade);
+			SyntheticMarket::ToScidRecord(trade, records[j]);
+		}
+
+		written = fwrite(records.data(), sizeof(ScidRecord), count, file) == count;
+	}
+
+	return fclose(file) == 0 && written;
+}
+
+/**
+ * @class CountingListener
+ * @brief Counts the reclaims created, reclaimed and evicted.
+ */
+class CountingListener : public ReclaimListener
+{
+public:
+	CountingListener()
+		: Created(0)
+		, Reclaimed(0)
+		, Evicted(0)
+	{
+	}
+
+	void OnReclaimCreated(Reclaim &) { Created++; }
+	void OnReclaimReclaimed(const Reclaim &) { Reclaimed++; }
+	void OnReclaimEvicted(const Reclaim &) { Evicted++; }
+
+	int64_t Created;
+	int64_t Reclaimed;
+	int64_t Evicted;
+};
+
+/**
+ * @brief Replays the trades the way `ReclaimEngine::ProcessTrade` does, with the counters read around
+ *        the volume, update and creation phases, and prints the counters of every phase per trade.
+ *
+ * The reclaims at the end must be the ones of `reference`, replayed with `ProcessTrade`.
+ *
+ * @return `false` if the phase replay differs from `reference`.
+ */
+static bool RunPerfPhases(const GenerateOptions &options, const std::vector<SyntheticTrade> &trades, const ReclaimEngine &reference)
+{
+	PerfCounters counters;
+	if (counters.Open() == 0)
+	{
+		fprintf(stderr, "perf: perf_event_open is not available (see /proc/sys/kernel/perf_event_paranoid)\n");
+		return true;
+	}
+
+	PerfPhaseCounters phases(counters);
+	const int volumePhase = phases.AddPhase("volume");
+	const int updatePhase = phases.AddPhase("update");
+	const int createPhase = phases.AddPhase("create");
+	const int barUpdatePhase = phases.AddPhase("update bar");
+
+	ReclaimEngine engine;
+	engine.EnableVolume(options.Volume);
+	engine.Reset(options.Settings);
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+	float barHigh = 0, barLow = 0, barClose = 0;
+
+	counters.Enable();
+	phases.Calibrate(10000);
+
+	for (size_t i = 0; i < trades.size(); i++)
+	{
+		const float price = trades[i].Price;
+		const float volume = (float)trades[i].Volume;
+		double barDateTime = 0;
+		bool newBar = clock.Locate(trades[i].DateTime, barDateTime) != 0;
+
+		if (!engine.IsStarted())
+		{
+			engine.Start(price, barDateTime);
+			engine.AddVolume(price, volume);
+			barHigh = barLow = barClose = price;
+			continue;
+		}
+
+		phases.Begin();
+		engine.AddVolume(price, volume);
+		phases.End(volumePhase);
+
+		if (!options.Settings.UpdateOnBarClose)
+		{
+			phases.Begin();
+			engine.UpdateReclaims(price, price, price, barDateTime);
+			phases.End(updatePhase);
+		}
+
+		if (newBar)
+		{
+			phases.Begin();
+			engine.CloseBar(barHigh, barLow, barClose);
+			engine.CreateReclaims(price, barDateTime);
+			phases.End(createPhase);
+
+			phases.Begin();
+			engine.UpdateReclaims(barHigh, barLow, price, barDateTime);
+			phases.End(barUpdatePhase);
+
+			barHigh = barLow = barClose = price;
+			continue;
+		}
+
+		barHigh = std::max(barHigh, price);
+		barLow = std::min(barLow, price);
+		barClose = price;
+	}
+
+	counters.Disable();
+
+	fprintf(stderr, "perf: %s, read overhead subtracted:", counters.IsMapped() ? "rdpmc" : "read()");
+	for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+	{
+		if (counters.IsOpen(k))
+			fprintf(stderr, " %s %llu", PerfCounters::GetName(k), (unsigned long long)phases.GetOverhead(k));
+	}
+	fprintf(stderr, "\n");
+
+	// per trade, and per call for the phases that do not run on every trade
+	const double tradeCount = (double)trades.size();
+	fprintf(stderr, "%-12s %10s %10s", "phase", "calls", "calls/trade");
+	for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+	{
+		if (counters.IsOpen(k))
+			fprintf(stderr, " %16s", PerfCounters::GetName(k));
+	}
+	fprintf(stderr, "\n");
+
+	for (int p = 0; p < phases.GetPhaseCount(); p++)
+	{
+		fprintf(stderr, "%-12s %10lld %11.4f", phases.GetPhaseName(p), (long long)phases.GetCalls(p), phases.GetCalls(p) / tradeCount);
+		for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+		{
+			if (counters.IsOpen(k))
+				fprintf(stderr, " %16.3f", phases.GetCalls(p) > 0 ? (double)phases.GetTotal(p, k) / phases.GetCalls(p) : 0.0);
+		}
+		fprintf(stderr, "\n");
+	}
+
+	fprintf(stderr, "%-12s %10lld %11.4f", "all (/trade)", (long long)trades.size(), 1.0);
+	for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+	{
+		if (counters.IsOpen(k))
+		{
+			uint64_t total = 0;
+			for (int p = 0; p < phases.GetPhaseCount(); p++)
+				total += phases.GetTotal(p, k);
+			fprintf(stderr, " %16.3f", total / tradeCount);
+		}
+	}
+	fprintf(stderr, "\n");
+
+	if (counters.IsOpen(PERF_CYCLES) && counters.IsOpen(PERF_INSTRUCTIONS))
+	{
+		for (int p = 0; p < phases.GetPhaseCount(); p++)
+		{
+			uint64_t cycles = phases.GetTotal(p, PERF_CYCLES);
+			fprintf(stderr, "%s IPC %.2f\n", phases.GetPhaseName(p), cycles > 0 ? (double)phases.GetTotal(p, PERF_INSTRUCTIONS) / cycles : 0.0);
+		}
+	}
+
+	// the replay must match ProcessTrade, or the counters are not the ones of the engine
+	for (int type = 0; type < 2; type++)
+	{
+		const Reclaim *expected = type == 0 ? reference.GetUpReclaims() : reference.GetDownReclaims();
+		const Reclaim *actual = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+		for (int i = 0; i < engine.GetSize(); i++)
+		{
+			if (expected[i].Id != actual[i].Id || expected[i].Deleted != actual[i].Deleted
+				|| expected[i].ActiveSidePrice != actual[i].ActiveSidePrice || expected[i].MaxRetracement != actual[i].MaxRetracement)
+			{
+				fprintf(stderr, "perf: the phase replay differs from ProcessTrade at reclaim %d of type %d\n", i, type);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Generates the trades in memory, then times the engine on them alone.
+ *
+ * @return `false` if the phase replay of --perf differs from the engine.
+ */
+static bool RunBenchmark(const GenerateOptions &options, SyntheticMarket &market)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<SyntheticTrade> trades((size_t)options.Trades);
+	for (size_t i = 0; i < trades.size(); i++)
+		market.Next(trades[i]);
+
+	double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	ReclaimEngine engine;
+	engine.EnableVolume(options.Volume);
+	engine.Reset(options.Settings);
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+	CountingListener listener;
+
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < trades.size(); i++)
+	{
+		double barDateTime = 0;
+		int newBar = clock.Locate(trades[i].DateTime, barDateTime);
+		engine.ProcessTrade(trades[i].Price, (float)trades[i].Volume, barDateTime, newBar != 0, &listener);
+	}
+
+	double engineSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(stderr, "regime %s: %lld trades over %.2f days, last price %g\n", options.Regime, (long long)options.Trades,
+		trades.empty() ? 0.0 : trades.back().DateTime - options.Market.StartDateTime, trades.empty() ? 0.0 : trades.back().Price);
+	fprintf(stderr, "generated in %.3f s (%.1f M trades/s)\n", generateSeconds,
+		generateSeconds > 0 ? options.Trades / generateSeconds / 1e6 : 0.0);
+	fprintf(stderr, "engine in %.3f s (%.1f M trades/s, %.1f ns/trade)\n", engineSeconds,
+		engineSeconds > 0 ? options.Trades / engineSeconds / 1e6 : 0.0, engineSeconds * 1e9 / options.Trades);
+	fprintf(stderr, "created %lld, reclaimed %lld, evicted %lld\n", (long long)listener.Created, (long long)listener.Reclaimed,
+		(long long)listener.Evicted);
+
+	return !options.Perf || RunPerfPhases(options, trades, engine);
+}
+
+int main(int argc, char **argv)
+{
+	GenerateOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	SyntheticMarket market;
+
+	if (options.OutputPath != NULL)
+	{
+		market.Reset(options.Market);
+		if (!WriteScidFile(options.OutputPath, market, options.Trades))
+		{
+			fprintf(stderr, "unable to write %s\n", options.OutputPath);
+			return 1;
+		}
+	}
+
+	if (options.Bench)
+	{
+		market.Reset(options.Market);
+		if (!RunBenchmark(options, market))
+			return 1;
+	}
+
+	return 0;
+}
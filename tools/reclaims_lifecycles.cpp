@@ -0,0 +1,226 @@
+/*
+ * @file reclaims_lifecycles.cpp
+ * @brief Reads a lifecycle file written by reclaims_replay --lifecycles.
+ *
+ * Without options it prints the chunk index of the file: the rows and the range of end times of every
+ * chunk, and the encoding and size of every column. With --csv it prints every row as CSV, with the
+ * times as SCDateTime days. With --column it adds up one column over the whole file and prints how long
+ * the read took and whether the column was read in place or decoded.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_lifecycles reclaims_lifecycles.cpp
+ *
+ * Usage:
+ *   reclaims_lifecycles <file> [--csv | --column <name>]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "reclaims_lifecycles.h"
+
+/**
+ * @struct LifecyclesOptions
+ * @brief Command line options of the lifecycle reader.
+ */
+struct LifecyclesOptions
+{
+	const char *Path;
+	bool Csv;
+	int Column;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr, "usage: reclaims_lifecycles <file> [--csv | --column <name>]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, LifecyclesOptions &options)
+{
+	options.Path = NULL;
+	options.Csv = false;
+	options.Column = -1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--csv") == 0)
+			options.Csv = true;
+		else if (strcmp(argv[i], "--column") == 0 && hasValue)
+		{
+			const char *name = argv[++i];
+			for (int column = 0; column < RECLAIM_LIFECYCLE_COLUMN_COUNT; column++)
+			{
+				if (strcmp(name, GetReclaimLifecycleColumnName(column)) == 0)
+					options.Column = column;
+			}
+			if (options.Column < 0)
+				return false;
+		}
+		else if (argv[i][0] != '-' && options.Path == NULL)
+			options.Path = argv[i];
+		else
+			return false;
+	}
+
+	return options.Path != NULL && !(options.Csv && options.Column >= 0);
+}
+
+/**
+ * @brief Prints the chunk index of the file.
+ */
+static void PrintIndex(const ReclaimLifecycleReader &reader)
+{
+	static const char *encodings[] = { "raw", "varint", "delta-varint" };
+
+	printf("%lld rows in %d chunks\n", (long long)reader.GetRowCount(), reader.GetChunkCount());
+	for (int chunk = 0; chunk < reader.GetChunkCount(); chunk++)
+	{
+		const ReclaimLifecycleChunkIndex &index = reader.GetChunk(chunk);
+		printf("chunk %d: %llu rows, end times %.6f to %.6f\n", chunk, (unsigned long long)index.RowCount,
+			ScidTimeToDateTime(index.MinEndTime), ScidTimeToDateTime(index.MaxEndTime));
+
+		for (int column = 0; column < RECLAIM_LIFECYCLE_COLUMN_COUNT; column++)
+		{
+			const ReclaimLifecycleColumnIndex &columnIndex = index.Columns[column];
+			uint64_t rawSize = index.RowCount * GetReclaimLifecycleValueSize(column);
+			printf("  %-18s %-12s %10llu bytes, %.2f of raw\n", GetReclaimLifecycleColumnName(column), encodings[columnIndex.Encoding],
+				(unsigned long long)columnIndex.Size, rawSize > 0 ? (double)columnIndex.Size / rawSize : 1.0);
+		}
+	}
+}
+
+/**
+ * @brief Prints every row of the file as CSV.
+ */
+static void PrintRows(const ReclaimLifecycleReader &reader)
+{
+	static const char *outcomes[] = { "reclaimed", "evicted", "active" };
+
+	std::vector<int64_t> ids, startTimes, endTimes;
+	std::vector<int32_t> maxHeights, maxRetracements;
+	std::vector<uint8_t> types, outcomeValues;
+	std::vector<float> lifetimes, fixedSidePrices, activeSidePrices;
+	std::vector<double> volumes;
+
+	printf("id,type,outcome,start_date,end_date,lifetime,fixed_side_price,active_side_price,max_height,max_retracement,volume\n");
+	for (int chunk = 0; chunk < reader.GetChunkCount(); chunk++)
+	{
+		const int64_t *id = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_ID, ids);
+		const uint8_t *type = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_TYPE, types);
+		const uint8_t *outcome = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_OUTCOME, outcomeValues);
+		const int64_t *startTime = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_START_TIME, startTimes);
+		const int64_t *endTime = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_END_TIME, endTimes);
+		const float *lifetime = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_LIFETIME, lifetimes);
+		const float *fixedSidePrice = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_FIXED_SIDE_PRICE, fixedSidePrices);
+		const float *activeSidePrice = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_ACTIVE_SIDE_PRICE, activeSidePrices);
+		const int32_t *maxHeight = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_MAX_HEIGHT, maxHeights);
+		const int32_t *maxRetracement = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_MAX_RETRACEMENT, maxRetracements);
+		const double *volume = reader.GetColumn(chunk, RECLAIM_LIFECYCLE_VOLUME, volumes);
+
+		for (uint64_t i = 0; i < reader.GetChunk(chunk).RowCount; i++)
+		{
+			printf("%lld,%s,%s,%.6f,%.6f,%.3f,%g,%g,%d,%d,%.0f\n", (long long)id[i], type[i] == 0 ? "bullish" : "bearish",
+				outcome[i] <= RECLAIM_LIFECYCLE_ACTIVE ? outcomes[outcome[i]] : "unknown", ScidTimeToDateTime(startTime[i]),
+				ScidTimeToDateTime(endTime[i]), lifetime[i], fixedSidePrice[i], activeSidePrice[i], maxHeight[i], maxRetracement[i],
+				volume[i]);
+		}
+	}
+}
+
+/**
+ * @brief Adds up the values of a column of every chunk.
+ */
+template <class T>
+static double SumColumn(const ReclaimLifecycleReader &reader, int column, int &decodedChunks)
+{
+	std::vector<T> buffer;
+	double sum = 0;
+	decodedChunks = 0;
+
+	for (int chunk = 0; chunk < reader.GetChunkCount(); chunk++)
+	{
+		const T *values = reader.GetColumn(chunk, column, buffer);
+		decodedChunks += reader.GetRawColumn(chunk, column) == NULL ? 1 : 0;
+
+		for (uint64_t i = 0; i < reader.GetChunk(chunk).RowCount; i++)
+			sum += (double)values[i];
+	}
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	LifecyclesOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ReclaimLifecycleReader reader;
+	if (!reader.Open(options.Path))
+	{
+		fprintf(stderr, "unable to read %s, or it is not a complete lifecycle file\n", options.Path);
+		return 1;
+	}
+
+	if (options.Csv)
+	{
+		PrintRows(reader);
+		return 0;
+	}
+
+	if (options.Column < 0)
+	{
+		PrintIndex(reader);
+		return 0;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int decodedChunks = 0;
+	double sum = 0;
+	switch (options.Column)
+	{
+	case RECLAIM_LIFECYCLE_TYPE:
+	case RECLAIM_LIFECYCLE_OUTCOME:
+		sum = SumColumn<uint8_t>(reader, options.Column, decodedChunks);
+		break;
+	case RECLAIM_LIFECYCLE_LIFETIME:
+	case RECLAIM_LIFECYCLE_FIXED_SIDE_PRICE:
+	case RECLAIM_LIFECYCLE_ACTIVE_SIDE_PRICE:
+		sum = SumColumn<float>(reader, options.Column, decodedChunks);
+		break;
+	case RECLAIM_LIFECYCLE_MAX_HEIGHT:
+	case RECLAIM_LIFECYCLE_MAX_RETRACEMENT:
+		sum = SumColumn<int32_t>(reader, options.Column, decodedChunks);
+		break;
+	case RECLAIM_LIFECYCLE_VOLUME:
+		sum = SumColumn<double>(reader, options.Column, decodedChunks);
+		break;
+	default:
+		sum = SumColumn<int64_t>(reader, options.Column, decodedChunks);
+		break;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s: sum %.6g over %lld rows, mean %.6g\n", GetReclaimLifecycleColumnName(options.Column), sum, (long long)reader.GetRowCount(),
+		reader.GetRowCount() > 0 ? sum / reader.GetRowCount() : 0.0);
+	fprintf(stderr, "read in %.3f ms, %d of %d chunks decoded, the others read in place\n", seconds * 1e3, decodedChunks,
+		reader.GetChunkCount());
+	return 0;
+}
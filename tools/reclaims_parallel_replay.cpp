@@ -0,0 +1,561 @@
+/*
+ * @file reclaims_parallel_replay.cpp
+ * @brief Replays a .scid file one trading day per thread and stitches the days together.
+ *
+ * Every day is first replayed in parallel by its own engine, started on the first trade of the
+ * day. Such an engine does not know the reclaims carried over from the previous days, so the days
+ * are then stitched in order:
+ *
+ * 1. The exact state at the end of the previous day is restored and the day is replayed from it
+ *    until the current reclaims and the bar being built are the same as in the parallel replay.
+ *    From that trade on, both engines create the same reclaims at the same trades.
+ * 2. The reclaims carried over from the previous days are the only ones that still differ. They
+ *    are re-run alone against the rest of the day, shifting when a reclaim is created, and put
+ *    back behind the reclaims of the parallel replay, whose ids are renumbered.
+ *
+ * If the engines never converge during a day, the day is simply replayed from the exact state,
+ * so the result is always the same as a sequential replay. `--verify` runs the sequential replay
+ * too and compares every reclaim.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_parallel_replay reclaims_parallel_replay.cpp -lpthread
+ *
+ * Usage:
+ *   reclaims_parallel_replay <file.scid> --tick-size <ticksize> [--bar-seconds 60] [--max-reclaims 100]
+ *                            [--threshold 2] [--update-on-bar-close] [--threads 0] [--verify]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "reclaims_pool.h"
+#include "reclaims_scid.h"
+
+/**
+ * @brief Maximum number of convergence candidates recorded per day.
+ *
+ * The engines usually converge within the first candidates, later ones only cost memory.
+ */
+static const size_t MAX_CANDIDATES_PER_DAY = 1 << 16;
+
+/**
+ * @struct ParallelReplayOptions
+ * @brief Command line options of the parallel replay tool.
+ */
+struct ParallelReplayOptions
+{
+	const char *ScidPath;
+	int BarPeriodSeconds;
+	int Threads;
+	bool Verify;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @struct ConvergenceCandidate
+ * @brief State of the current reclaims of a day engine after a trade that restarted one of them.
+ *
+ * The exact engine can only become equal to the day engine after such a trade.
+ */
+struct ConvergenceCandidate
+{
+	int64_t Trade;
+	Reclaim Up;
+	Reclaim Down;
+	float BarHigh;
+	float BarLow;
+	int64_t NextId;
+	int64_t UpCreated;
+	int64_t DownCreated;
+};
+
+/**
+ * @struct DayReplay
+ * @brief Result of the replay of one day by its own engine.
+ */
+struct DayReplay
+{
+	int64_t Begin;
+	int64_t End;
+
+	std::vector<ConvergenceCandidate> Candidates;
+
+	// trades that created a reclaim, per side
+	std::vector<int64_t> UpCreations;
+	std::vector<int64_t> DownCreations;
+
+	ReclaimEngineState State;
+	int64_t UpCreated;
+	int64_t DownCreated;
+};
+
+/**
+ * @class CreationRecorder
+ * @brief Records the trades that create reclaims.
+ */
+class CreationRecorder : public ReclaimListener
+{
+public:
+	CreationRecorder(DayReplay &day)
+		: Trade(0)
+		, m_Day(day)
+	{
+	}
+
+	void OnReclaimCreated(Reclaim &reclaim) { (reclaim.Type == 0 ? m_Day.UpCreations : m_Day.DownCreations).push_back(Trade); }
+
+	int64_t Trade;
+
+private:
+	DayReplay &m_Day;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_parallel_replay <file.scid> --tick-size <ticksize> [--bar-seconds 60]\n"
+		"                                [--max-reclaims 100] [--threshold 2] [--update-on-bar-close]\n"
+		"                                [--threads 0] [--verify]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, ParallelReplayOptions &options)
+{
+	options.ScidPath = NULL;
+	options.BarPeriodSeconds = 60;
+	options.Threads = 0;
+	options.Verify = false;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 0;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+			options.Settings.TickSize = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--update-on-bar-close") == 0)
+			options.Settings.UpdateOnBarClose = true;
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.Threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--verify") == 0)
+			options.Verify = true;
+		else if (argv[i][0] != '-' && options.ScidPath == NULL)
+			options.ScidPath = argv[i];
+		else
+			return false;
+	}
+
+	return options.ScidPath != NULL
+		&& options.Settings.TickSize > 0
+		&& options.Settings.MaxNumberOfReclaims > 0
+		&& options.Settings.NewReclaimThreshold > 0
+		&& options.BarPeriodSeconds >= 0
+		&& options.Threads >= 0;
+}
+
+/**
+ * @brief Splits the trades at the first trade of every UTC day.
+ */
+static void SplitDays(const std::vector<ScidTrade> &trades, const std::vector<double> &barStartTimes, std::vector<DayReplay> &days)
+{
+	double day = -1;
+	for (size_t i = 0; i < trades.size(); i++)
+	{
+		double tradeDay = std::floor(barStartTimes[trades[i].BarIndex]);
+		if (tradeDay == day)
+			continue;
+
+		if (!days.empty())
+			days.back().End = (int64_t)i;
+
+		days.push_back(DayReplay());
+		days.back().Begin = (int64_t)i;
+		day = tradeDay;
+	}
+
+	if (!days.empty())
+		days.back().End = (int64_t)trades.size();
+}
+
+/**
+ * @brief Returns true if two current reclaims are equal, ignoring their ids.
+ */
+static bool SameCurrentReclaim(const Reclaim &a, const Reclaim &b)
+{
+	return a.FixedSidePrice == b.FixedSidePrice
+		&& a.ActiveSidePrice == b.ActiveSidePrice
+		&& a.MaxHeight == b.MaxHeight
+		&& a.CurrentHeight == b.CurrentHeight
+		&& a.MaxRetracement == b.MaxRetracement
+		&& a.StartDate == b.StartDate
+		&& a.Deleted == b.Deleted;
+}
+
+/**
+ * @brief Replays one day with a fresh engine and records what the stitching needs.
+ */
+static void ReplayDay(const std::vector<ScidTrade> &trades, const std::vector<double> &barStartTimes,
+	const ReclaimSettings &settings, DayReplay &day)
+{
+	ReclaimEngine engine;
+	engine.Reset(settings);
+
+	CreationRecorder recorder(day);
+
+	// the day engine starts on the first trade of the day, it always starts a new bar
+	int32_t barIndex = -1;
+	const Reclaim &up = engine.GetUpReclaims()[0];
+	const Reclaim &down = engine.GetDownReclaims()[0];
+
+	for (int64_t i = day.Begin; i < day.End; i++)
+	{
+		const ScidTrade &trade = trades[i];
+
+		int64_t upId = up.Id;
+		int64_t downId = down.Id;
+		double upStart = up.StartDate;
+		double downStart = down.StartDate;
+		float upFixed = up.FixedSidePrice;
+		float downFixed = down.FixedSidePrice;
+
+		recorder.Trade = i;
+		engine.ProcessTrade(trade.Price, trade.Volume, barStartTimes[trade.BarIndex], trade.BarIndex != barIndex, &recorder);
+		barIndex = trade.BarIndex;
+
+		bool restarted = up.Id != upId || down.Id != downId || up.StartDate != upStart || down.StartDate != downStart
+			|| up.FixedSidePrice != upFixed || down.FixedSidePrice != downFixed;
+
+		if (restarted && day.Candidates.size() < MAX_CANDIDATES_PER_DAY)
+		{
+			ConvergenceCandidate candidate;
+			candidate.Trade = i;
+			candidate.Up = up;
+			candidate.Down = down;
+			candidate.BarHigh = engine.GetBarHigh();
+			candidate.BarLow = engine.GetBarLow();
+			candidate.NextId = engine.GetNextId();
+			candidate.UpCreated = engine.GetCreatedCount(0);
+			candidate.DownCreated = engine.GetCreatedCount(1);
+			day.Candidates.push_back(candidate);
+		}
+	}
+
+	engine.SaveState(day.State);
+	day.UpCreated = engine.GetCreatedCount(0);
+	day.DownCreated = engine.GetCreatedCount(1);
+}
+
+/**
+ * @brief Updates the carried reclaims that are still in the array with a price range.
+ */
+static void UpdateCarriedReclaims(std::vector<Reclaim> &carried, int64_t shift, float high, float low, int &alive)
+{
+	// index 0 is the current reclaim, it belongs to the day engine
+	for (int64_t i = 1; i + shift < (int64_t)carried.size(); i++)
+	{
+		Reclaim &reclaim = carried[i];
+		if (!reclaim.Deleted && ReclaimEngine::UpdateOlderReclaim(reclaim, high, low))
+		{
+			reclaim.Deleted = true;
+			alive--;
+		}
+	}
+}
+
+/**
+ * @brief Re-runs the reclaims carried over from the previous days against the rest of a day.
+ *
+ * This is what `ReclaimEngine::ProcessTrade` does to the reclaims that are not the current one:
+ * every trade updates them (unless UpdateOnBarClose is set), and on a new bar the arrays shift when
+ * a reclaim is created and are then updated with the high and low of the bar that closed.
+ *
+ * @param carried Reclaims of one side, at their index after the convergence trade. Updated in place.
+ * @param shift Receives the number of reclaims created after the convergence trade.
+ * @param creations Trades that created a reclaim on this side in the day engine.
+ */
+static void RerunCarriedReclaims(std::vector<Reclaim> &carried, int64_t &shift, const std::vector<int64_t> &creations,
+	const std::vector<ScidTrade> &trades, int64_t begin, int64_t end, float barHigh, float barLow, bool updateOnBarClose)
+{
+	const int64_t size = (int64_t)carried.size();
+
+	size_t creation = 0;
+	while (creation < creations.size() && creations[creation] < begin)
+		creation++;
+
+	shift = 0;
+	int alive = 0;
+	for (int64_t i = 1; i < size; i++)
+		alive += carried[i].Deleted ? 0 : 1;
+
+	int32_t barIndex = begin > 0 ? trades[begin - 1].BarIndex : -1;
+
+	for (int64_t i = begin; i < end; i++)
+	{
+		const ScidTrade &trade = trades[i];
+		bool newBar = trade.BarIndex != barIndex;
+		barIndex = trade.BarIndex;
+
+		bool created = creation < creations.size() && creations[creation] == i;
+		if (created)
+			creation++;
+
+		// once every carried reclaim is gone only the shifts are left to count
+		if (alive == 0)
+		{
+			shift += created ? 1 : 0;
+			continue;
+		}
+
+		if (!updateOnBarClose)
+			UpdateCarriedReclaims(carried, shift, trade.Price, trade.Price, alive);
+
+		if (newBar)
+		{
+			if (created)
+			{
+				// the reclaim at the end of the array is dropped
+				int64_t dropped = size - 1 - shift;
+				if (dropped >= 1 && !carried[dropped].Deleted)
+				{
+					carried[dropped].Deleted = true;
+					alive--;
+				}
+				shift++;
+			}
+
+			UpdateCarriedReclaims(carried, shift, barHigh, barLow, alive);
+			barHigh = trade.Price;
+			barLow = trade.Price;
+		}
+		else
+		{
+			barHigh = std::max(barHigh, trade.Price);
+			barLow = std::min(barLow, trade.Price);
+		}
+	}
+}
+
+/**
+ * @brief Continues the exact state of the previous day through one day.
+ *
+ * @param day The replay of the day by its own engine.
+ * @param state The exact state at the end of the previous day, receives the state at the end of the day.
+ * @return `true` if the engines converged and the day was stitched, `false` if it was replayed.
+ */
+static bool StitchDay(const std::vector<ScidTrade> &trades, const std::vector<double> &barStartTimes,
+	const ReclaimSettings &settings, const DayReplay &day, ReclaimEngineState &state)
+{
+	ReclaimEngine engine;
+	engine.Reset(settings);
+	engine.RestoreState(state);
+
+	const Reclaim &up = engine.GetUpReclaims()[0];
+	const Reclaim &down = engine.GetDownReclaims()[0];
+
+	size_t next = 0;
+	const ConvergenceCandidate *converged = NULL;
+	int32_t barIndex = day.Begin > 0 ? trades[day.Begin - 1].BarIndex : -1;
+
+	for (int64_t i = day.Begin; i < day.End && converged == NULL; i++)
+	{
+		const ScidTrade &trade = trades[i];
+		engine.ProcessTrade(trade.Price, trade.Volume, barStartTimes[trade.BarIndex], trade.BarIndex != barIndex);
+		barIndex = trade.BarIndex;
+
+		while (next < day.Candidates.size() && day.Candidates[next].Trade < i)
+			next++;
+		if (next == day.Candidates.size() || day.Candidates[next].Trade != i)
+			continue;
+
+		const ConvergenceCandidate &candidate = day.Candidates[next];
+		if (SameCurrentReclaim(up, candidate.Up) && SameCurrentReclaim(down, candidate.Down)
+			&& engine.GetBarHigh() == candidate.BarHigh && engine.GetBarLow() == candidate.BarLow)
+		{
+			converged = &candidate;
+		}
+	}
+
+	ReclaimEngineState exact;
+	engine.SaveState(exact);
+
+	if (converged == NULL)
+	{
+		state = exact;
+		return false;
+	}
+
+	// from the convergence trade on, the day engine created the same reclaims
+	state = day.State;
+	state.NextId = exact.NextId + (day.State.NextId - converged->NextId);
+
+	for (int type = 0; type < 2; type++)
+	{
+		std::vector<Reclaim> &reclaims = type == 0 ? state.UpReclaims : state.DownReclaims;
+		std::vector<Reclaim> &carried = type == 0 ? exact.UpReclaims : exact.DownReclaims;
+		const std::vector<int64_t> &creations = type == 0 ? day.UpCreations : day.DownCreations;
+
+		int64_t shift = 0;
+		RerunCarriedReclaims(carried, shift, creations, trades, converged->Trade + 1, day.End,
+			converged->BarHigh, converged->BarLow, settings.UpdateOnBarClose);
+
+		for (int64_t i = 0; i < (int64_t)reclaims.size(); i++)
+		{
+			if (i < shift)
+				reclaims[i].Id = exact.NextId + (reclaims[i].Id - converged->NextId);
+			else if (i == shift)
+				reclaims[i].Id = carried[0].Id;
+			else
+				reclaims[i] = carried[i - shift];
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Returns true if two reclaims are equal in every field.
+ */
+static bool SameReclaim(const Reclaim &a, const Reclaim &b)
+{
+	return SameCurrentReclaim(a, b) && a.Id == b.Id && a.Type == b.Type && a.LineNumber == b.LineNumber && a.Volume == b.Volume;
+}
+
+/**
+ * @brief Counts the differences between two engine states.
+ */
+static int CompareStates(const ReclaimEngineState &a, const ReclaimEngineState &b)
+{
+	int differences = 0;
+	for (size_t i = 0; i < a.UpReclaims.size(); i++)
+	{
+		differences += SameReclaim(a.UpReclaims[i], b.UpReclaims[i]) ? 0 : 1;
+		differences += SameReclaim(a.DownReclaims[i], b.DownReclaims[i]) ? 0 : 1;
+	}
+
+	differences += a.Started == b.Started && a.NextId == b.NextId && a.BarHigh == b.BarHigh && a.BarLow == b.BarLow ? 0 : 1;
+	return differences;
+}
+
+/**
+ * @brief Prints the active reclaims of one side as CSV rows, in the format of reclaims_replay.
+ */
+static void PrintReclaims(const std::vector<Reclaim> &reclaims)
+{
+	for (size_t i = 0; i < reclaims.size(); i++)
+	{
+		const Reclaim &reclaim = reclaims[i];
+		if (reclaim.Deleted)
+			continue;
+
+		printf("%s,%d,%.6f,%g,%g,%d,%d,%d,%.0f\n", reclaim.Type == 0 ? "bullish" : "bearish", (int)i, reclaim.StartDate,
+			reclaim.FixedSidePrice, reclaim.ActiveSidePrice, reclaim.CurrentHeight, reclaim.MaxHeight, reclaim.MaxRetracement,
+			reclaim.Volume);
+	}
+}
+
+/**
+ * @brief Returns the seconds elapsed since a time point.
+ */
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	ParallelReplayOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ScidFile scidFile;
+	if (!scidFile.Open(options.ScidPath))
+	{
+		fprintf(stderr, "unable to read %s\n", options.ScidPath);
+		return 1;
+	}
+
+	std::vector<ScidTrade> trades;
+	std::vector<double> barStartTimes;
+	trades.reserve((size_t)scidFile.GetRecordCount());
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+	DecodeScidTrades(scidFile.GetRecords(), 0, scidFile.GetRecordCount(), clock, trades, barStartTimes);
+	scidFile.Close();
+
+	std::vector<DayReplay> days;
+	SplitDays(trades, barStartTimes, days);
+
+	// every day on its own engine, in parallel
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	WorkStealingPool pool(options.Threads);
+	pool.Run((int)days.size(), [&](int task, int) {
+		ReplayDay(trades, barStartTimes, options.Settings, days[task]);
+	});
+	double parallelSeconds = SecondsSince(start);
+
+	// the first day engine started like a sequential replay, the others are stitched in order
+	start = std::chrono::steady_clock::now();
+	ReclaimEngineState state;
+	int stitched = 0;
+	if (!days.empty())
+		state = days[0].State;
+	for (size_t i = 1; i < days.size(); i++)
+		stitched += StitchDay(trades, barStartTimes, options.Settings, days[i], state) ? 1 : 0;
+	double stitchSeconds = SecondsSince(start);
+
+	fprintf(stderr, "%zu trades, %zu days on %d threads: %.3f s parallel, %.3f s stitching, %d of %zu days stitched\n",
+		trades.size(), days.size(), pool.GetThreadCount(), parallelSeconds, stitchSeconds, stitched,
+		days.empty() ? (size_t)0 : days.size() - 1);
+
+	int differences = 0;
+	if (options.Verify)
+	{
+		start = std::chrono::steady_clock::now();
+		ReclaimEngine engine;
+		engine.Reset(options.Settings);
+		ReplayScidTrades(engine, trades.data(), 0, (int64_t)trades.size(), barStartTimes.data());
+		double sequentialSeconds = SecondsSince(start);
+
+		ReclaimEngineState sequential;
+		engine.SaveState(sequential);
+		if (days.empty())
+			state = sequential;
+		differences = CompareStates(state, sequential);
+
+		fprintf(stderr, "sequential: %.3f s, speedup %.2fx, %s (%d differences)\n", sequentialSeconds,
+			sequentialSeconds / std::max(parallelSeconds + stitchSeconds, 1e-9), differences == 0 ? "identical" : "MISMATCH", differences);
+	}
+
+	printf("type,index,start_date,fixed_side_price,active_side_price,current_height,max_height,max_retracement,volume\n");
+	PrintReclaims(state.UpReclaims);
+	PrintReclaims(state.DownReclaims);
+
+	return differences == 0 ? 0 : 1;
+}
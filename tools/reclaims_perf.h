@@ -0,0 +1,376 @@
+/*
+ * @file reclaims_perf.h
+ * @brief Hardware performance counters of the calling thread, read with perf_event_open (Linux).
+ *
+ * `PerfCounters` opens cycles, instructions, L1 data cache read misses, last level cache misses and
+ * branch misses as one group, so that they are counted over the same instructions. When the kernel
+ * allows user space to read the counters (cap_user_rdpmc on x86), `Read` uses rdpmc and costs a few
+ * dozen cycles, so it can be called around every phase of a trade. Otherwise it reads the whole group
+ * with one read() system call. Counters the CPU or the virtual machine does not provide are skipped;
+ * when none of them can be opened, the task clock and the page faults are counted instead.
+ *
+ * Only user space is counted, which perf_event_paranoid up to 2 allows for the own process.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief Counters of `PerfCounters`, in the order of the values returned by `Read`.
+ */
+enum PerfCounterKind
+{
+	PERF_CYCLES = 0,
+	PERF_INSTRUCTIONS = 1,
+	PERF_L1D_MISSES = 2,
+	PERF_LLC_MISSES = 3,
+	PERF_BRANCH_MISSES = 4,
+	PERF_TASK_CLOCK = 5,  // software fallback, nanoseconds
+	PERF_PAGE_FAULTS = 6, // software fallback
+	PERF_COUNTER_COUNT = 7
+};
+
+/**
+ * @class PerfCounters
+ * @brief A group of performance counters of the calling thread.
+ */
+class PerfCounters
+{
+public:
+	PerfCounters()
+		: m_Count(0)
+		, m_Mapped(false)
+	{
+		for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+			m_Fds[i] = -1;
+			m_Pages[i] = NULL;
+		}
+	}
+
+	~PerfCounters() { Close(); }
+
+	/**
+	 * @brief Opens the counters, disabled.
+	 *
+	 * @return Number of counters opened, 0 if perf events are not available.
+	 */
+	int Open()
+	{
+		Close();
+
+		for (int kind = PERF_CYCLES; kind <= PERF_BRANCH_MISSES; kind++)
+			OpenCounter((PerfCounterKind)kind);
+
+		if (m_Count == 0)
+		{
+			OpenCounter(PERF_TASK_CLOCK);
+			OpenCounter(PERF_PAGE_FAULTS);
+		}
+
+		// rdpmc only when every counter of the group can be read from user space
+		m_Mapped = m_Count > 0;
+		for (int i = 0; i < m_Count && m_Mapped; i++)
+		{
+			int kind = m_Order[i];
+			void *page = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, m_Fds[kind], 0);
+			if (page == MAP_FAILED)
+			{
+				m_Mapped = false;
+				break;
+			}
+
+			m_Pages[kind] = (perf_event_mmap_page *)page;
+			m_Mapped = m_Pages[kind]->cap_user_rdpmc != 0;
+		}
+
+#if !defined(__x86_64__) && !defined(__i386__)
+		m_Mapped = false;
+#endif
+
+		return m_Count;
+	}
+
+	/**
+	 * @brief Closes the counters.
+	 */
+	void Close()
+	{
+		for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+			if (m_Pages[i] != NULL)
+				munmap(m_Pages[i], (size_t)sysconf(_SC_PAGESIZE));
+			if (m_Fds[i] >= 0)
+				close(m_Fds[i]);
+
+			m_Fds[i] = -1;
+			m_Pages[i] = NULL;
+		}
+
+		m_Count = 0;
+		m_Mapped = false;
+	}
+
+	/**
+	 * @brief Starts and stops counting.
+	 */
+	void Enable()
+	{
+		if (m_Count > 0)
+			ioctl(m_Fds[m_Order[0]], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+
+	void Disable()
+	{
+		if (m_Count > 0)
+			ioctl(m_Fds[m_Order[0]], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	}
+
+	/**
+	 * @brief Returns `true` if a counter is open.
+	 */
+	bool IsOpen(int kind) const { return m_Fds[kind] >= 0; }
+
+	/**
+	 * @brief Returns `true` if the counters are read with rdpmc instead of a system call.
+	 */
+	bool IsMapped() const { return m_Mapped; }
+
+	/**
+	 * @brief Returns the name of a counter.
+	 */
+	static const char *GetName(int kind)
+	{
+		static const char *names[PERF_COUNTER_COUNT] = {
+			"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "task_clock_ns", "page_faults"};
+		return names[kind];
+	}
+
+	/**
+	 * @brief Reads the current values of the counters since they were opened.
+	 *
+	 * @param values Receives `PERF_COUNTER_COUNT` values, 0 for the counters that are not open.
+	 * @return `false` if the counters could not be read.
+	 */
+	bool Read(uint64_t *values)
+	{
+		memset(values, 0, PERF_COUNTER_COUNT * sizeof(uint64_t));
+
+		if (m_Mapped)
+		{
+			bool mapped = true;
+			for (int i = 0; i < m_Count && mapped; i++)
+				mapped = ReadMapped(m_Pages[m_Order[i]], values[m_Order[i]]);
+
+			if (mapped)
+				return true;
+		}
+
+		// PERF_FORMAT_GROUP: the number of counters and their values in the order they were opened
+		uint64_t buffer[1 + PERF_COUNTER_COUNT];
+		if (m_Count == 0 || read(m_Fds[m_Order[0]], buffer, sizeof(buffer)) < (ssize_t)((1 + m_Count) * sizeof(uint64_t)))
+			return false;
+
+		for (int i = 0; i < m_Count && i < (int)buffer[0]; i++)
+			values[m_Order[i]] = buffer[1 + i];
+
+		return true;
+	}
+
+private:
+	void OpenCounter(PerfCounterKind kind)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = m_Count == 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		switch (kind)
+		{
+		case PERF_CYCLES:
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PERF_INSTRUCTIONS:
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PERF_L1D_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case PERF_LLC_MISSES:
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		case PERF_BRANCH_MISSES:
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		case PERF_TASK_CLOCK:
+			attr.type = PERF_TYPE_SOFTWARE;
+			attr.config = PERF_COUNT_SW_TASK_CLOCK;
+			break;
+		case PERF_PAGE_FAULTS:
+			attr.type = PERF_TYPE_SOFTWARE;
+			attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+			break;
+		default:
+			return;
+		}
+
+		int groupFd = m_Count == 0 ? -1 : m_Fds[m_Order[0]];
+		int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+		if (fd < 0)
+			return;
+
+		m_Fds[kind] = fd;
+		m_Order[m_Count++] = kind;
+	}
+
+	/**
+	 * @brief Reads a counter with rdpmc, see the comments of `perf_event_mmap_page`.
+	 *
+	 * @return `false` if the counter is not on a hardware counter right now.
+	 */
+	static bool ReadMapped(volatile perf_event_mmap_page *page, uint64_t &value)
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		uint32_t sequence;
+		do
+		{
+			sequence = page->lock;
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+
+			uint32_t index = page->index;
+			if (index == 0)
+				return false;
+
+			uint32_t low, high;
+			__asm__ volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+
+			int shift = 64 - page->pmc_width;
+			int64_t count = (int64_t)(((uint64_t)high << 32) | low);
+			count = (int64_t)((uint64_t)count << shift) >> shift;
+			value = (uint64_t)(page->offset + count);
+
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		} while (page->lock != sequence);
+
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	int m_Fds[PERF_COUNTER_COUNT];
+	perf_event_mmap_page *m_Pages[PERF_COUNTER_COUNT];
+
+	// kinds in the order they were opened, the first one leads the group
+	int m_Order[PERF_COUNTER_COUNT];
+	int m_Count;
+
+	bool m_Mapped;
+};
+
+/**
+ * @class PerfPhaseCounters
+ * @brief Accumulates the counters of named phases, with the cost of a read pair subtracted.
+ */
+class PerfPhaseCounters
+{
+public:
+	static const int MAX_PHASES = 8;
+
+	explicit PerfPhaseCounters(PerfCounters &counters)
+		: m_Counters(counters)
+		, m_PhaseCount(0)
+	{
+		memset(m_Totals, 0, sizeof(m_Totals));
+		memset(m_Calls, 0, sizeof(m_Calls));
+		memset(m_Overhead, 0, sizeof(m_Overhead));
+		memset(m_Names, 0, sizeof(m_Names));
+	}
+
+	/**
+	 * @brief Adds a phase and returns its index.
+	 */
+	int AddPhase(const char *name)
+	{
+		m_Names[m_PhaseCount] = name;
+		return m_PhaseCount++;
+	}
+
+	/**
+	 * @brief Measures the counters of two reads in a row, subtracted from every phase.
+	 */
+	void Calibrate(int iterations)
+	{
+		uint64_t start[PERF_COUNTER_COUNT], end[PERF_COUNTER_COUNT];
+		uint64_t best[PERF_COUNTER_COUNT];
+		for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+			best[k] = UINT64_MAX;
+
+		// the smallest delta of every counter, the larger ones include interrupts
+		for (int i = 0; i < iterations; i++)
+		{
+			m_Counters.Read(start);
+			m_Counters.Read(end);
+			for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+				best[k] = std::min(best[k], end[k] - start[k]);
+		}
+
+		for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+			m_Overhead[k] = iterations > 0 ? best[k] : 0;
+	}
+
+	/**
+	 * @brief Reads the counters at the start of a phase.
+	 */
+	void Begin() { m_Counters.Read(m_Start); }
+
+	/**
+	 * @brief Reads the counters at the end of a phase and adds the difference to it.
+	 */
+	void End(int phase)
+	{
+		uint64_t end[PERF_COUNTER_COUNT];
+		m_Counters.Read(end);
+
+		for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+		{
+			uint64_t delta = end[k] - m_Start[k];
+			m_Totals[phase][k] += delta > m_Overhead[k] ? delta - m_Overhead[k] : 0;
+		}
+
+		m_Calls[phase]++;
+	}
+
+	int GetPhaseCount() const { return m_PhaseCount; }
+	const char *GetPhaseName(int phase) const { return m_Names[phase]; }
+	int64_t GetCalls(int phase) const { return m_Calls[phase]; }
+	uint64_t GetTotal(int phase, int kind) const { return m_Totals[phase][kind]; }
+	uint64_t GetOverhead(int kind) const { return m_Overhead[kind]; }
+
+private:
+	PerfCounters &m_Counters;
+
+	const char *m_Names[MAX_PHASES];
+	int m_PhaseCount;
+
+	uint64_t m_Start[PERF_COUNTER_COUNT];
+	uint64_t m_Totals[MAX_PHASES][PERF_COUNTER_COUNT];
+	int64_t m_Calls[MAX_PHASES];
+	uint64_t m_Overhead[PERF_COUNTER_COUNT];
+};
@@ -0,0 +1,118 @@
+/*
+ * @file reclaims_pool.h
+ * @brief Work stealing thread pool used by the offline tools.
+ *
+ * Tasks are numbered and dealt to the threads round robin. A thread runs its own tasks from the
+ * back of its queue and, when it runs out, steals from the front of the other queues, so threads
+ * that drew short tasks keep helping the others until every task is done. With `RunInOrder` the
+ * threads run their own tasks from the front and steal from the back instead, so tasks sorted from
+ * the longest to the shortest start about in that order and the short ones fill the gaps at the end.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Runs a fixed set of independent tasks on several threads.
+ */
+class WorkStealingPool
+{
+public:
+	/**
+	 * @param threadCount Number of threads, 0 for one per hardware thread.
+	 */
+	explicit WorkStealingPool(int threadCount)
+		: m_ThreadCount(threadCount > 0 ? threadCount : (int)std::thread::hardware_concurrency())
+	{
+		if (m_ThreadCount < 1)
+			m_ThreadCount = 1;
+	}
+
+	int GetThreadCount() const { return m_ThreadCount; }
+
+	/**
+	 * @brief Runs `task(index)` for every index in [0, taskCount) and returns when all have run.
+	 *
+	 * @param taskCount Number of tasks.
+	 * @param task Called with the task index and the index of the thread that runs it.
+	 */
+	void Run(int taskCount, const std::function<void(int task, int thread)> &task) { Run(taskCount, task, false); }
+
+	/**
+	 * @brief Like `Run`, but the tasks start about in index order, sort them by decreasing cost.
+	 */
+	void RunInOrder(int taskCount, const std::function<void(int task, int thread)> &task) { Run(taskCount, task, true); }
+
+private:
+	struct Queue
+	{
+		std::mutex Mutex;
+		std::deque<int> Tasks;
+	};
+
+	void Run(int taskCount, const std::function<void(int task, int thread)> &task, bool inOrder)
+	{
+		std::vector<Queue> queues(m_ThreadCount);
+		for (int i = 0; i < taskCount; i++)
+			queues[i % m_ThreadCount].Tasks.push_back(i);
+
+		std::vector<std::thread> threads;
+		for (int thread = 1; thread < m_ThreadCount; thread++)
+			threads.push_back(std::thread(&WorkStealingPool::Work, &queues, thread, inOrder, std::cref(task)));
+
+		// the calling thread is one of the workers
+		Work(&queues, 0, inOrder, task);
+
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+
+	static void Work(std::vector<Queue> *queues, int thread, bool inOrder, const std::function<void(int, int)> &task)
+	{
+		const int queueCount = (int)queues->size();
+		int index;
+
+		for (;;)
+		{
+			bool found = Pop((*queues)[thread], !inOrder, index);
+
+			// no task is added while running, so a full round of empty queues means everything is taken
+			for (int i = 1; i < queueCount && !found; i++)
+				found = Pop((*queues)[(thread + i) % queueCount], inOrder, index);
+
+			if (!found)
+				return;
+
+			task(index, thread);
+		}
+	}
+
+	static bool Pop(Queue &queue, bool back, int &index)
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Tasks.empty())
+			return false;
+
+		if (back)
+		{
+			index = queue.Tasks.back();
+			queue.Tasks.pop_back();
+		}
+		else
+		{
+			index = queue.Tasks.front();
+			queue.Tasks.pop_front();
+		}
+		return true;
+	}
+
+	int m_ThreadCount;
+};
@@ -0,0 +1,261 @@
+/*
+ * @file reclaims_query_bench.cpp
+ * @brief Measures the nearest reclaim queries and checks them against a scan of the reclaims arrays.
+ *
+ * The trades of a .scid file are replayed without the level indexes, with them, and with the
+ * volume of every trade added to the reclaims that contain it, to measure what each costs the
+ * engine. The indexed engine is then registered in `ReclaimQueryRegistry` and queried at random
+ * prices around the last trade, the same way the functions exported by the study DLL query it.
+ * Every result is compared with a linear scan of the reclaims arrays.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_query_bench reclaims_query_bench.cpp -lpthread
+ *
+ * Usage:
+ *   reclaims_query_bench <file.scid> --tick-size <ticksize> [--bar-seconds 60] [--max-reclaims 100]
+ *                        [--threshold 2] [--queries 1000000] [--k 5]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "reclaims_query.h"
+#include "reclaims_scid.h"
+
+/**
+ * @struct BenchOptions
+ * @brief Command line options of the benchmark.
+ */
+struct BenchOptions
+{
+	const char *ScidPath;
+	int BarPeriodSeconds;
+	int Queries;
+	int K;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_query_bench <file.scid> --tick-size <ticksize> [--bar-seconds 60]\n"
+		"                            [--max-reclaims 100] [--threshold 2] [--queries 1000000] [--k 5]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, BenchOptions &options)
+{
+	options.ScidPath = NULL;
+	options.BarPeriodSeconds = 60;
+	options.Queries = 1000000;
+	options.K = 5;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 0;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+			options.Settings.TickSize = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--queries") == 0 && hasValue)
+			options.Queries = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--k") == 0 && hasValue)
+			options.K = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && options.ScidPath == NULL)
+			options.ScidPath = argv[i];
+		else
+			return false;
+	}
+
+	return options.ScidPath != NULL
+		&& options.Settings.TickSize > 0
+		&& options.Settings.MaxNumberOfReclaims > 0
+		&& options.Settings.NewReclaimThreshold > 0
+		&& options.BarPeriodSeconds >= 0
+		&& options.Queries > 0
+		&& options.K > 0;
+}
+
+/**
+ * @brief Replays the whole file into an engine and returns the elapsed seconds.
+ */
+static double Replay(const ScidFile &scidFile, const BenchOptions &options, ReclaimEngine &engine, bool indexed, bool volume)
+{
+	engine.EnableLevelIndex(indexed);
+	engine.EnableVolume(volume);
+	engine.Reset(options.Settings);
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ReplayScidRecords(engine, scidFile.GetRecords(), 0, scidFile.GetRecordCount(), clock);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Reference for `FindNearest`: scans the reclaims array of one side.
+ */
+static const Reclaim *ScanNearest(const ReclaimEngine &engine, int type, float price, bool above)
+{
+	const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+	const Reclaim *nearest = NULL;
+
+	for (int i = 0; i < engine.GetSize(); i++)
+	{
+		const Reclaim &reclaim = reclaims[i];
+		if (reclaim.Deleted || (above ? reclaim.ActiveSidePrice < price : reclaim.ActiveSidePrice > price))
+			continue;
+
+		if (nearest == NULL || (above ? reclaim.ActiveSidePrice < nearest->ActiveSidePrice : reclaim.ActiveSidePrice > nearest->ActiveSidePrice))
+			nearest = &reclaim;
+	}
+
+	return nearest;
+}
+
+/**
+ * @brief Reference for `FindInRange`: counts the reclaims of one side inside a range.
+ */
+static int ScanInRange(const ReclaimEngine &engine, int type, float low, float high)
+{
+	const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+
+	int count = 0;
+	for (int i = 0; i < engine.GetSize(); i++)
+	{
+		if (!reclaims[i].Deleted && reclaims[i].ActiveSidePrice >= low && reclaims[i].ActiveSidePrice <= high)
+			count++;
+	}
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ScidFile scidFile;
+	if (!scidFile.Open(options.ScidPath) || scidFile.GetRecordCount() == 0)
+	{
+		fprintf(stderr, "unable to read %s\n", options.ScidPath);
+		return 1;
+	}
+
+	ReclaimEngine plainEngine;
+	double plainSeconds = Replay(scidFile, options, plainEngine, false, false);
+
+	ReclaimEngine engine;
+	double indexedSeconds = Replay(scidFile, options, engine, true, false);
+
+	ReclaimEngine volumeEngine;
+	double volumeSeconds = Replay(scidFile, options, volumeEngine, true, true);
+
+	double trades = (double)scidFile.GetRecordCount();
+	printf("replay: %.1f ns/trade without index, %.1f ns/trade with index, %.1f ns/trade with index and volume\n",
+		plainSeconds / trades * 1e9, indexedSeconds / trades * 1e9, volumeSeconds / trades * 1e9);
+
+	std::mutex engineMutex;
+	ReclaimQueryRegistry::Register("BENCH", &engine, &engineMutex);
+
+	// query prices spread around the last trade
+	float lastPrice = scidFile.GetRecords()[scidFile.GetRecordCount() - 1].Close;
+	float spread = 200 * options.Settings.TickSize;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> distribution(lastPrice - spread, lastPrice + spread);
+
+	std::vector<float> prices(options.Queries);
+	for (int i = 0; i < options.Queries; i++)
+		prices[i] = distribution(random);
+
+	int mismatches = 0;
+	std::vector<FatCatReclaimLevel> levels(std::max(options.K, 2 * options.Settings.MaxNumberOfReclaims));
+
+	// nearest through the registry, as the exported functions do
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int64_t found = 0;
+	for (int i = 0; i < options.Queries; i++)
+		found += ReclaimQueryRegistry::FindNearest("BENCH", i & 1, prices[i], (i & 2) != 0, levels[0]) > 0 ? 1 : 0;
+	double nearestSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// the same queries with a scan
+	start = std::chrono::steady_clock::now();
+	int64_t scanned = 0;
+	for (int i = 0; i < options.Queries; i++)
+		scanned += ScanNearest(engine, i & 1, prices[i], (i & 2) != 0) != NULL ? 1 : 0;
+	double scanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < options.Queries; i++)
+		ReclaimQueryRegistry::FindKNearest("BENCH", i & 1, prices[i], options.K, levels.data());
+	double kNearestSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// check every kind of query against the scan
+	for (int i = 0; i < std::min(options.Queries, 100000); i++)
+	{
+		int type = i & 1;
+		bool above = (i & 2) != 0;
+
+		const Reclaim *expected = ScanNearest(engine, type, prices[i], above);
+		const Reclaim *actual = engine.FindNearest(type, prices[i], above);
+		if ((expected == NULL) != (actual == NULL) || (expected != NULL && expected->ActiveSidePrice != actual->ActiveSidePrice))
+			mismatches++;
+
+		int count = ReclaimQueryRegistry::FindKNearest("BENCH", type, prices[i], options.K, levels.data());
+		for (int j = 1; j < count; j++)
+		{
+			if (std::fabs(levels[j].ActiveSidePrice - prices[i]) < std::fabs(levels[j - 1].ActiveSidePrice - prices[i]))
+				mismatches++;
+		}
+
+		float low = std::min(prices[i], lastPrice);
+		float high = std::max(prices[i], lastPrice);
+		count = ReclaimQueryRegistry::FindInRange("BENCH", type, low, high, levels.data(), (int)levels.size());
+		if (count != ScanInRange(engine, type, low, high))
+			mismatches++;
+	}
+
+	ReclaimQueryRegistry::Unregister(&engine);
+
+	int active = 0;
+	for (int i = 0; i < engine.GetSize(); i++)
+		active += (engine.GetUpReclaims()[i].Deleted ? 0 : 1) + (engine.GetDownReclaims()[i].Deleted ? 0 : 1);
+
+	printf("active reclaims: %d\n", active);
+	printf("nearest (registry): %.1f ns/query, %lld found\n", nearestSeconds / options.Queries * 1e9, (long long)found);
+	printf("nearest (scan):     %.1f ns/query, %lld found\n", scanSeconds / options.Queries * 1e9, (long long)scanned);
+	printf("%d nearest (registry): %.1f ns/query\n", options.K, kNearestSeconds / options.Queries * 1e9);
+	printf("mismatches: %d\n", mismatches);
+
+	return mismatches == 0 && found == scanned ? 0 : 1;
+}
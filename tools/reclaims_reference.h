@@ -0,0 +1,419 @@
+/*
+ * @file reclaims_reference.h
+ * @brief Straightforward reclaim engine, the reference that the optimized engine is checked against.
+ *
+ * `ReferenceReclaimEngine` computes reclaims exactly like the chart study did before any
+ * optimization: every update visits every reclaim of both sides, the volume and the coverage are
+ * found by scanning all reclaims, the nearest reclaims by a scan too, and the average true range of
+ * the adaptive threshold is summed again on every bar. It is slow on purpose and must only change
+ * when the semantics of the reclaims change.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include "reclaims_engine.h"
+
+/**
+ * @enum ReferenceEventKind
+ * @brief Lifecycle events compared between the engines. Updates are not events of the reference.
+ */
+enum ReferenceEventKind
+{
+	REFERENCE_EVENT_CREATED = 0,
+	REFERENCE_EVENT_RECLAIMED = 1,
+	REFERENCE_EVENT_EVICTED = 2
+};
+
+/**
+ * @struct ReferenceEvent
+ * @brief A lifecycle event with the reclaim as it was when the event happened.
+ */
+struct ReferenceEvent
+{
+	ReferenceEventKind Kind;
+	Reclaim Snapshot;
+};
+
+/**
+ * @class ReferenceEventRecorder
+ * @brief Records the lifecycle events of a `ReclaimEngine` in the form of the reference events.
+ */
+class ReferenceEventRecorder : public ReclaimListener
+{
+public:
+	void OnReclaimCreated(Reclaim &reclaim) { Record(REFERENCE_EVENT_CREATED, reclaim); }
+	void OnReclaimReclaimed(const Reclaim &reclaim) { Record(REFERENCE_EVENT_RECLAIMED, reclaim); }
+	void OnReclaimEvicted(const Reclaim &reclaim) { Record(REFERENCE_EVENT_EVICTED, reclaim); }
+
+	void Record(ReferenceEventKind kind, const Reclaim &reclaim)
+	{
+		ReferenceEvent event;
+		event.Kind = kind;
+		event.Snapshot = reclaim;
+		Events.push_back(event);
+	}
+
+	std::vector<ReferenceEvent> Events;
+};
+
+/**
+ * @class ReferenceReclaimEngine
+ * @brief Reclaim engine written for clarity, with the interface of `ReclaimEngine::ProcessTrade`.
+ */
+class ReferenceReclaimEngine
+{
+public:
+	ReferenceReclaimEngine()
+		: m_Started(false)
+		, m_NextId(1)
+		, m_BarHigh(0)
+		, m_BarLow(0)
+		, m_BarClose(0)
+		, m_Threshold(1)
+		, m_PreviousClose(0)
+	{
+	}
+
+	void Reset(const ReclaimSettings &settings)
+	{
+		m_Settings = settings;
+		m_Started = false;
+		m_NextId = 1;
+		m_Reclaims[0].assign(settings.MaxNumberOfReclaims, EmptyReclaim(0));
+		m_Reclaims[1].assign(settings.MaxNumberOfReclaims, EmptyReclaim(1));
+		m_Threshold = settings.NewReclaimThreshold;
+		m_Ranges.clear();
+		m_PreviousClose = 0;
+	}
+
+	/**
+	 * @brief Processes one trade, see `ReclaimEngine::ProcessTrade`.
+	 *
+	 * @param events Receives the lifecycle events, appended.
+	 */
+	void ProcessTrade(float price, float volume, double barDateTime, bool newBar, std::vector<ReferenceEvent> &events)
+	{
+		if (!m_Started)
+		{
+			Start(price, barDateTime, events);
+			AddVolume(price, volume);
+			return;
+		}
+
+		AddVolume(price, volume);
+
+		if (!m_Settings.UpdateOnBarClose)
+			Update(price, price, price, barDateTime, events);
+
+		if (newBar)
+		{
+			CloseBar(m_BarHigh, m_BarLow, m_BarClose);
+			Create(0, price, barDateTime, events);
+			Create(1, price, barDateTime, events);
+			Update(m_BarHigh, m_BarLow, price, barDateTime, events);
+
+			m_BarHigh = price;
+			m_BarLow = price;
+			m_BarClose = price;
+			return;
+		}
+
+		m_BarHigh = std::max(m_BarHigh, price);
+		m_BarLow = std::min(m_BarLow, price);
+		m_BarClose = price;
+	}
+
+	/**
+	 * @brief Returns the reclaims of one side, index 0 is the current reclaim.
+	 */
+	const std::vector<Reclaim> &GetReclaims(int type) const { return m_Reclaims[type]; }
+
+	int GetThreshold() const { return m_Threshold; }
+
+	/**
+	 * @brief Returns the number of active reclaims of one side whose ticks contain the tick of a price.
+	 */
+	int GetCoverage(int type, float price) const
+	{
+		int64_t tick = GetTick(price);
+
+		int count = 0;
+		for (size_t i = 0; i < m_Reclaims[type].size(); i++)
+		{
+			const Reclaim &reclaim = m_Reclaims[type][i];
+			if (reclaim.Deleted)
+				continue;
+
+			int64_t low = GetTick(std::min(reclaim.FixedSidePrice, reclaim.ActiveSidePrice));
+			int64_t high = GetTick(std::max(reclaim.FixedSidePrice, reclaim.ActiveSidePrice));
+			if (low <= tick && tick <= high)
+				count++;
+		}
+		return count;
+	}
+
+	/**
+	 * @brief Returns the active reclaim whose active side is nearest at or above (or below) a price.
+	 *
+	 * Ties are broken by the lowest id above and the highest id below, like the level index.
+	 */
+	const Reclaim *FindNearest(int type, float price, bool above) const
+	{
+		const Reclaim *nearest = NULL;
+		for (size_t i = 0; i < m_Reclaims[type].size(); i++)
+		{
+			const Reclaim &reclaim = m_Reclaims[type][i];
+			if (reclaim.Deleted)
+				continue;
+
+			if (above)
+			{
+				if (reclaim.ActiveSidePrice >= price && (nearest == NULL || reclaim.ActiveSidePrice < nearest->ActiveSidePrice
+					|| (reclaim.ActiveSidePrice == nearest->ActiveSidePrice && reclaim.Id < nearest->Id)))
+					nearest = &reclaim;
+			}
+			else
+			{
+				if (reclaim.ActiveSidePrice <= price && (nearest == NULL || reclaim.ActiveSidePrice > nearest->ActiveSidePrice
+					|| (reclaim.ActiveSidePrice == nearest->ActiveSidePrice && reclaim.Id > nearest->Id)))
+					nearest = &reclaim;
+			}
+		}
+		return nearest;
+	}
+
+private:
+	static Reclaim EmptyReclaim(int type)
+	{
+		Reclaim reclaim;
+		reclaim.FixedSidePrice = 0;
+		reclaim.ActiveSidePrice = 0;
+		reclaim.MaxHeight = 0;
+		reclaim.CurrentHeight = 0;
+		reclaim.MaxRetracement = 0;
+		reclaim.StartDate = 0;
+		reclaim.Volume = 0;
+		reclaim.LineNumber = 0;
+		reclaim.Handle = 0;
+		reclaim.Id = 0;
+		reclaim.Deleted = true;
+		reclaim.Type = type;
+		return reclaim;
+	}
+
+	int64_t GetTick(float price) const
+	{
+		float tickSize = m_Settings.TickSize > 0 ? m_Settings.TickSize : 1;
+		return (int64_t)std::floor(price / tickSize + 0.5f);
+	}
+
+	void NewReclaim(Reclaim &reclaim, float price, double dateTime, std::vector<ReferenceEvent> &events)
+	{
+		reclaim.Id = m_NextId++;
+		reclaim.FixedSidePrice = price;
+		reclaim.ActiveSidePrice = price;
+		reclaim.StartDate = dateTime;
+		reclaim.MaxHeight = 0;
+		reclaim.CurrentHeight = 0;
+		reclaim.MaxRetracement = 0;
+		reclaim.Volume = 0;
+		reclaim.Deleted = false;
+		AddEvent(events, REFERENCE_EVENT_CREATED, reclaim);
+	}
+
+	static void AddEvent(std::vector<ReferenceEvent> &events, ReferenceEventKind kind, const Reclaim &reclaim)
+	{
+		ReferenceEvent event;
+		event.Kind = kind;
+		event.Snapshot = reclaim;
+		events.push_back(event);
+	}
+
+	void Start(float price, double dateTime, std::vector<ReferenceEvent> &events)
+	{
+		NewReclaim(m_Reclaims[0][0], price, dateTime, events);
+		NewReclaim(m_Reclaims[1][0], price, dateTime, events);
+		m_BarHigh = price;
+		m_BarLow = price;
+		m_BarClose = price;
+		m_Started = true;
+	}
+
+	void AddVolume(float price, float volume)
+	{
+		if (volume <= 0)
+			return;
+
+		for (int type = 0; type < 2; type++)
+		{
+			for (size_t i = 0; i < m_Reclaims[type].size(); i++)
+			{
+				Reclaim &reclaim = m_Reclaims[type][i];
+				if (reclaim.Deleted)
+					continue;
+
+				bool inside = type == 0 ? reclaim.FixedSidePrice <= price && price <= reclaim.ActiveSidePrice
+					: reclaim.ActiveSidePrice <= price && price <= reclaim.FixedSidePrice;
+				if (inside)
+					reclaim.Volume += volume;
+			}
+		}
+	}
+
+	/**
+	 * @brief Average true range of the last bars, summed from scratch on every bar.
+	 */
+	void CloseBar(float high, float low, float close)
+	{
+		if (m_Settings.AdaptiveThresholdFactor <= 0 || m_Settings.AdaptiveThresholdBars <= 0)
+			return;
+
+		double range = high - low;
+		if (!m_Ranges.empty())
+			range = std::max(high, m_PreviousClose) - std::min(low, m_PreviousClose);
+		m_PreviousClose = close;
+
+		m_Ranges.push_back(range);
+		if ((int)m_Ranges.size() > m_Settings.AdaptiveThresholdBars)
+			m_Ranges.pop_front();
+
+		double sum = 0;
+		for (size_t i = 0; i < m_Ranges.size(); i++)
+			sum += m_Ranges[i];
+
+		double ticks = sum / m_Ranges.size() * m_Settings.AdaptiveThresholdFactor / m_Settings.TickSize;
+		m_Threshold = std::max(1, (int)std::floor(ticks + 0.5));
+	}
+
+	void Create(int type, float price, double dateTime, std::vector<ReferenceEvent> &events)
+	{
+		std::vector<Reclaim> &reclaims = m_Reclaims[type];
+		if (reclaims[0].MaxRetracement < m_Threshold)
+			return;
+
+		const int size = (int)reclaims.size();
+		if (!reclaims[size - 1].Deleted)
+			AddEvent(events, REFERENCE_EVENT_EVICTED, reclaims[size - 1]);
+
+		for (int i = size - 1; i > 0; i--)
+			reclaims[i] = reclaims[i - 1];
+
+		NewReclaim(reclaims[0], price, dateTime, events);
+	}
+
+	/**
+	 * @brief Updates every reclaim of both sides, the loops of the original study.
+	 */
+	void Update(float high, float low, float close, double dateTime, std::vector<ReferenceEvent> &events)
+	{
+		const float tickSize = m_Settings.TickSize;
+		std::vector<Reclaim> &upReclaims = m_Reclaims[0];
+		std::vector<Reclaim> &downReclaims = m_Reclaims[1];
+
+		for (size_t i = 0; i < upReclaims.size(); i++)
+		{
+			Reclaim &reclaim = upReclaims[i];
+
+			if (i == 0)
+			{
+				reclaim.ActiveSidePrice = high;
+				reclaim.CurrentHeight = (int)((reclaim.ActiveSidePrice - reclaim.FixedSidePrice) / tickSize);
+
+				int newMaxHeight = int((high - reclaim.FixedSidePrice) / tickSize);
+				if (newMaxHeight > reclaim.MaxHeight)
+					reclaim.MaxHeight = newMaxHeight;
+
+				int newMaxRetracement = int((reclaim.FixedSidePrice + reclaim.MaxHeight * tickSize - close) / tickSize);
+				if (newMaxRetracement > reclaim.MaxRetracement)
+					reclaim.MaxRetracement = newMaxRetracement;
+
+				if (low <= reclaim.FixedSidePrice)
+				{
+					reclaim.FixedSidePrice = low;
+					reclaim.ActiveSidePrice = low;
+					reclaim.StartDate = dateTime;
+					reclaim.CurrentHeight = 0;
+					reclaim.MaxHeight = 0;
+					reclaim.MaxRetracement = 0;
+					reclaim.Volume = 0;
+				}
+			}
+			else
+			{
+				if (low < reclaim.ActiveSidePrice)
+					reclaim.ActiveSidePrice = std::max(low, reclaim.FixedSidePrice);
+
+				if (low <= reclaim.FixedSidePrice || reclaim.ActiveSidePrice <= reclaim.FixedSidePrice)
+				{
+					bool wasActive = !reclaim.Deleted;
+					reclaim.Deleted = true;
+					if (wasActive)
+						AddEvent(events, REFERENCE_EVENT_RECLAIMED, reclaim);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < downReclaims.size(); i++)
+		{
+			Reclaim &reclaim = downReclaims[i];
+
+			if (i == 0)
+			{
+				reclaim.ActiveSidePrice = low;
+				reclaim.CurrentHeight = (int)((reclaim.FixedSidePrice - reclaim.ActiveSidePrice) / tickSize);
+
+				int newMaxHeight = int((reclaim.FixedSidePrice - low) / tickSize);
+				if (newMaxHeight > reclaim.MaxHeight)
+					reclaim.MaxHeight = newMaxHeight;
+
+				int newMaxRetracement = int((close - (reclaim.FixedSidePrice - reclaim.MaxHeight * tickSize)) / tickSize);
+				if (newMaxRetracement > reclaim.MaxRetracement)
+					reclaim.MaxRetracement = newMaxRetracement;
+
+				if (high >= reclaim.FixedSidePrice)
+				{
+					reclaim.FixedSidePrice = high;
+					reclaim.StartDate = dateTime;
+					reclaim.CurrentHeight = 0;
+					reclaim.MaxHeight = 0;
+					reclaim.MaxRetracement = 0;
+					reclaim.Volume = 0;
+				}
+			}
+			else
+			{
+				if (high > reclaim.ActiveSidePrice)
+					reclaim.ActiveSidePrice = std::min(high, reclaim.FixedSidePrice);
+
+				if (high >= reclaim.FixedSidePrice || reclaim.ActiveSidePrice >= reclaim.FixedSidePrice)
+				{
+					bool wasActive = !reclaim.Deleted;
+					reclaim.Deleted = true;
+					if (wasActive)
+						AddEvent(events, REFERENCE_EVENT_RECLAIMED, reclaim);
+				}
+			}
+		}
+	}
+
+	ReclaimSettings m_Settings;
+	bool m_Started;
+	int64_t m_NextId;
+
+	std::vector<Reclaim> m_Reclaims[2];
+
+	float m_BarHigh;
+	float m_BarLow;
+	float m_BarClose;
+
+	int m_Threshold;
+	std::deque<double> m_Ranges;
+	float m_PreviousClose;
+};
@@ -0,0 +1,452 @@
+/*
+ * @file reclaims_replay.cpp
+ * @brief Offline entry point that computes reclaims from every trade of a .scid file.
+ *
+ * This runs the same engine as the chart study, on time based bars of a fixed length, and prints
+ * the reclaims that are still active at the end of the file as CSV. With --events it prints every
+ * reclaim that is created, reclaimed or evicted instead, with the volume traded inside it. With
+ * --stats the latency of every trade and the number of reclaims created, reclaimed and evicted are
+ * written to a file, with the percentiles the study logs. With --timeframes the reclaims of several
+ * bar periods are computed in one pass over the records, printed one after the other with their bar
+ * period, and the time of the pass is compared with a replay of each bar period on its own. With
+ * --lifecycles every reclaim that is reclaimed, evicted or still active at the end is written to a
+ * columnar file of reclaims_lifecycles.h, with integer columns compressed unless --raw-columns is given.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_replay reclaims_replay.cpp
+ *
+ * Usage:
+ *   reclaims_replay <file.scid> --tick-size <ticksize> [--bar-seconds 60] [--max-reclaims 100]
+ *                   [--threshold 2] [--update-on-bar-close] [--volume] [--events]
+ *                   [--adaptive-factor 0 --adaptive-bars 20] [--stats <file>]
+ *                   [--timeframes 60,300,1800] [--lifecycles <file> [--raw-columns]]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "reclaims_lifecycles.h"
+#include "reclaims_scid.h"
+#include "reclaims_stats.h"
+#include "reclaims_timeframes.h"
+
+/**
+ * @struct ReplayOptions
+ * @brief Command line options of the replay tool.
+ */
+struct ReplayOptions
+{
+	const char *ScidPath;
+	int BarPeriodSeconds;
+	bool Volume;
+	bool Events;
+	const char *StatsPath;
+	const char *LifecyclesPath;
+	bool RawColumns;
+	std::vector<int> Timeframes;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_replay <file.scid> --tick-size <ticksize> [--bar-seconds 60]\n"
+		"                       [--max-reclaims 100] [--threshold 2] [--update-on-bar-close]\n"
+		"                       [--volume] [--events] [--adaptive-factor 0 --adaptive-bars 20]\n"
+		"                       [--stats <file>] [--timeframes 60,300,1800]\n"
+		"                       [--lifecycles <file> [--raw-columns]]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, ReplayOptions &options)
+{
+	options.ScidPath = NULL;
+	options.BarPeriodSeconds = 60;
+	options.Volume = false;
+	options.Events = false;
+	options.StatsPath = NULL;
+	options.LifecyclesPath = NULL;
+	options.RawColumns = false;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 20;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+			options.Settings.TickSize = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--update-on-bar-close") == 0)
+			options.Settings.UpdateOnBarClose = true;
+		else if (strcmp(argv[i], "--adaptive-factor") == 0 && hasValue)
+			options.Settings.AdaptiveThresholdFactor = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--adaptive-bars") == 0 && hasValue)
+			options.Settings.AdaptiveThresholdBars = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--volume") == 0)
+			options.Volume = true;
+		else if (strcmp(argv[i], "--events") == 0)
+			options.Events = true;
+		else if (strcmp(argv[i], "--stats") == 0 && hasValue)
+			options.StatsPath = argv[++i];
+		else if (strcmp(argv[i], "--lifecycles") == 0 && hasValue)
+			options.LifecyclesPath = argv[++i];
+		else if (strcmp(argv[i], "--raw-columns") == 0)
+			options.RawColumns = true;
+		else if (strcmp(argv[i], "--timeframes") == 0 && hasValue)
+		{
+			for (char *value = argv[++i]; *value != 0; value++)
+			{
+				options.Timeframes.push_back((int)strtol(value, &value, 10));
+				if (*value != ',')
+					break;
+			}
+		}
+		else if (argv[i][0] != '-' && options.ScidPath == NULL)
+			options.ScidPath = argv[i];
+		else
+			return false;
+	}
+
+	return options.ScidPath != NULL
+		&& options.Settings.TickSize > 0
+		&& options.Settings.MaxNumberOfReclaims > 0
+		&& options.Settings.NewReclaimThreshold > 0
+		&& options.Settings.AdaptiveThresholdFactor >= 0
+		&& options.Settings.AdaptiveThresholdBars > 0
+		&& options.BarPeriodSeconds >= 0
+		&& (int)options.Timeframes.size() <= ReclaimTimeframes::MAX_TIMEFRAMES
+		&& (options.Timeframes.empty() || (!options.Events && options.StatsPath == NULL && options.LifecyclesPath == NULL))
+		&& (!options.RawColumns || options.LifecyclesPath != NULL);
+}
+
+/**
+ * @brief Prints the active reclaims of one side as CSV rows.
+ *
+ * @param firstIndex Index of the first reclaim in its array.
+ */
+static void PrintReclaims(const Reclaim *reclaims, int size, int firstIndex = 0)
+{
+	for (int i = 0; i < size; i++)
+	{
+		const Reclaim &reclaim = reclaims[i];
+		if (reclaim.Deleted)
+			continue;
+
+		printf("%s,%d,%.6f,%g,%g,%d,%d,%d,%.0f\n", reclaim.Type == 0 ? "bullish" : "bearish", firstIndex + i, reclaim.StartDate,
+			reclaim.FixedSidePrice, reclaim.ActiveSidePrice, reclaim.CurrentHeight, reclaim.MaxHeight, reclaim.MaxRetracement,
+			reclaim.Volume);
+	}
+}
+
+/**
+ * @class EventPrinter
+ * @brief Prints the lifecycle events of the reclaims as CSV rows.
+ *
+ * Reclaimed and evicted events carry the final volume of the reclaim.
+ */
+class EventPrinter : public ReclaimListener
+{
+public:
+	void OnReclaimCreated(Reclaim &reclaim) { Print("created", reclaim); }
+	void OnReclaimReclaimed(const Reclaim &reclaim) { Print("reclaimed", reclaim); }
+	void OnReclaimEvicted(const Reclaim &reclaim) { Print("evicted", reclaim); }
+
+private:
+	static void Print(const char *event, const Reclaim &reclaim)
+	{
+		printf("%s,%s,%lld,%.6f,%g,%g,%d,%.0f\n", event, reclaim.Type == 0 ? "bullish" : "bearish", (long long)reclaim.Id,
+			reclaim.StartDate, reclaim.FixedSidePrice, reclaim.ActiveSidePrice, reclaim.MaxHeight, reclaim.Volume);
+	}
+};
+
+/**
+ * @class StatsListener
+ * @brief Counts the reclaims created, reclaimed and evicted and forwards the events to another listener.
+ */
+class StatsListener : public ReclaimListener
+{
+public:
+	StatsListener(ReclaimStats &stats, ReclaimListener *next)
+		: m_Stats(stats)
+		, p_Next(next)
+	{
+	}
+
+	void OnReclaimCreated(Reclaim &reclaim)
+	{
+		m_Stats.Counters.Created++;
+		if (p_Next != NULL)
+			p_Next->OnReclaimCreated(reclaim);
+	}
+
+	void OnReclaimReclaimed(const Reclaim &reclaim)
+	{
+		m_Stats.Counters.Reclaimed++;
+		if (p_Next != NULL)
+			p_Next->OnReclaimReclaimed(reclaim);
+	}
+
+	void OnReclaimEvicted(const Reclaim &reclaim)
+	{
+		m_Stats.Counters.Evicted++;
+		if (p_Next != NULL)
+			p_Next->OnReclaimEvicted(reclaim);
+	}
+
+private:
+	ReclaimStats &m_Stats;
+	ReclaimListener *p_Next;
+};
+
+/**
+ * @class LifecycleListener
+ * @brief Writes the reclaims that end to a lifecycle file and forwards the events to another listener.
+ */
+class LifecycleListener : public ReclaimListener
+{
+public:
+	LifecycleListener(ReclaimLifecycleWriter *writer, ReclaimListener *next)
+		: p_Writer(writer)
+		, p_Next(next)
+	{
+	}
+
+	void OnReclaimCreated(Reclaim &reclaim)
+	{
+		if (p_Next != NULL)
+			p_Next->OnReclaimCreated(reclaim);
+	}
+
+	void OnReclaimReclaimed(const Reclaim &reclaim)
+	{
+		p_Writer->OnReclaimReclaimed(reclaim);
+		if (p_Next != NULL)
+			p_Next->OnReclaimReclaimed(reclaim);
+	}
+
+	void OnReclaimEvicted(const Reclaim &reclaim)
+	{
+		p_Writer->OnReclaimEvicted(reclaim);
+		if (p_Next != NULL)
+			p_Next->OnReclaimEvicted(reclaim);
+	}
+
+private:
+	ReclaimLifecycleWriter *p_Writer;
+	ReclaimListener *p_Next;
+};
+
+/**
+ * @brief Replays the records like `ReplayScidRecords` and records the latency of every trade.
+ *
+ * @param timeTrades `false` to only count the events, the latency is not recorded.
+ * @param writer Writer of the lifecycles of the reclaims, or `NULL`.
+ */
+static int64_t ReplayWithStats(ReclaimEngine &engine, const ScidFile &scidFile, FixedPeriodBarClock &clock,
+	ReclaimListener *listener, ReclaimStats &stats, bool timeTrades, ReclaimLifecycleWriter *writer)
+{
+	LifecycleListener lifecycleListener(writer, listener);
+	StatsListener statsListener(stats, writer != NULL ? &lifecycleListener : listener);
+
+	const ScidRecord *records = scidFile.GetRecords();
+	for (int64_t i = 0; i < scidFile.GetRecordCount(); i++)
+	{
+		double dateTime = ScidTimeToDateTime(records[i].DateTime);
+		double barDateTime = 0;
+		int newBar = clock.Locate(dateTime, barDateTime);
+		if (writer != NULL)
+			writer->SetDateTime(dateTime);
+
+		ReclaimLatencyTimer latencyTimer(timeTrades ? &stats : NULL);
+		engine.ProcessTrade(records[i].Close, (float)records[i].TotalVolume, barDateTime, newBar != 0, &statsListener);
+		stats.Counters.Ticks++;
+	}
+
+	return stats.Counters.Ticks;
+}
+
+/**
+ * @brief Replays the records for every bar period in one pass, then for each bar period on its own, and
+ *        prints the reclaims of the pass.
+ *
+ * @return The process exit code, `1` if the reclaims of the pass differ from the ones of the separate replays.
+ */
+static int ReplayTimeframes(const ReplayOptions &options, const ScidFile &scidFile)
+{
+	ReclaimTimeframes timeframes;
+	for (size_t i = 0; i < options.Timeframes.size(); i++)
+	{
+		int timeframe = timeframes.Add(options.Settings, options.Timeframes[i]);
+		timeframes.GetEngine(timeframe).EnableVolume(options.Volume);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (timeframes.Replay(scidFile.GetRecords(), scidFile.GetRecordCount(), scidFile.GetRecordCount()) > 0)
+	{
+	}
+	double onePassSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double separateSeconds = 0;
+	int differences = 0;
+	for (int i = 0; i < timeframes.GetCount(); i++)
+	{
+		ReclaimEngine engine;
+		engine.EnableVolume(options.Volume);
+		engine.Reset(options.Settings);
+		FixedPeriodBarClock clock(timeframes.GetBarPeriod(i));
+
+		start = std::chrono::steady_clock::now();
+		ReplayScidRecords(engine, scidFile.GetRecords(), 0, scidFile.GetRecordCount(), clock);
+		separateSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const ReclaimEngine &shared = timeframes.GetEngine(i);
+		for (int j = 0; j < engine.GetSize(); j++)
+		{
+			const Reclaim *pairs[2][2] = { { &engine.GetUpReclaims()[j], &shared.GetUpReclaims()[j] },
+				{ &engine.GetDownReclaims()[j], &shared.GetDownReclaims()[j] } };
+			for (int type = 0; type < 2; type++)
+			{
+				const Reclaim &expected = *pairs[type][0];
+				const Reclaim &actual = *pairs[type][1];
+				if (expected.Deleted != actual.Deleted || (!expected.Deleted && (expected.Id != actual.Id ||
+					expected.StartDate != actual.StartDate || expected.FixedSidePrice != actual.FixedSidePrice ||
+					expected.ActiveSidePrice != actual.ActiveSidePrice || expected.Volume != actual.Volume)))
+					differences++;
+			}
+		}
+	}
+
+	int64_t records = scidFile.GetRecordCount();
+	fprintf(stderr, "%lld trades, %d bar periods in one pass: %.3f s (%.1f ns/trade), each on its own: %.3f s (%.1f ns/trade)%s\n",
+		(long long)records, timeframes.GetCount(), onePassSeconds, records > 0 ? onePassSeconds * 1e9 / records : 0.0,
+		separateSeconds, records > 0 ? separateSeconds * 1e9 / records : 0.0, differences == 0 ? ", identical" : "");
+
+	printf("bar_seconds,type,index,start_date,fixed_side_price,active_side_price,current_height,max_height,max_retracement,volume\n");
+	for (int i = 0; i < timeframes.GetCount(); i++)
+	{
+		for (int type = 0; type < 2; type++)
+		{
+			const ReclaimEngine &engine = timeframes.GetEngine(i);
+			const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+			for (int j = 0; j < engine.GetSize(); j++)
+			{
+				if (reclaims[j].Deleted)
+					continue;
+
+				printf("%d,", timeframes.GetBarPeriod(i));
+				PrintReclaims(reclaims + j, 1, j);
+			}
+		}
+	}
+
+	if (differences > 0)
+	{
+		fprintf(stderr, "%d reclaims differ from the replays of the bar periods on their own\n", differences);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	ReplayOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ScidFile scidFile;
+	if (!scidFile.Open(options.ScidPath))
+	{
+		fprintf(stderr, "unable to read %s\n", options.ScidPath);
+		return 1;
+	}
+
+	if (!options.Timeframes.empty())
+		return ReplayTimeframes(options, scidFile);
+
+	ReclaimEngine engine;
+	engine.EnableVolume(options.Volume);
+	engine.Reset(options.Settings);
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+
+	EventPrinter eventPrinter;
+	if (options.Events)
+		printf("event,type,id,start_date,fixed_side_price,active_side_price,max_height,volume\n");
+
+	ReclaimStats stats;
+
+	ReclaimLifecycleWriter lifecycleWriter;
+	if (options.LifecyclesPath != NULL && !lifecycleWriter.Open(options.LifecyclesPath, !options.RawColumns))
+	{
+		fprintf(stderr, "unable to create %s\n", options.LifecyclesPath);
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int64_t processed = 0;
+	if (options.StatsPath != NULL || options.LifecyclesPath != NULL)
+		processed = ReplayWithStats(engine, scidFile, clock, options.Events ? &eventPrinter : NULL, stats, options.StatsPath != NULL,
+			options.LifecyclesPath != NULL ? &lifecycleWriter : NULL);
+	else
+		processed = ReplayScidRecords(engine, scidFile.GetRecords(), 0, scidFile.GetRecordCount(), clock, 0,
+			options.Events ? &eventPrinter : NULL);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(stderr, "%lld trades in %.3f s (%.1f M trades/s)\n", (long long)processed, seconds,
+		seconds > 0 ? processed / seconds / 1e6 : 0.0);
+
+	if (options.Settings.AdaptiveThresholdFactor > 0)
+		fprintf(stderr, "adaptive threshold after the last bar: %d ticks\n", engine.GetThreshold());
+
+	if (options.StatsPath != NULL && !stats.WriteToFile(options.StatsPath, options.ScidPath))
+	{
+		fprintf(stderr, "unable to write %s\n", options.StatsPath);
+		return 1;
+	}
+
+	if (options.LifecyclesPath != NULL)
+	{
+		lifecycleWriter.WriteActive(engine);
+		int64_t rowCount = lifecycleWriter.GetRowCount();
+		if (!lifecycleWriter.Close())
+		{
+			fprintf(stderr, "unable to write %s\n", options.LifecyclesPath);
+			return 1;
+		}
+		fprintf(stderr, "%lld lifecycles written to %s\n", (long long)rowCount, options.LifecyclesPath);
+	}
+
+	if (options.Events)
+		return 0;
+
+	printf("type,index,start_date,fixed_side_price,active_side_price,current_height,max_height,max_retracement,volume\n");
+	PrintReclaims(engine.GetUpReclaims(), engine.GetSize());
+	PrintReclaims(engine.GetDownReclaims(), engine.GetSize());
+
+	return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * @file reclaims_scan.cpp
+ * @brief Ranks the symbols of a folder of .scid files by how close their last price is to a large reclaim.
+ *
+ * Every .scid file of the folder is a symbol named after the file. The files run on a work stealing
+ * pool from the largest to the smallest, so a large file does not start last and keep one thread
+ * busy after the others are done. Each file is mapped with sequential read ahead and its records are
+ * fed straight to an engine, then the active reclaims whose height is at least --min-height ticks and
+ * whose active side is at most --within ticks from the last price are written as CSV, the nearest
+ * first and the highest first at the same distance.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_scan reclaims_scan.cpp -lpthread
+ *
+ * Usage:
+ *   reclaims_scan <folder> --tick-size <ticksize> [--tick-size <symbol>=<ticksize>]... [--within 8]
+ *                 [--min-height 20] [--top 0] [--bar-seconds 60] [--max-reclaims 100] [--threshold 2]
+ *                 [--threads 0] [--output file.csv]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+#include "reclaims_pool.h"
+#include "reclaims_scid.h"
+
+/**
+ * @struct ScanOptions
+ * @brief Command line options of the scanner.
+ */
+struct ScanOptions
+{
+	const char *FolderPath;
+	const char *OutputPath;
+	std::unordered_map<std::string, float> TickSizes;
+	int Within;
+	int MinHeight;
+	int Top;
+	int BarPeriodSeconds;
+	int Threads;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @struct ScanFile
+ * @brief A .scid file of the folder and the result of its replay.
+ */
+struct ScanFile
+{
+	std::string Path;
+	std::string Symbol;
+	int64_t Size;
+	float TickSize;
+
+	bool Read;
+	int64_t Records;
+	float LastPrice;
+	double LastDateTime;
+};
+
+/**
+ * @struct ScanCandidate
+ * @brief An active reclaim near the last price of its symbol.
+ */
+struct ScanCandidate
+{
+	int File;
+	int Height;   // ticks between the fixed and the active side
+	int Distance; // ticks between the last price and the active side
+	Reclaim Snapshot;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_scan <folder> --tick-size <ticksize> [--tick-size <symbol>=<ticksize>]... [--within 8]\n"
+		"                     [--min-height 20] [--top 0] [--bar-seconds 60] [--max-reclaims 100] [--threshold 2]\n"
+		"                     [--threads 0] [--output file.csv]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, ScanOptions &options)
+{
+	options.FolderPath = NULL;
+	options.OutputPath = NULL;
+	options.Within = 8;
+	options.MinHeight = 20;
+	options.Top = 0;
+	options.BarPeriodSeconds = 60;
+	options.Threads = 0;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 20;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+		{
+			// either the default tick size or the one of a symbol
+			const char *value = argv[++i];
+			const char *separator = strchr(value, '=');
+			if (separator == NULL)
+				options.Settings.TickSize = (float)atof(value);
+			else
+				options.TickSizes[std::string(value, separator - value)] = (float)atof(separator + 1);
+		}
+		else if (strcmp(argv[i], "--within") == 0 && hasValue)
+			options.Within = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--min-height") == 0 && hasValue)
+			options.MinHeight = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--top") == 0 && hasValue)
+			options.Top = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.Threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+			options.OutputPath = argv[++i];
+		else if (argv[i][0] != '-' && options.FolderPath == NULL)
+			options.FolderPath = argv[i];
+		else
+			return false;
+	}
+
+	return options.FolderPath != NULL && options.Settings.TickSize > 0 && options.Within >= 0 && options.MinHeight >= 0 &&
+		options.Top >= 0 && options.BarPeriodSeconds > 0 && options.Settings.MaxNumberOfReclaims >= 2 &&
+		options.Settings.NewReclaimThreshold > 0;
+}
+
+/**
+ * @brief Lists the .scid files of a folder, the largest first.
+ *
+ * @return `false` if the folder cannot be read.
+ */
+static bool FindScidFiles(const ScanOptions &options, std::vector<ScanFile> &files)
+{
+	DIR *folder = opendir(options.FolderPath);
+	if (folder == NULL)
+		return false;
+
+	for (dirent *entry = readdir(folder); entry != NULL; entry = readdir(folder))
+	{
+		const char *extension = strrchr(entry->d_name, '.');
+		if (extension == NULL || extension == entry->d_name || strcasecmp(extension, ".scid") != 0)
+			continue;
+
+		ScanFile file;
+		file.Path = std::string(options.FolderPath) + "/" + entry->d_name;
+		file.Symbol = std::string(entry->d_name, extension - entry->d_name);
+
+		struct stat fileStat;
+		if (stat(file.Path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+			continue;
+		file.Size = (int64_t)fileStat.st_size;
+
+		std::unordered_map<std::string, float>::const_iterator tickSize = options.TickSizes.find(file.Symbol);
+		file.TickSize = tickSize != options.TickSizes.end() ? tickSize->second : options.Settings.TickSize;
+
+		file.Read = false;
+		file.Records = 0;
+		file.LastPrice = 0;
+		file.LastDateTime = 0;
+		files.push_back(file);
+	}
+	closedir(folder);
+
+	// the largest first, by name at the same size so the output does not depend on the folder order
+	std::sort(files.begin(), files.end(), [](const ScanFile &a, const ScanFile &b) {
+		return a.Size != b.Size ? a.Size > b.Size : a.Symbol < b.Symbol;
+	});
+	return true;
+}
+
+/**
+ * @brief Replays a .scid file and collects its candidates.
+ */
+static void ScanScidFile(const ScanOptions &options, int index, ScanFile &file, std::vector<ScanCandidate> &candidates)
+{
+	ScidFile scidFile;
+	if (!scidFile.Open(file.Path.c_str()))
+		return;
+
+	ReclaimSettings settings = options.Settings;
+	settings.TickSize = file.TickSize;
+
+	ReclaimEngine engine;
+	engine.EnableVolume(true);
+	engine.Reset(settings);
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+	file.Records = ReplayScidRecords(engine, scidFile.GetRecords(), 0, scidFile.GetRecordCount(), clock);
+	file.Read = true;
+	if (scidFile.GetRecordCount() == 0)
+		return;
+
+	const ScidRecord &last = scidFile.GetRecords()[scidFile.GetRecordCount() - 1];
+	file.LastPrice = last.Close;
+	file.LastDateTime = ScidTimeToDateTime(last.DateTime);
+	scidFile.Close();
+
+	for (int type = 0; type < 2; type++)
+	{
+		const Reclaim *reclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+		for (int i = 0; i < engine.GetSize(); i++)
+		{
+			const Reclaim &reclaim = reclaims[i];
+			if (reclaim.Deleted)
+				continue;
+
+			// CurrentHeight is only kept for the current reclaims, the older ones only move their bounds
+			int height = (int)lround(fabs(reclaim.ActiveSidePrice - reclaim.FixedSidePrice) / file.TickSize);
+			if (height < options.MinHeight)
+				continue;
+
+			int distance = (int)lround(fabs(file.LastPrice - reclaim.ActiveSidePrice) / file.TickSize);
+			if (distance > options.Within)
+				continue;
+
+			ScanCandidate candidate;
+			candidate.File = index;
+			candidate.Height = height;
+			candidate.Distance = distance;
+			candidate.Snapshot = reclaim;
+			candidates.push_back(candidate);
+		}
+	}
+}
+
+static void WriteCsv(FILE *file, const std::vector<ScanFile> &files, const std::vector<ScanCandidate> &candidates, int top)
+{
+	fprintf(file, "rank,symbol,last_price,last_date,type,start_date,fixed_side_price,active_side_price,height,"
+		"max_height,distance,volume\n");
+
+	size_t count = top > 0 ? std::min(candidates.size(), (size_t)top) : candidates.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		const ScanCandidate &candidate = candidates[i];
+		const ScanFile &scanFile = files[candidate.File];
+		const Reclaim &reclaim = candidate.Snapshot;
+		fprintf(file, "%d,%s,%g,%.6f,%s,%.6f,%g,%g,%d,%d,%d,%.0f\n", (int)i + 1, scanFile.Symbol.c_str(), scanFile.LastPrice,
+			scanFile.LastDateTime, reclaim.Type == 0 ? "bullish" : "bearish", reclaim.StartDate, reclaim.FixedSidePrice,
+			reclaim.ActiveSidePrice, candidate.Height, reclaim.MaxHeight, candidate.Distance, reclaim.Volume);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	ScanOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::vector<ScanFile> files;
+	if (!FindScidFiles(options, files))
+	{
+		fprintf(stderr, "unable to read the folder %s\n", options.FolderPath);
+		return 1;
+	}
+
+	// one list per thread, merged once every file is done
+	WorkStealingPool pool(options.Threads);
+	std::vector<std::vector<ScanCandidate>> threadCandidates(pool.GetThreadCount());
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.RunInOrder((int)files.size(), [&](int task, int thread) {
+		ScanScidFile(options, task, files[task], threadCandidates[thread]);
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<ScanCandidate> candidates;
+	for (size_t i = 0; i < threadCandidates.size(); i++)
+		candidates.insert(candidates.end(), threadCandidates[i].begin(), threadCandidates[i].end());
+
+	// the nearest first, the highest first at the same distance
+	std::sort(candidates.begin(), candidates.end(), [&](const ScanCandidate &a, const ScanCandidate &b) {
+		if (a.Distance != b.Distance)
+			return a.Distance < b.Distance;
+		if (a.Height != b.Height)
+			return a.Height > b.Height;
+		if (a.File != b.File)
+			return files[a.File].Symbol < files[b.File].Symbol;
+		return a.Snapshot.Id < b.Snapshot.Id;
+	});
+
+	int64_t records = 0;
+	int64_t bytes = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (!files[i].Read)
+		{
+			fprintf(stderr, "unable to read %s\n", files[i].Path.c_str());
+			continue;
+		}
+		records += files[i].Records;
+		bytes += files[i].Size;
+	}
+
+	fprintf(stderr, "%zu files, %lld trades (%.1f MB) on %d threads in %.3f s (%.1f M trades/s, %.0f MB/s), %zu candidates\n",
+		files.size(), (long long)records, bytes / 1e6, pool.GetThreadCount(), seconds, seconds > 0 ? records / seconds / 1e6 : 0.0,
+		seconds > 0 ? bytes / seconds / 1e6 : 0.0, candidates.size());
+
+	if (options.OutputPath != NULL)
+	{
+		FILE *file = fopen(options.OutputPath, "w");
+		if (file == NULL)
+		{
+			fprintf(stderr, "unable to write %s\n", options.OutputPath);
+			return 1;
+		}
+		WriteCsv(file, files, candidates, options.Top);
+		fclose(file);
+	}
+	else
+	{
+		WriteCsv(stdout, files, candidates, options.Top);
+	}
+
+	return 0;
+}
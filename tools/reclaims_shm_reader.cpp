@@ -0,0 +1,179 @@
+/*
+ * @file reclaims_shm_reader.cpp
+ * @brief Prints the reclaims published in shared memory by the study, or checks the shared memory
+ * publication against a simulated writer.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_shm_reader reclaims_shm_reader.cpp -pthread -lrt
+ *
+ * Usage:
+ *   reclaims_shm_reader <region name>             prints the published reclaims once
+ *   reclaims_shm_reader --simulate [seconds]      runs a writer thread on a random walk and reads
+ *                                                 concurrently, exits with 1 on a torn read
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "reclaims_shm.h"
+
+/**
+ * @brief Prints the levels of a snapshot.
+ */
+static void PrintSnapshot(const ReclaimShmSnapshot &snapshot)
+{
+	printf("publish %llu, %d bullish, %d bearish\n", (unsigned long long)snapshot.PublishCount, snapshot.UpCount, snapshot.DownCount);
+
+	for (int i = 0; i < snapshot.UpCount + snapshot.DownCount; i++)
+	{
+		const ReclaimShmLevel &level = snapshot.Levels[i];
+		printf("%s,%d,%lld,%g,%g,%.0f\n", level.Type == 0 ? "bullish" : "bearish", level.Index, (long long)level.Id,
+			level.FixedSidePrice, level.ActiveSidePrice, level.Volume);
+	}
+}
+
+/**
+ * @brief Runs a simulated writer and a reader on the same region.
+ *
+ * The writer drives an engine with a random walk and publishes after every trade, the reader checks
+ * that every snapshot it gets is consistent.
+ *
+ * @return The process exit code.
+ */
+static int Simulate(double seconds)
+{
+	std::string name = GetReclaimShmName("SIMULATED");
+
+	ReclaimShmPublisher publisher;
+	if (!publisher.Open(name))
+	{
+		fprintf(stderr, "unable to create shared memory region %s\n", name.c_str());
+		return 1;
+	}
+
+	std::atomic<bool> stop(false);
+	uint64_t publishCount = 0;
+	double publishSeconds = 0;
+
+	std::thread writer([&]() {
+		ReclaimSettings settings;
+		settings.MaxNumberOfReclaims = 100;
+		settings.NewReclaimThreshold = 2;
+		settings.TickSize = 0.25f;
+		settings.UpdateOnBarClose = false;
+		settings.AdaptiveThresholdBars = 0;
+		settings.AdaptiveThresholdFactor = 0;
+
+		ReclaimEngine engine;
+		engine.Reset(settings);
+
+		std::mt19937 random(1);
+		float price = 4000;
+		int trade = 0;
+
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			price += ((int)(random() % 3) - 1) * settings.TickSize;
+			engine.ProcessTrade(price, 1, trade / 50, trade % 50 == 0);
+			trade++;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			publisher.Publish(engine);
+			publishSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			publishCount++;
+		}
+	});
+
+	ReclaimShmReader reader;
+	if (!reader.Open(name))
+	{
+		fprintf(stderr, "unable to open shared memory region %s\n", name.c_str());
+		stop.store(true);
+		writer.join();
+		return 1;
+	}
+
+	static ReclaimShmSnapshot snapshot;
+	uint64_t reads = 0;
+	uint64_t failedReads = 0;
+	uint64_t tornReads = 0;
+	uint64_t retries = 0;
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+	while (std::chrono::steady_clock::now() < end)
+	{
+		int attemptRetries = 0;
+		if (!reader.Read(snapshot, 1000, &attemptRetries))
+		{
+			failedReads++;
+			continue;
+		}
+
+		reads++;
+		retries += attemptRetries;
+		if (!snapshot.VerifyChecksum())
+			tornReads++;
+	}
+
+	stop.store(true);
+	writer.join();
+
+	printf("writer: %llu publications, %.0f ns per publication\n", (unsigned long long)publishCount,
+		publishCount > 0 ? publishSeconds / publishCount * 1e9 : 0.0);
+	printf("reader: %llu reads, %llu retries, %llu failed, %llu torn\n", (unsigned long long)reads,
+		(unsigned long long)retries, (unsigned long long)failedReads, (unsigned long long)tornReads);
+
+	// the reader keeps its mapping of the unlinked region, and sees that the writer closed it
+	publisher.Close();
+	bool writerGone = !reader.IsWriterAlive();
+	reader.Close();
+	if (!writerGone)
+		fprintf(stderr, "the reader did not see that the writer closed the region\n");
+
+	return tornReads == 0 && reads > 0 && writerGone ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "--simulate") == 0)
+		return Simulate(argc >= 3 ? atof(argv[2]) : 2.0);
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: reclaims_shm_reader <region name> | --simulate [seconds]\n");
+		return 2;
+	}
+
+	ReclaimShmReader reader;
+	if (!reader.Open(argv[1]))
+	{
+		fprintf(stderr, "unable to open shared memory region %s, or its writer is gone\n", argv[1]);
+		return 1;
+	}
+
+	// a failed read only means the writer was publishing, read again a little later
+	static ReclaimShmSnapshot snapshot;
+	bool read = false;
+	for (int attempt = 0; attempt < 100 && !read; attempt++)
+	{
+		if (attempt > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		read = reader.Read(snapshot);
+	}
+
+	if (!read)
+	{
+		fprintf(stderr, "no consistent copy, the writer is publishing too often\n");
+		return 1;
+	}
+
+	PrintSnapshot(snapshot);
+	return 0;
+}
@@ -0,0 +1,470 @@
+/*
+ * @file reclaims_stream_client.cpp
+ * @brief Subscribes to the reclaim changes streamed by the study, or benchmarks the stream.
+ *
+ * Without --bench the client connects to the socket of a study on a chart, rebuilds the active reclaims from
+ * the messages of reclaims_stream.h and prints every message, or with --quiet the number of messages
+ * and active reclaims every second. It exits with 1 when a message does not follow the previous ones.
+ * With --bench the trades of a synthetic market regime are fed to an engine that streams its changes
+ * to subscribers connected in the same process. The trades per second with and without the stream,
+ * the messages and bytes delivered per second and the time until the last subscriber caught up are
+ * printed, and the reclaims rebuilt by every subscriber are compared with the ones of the engine.
+ * The trades are fed as fast as possible, or at --rate trades per second. A subscriber that falls
+ * more than 16 MB behind is disconnected by the study, which is reported and not an error.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_stream_client reclaims_stream_client.cpp -pthread
+ *
+ * Usage:
+ *   reclaims_stream_client <symbol | socket path> [--chartbook <name> --chart <number>] [--quiet]
+ *   reclaims_stream_client --bench [--regime chop] [--trades 1000000] [--seed 1] [--subscribers 2]
+ *                          [--rate 0] [--bar-seconds 60] [--max-reclaims 100] [--threshold 2]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "reclaims_scid.h"
+#include "reclaims_stream.h"
+#include "reclaims_synthetic.h"
+
+/**
+ * @struct StreamClientOptions
+ * @brief Command line options of the client.
+ */
+struct StreamClientOptions
+{
+	const char *Target;
+	const char *Chartbook;
+	int ChartNumber;
+	bool Quiet;
+	bool Bench;
+	const char *Regime;
+	int64_t Trades;
+	uint64_t Seed;
+	int Subscribers;
+	double Rate;
+	int BarPeriodSeconds;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_stream_client <symbol | socket path> [--chartbook <name> --chart <number>] [--quiet]\n"
+		"       reclaims_stream_client --bench [--regime chop] [--trades 1000000] [--seed 1] [--subscribers 2]\n"
+		"                              [--rate 0] [--bar-seconds 60] [--max-reclaims 100] [--threshold 2]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, StreamClientOptions &options)
+{
+	options.Target = NULL;
+	options.Chartbook = NULL;
+	options.ChartNumber = 0;
+	options.Quiet = false;
+	options.Bench = false;
+	options.Regime = "chop";
+	options.Trades = 1000000;
+	options.Seed = 1;
+	options.Subscribers = 2;
+	options.Rate = 0;
+	options.BarPeriodSeconds = 60;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 20;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--quiet") == 0)
+			options.Quiet = true;
+		else if (strcmp(argv[i], "--chartbook") == 0 && hasValue)
+			options.Chartbook = argv[++i];
+		else if (strcmp(argv[i], "--chart") == 0 && hasValue)
+			options.ChartNumber = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench") == 0)
+			options.Bench = true;
+		else if (strcmp(argv[i], "--regime") == 0 && hasValue)
+			options.Regime = argv[++i];
+		else if (strcmp(argv[i], "--trades") == 0 && hasValue)
+			options.Trades = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--subscribers") == 0 && hasValue)
+			options.Subscribers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && hasValue)
+			options.Rate = atof(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && options.Target == NULL)
+			options.Target = argv[i];
+		else
+			return false;
+	}
+
+	if (options.Bench)
+		return options.Trades > 0 && options.Subscribers > 0 && options.BarPeriodSeconds > 0 &&
+			options.Settings.MaxNumberOfReclaims >= 2 && options.Settings.NewReclaimThreshold > 0;
+
+	return options.Target != NULL && (options.Chartbook != NULL) == (options.ChartNumber > 0);
+}
+
+static const char *GetKindName(int kind)
+{
+	switch (kind)
+	{
+	case RECLAIM_STREAM_HELLO:
+		return "hello";
+	case RECLAIM_STREAM_SNAPSHOT:
+		return "snapshot";
+	case RECLAIM_STREAM_CREATED:
+		return "created";
+	case RECLAIM_STREAM_RESIZED:
+		return "resized";
+	case RECLAIM_STREAM_RECLAIMED:
+		return "reclaimed";
+	case RECLAIM_STREAM_EVICTED:
+		return "evicted";
+	case RECLAIM_STREAM_RESET:
+		return "reset";
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * @brief Prints the messages of a study until it closes the connection.
+ *
+ * @return The process exit code.
+ */
+static int Subscribe(const StreamClientOptions &options)
+{
+	// a path has a separator, anything else is a symbol, streamed by the study on every chart to its own socket
+	std::string path;
+	if (strchr(options.Target, '/') != NULL || strchr(options.Target, '\\') != NULL)
+		path = options.Target;
+	else if (options.Chartbook != NULL)
+		path = GetReclaimStreamPath(options.Target, GetReclaimChartSuffix(options.Chartbook, options.ChartNumber).c_str());
+	else
+		path = GetReclaimStreamPath(options.Target);
+
+	ReclaimStreamSubscriber subscriber;
+	if (!subscriber.Open(path))
+	{
+		fprintf(stderr, "unable to connect to %s\n", path.c_str());
+		return 1;
+	}
+
+	ReclaimStreamMirror mirror;
+	std::vector<ReclaimStreamMessage> messages;
+	int64_t count = 0;
+	std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+	if (!options.Quiet)
+		printf("kind,sequence,type,handle,id,start,fixed,active,volume\n");
+
+	while (subscriber.Read(messages, 100))
+	{
+		for (size_t i = 0; i < messages.size(); i++)
+		{
+			const ReclaimStreamMessage &message = messages[i];
+			if (!mirror.Apply(message))
+			{
+				fprintf(stderr, "%s message %u of reclaim %llx does not follow the previous ones\n", GetKindName(message.Kind),
+					message.Sequence, (unsigned long long)message.Handle);
+				return 1;
+			}
+
+			if (!options.Quiet)
+				printf("%s,%u,%s,%llx,%lld,%.6f,%g,%g,%.0f\n", GetKindName(message.Kind), message.Sequence,
+					message.Type == 0 ? "bullish" : "bearish", (unsigned long long)message.Handle, (long long)message.Id,
+					message.StartDate, message.FixedSidePrice, message.ActiveSidePrice, message.Volume);
+		}
+		count += messages.size();
+
+		if (options.Quiet && std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(1))
+		{
+			lastReport = std::chrono::steady_clock::now();
+			printf("%lld messages, sequence %u, %d active reclaims\n", (long long)count, mirror.GetSequence(),
+				(int)mirror.GetReclaims().size());
+			fflush(stdout);
+		}
+	}
+
+	fprintf(stderr, "connection closed after %lld messages\n", (long long)count);
+	return 0;
+}
+
+/**
+ * @struct BenchSubscriber
+ * @brief A subscriber thread of the benchmark and what it received.
+ */
+struct BenchSubscriber
+{
+	ReclaimStreamMirror Mirror;
+	int64_t Messages;
+	bool Connected;
+	bool Closed;
+	std::chrono::steady_clock::time_point CaughtUp;
+};
+
+/**
+ * @brief Reads the stream until the mirror reached the last change of the engine.
+ *
+ * @param ready Increased once the subscriber got its hello message.
+ * @param lastSequence Sequence of the last change once the engine is done, 0 before.
+ */
+static void RunBenchSubscriber(const std::string &path, BenchSubscriber &result, std::atomic<int> &ready,
+	std::atomic<uint32_t> &lastSequence, std::atomic<bool> &done)
+{
+	ReclaimStreamSubscriber subscriber;
+	result.Messages = 0;
+	result.Closed = false;
+	result.Connected = subscriber.Open(path);
+	if (!result.Connected)
+	{
+		ready.fetch_add(1);
+		return;
+	}
+
+	std::vector<ReclaimStreamMessage> messages;
+	bool hello = false;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+	while (true)
+	{
+		if (!subscriber.Read(messages, 10))
+		{
+			result.Closed = true;
+			break;
+		}
+
+		for (size_t i = 0; i < messages.size(); i++)
+			result.Mirror.Apply(messages[i]);
+		result.Messages += messages.size();
+
+		if (!hello && result.Mirror.IsSynchronized())
+		{
+			hello = true;
+			ready.fetch_add(1);
+		}
+
+		if (done.load())
+		{
+			if (result.Mirror.GetSequence() == lastSequence.load())
+				break;
+
+			// the changes are delivered within a few milliseconds, a subscriber still behind after seconds was disconnected
+			if (deadline == std::chrono::steady_clock::time_point::max())
+				deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			else if (std::chrono::steady_clock::now() > deadline)
+				break;
+		}
+	}
+
+	result.CaughtUp = std::chrono::steady_clock::now();
+	if (!hello)
+		ready.fetch_add(1);
+}
+
+/**
+ * @brief Compares the reclaims rebuilt by a subscriber with the active reclaims of the engine.
+ *
+ * @return The number of differences.
+ */
+static int CompareMirror(const ReclaimStreamMirror &mirror, const ReclaimEngine &engine)
+{
+	const std::unordered_map<uint64_t, ReclaimStreamMessage> &reclaims = mirror.GetReclaims();
+	int differences = 0;
+	size_t active = 0;
+
+	for (int type = 0; type < 2; type++)
+	{
+		const Reclaim *engineReclaims = type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims();
+		for (int i = 0; i < engine.GetSize(); i++)
+		{
+			const Reclaim &reclaim = engineReclaims[i];
+			if (reclaim.Deleted)
+				continue;
+			active++;
+
+			std::unordered_map<uint64_t, ReclaimStreamMessage>::const_iterator found = reclaims.find(reclaim.Handle);
+			if (found == reclaims.end())
+			{
+				differences++;
+				continue;
+			}
+
+			const ReclaimStreamMessage &message = found->second;
+			if (message.Type != reclaim.Type || message.Id != reclaim.Id || message.StartDate != reclaim.StartDate ||
+				message.FixedSidePrice != reclaim.FixedSidePrice || message.ActiveSidePrice != reclaim.ActiveSidePrice)
+				differences++;
+		}
+	}
+
+	if (reclaims.size() != active)
+		differences++;
+	return differences;
+}
+
+/**
+ * @brief Runs the engine on synthetic trades with and without the stream and checks the subscribers.
+ *
+ * @return The process exit code.
+ */
+static int RunBenchmark(const StreamClientOptions &options)
+{
+	SyntheticMarketSettings marketSettings;
+	if (!SyntheticMarket::GetRegimeSettings(options.Regime, marketSettings))
+	{
+		fprintf(stderr, "unknown regime %s\n", options.Regime);
+		return 2;
+	}
+	marketSettings.Seed = options.Seed;
+
+	ReclaimSettings settings = options.Settings;
+	settings.TickSize = marketSettings.TickSize;
+
+	SyntheticMarket market;
+	market.Reset(marketSettings);
+	std::vector<SyntheticTrade> trades((size_t)options.Trades);
+	for (size_t i = 0; i < trades.size(); i++)
+		market.Next(trades[i]);
+
+	// the engine alone
+	ReclaimEngine engine;
+	engine.Reset(settings);
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < trades.size(); i++)
+	{
+		double barDateTime = 0;
+		int newBar = clock.Locate(trades[i].DateTime, barDateTime);
+		engine.ProcessTrade(trades[i].Price, (float)trades[i].Volume, barDateTime, newBar != 0);
+	}
+	double engineSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// the same trades with the changes streamed to the subscribers
+	std::string path = GetReclaimStreamPath("BENCH") + "." + std::to_string((long long)getpid());
+	ReclaimStreamServer server;
+	if (!server.Open(path))
+	{
+		fprintf(stderr, "unable to create socket %s\n", path.c_str());
+		return 1;
+	}
+
+	std::vector<BenchSubscriber> results(options.Subscribers);
+	std::vector<std::thread> threads;
+	std::atomic<int> ready(0);
+	std::atomic<uint32_t> lastSequence(0);
+	std::atomic<bool> done(false);
+	for (int i = 0; i < options.Subscribers; i++)
+		threads.push_back(std::thread(RunBenchSubscriber, path, std::ref(results[i]), std::ref(ready), std::ref(lastSequence), std::ref(done)));
+
+	while (ready.load() < options.Subscribers)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	ReclaimEngine streamedEngine;
+	streamedEngine.Reset(settings);
+	clock = FixedPeriodBarClock(options.BarPeriodSeconds);
+
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < trades.size(); i++)
+	{
+		if (options.Rate > 0 && i % 1000 == 0)
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(i / options.Rate)));
+
+		// the study does this at the start of every call
+		if (server.NeedsResync())
+			server.Resync(streamedEngine);
+
+		double barDateTime = 0;
+		int newBar = clock.Locate(trades[i].DateTime, barDateTime);
+		streamedEngine.ProcessTrade(trades[i].Price, (float)trades[i].Volume, barDateTime, newBar != 0, &server);
+	}
+	while (server.NeedsResync() && !server.Resync(streamedEngine))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	double streamSeconds = std::chrono::duration<double>(end - start).count();
+
+	lastSequence.store(server.GetSequence());
+	done.store(true);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	double deliverySeconds = 0;
+	int64_t errors = 0;
+	int failed = 0;
+	int disconnected = 0;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchSubscriber &result = results[i];
+		if (!result.Closed)
+			deliverySeconds = std::max(deliverySeconds, std::chrono::duration<double>(result.CaughtUp - start).count());
+		errors += result.Mirror.GetErrorCount();
+
+		if (result.Connected && result.Closed)
+			disconnected++;
+		else if (!result.Connected || result.Mirror.GetSequence() != server.GetSequence() || CompareMirror(result.Mirror, streamedEngine) != 0)
+			failed++;
+	}
+	server.Close();
+
+	int64_t messages = server.GetSequence();
+	fprintf(stderr, "regime %s: %lld trades, %d subscribers\n", options.Regime, (long long)options.Trades, options.Subscribers);
+	fprintf(stderr, "engine alone:    %.3f s (%.1f ns/trade)\n", engineSeconds, engineSeconds * 1e9 / options.Trades);
+	if (options.Rate > 0)
+		fprintf(stderr, "engine streamed: %.3f s at %.0f trades/s\n", streamSeconds, options.Rate);
+	else
+		fprintf(stderr, "engine streamed: %.3f s (%.1f ns/trade, %.1f ns/message)\n", streamSeconds, streamSeconds * 1e9 / options.Trades,
+			messages > 0 ? (streamSeconds - engineSeconds) * 1e9 / messages : 0.0);
+	fprintf(stderr, "%lld messages (%.2f per trade), %lld dropped, %lld resyncs\n", (long long)messages, (double)messages / options.Trades,
+		(long long)server.GetDroppedCount(), (long long)server.GetResyncCount());
+	fprintf(stderr, "delivered to the connected subscribers in %.3f s: %.1f M messages/s, %.0f MB/s per subscriber\n", deliverySeconds,
+		deliverySeconds > 0 ? messages / deliverySeconds / 1e6 : 0.0,
+		deliverySeconds > 0 ? messages * sizeof(ReclaimStreamMessage) / deliverySeconds / 1e6 : 0.0);
+	fprintf(stderr, "%lld protocol errors, %d of %d subscribers differ from the engine, %d disconnected for reading too slowly\n",
+		(long long)errors, failed, options.Subscribers, disconnected);
+
+	return errors == 0 && failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	StreamClientOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	if (options.Bench)
+		return RunBenchmark(options);
+
+	return Subscribe(options);
+}
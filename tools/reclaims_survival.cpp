@@ -0,0 +1,259 @@
+/*
+ * @file reclaims_survival.cpp
+ * @brief Computes when every reclaim of a .scid file is reclaimed or evicted, in closed form.
+ *
+ * Only the current reclaims are replayed trade by trade. The reclaims that are shifted out of the
+ * current position are then resolved against the recorded price series by `ReclaimSurvivalAnalyzer`,
+ * without the per trade update of every active reclaim that the engine does. With --verify the
+ * engine replays the file too and every lifetime is compared with what it did.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_survival reclaims_survival.cpp
+ *
+ * Usage:
+ *   reclaims_survival <file.scid> --tick-size <ticksize> [--bar-seconds 60] [--max-reclaims 100]
+ *                     [--threshold 2] [--update-on-bar-close] [--verify] [--quiet]
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#include "reclaims_scid.h"
+#include "reclaims_survival.h"
+
+/**
+ * @struct SurvivalOptions
+ * @brief Command line options of the survival tool.
+ */
+struct SurvivalOptions
+{
+	const char *ScidPath;
+	int BarPeriodSeconds;
+	bool Verify;
+	bool Quiet;
+	ReclaimSettings Settings;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_survival <file.scid> --tick-size <ticksize> [--bar-seconds 60]\n"
+		"                         [--max-reclaims 100] [--threshold 2] [--update-on-bar-close]\n"
+		"                         [--verify] [--quiet]\n");
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, SurvivalOptions &options)
+{
+	options.ScidPath = NULL;
+	options.BarPeriodSeconds = 60;
+	options.Verify = false;
+	options.Quiet = false;
+	options.Settings.MaxNumberOfReclaims = 100;
+	options.Settings.NewReclaimThreshold = 2;
+	options.Settings.TickSize = 0;
+	options.Settings.UpdateOnBarClose = false;
+	options.Settings.AdaptiveThresholdBars = 0;
+	options.Settings.AdaptiveThresholdFactor = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+			options.Settings.TickSize = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+			options.Settings.MaxNumberOfReclaims = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+			options.Settings.NewReclaimThreshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--update-on-bar-close") == 0)
+			options.Settings.UpdateOnBarClose = true;
+		else if (strcmp(argv[i], "--verify") == 0)
+			options.Verify = true;
+		else if (strcmp(argv[i], "--quiet") == 0)
+			options.Quiet = true;
+		else if (argv[i][0] != '-' && options.ScidPath == NULL)
+			options.ScidPath = argv[i];
+		else
+			return false;
+	}
+
+	return options.ScidPath != NULL
+		&& options.Settings.TickSize > 0
+		&& options.Settings.MaxNumberOfReclaims > 0
+		&& options.Settings.NewReclaimThreshold > 0
+		&& options.BarPeriodSeconds >= 0;
+}
+
+/**
+ * @struct ObservedEnd
+ * @brief How the engine ended a reclaim.
+ */
+struct ObservedEnd
+{
+	ReclaimLifetimeEnd End;
+	double EndDate;
+	float ActiveSidePrice;
+};
+
+/**
+ * @class EndRecorder
+ * @brief Records the reclaims reclaimed or evicted by the engine.
+ */
+class EndRecorder : public ReclaimListener
+{
+public:
+	EndRecorder()
+		: BarDateTime(0)
+	{
+	}
+
+	void OnReclaimReclaimed(const Reclaim &reclaim) { Record(reclaim, RECLAIM_LIFETIME_RECLAIMED); }
+	void OnReclaimEvicted(const Reclaim &reclaim) { Record(reclaim, RECLAIM_LIFETIME_EVICTED); }
+
+	void Record(const Reclaim &reclaim, ReclaimLifetimeEnd end)
+	{
+		ObservedEnd &observed = Ends[reclaim.Id];
+		observed.End = end;
+		observed.EndDate = BarDateTime;
+		observed.ActiveSidePrice = reclaim.ActiveSidePrice;
+	}
+
+	double BarDateTime;
+	std::unordered_map<int64_t, ObservedEnd> Ends;
+};
+
+/**
+ * @brief Replays the file with the engine and counts the lifetimes that differ from what it did.
+ */
+static int Verify(const ScidFile &scidFile, const SurvivalOptions &options, const ReclaimSurvivalAnalyzer &analyzer,
+	const std::vector<ReclaimLifetime> &lifetimes, double &seconds)
+{
+	ReclaimEngine engine;
+	engine.Reset(options.Settings);
+
+	EndRecorder recorder;
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const ScidRecord *records = scidFile.GetRecords();
+	for (int64_t i = 0; i < scidFile.GetRecordCount(); i++)
+	{
+		int newBar = clock.Locate(ScidTimeToDateTime(records[i].DateTime), recorder.BarDateTime);
+		engine.ProcessTrade(records[i].Close, 0, recorder.BarDateTime, newBar != 0, &recorder);
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// the reclaims still active after the last trade, except the current ones
+	for (int i = 1; i < engine.GetSize(); i++)
+	{
+		for (int type = 0; type < 2; type++)
+		{
+			const Reclaim &reclaim = (type == 0 ? engine.GetUpReclaims() : engine.GetDownReclaims())[i];
+			if (!reclaim.Deleted)
+				recorder.Record(reclaim, RECLAIM_LIFETIME_ACTIVE);
+		}
+	}
+
+	int differences = 0;
+	for (size_t i = 0; i < lifetimes.size(); i++)
+	{
+		const ReclaimLifetime &lifetime = lifetimes[i];
+
+		std::unordered_map<int64_t, ObservedEnd>::const_iterator observed = recorder.Ends.find(lifetime.Id);
+		if (observed == recorder.Ends.end())
+		{
+			differences++;
+			continue;
+		}
+
+		double endDate = lifetime.End == RECLAIM_LIFETIME_ACTIVE ? 0 : analyzer.GetUpdateDate(lifetime.EndUpdate);
+		double observedEndDate = observed->second.End == RECLAIM_LIFETIME_ACTIVE ? 0 : observed->second.EndDate;
+
+		if (observed->second.End != lifetime.End || observedEndDate != endDate || observed->second.ActiveSidePrice != lifetime.ActiveSidePrice)
+			differences++;
+	}
+
+	return differences;
+}
+
+int main(int argc, char **argv)
+{
+	SurvivalOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ScidFile scidFile;
+	if (!scidFile.Open(options.ScidPath))
+	{
+		fprintf(stderr, "unable to read %s\n", options.ScidPath);
+		return 1;
+	}
+
+	ReclaimSurvivalAnalyzer analyzer;
+	analyzer.Reset(options.Settings);
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const ScidRecord *records = scidFile.GetRecords();
+	for (int64_t i = 0; i < scidFile.GetRecordCount(); i++)
+	{
+		double barDateTime = 0;
+		int newBar = clock.Locate(ScidTimeToDateTime(records[i].DateTime), barDateTime);
+		analyzer.ProcessTrade(records[i].Close, barDateTime, newBar != 0);
+	}
+	double recordSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	std::vector<ReclaimLifetime> lifetimes;
+	analyzer.Compute(lifetimes);
+	double computeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!options.Quiet)
+	{
+		static const char *endNames[] = { "active", "reclaimed", "evicted" };
+
+		printf("type,id,start_date,shift_date,end,end_date,fixed_side_price,active_side_price,max_height\n");
+		for (size_t i = 0; i < lifetimes.size(); i++)
+		{
+			const ReclaimLifetime &lifetime = lifetimes[i];
+			printf("%s,%lld,%.6f,%.6f,%s,%.6f,%g,%g,%d\n", lifetime.Type == 0 ? "bullish" : "bearish", (long long)lifetime.Id,
+				lifetime.StartDate, analyzer.GetUpdateDate(lifetime.ShiftUpdate), endNames[lifetime.End],
+				lifetime.End == RECLAIM_LIFETIME_ACTIVE ? 0.0 : analyzer.GetUpdateDate(lifetime.EndUpdate),
+				lifetime.FixedSidePrice, lifetime.ActiveSidePrice, lifetime.MaxHeight);
+		}
+	}
+
+	fprintf(stderr, "%lld trades, %lld updates, %zu reclaims: %.3f s recording, %.3f s computing\n",
+		(long long)scidFile.GetRecordCount(), (long long)analyzer.GetUpdateCount(), lifetimes.size(), recordSeconds, computeSeconds);
+
+	if (!options.Verify)
+		return 0;
+
+	double engineSeconds = 0;
+	int differences = Verify(scidFile, options, analyzer, lifetimes, engineSeconds);
+
+	fprintf(stderr, "engine: %.3f s, speedup %.1fx, %s (%d differences)\n", engineSeconds,
+		engineSeconds / std::max(recordSeconds + computeSeconds, 1e-9), differences == 0 ? "identical" : "MISMATCH", differences);
+
+	return differences == 0 ? 0 : 1;
+}
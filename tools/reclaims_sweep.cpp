@@ -0,0 +1,396 @@
+/*
+ * @file reclaims_sweep.cpp
+ * @brief Offline parameter sweep over "Threshold tick size" and "Max active reclaims".
+ *
+ * The trades of a .scid file are decoded once and shared by every configuration of the grid. The
+ * configurations run on a work stealing pool, one engine each, and the tool writes one row of
+ * statistics per configuration: reclaims created, reclaimed and evicted, reclaim rate and the
+ * distribution of the time between the creation of a reclaim and its reclaim.
+ *
+ * Build (Linux):
+ *   g++ -O2 -std=c++17 -I.. -o reclaims_sweep reclaims_sweep.cpp -lpthread
+ *
+ * Usage:
+ *   reclaims_sweep <file.scid> --tick-size <ticksize> [--thresholds 1:10] [--max-reclaims 100]
+ *                  [--bar-seconds 60] [--update-on-bar-close] [--threads 0] [--output file.csv]
+ *                  [--binary file.bin]
+ *
+ * Lists are either comma separated ("50,100,200") or ranges ("first:last" or "first:last:step").
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "reclaims_pool.h"
+#include "reclaims_scid.h"
+
+/**
+ * @struct SweepOptions
+ * @brief Command line options of the sweep tool.
+ */
+struct SweepOptions
+{
+	const char *ScidPath;
+	const char *OutputPath;
+	const char *BinaryPath;
+	float TickSize;
+	int BarPeriodSeconds;
+	bool UpdateOnBarClose;
+	int Threads;
+	std::vector<int> Thresholds;
+	std::vector<int> MaxReclaims;
+};
+
+/**
+ * @struct SweepStats
+ * @brief Statistics of one configuration. Also the record layout of the binary output (80 bytes).
+ */
+struct SweepStats
+{
+	int32_t NewReclaimThreshold;
+	int32_t MaxNumberOfReclaims;
+
+	int64_t Created;
+	int64_t Reclaimed;
+	int64_t Evicted;
+	int64_t Active; // still active after the last trade
+
+	/**
+	 * @brief Reclaimed / created.
+	 */
+	double ReclaimRate;
+
+	/**
+	 * @brief Seconds between the start of a reclaim and the bar of its reclaim.
+	 */
+	double MeanLifetime;
+	double MedianLifetime;
+	double P90Lifetime;
+	double P99Lifetime;
+};
+
+/**
+ * @struct SweepFileHeader
+ * @brief Header of the binary output, followed by `Count` `SweepStats` records.
+ */
+struct SweepFileHeader
+{
+	char Magic[4]; // "FCSW"
+	uint32_t Version;
+	uint32_t RecordSize;
+	uint32_t Count;
+};
+
+/**
+ * @class LifetimeListener
+ * @brief Counts the lifecycle events of the reclaims and records the lifetime of every reclaimed one.
+ */
+class LifetimeListener : public ReclaimListener
+{
+public:
+	LifetimeListener()
+		: CurrentDateTime(0)
+		, Created(0)
+		, Evicted(0)
+	{
+	}
+
+	void OnReclaimCreated(Reclaim &) { Created++; }
+
+	void OnReclaimReclaimed(const Reclaim &reclaim)
+	{
+		Lifetimes.push_back((float)((CurrentDateTime - reclaim.StartDate) * 86400.0));
+	}
+
+	void OnReclaimEvicted(const Reclaim &) { Evicted++; }
+
+	/**
+	 * @brief Start time of the bar of the trade being processed.
+	 */
+	double CurrentDateTime;
+
+	int64_t Created;
+	int64_t Evicted;
+	std::vector<float> Lifetimes;
+};
+
+/**
+ * @brief Prints the command line usage.
+ */
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: reclaims_sweep <file.scid> --tick-size <ticksize> [--thresholds 1:10] [--max-reclaims 100]\n"
+		"                      [--bar-seconds 60] [--update-on-bar-close] [--threads 0]\n"
+		"                      [--output file.csv] [--binary file.bin]\n");
+}
+
+/**
+ * @brief Parses "a,b,c", "first:last" or "first:last:step" into a list of positive values.
+ */
+static bool ParseList(const char *text, std::vector<int> &values)
+{
+	values.clear();
+
+	int first = 0, last = 0, step = 1;
+	int fields = sscanf(text, "%d:%d:%d", &first, &last, &step);
+	if (fields >= 2 && strchr(text, ':') != NULL)
+	{
+		if (step < 1 || first > last)
+			return false;
+		for (int value = first; value <= last; value += step)
+			values.push_back(value);
+	}
+	else
+	{
+		for (const char *field = text; field != NULL; field = strchr(field, ','))
+		{
+			if (*field == ',')
+				field++;
+			values.push_back(atoi(field));
+		}
+	}
+
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		if (values[i] < 1)
+			return false;
+	}
+	return !values.empty();
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * @return `true` if the options are valid, otherwise `false`.
+ */
+static bool ParseOptions(int argc, char **argv, SweepOptions &options)
+{
+	options.ScidPath = NULL;
+	options.OutputPath = NULL;
+	options.BinaryPath = NULL;
+	options.TickSize = 0;
+	options.BarPeriodSeconds = 60;
+	options.UpdateOnBarClose = false;
+	options.Threads = 0;
+	options.Thresholds.assign(1, 2);
+	options.MaxReclaims.assign(1, 100);
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tick-size") == 0 && hasValue)
+			options.TickSize = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--thresholds") == 0 && hasValue)
+		{
+			if (!ParseList(argv[++i], options.Thresholds))
+				return false;
+		}
+		else if (strcmp(argv[i], "--max-reclaims") == 0 && hasValue)
+		{
+			if (!ParseList(argv[++i], options.MaxReclaims))
+				return false;
+		}
+		else if (strcmp(argv[i], "--bar-seconds") == 0 && hasValue)
+			options.BarPeriodSeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--update-on-bar-close") == 0)
+			options.UpdateOnBarClose = true;
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.Threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+			options.OutputPath = argv[++i];
+		else if (strcmp(argv[i], "--binary") == 0 && hasValue)
+			options.BinaryPath = argv[++i];
+		else if (argv[i][0] != '-' && options.ScidPath == NULL)
+			options.ScidPath = argv[i];
+		else
+			return false;
+	}
+
+	return options.ScidPath != NULL
+		&& options.TickSize > 0
+		&& options.BarPeriodSeconds >= 0
+		&& options.Threads >= 0;
+}
+
+/**
+ * @brief Returns the value below which `fraction` of the sorted values are.
+ */
+static double Percentile(const std::vector<float> &sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0;
+	return sorted[(size_t)(fraction * (sorted.size() - 1) + 0.5)];
+}
+
+/**
+ * @brief Runs one configuration over the decoded trades.
+ */
+static void RunConfiguration(const std::vector<ScidTrade> &trades, const std::vector<double> &barStartTimes,
+	const ReclaimSettings &settings, SweepStats &stats)
+{
+	ReclaimEngine engine;
+	engine.Reset(settings);
+
+	LifetimeListener listener;
+	int32_t barIndex = -1;
+
+	for (size_t i = 0; i < trades.size(); i++)
+	{
+		const ScidTrade &trade = trades[i];
+		listener.CurrentDateTime = barStartTimes[trade.BarIndex];
+		engine.ProcessTrade(trade.Price, trade.Volume, listener.CurrentDateTime, trade.BarIndex != barIndex, &listener);
+		barIndex = trade.BarIndex;
+	}
+
+	stats.NewReclaimThreshold = settings.NewReclaimThreshold;
+	stats.MaxNumberOfReclaims = settings.MaxNumberOfReclaims;
+	stats.Created = listener.Created;
+	stats.Reclaimed = (int64_t)listener.Lifetimes.size();
+	stats.Evicted = listener.Evicted;
+
+	stats.Active = 0;
+	for (int i = 0; i < engine.GetSize(); i++)
+		stats.Active += (engine.GetUpReclaims()[i].Deleted ? 0 : 1) + (engine.GetDownReclaims()[i].Deleted ? 0 : 1);
+
+	stats.ReclaimRate = stats.Created > 0 ? (double)stats.Reclaimed / stats.Created : 0;
+
+	std::vector<float> &lifetimes = listener.Lifetimes;
+	std::sort(lifetimes.begin(), lifetimes.end());
+
+	double total = 0;
+	for (size_t i = 0; i < lifetimes.size(); i++)
+		total += lifetimes[i];
+
+	stats.MeanLifetime = lifetimes.empty() ? 0 : total / lifetimes.size();
+	stats.MedianLifetime = Percentile(lifetimes, 0.5);
+	stats.P90Lifetime = Percentile(lifetimes, 0.9);
+	stats.P99Lifetime = Percentile(lifetimes, 0.99);
+}
+
+/**
+ * @brief Writes the statistics as CSV.
+ */
+static void WriteCsv(FILE *file, const std::vector<SweepStats> &results)
+{
+	fprintf(file, "threshold,max_reclaims,created,reclaimed,evicted,active,reclaim_rate,"
+		"mean_lifetime_s,median_lifetime_s,p90_lifetime_s,p99_lifetime_s\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const SweepStats &stats = results[i];
+		fprintf(file, "%d,%d,%lld,%lld,%lld,%lld,%.6f,%.1f,%.1f,%.1f,%.1f\n", stats.NewReclaimThreshold, stats.MaxNumberOfReclaims,
+			(long long)stats.Created, (long long)stats.Reclaimed, (long long)stats.Evicted, (long long)stats.Active,
+			stats.ReclaimRate, stats.MeanLifetime, stats.MedianLifetime, stats.P90Lifetime, stats.P99Lifetime);
+	}
+}
+
+/**
+ * @brief Writes the statistics as a `SweepFileHeader` followed by the `SweepStats` records.
+ */
+static bool WriteBinary(const char *path, const std::vector<SweepStats> &results)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	SweepFileHeader header;
+	memcpy(header.Magic, "FCSW", 4);
+	header.Version = 1;
+	header.RecordSize = sizeof(SweepStats);
+	header.Count = (uint32_t)results.size();
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(results.data(), sizeof(SweepStats), results.size(), file) == results.size();
+	return fclose(file) == 0 && written;
+}
+
+int main(int argc, char **argv)
+{
+	SweepOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ScidFile scidFile;
+	if (!scidFile.Open(options.ScidPath))
+	{
+		fprintf(stderr, "unable to read %s\n", options.ScidPath);
+		return 1;
+	}
+
+	// decode once, every configuration reads the same trades
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<ScidTrade> trades;
+	std::vector<double> barStartTimes;
+	trades.reserve((size_t)scidFile.GetRecordCount());
+
+	FixedPeriodBarClock clock(options.BarPeriodSeconds);
+	DecodeScidTrades(scidFile.GetRecords(), 0, scidFile.GetRecordCount(), clock, trades, barStartTimes);
+	scidFile.Close();
+
+	double decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<ReclaimSettings> configurations;
+	for (size_t i = 0; i < options.MaxReclaims.size(); i++)
+	{
+		for (size_t j = 0; j < options.Thresholds.size(); j++)
+		{
+			ReclaimSettings settings;
+			settings.MaxNumberOfReclaims = options.MaxReclaims[i];
+			settings.NewReclaimThreshold = options.Thresholds[j];
+			settings.TickSize = options.TickSize;
+			settings.UpdateOnBarClose = options.UpdateOnBarClose;
+			settings.AdaptiveThresholdBars = 0;
+			settings.AdaptiveThresholdFactor = 0;
+			configurations.push_back(settings);
+		}
+	}
+
+	std::vector<SweepStats> results(configurations.size());
+	WorkStealingPool pool(options.Threads);
+
+	start = std::chrono::steady_clock::now();
+	pool.Run((int)configurations.size(), [&](int task, int) {
+		RunConfiguration(trades, barStartTimes, configurations[task], results[task]);
+	});
+	double sweepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(stderr, "%zu trades decoded in %.3f s, %zu configurations on %d threads in %.3f s (%.1f M trades/s)\n",
+		trades.size(), decodeSeconds, configurations.size(), pool.GetThreadCount(), sweepSeconds,
+		sweepSeconds > 0 ? trades.size() * (double)configurations.size() / sweepSeconds / 1e6 : 0.0);
+
+	if (options.BinaryPath != NULL && !WriteBinary(options.BinaryPath, results))
+	{
+		fprintf(stderr, "unable to write %s\n", options.BinaryPath);
+		return 1;
+	}
+
+	if (options.OutputPath != NULL)
+	{
+		FILE *file = fopen(options.OutputPath, "w");
+		if (file == NULL)
+		{
+			fprintf(stderr, "unable to write %s\n", options.OutputPath);
+			return 1;
+		}
+		WriteCsv(file, results);
+		fclose(file);
+	}
+	else if (options.BinaryPath == NULL)
+	{
+		WriteCsv(stdout, results);
+	}
+
+	return 0;
+}
@@ -0,0 +1,359 @@
+/*
+ * @file reclaims_synthetic.h
+ * @brief Seeded synthetic trade streams for the reclaim engine benchmarks.
+ *
+ * `SyntheticMarket` generates trades from a mid price process (geometric Brownian motion, mean
+ * reverting, jump diffusion or a flat mid with bid/ask bounce), with Poisson trade arrivals at a
+ * given rate, prices on the tick grid at the bid or the ask, and optional session gaps and flash
+ * crashes. The same seed always gives the same trades. The trades can be fed to the engine as they
+ * are generated or written to a .scid file with `ToScidRecord`.
+ *
+ * @license MIT License (see reclaims.cpp)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdint.h>
+#include <string.h>
+
+#include "reclaims_scid.h"
+
+/**
+ * @brief Processes of the mid price.
+ */
+enum SyntheticModel
+{
+	SYNTHETIC_GBM = 0,            // geometric Brownian motion with drift
+	SYNTHETIC_MEAN_REVERTING = 1, // Ornstein-Uhlenbeck on the log price, around the start price
+	SYNTHETIC_JUMP_DIFFUSION = 2, // geometric Brownian motion with Poisson jumps
+	SYNTHETIC_BOUNCE = 3          // flat mid, the trades bounce between the bid and the ask
+};
+
+/**
+ * @struct SyntheticMarketSettings
+ * @brief Parameters of a synthetic market. Rates and volatilities are per day of trading.
+ */
+struct SyntheticMarketSettings
+{
+	SyntheticModel Model;
+	uint64_t Seed;
+
+	double StartPrice;
+	float TickSize;
+
+	/**
+	 * @brief SCDateTime of the first session start, in days since 1899-12-30.
+	 */
+	double StartDateTime;
+
+	/**
+	 * @brief Length of each daily session in seconds, 86400 for a continuous market.
+	 */
+	double SessionSeconds;
+
+	/**
+	 * @brief Average number of trades per second, the arrivals are a Poisson process.
+	 */
+	double TradesPerSecond;
+
+	/**
+	 * @brief Standard deviation of the log mid price over one day of trading.
+	 */
+	double Volatility;
+
+	/**
+	 * @brief Expected log return over one day of trading (trend).
+	 */
+	double Drift;
+
+	/**
+	 * @brief Speed of the pull toward the start price per day, for `SYNTHETIC_MEAN_REVERTING`.
+	 */
+	double MeanReversion;
+
+	/**
+	 * @brief Average number of jumps per day and standard deviation of their log size, for `SYNTHETIC_JUMP_DIFFUSION`.
+	 */
+	double JumpsPerDay;
+	double JumpSize;
+
+	/**
+	 * @brief Standard deviation of the log gap between the close of a session and the next open.
+	 */
+	double GapSize;
+
+	/**
+	 * @brief Average number of flash crashes per day, their depth as a fraction of the price and
+	 *        the seconds to the bottom. The price recovers in the same time.
+	 */
+	double FlashCrashesPerDay;
+	double FlashCrashDepth;
+	double FlashCrashSeconds;
+
+	/**
+	 * @brief Spread in ticks and probability that a trade is on the other side than the previous one.
+	 *
+	 * 0.5 gives independent sides, higher values the alternating prints of a bouncing market.
+	 */
+	int SpreadTicks;
+	double BounceProbability;
+
+	/**
+	 * @brief Largest trade volume, volumes are uniform from 1.
+	 */
+	uint32_t MaxVolume;
+};
+
+/**
+ * @struct SyntheticTrade
+ * @brief A generated trade.
+ */
+struct SyntheticTrade
+{
+	double DateTime; // SCDateTime, days since 1899-12-30
+	float Price;
+	float Bid;
+	float Ask;
+	uint32_t Volume;
+	bool AtAsk; // bought at the ask, otherwise sold at the bid
+};
+
+/**
+ * @class SyntheticMarket
+ * @brief Generates the trades of a synthetic market one by one.
+ */
+class SyntheticMarket
+{
+public:
+	SyntheticMarket()
+		: m_Time(0)
+		, m_LogMid(0)
+		, m_CrashStart(-1)
+		, m_AtAsk(false)
+	{
+		memset(&m_Settings, 0, sizeof(m_Settings));
+	}
+
+	/**
+	 * @brief Fills the settings with the parameters of a named market regime.
+	 *
+	 * - `trend`: strong drift, few reclaims are reclaimed.
+	 * - `chop`: tight mean reversion, reclaims are created and reclaimed constantly.
+	 * - `gaps`: short sessions with large opening gaps, every reclaim on one side is reclaimed at once.
+	 * - `crash`: flash crashes of 5% that recover within minutes.
+	 * - `jumps`: jump diffusion.
+	 * - `bounce`: flat mid price, trades alternating between the bid and the ask.
+	 *
+	 * @return `false` if the regime is unknown.
+	 */
+	static bool GetRegimeSettings(const char *regime, SyntheticMarketSettings &settings)
+	{
+		memset(&settings, 0, sizeof(settings));
+		settings.Seed = 1;
+		settings.StartPrice = 4000;
+		settings.TickSize = 0.25f;
+		settings.StartDateTime = 45000;
+		settings.SessionSeconds = 86400;
+		settings.TradesPerSecond = 50;
+		settings.Model = SYNTHETIC_GBM;
+		settings.Volatility = 0.012;
+		settings.SpreadTicks = 1;
+		settings.BounceProbability = 0.5;
+		settings.MaxVolume = 10;
+
+		if (strcmp(regime, "trend") == 0)
+		{
+			settings.Drift = 0.04;
+			settings.Volatility = 0.008;
+		}
+		else if (strcmp(regime, "chop") == 0)
+		{
+			settings.Model = SYNTHETIC_MEAN_REVERTING;
+			settings.MeanReversion = 200;
+		}
+		else if (strcmp(regime, "gaps") == 0)
+		{
+			settings.SessionSeconds = 6.5 * 3600;
+			settings.GapSize = 0.015;
+		}
+		else if (strcmp(regime, "crash") == 0)
+		{
+			settings.FlashCrashesPerDay = 2;
+			settings.FlashCrashDepth = 0.05;
+			settings.FlashCrashSeconds = 120;
+		}
+		else if (strcmp(regime, "jumps") == 0)
+		{
+			settings.Model = SYNTHETIC_JUMP_DIFFUSION;
+			settings.JumpsPerDay = 30;
+			settings.JumpSize = 0.004;
+		}
+		else if (strcmp(regime, "bounce") == 0)
+		{
+			settings.Model = SYNTHETIC_BOUNCE;
+			settings.Volatility = 0.001;
+			settings.BounceProbability = 0.85;
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Restarts the market with new settings, at the start of the first session.
+	 */
+	void Reset(const SyntheticMarketSettings &settings)
+	{
+		m_Settings = settings;
+		m_Random.seed(settings.Seed);
+		m_Time = 0;
+		m_LogMid = std::log(settings.StartPrice);
+		m_CrashStart = -1;
+		m_AtAsk = false;
+	}
+
+	/**
+	 * @brief Generates the next trade.
+	 */
+	void Next(SyntheticTrade &trade)
+	{
+		const double sessionSeconds = m_Settings.SessionSeconds > 0 ? std::min(m_Settings.SessionSeconds, 86400.0) : 86400.0;
+		const double secondsPerDay = sessionSeconds;
+
+		// Poisson arrivals, the elapsed time is in seconds of trading
+		double elapsed = std::exponential_distribution<double>(m_Settings.TradesPerSecond > 0 ? m_Settings.TradesPerSecond : 1)(m_Random);
+		double sessionBefore = std::floor(m_Time / sessionSeconds);
+		m_Time += elapsed;
+		double session = std::floor(m_Time / sessionSeconds);
+
+		double dt = elapsed / secondsPerDay;
+		double normal = m_Normal(m_Random);
+		double volatility = m_Settings.Volatility;
+
+		switch (m_Settings.Model)
+		{
+		case SYNTHETIC_MEAN_REVERTING:
+			m_LogMid += -m_Settings.MeanReversion * (m_LogMid - std::log(m_Settings.StartPrice)) * dt + volatility * std::sqrt(dt) * normal;
+			break;
+
+		case SYNTHETIC_JUMP_DIFFUSION:
+			m_LogMid += (m_Settings.Drift - 0.5 * volatility * volatility) * dt + volatility * std::sqrt(dt) * normal;
+			if (m_Uniform(m_Random) < m_Settings.JumpsPerDay * dt)
+				m_LogMid += m_Settings.JumpSize * m_Normal(m_Random);
+			break;
+
+		default:
+			m_LogMid += (m_Settings.Drift - 0.5 * volatility * volatility) * dt + volatility * std::sqrt(dt) * normal;
+			break;
+		}
+
+		// the close to open gaps of the sessions that started since the previous trade
+		if (m_Settings.GapSize > 0)
+		{
+			for (double s = sessionBefore; s < session; s++)
+				m_LogMid += m_Settings.GapSize * m_Normal(m_Random);
+		}
+
+		double logPrice = m_LogMid + GetCrashOffset(dt);
+
+		// quotes on the tick grid around the mid, the trade is at one of them
+		const double tickSize = m_Settings.TickSize;
+		const int spreadTicks = std::max(m_Settings.SpreadTicks, 1);
+		double bidTick = std::floor(std::exp(logPrice) / tickSize - 0.5 * spreadTicks + 0.5);
+		if (bidTick < 1)
+			bidTick = 1;
+
+		if (m_Uniform(m_Random) < m_Settings.BounceProbability)
+			m_AtAsk = !m_AtAsk;
+
+		trade.Bid = (float)(bidTick * tickSize);
+		trade.Ask = (float)((bidTick + spreadTicks) * tickSize);
+		trade.AtAsk = m_AtAsk;
+		trade.Price = m_AtAsk ? trade.Ask : trade.Bid;
+		trade.Volume = 1 + (uint32_t)(m_Random() % std::max(m_Settings.MaxVolume, 1u));
+
+		// the sessions start at the same time of consecutive days
+		double secondsInSession = m_Time - session * sessionSeconds;
+		trade.DateTime = m_Settings.StartDateTime + session + secondsInSession / 86400.0;
+	}
+
+	/**
+	 * @brief Converts a trade to a .scid tick record: Close is the price, High the ask and Low the bid.
+	 */
+	static void ToScidRecord(const SyntheticTrade &trade, ScidRecord &record)
+	{
+		memset(&record, 0, sizeof(record));
+		record.DateTime = DateTimeToScidTime(trade.DateTime);
+		record.Close = trade.Price;
+		record.High = trade.Ask;
+		record.Low = trade.Bid;
+		record.NumTrades = 1;
+		record.TotalVolume = trade.Volume;
+		if (trade.AtAsk)
+			record.AskVolume = trade.Volume;
+		else
+			record.BidVolume = trade.Volume;
+	}
+
+	/**
+	 * @brief Fills the header of a .scid file of tick records.
+	 */
+	static void InitScidHeader(ScidFileHeader &header)
+	{
+		memset(&header, 0, sizeof(header));
+		memcpy(header.FileTypeUniqueHeaderID, "SCID", 4);
+		header.HeaderSize = sizeof(ScidFileHeader);
+		header.RecordSize = sizeof(ScidRecord);
+		header.Version = 1;
+	}
+
+private:
+	/**
+	 * @brief Returns the log price offset of the flash crash in progress, and starts new ones.
+	 *
+	 * The price falls linearly to the depth of the crash and recovers in the same time.
+	 */
+	double GetCrashOffset(double dt)
+	{
+		if (m_Settings.FlashCrashesPerDay <= 0 || m_Settings.FlashCrashSeconds <= 0)
+			return 0;
+
+		if (m_CrashStart < 0)
+		{
+			if (m_Uniform(m_Random) >= m_Settings.FlashCrashesPerDay * dt)
+				return 0;
+			m_CrashStart = m_Time;
+		}
+
+		double progress = (m_Time - m_CrashStart) / m_Settings.FlashCrashSeconds;
+		if (progress >= 2)
+		{
+			m_CrashStart = -1;
+			return 0;
+		}
+
+		double depth = progress < 1 ? progress : 2 - progress;
+		return std::log(1 - m_Settings.FlashCrashDepth * depth);
+	}
+
+	SyntheticMarketSettings m_Settings;
+
+	std::mt19937_64 m_Random;
+	std::normal_distribution<double> m_Normal;
+	std::uniform_real_distribution<double> m_Uniform;
+
+	// seconds of trading since the start, and log mid price without the flash crash
+	double m_Time;
+	double m_LogMid;
+
+	// m_Time when the flash crash in progress started, -1 without one
+	double m_CrashStart;
+
+	bool m_AtAsk;
+};